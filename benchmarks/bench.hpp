@@ -0,0 +1,65 @@
+/*************************************************************************
+ * This file is part of input-overlay
+ * github.con/univrsal/input-overlay
+ * Copyright 2022 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+/* Minimal benchmark runner, each benchmark loops while keep_running() is true
+ * and main.cpp picks the iteration count so a run takes long enough to be
+ * measured. Results are ns per iteration */
+namespace bench {
+class state {
+    uint64_t m_iterations, m_done = 0;
+
+public:
+    explicit state(uint64_t iterations) : m_iterations(iterations) {}
+
+    bool keep_running() { return m_done++ < m_iterations; }
+    uint64_t iterations() const { return m_iterations; }
+};
+
+typedef void (*function)(state &);
+
+struct entry {
+    const char *name;
+    function run;
+};
+
+inline std::vector<entry> &registry()
+{
+    static std::vector<entry> entries;
+    return entries;
+}
+
+struct registrar {
+    registrar(const char *name, function f) { registry().push_back({name, f}); }
+};
+
+/* Keeps the compiler from optimizing away a result */
+template<class T> inline void do_not_optimize(const T &value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+}
+
+#define BENCHMARK(name)                                                  \
+    static void name(bench::state &state);                               \
+    static const bench::registrar name##_registrar(#name, name);         \
+    static void name(bench::state &state)
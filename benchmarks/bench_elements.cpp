@@ -0,0 +1,124 @@
+/*************************************************************************
+ * This file is part of input-overlay
+ * github.con/univrsal/input-overlay
+ * Copyright 2022 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#include "bench.hpp"
+#include "../src/sources/input_source.hpp"
+#include "../src/util/element/element_table.hpp"
+#include "../src/util/sprite_batch.hpp"
+#include <layout_constants.h>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <cstdio>
+#include <memory>
+
+/* Elements of a preset with a fake texture of the layout size, drawing goes
+ * to mock_graphics.cpp */
+struct preset {
+    element_table elements;
+    gs_image_file_t image{};
+    std::unique_ptr<sources::overlay_settings> settings = std::make_unique<sources::overlay_settings>();
+    std::unique_ptr<input_state> input = std::make_unique<input_state>();
+
+    explicit preset(const char *layout)
+    {
+        static char texture;
+        QFile file(QString(IO_PRESET_DIR "/") + layout);
+        if (!file.open(QIODevice::ReadOnly)) {
+            fprintf(stderr, "Couldn't open preset %s\n", layout);
+            return;
+        }
+        const auto obj = QJsonDocument::fromJson(file.readAll()).object();
+        for (const auto element : obj[CFG_ELEMENTS].toArray()) {
+            const auto desc = element::read_desc(element.toObject());
+            if (auto *e = elements.add(static_cast<element_type>(desc.type)))
+                e->load(desc);
+        }
+        image.texture = reinterpret_cast<gs_texture_t *>(&texture);
+        image.cx = uint32_t(obj[CFG_TOTAL_WIDTH].toInt());
+        image.cy = uint32_t(obj[CFG_TOTAL_HEIGHT].toInt());
+        settings->cx = image.cx;
+        settings->cy = image.cy;
+        settings->mouse_sens = 50;
+        settings->input = input.get();
+
+        /* A few held keys and buttons, so some elements draw their pressed state */
+        for (const auto code : {0x1e, 0x1f, 0x20, 0x11})
+            input->keyboard.set(code, true);
+        input->mouse.set(1, true);
+    }
+};
+
+static void tick(bench::state &state, const char *layout)
+{
+    preset p(layout);
+    int16_t x = 0;
+    while (state.keep_running()) {
+        p.input->last_mouse_movement.x = x++;
+        p.elements.tick(1.f / 60.f, p.settings.get());
+    }
+}
+
+static void draw(bench::state &state, const char *layout, bool batched)
+{
+    preset p(layout);
+    sprite_batch batch;
+    while (state.keep_running()) {
+        if (batched)
+            batch.begin(&p.image);
+        p.elements.draw(nullptr, &p.image, p.settings.get());
+        if (batched)
+            batch.end(nullptr);
+    }
+}
+
+BENCHMARK(elements_tick_qwerty)
+{
+    tick(state, "qwerty/qwerty.json");
+}
+
+BENCHMARK(elements_draw_qwerty)
+{
+    draw(state, "qwerty/qwerty.json", true);
+}
+
+BENCHMARK(elements_draw_qwerty_unbatched)
+{
+    draw(state, "qwerty/qwerty.json", false);
+}
+
+BENCHMARK(elements_tick_dualsense)
+{
+    tick(state, "dualsense/dualsense.json");
+}
+
+BENCHMARK(elements_draw_dualsense)
+{
+    draw(state, "dualsense/dualsense.json", true);
+}
+
+BENCHMARK(elements_tick_mouse)
+{
+    tick(state, "mouse/mouse-arrow.json");
+}
+
+BENCHMARK(elements_draw_mouse)
+{
+    draw(state, "mouse/mouse-arrow.json", true);
+}
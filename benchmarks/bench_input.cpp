@@ -0,0 +1,121 @@
+/*************************************************************************
+ * This file is part of input-overlay
+ * github.con/univrsal/input-overlay
+ * Copyright 2022 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#include "bench.hpp"
+#include "../src/util/config.hpp"
+#include "../src/util/input_data.hpp"
+#include "../src/util/input_filter.hpp"
+#include <memory>
+
+static uiohook_event key_event(event_type type, uint16_t keycode)
+{
+    uiohook_event event{};
+    event.type = type;
+    event.data.keyboard.keycode = keycode;
+    return event;
+}
+
+static uiohook_event mouse_event(event_type type, int16_t x, int16_t y)
+{
+    uiohook_event event{};
+    event.type = type;
+    event.data.mouse.x = x;
+    event.data.mouse.y = y;
+    return event;
+}
+
+BENCHMARK(input_data_dispatch_key)
+{
+    auto data = std::make_unique<input_data>();
+    const auto pressed = key_event(EVENT_KEY_PRESSED, 0x1e);
+    const auto released = key_event(EVENT_KEY_RELEASED, 0x1e);
+    uint64_t time = 0;
+    while (state.keep_running()) {
+        data->dispatch_uiohook_event(&pressed, time++);
+        data->dispatch_uiohook_event(&released, time++);
+    }
+    bench::do_not_optimize(data->generation());
+}
+
+BENCHMARK(input_data_dispatch_mouse_move)
+{
+    auto data = std::make_unique<input_data>();
+    auto moved = mouse_event(EVENT_MOUSE_MOVED, 0, 0);
+    uint64_t time = 0;
+    while (state.keep_running()) {
+        moved.data.mouse.x = int16_t(time & 0x3ff);
+        data->dispatch_uiohook_event(&moved, time++);
+    }
+    bench::do_not_optimize(data->generation());
+}
+
+/* The lock free snapshot every source takes once per frame */
+BENCHMARK(input_data_copy)
+{
+    auto data = std::make_unique<input_data>();
+    auto copy = std::make_unique<input_state>();
+    const auto pressed = key_event(EVENT_KEY_PRESSED, 0x1e);
+    data->dispatch_uiohook_event(&pressed, 0);
+    while (state.keep_running()) {
+        data->read(*copy);
+        bench::do_not_optimize(copy->keyboard[0x1e]);
+    }
+}
+
+/* One new event per frame, so every call copies the state and reads the history */
+BENCHMARK(input_cache_get_changed)
+{
+    auto data = std::make_unique<input_data>();
+    const auto pressed = key_event(EVENT_KEY_PRESSED, 0x1e);
+    uint64_t frame = 1;
+    bool refreshed = false;
+    while (state.keep_running()) {
+        data->dispatch_uiohook_event(&pressed, frame);
+        bench::do_not_optimize(input_cache::get("bench", data.get(), frame++, refreshed));
+    }
+}
+
+/* Further sources in the same frame */
+BENCHMARK(input_cache_get_same_frame)
+{
+    auto data = std::make_unique<input_data>();
+    bool refreshed = false;
+    input_cache::get("bench-frame", data.get(), 1, refreshed);
+    while (state.keep_running())
+        bench::do_not_optimize(input_cache::get("bench-frame", data.get(), 1, refreshed));
+}
+
+BENCHMARK(input_filter_disabled)
+{
+    io_config::enable_input_control = false;
+    input_filter filter;
+    while (state.keep_running())
+        bench::do_not_optimize(filter.input_blocked());
+}
+
+/* Every source after the first in a frame gets the cached result */
+BENCHMARK(input_filter_same_frame)
+{
+    io_config::enable_input_control = true;
+    input_filter filter;
+    filter.add_filter("bench window");
+    filter.input_blocked(1);
+    while (state.keep_running())
+        bench::do_not_optimize(filter.input_blocked(1));
+    io_config::enable_input_control = false;
+}
@@ -0,0 +1,118 @@
+/*************************************************************************
+ * This file is part of input-overlay
+ * github.con/univrsal/input-overlay
+ * Copyright 2022 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#include "bench.hpp"
+#include "../src/network/io_client.hpp"
+#include "../src/network/wss_events.hpp"
+#include <messages.hpp>
+#include <cstring>
+
+static wss::event uiohook_wss_event(event_type type, uint32_t bin)
+{
+    wss::event e;
+    e.bits = 1u << bin;
+    e.source = "local";
+    e.uiohook.type = type;
+    e.uiohook.time = 123456;
+    e.uiohook.data.keyboard.keycode = 0x1e;
+    e.uiohook.data.keyboard.rawcode = 0x41;
+    return e;
+}
+
+BENCHMARK(wss_serialize_key_json)
+{
+    const auto e = uiohook_wss_event(EVENT_KEY_PRESSED, wss::BIN_KEY_PRESSED);
+    while (state.keep_running())
+        bench::do_not_optimize(wss::serialize_text(e).size());
+}
+
+BENCHMARK(wss_serialize_mouse_json)
+{
+    auto e = uiohook_wss_event(EVENT_MOUSE_MOVED, wss::BIN_MOUSE_MOVED);
+    int16_t x = 0;
+    while (state.keep_running()) {
+        e.uiohook.data.mouse.x = x++;
+        bench::do_not_optimize(wss::serialize_text(e).size());
+    }
+}
+
+BENCHMARK(wss_serialize_key_binary)
+{
+    const auto e = uiohook_wss_event(EVENT_KEY_PRESSED, wss::BIN_KEY_PRESSED);
+    while (state.keep_running())
+        bench::do_not_optimize(wss::serialize_binary(e).size());
+}
+
+BENCHMARK(io_client_read_uiohook)
+{
+    network::io_client client("bench", nullptr);
+    uiohook_event event{};
+    event.type = EVENT_KEY_PRESSED;
+    event.data.keyboard.keycode = 0x1e;
+
+    buffer buf;
+    while (state.keep_running()) {
+        /* Copying 40 bytes back in is nothing compared to the dispatch */
+        buf.assign(&event, sizeof(event));
+        bench::do_not_optimize(client.read_event(buf, network::MSG_UIOHOOK_EVENT));
+    }
+}
+
+/* A full gamepad state like the one sent every GAMEPAD_KEYFRAME_INTERVAL */
+BENCHMARK(io_client_read_gamepad)
+{
+    network::io_client client("bench", nullptr);
+    static const char name[] = "bench pad";
+    buffer connect;
+    connect.write<uint8_t>(0);
+    connect.write<uint16_t>(uint16_t(strlen(name)));
+    connect.write(name, strlen(name));
+    client.read_event(connect, network::MSG_GAMEPAD_CONNECTED);
+
+    buffer input;
+    input.write<uint8_t>(0);
+    input.write<uint8_t>(15);
+    for (uint16_t i = 0; i < 15; i++) {
+        input.write<uint16_t>(i);
+        input.write<uint16_t>(i & 1);
+    }
+    input.write<uint8_t>(6);
+    for (uint16_t i = 0; i < 6; i++) {
+        input.write<uint16_t>(i);
+        input.write<float>(i * 0.1f);
+    }
+    const auto times = input.write_pos();
+    for (int i = 0; i < 2; i++) {
+        input.write<uint16_t>(0);
+        input.write<float>(0.5f);
+        input.write<uint64_t>(0);
+    }
+
+    buffer buf;
+    uint64_t time = 1;
+    const auto event_size = sizeof(uint16_t) + sizeof(float) + sizeof(uint64_t);
+    while (state.keep_running()) {
+        /* Newer event times, otherwise the last events are skipped */
+        for (size_t i = 0; i < 2; i++) {
+            memcpy(&input[times + i * event_size + sizeof(uint16_t) + sizeof(float)], &time, sizeof(time));
+        }
+        time++;
+        buf.assign(input.get(), input.write_pos());
+        bench::do_not_optimize(client.read_event(buf, network::MSG_GAMEPAD_EVENT));
+    }
+}
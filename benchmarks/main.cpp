@@ -0,0 +1,64 @@
+/*************************************************************************
+ * This file is part of input-overlay
+ * github.con/univrsal/input-overlay
+ * Copyright 2022 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#include "bench.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+/* Usage: input-overlay-bench [filter], only benchmarks containing filter run */
+
+using clock_type = std::chrono::steady_clock;
+
+static double run(const bench::entry &e, uint64_t iterations)
+{
+    bench::state state(iterations);
+    const auto start = clock_type::now();
+    e.run(state);
+    return std::chrono::duration<double, std::nano>(clock_type::now() - start).count();
+}
+
+int main(int argc, char **argv)
+{
+    const char *filter = argc > 1 ? argv[1] : nullptr;
+    printf("%-40s %14s %12s\n", "benchmark", "ns/iteration", "iterations");
+
+    for (const auto &e : bench::registry()) {
+        if (filter && !strstr(e.name, filter))
+            continue;
+
+        /* Grow until one run takes at least 50 ms, then measure three runs
+         * of about 200 ms and keep the fastest */
+        uint64_t iterations = 1;
+        auto elapsed = run(e, iterations);
+        while (elapsed < 50e6 && iterations < (1ull << 40)) {
+            iterations *= 2;
+            elapsed = run(e, iterations);
+        }
+        iterations = uint64_t(iterations * (200e6 / elapsed)) + 1;
+
+        auto best = run(e, iterations) / iterations;
+        for (int i = 1; i < 3; i++) {
+            const auto per_iteration = run(e, iterations) / iterations;
+            if (per_iteration < best)
+                best = per_iteration;
+        }
+        printf("%-40s %14.1f %12llu\n", e.name, best, (unsigned long long)iterations);
+    }
+    return 0;
+}
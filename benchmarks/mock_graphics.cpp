@@ -0,0 +1,129 @@
+/*************************************************************************
+ * This file is part of input-overlay
+ * github.con/univrsal/input-overlay
+ * Copyright 2022 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+/* Stand-ins for the graphics calls of libobs, so elements and sprite batches
+ * can be benchmarked without OBS running. Definitions in the executable take
+ * precedence over the ones in libobs. They don't do anything apart from
+ * keeping the vertex buffer data around, which the sprite batch writes to */
+
+#include <obs-module.h>
+#include <graphics/graphics.h>
+#include <util/bmem.h>
+
+namespace mock_graphics {
+/* Opaque handles only have to be distinct and non-null */
+static char texture, texrender, param;
+uint64_t frame_time = 0;
+uint64_t draw_calls = 0;
+}
+
+struct gs_vertex_buffer {
+    struct gs_vb_data *data;
+};
+
+extern "C" {
+void obs_enter_graphics(void) {}
+void obs_leave_graphics(void) {}
+
+uint64_t obs_get_video_frame_time(void)
+{
+    return mock_graphics::frame_time;
+}
+
+gs_eparam_t *gs_effect_get_param_by_name(const gs_effect_t *, const char *)
+{
+    return reinterpret_cast<gs_eparam_t *>(&mock_graphics::param);
+}
+
+void gs_effect_set_texture(gs_eparam_t *, gs_texture_t *) {}
+void gs_matrix_push(void) {}
+void gs_matrix_pop(void) {}
+void gs_matrix_translate3f(float, float, float) {}
+void gs_matrix_rotaa4f(float, float, float, float) {}
+void gs_ortho(float, float, float, float, float, float) {}
+void gs_clear(uint32_t, const struct vec4 *, float, uint8_t) {}
+void gs_blend_state_push(void) {}
+void gs_blend_state_pop(void) {}
+void gs_blend_function(enum gs_blend_type, enum gs_blend_type) {}
+void gs_blend_function_separate(enum gs_blend_type, enum gs_blend_type, enum gs_blend_type, enum gs_blend_type) {}
+
+void gs_draw_sprite(gs_texture_t *, uint32_t, uint32_t, uint32_t)
+{
+    mock_graphics::draw_calls++;
+}
+
+void gs_draw_sprite_subregion(gs_texture_t *, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t)
+{
+    mock_graphics::draw_calls++;
+}
+
+void gs_draw(enum gs_draw_mode, uint32_t, uint32_t)
+{
+    mock_graphics::draw_calls++;
+}
+
+gs_texrender_t *gs_texrender_create(enum gs_color_format, enum gs_zstencil_format)
+{
+    return reinterpret_cast<gs_texrender_t *>(&mock_graphics::texrender);
+}
+
+void gs_texrender_destroy(gs_texrender_t *) {}
+
+bool gs_texrender_begin(gs_texrender_t *, uint32_t, uint32_t)
+{
+    return true;
+}
+
+void gs_texrender_end(gs_texrender_t *) {}
+void gs_texrender_reset(gs_texrender_t *) {}
+
+gs_texture_t *gs_texrender_get_texture(const gs_texrender_t *)
+{
+    return reinterpret_cast<gs_texture_t *>(&mock_graphics::texture);
+}
+
+gs_texture_t *gs_texture_create(uint32_t, uint32_t, enum gs_color_format, uint32_t, const uint8_t **, uint32_t)
+{
+    return reinterpret_cast<gs_texture_t *>(&mock_graphics::texture);
+}
+
+void gs_texture_destroy(gs_texture_t *) {}
+
+gs_vertbuffer_t *gs_vertexbuffer_create(struct gs_vb_data *data, uint32_t)
+{
+    return new gs_vertex_buffer{data};
+}
+
+void gs_vertexbuffer_destroy(gs_vertbuffer_t *buffer)
+{
+    if (!buffer)
+        return;
+    gs_vbdata_destroy(buffer->data);
+    delete buffer;
+}
+
+void gs_vertexbuffer_flush(gs_vertbuffer_t *) {}
+
+struct gs_vb_data *gs_vertexbuffer_get_data(const gs_vertbuffer_t *buffer)
+{
+    return buffer->data;
+}
+
+void gs_load_vertexbuffer(gs_vertbuffer_t *) {}
+void gs_load_indexbuffer(gs_indexbuffer_t *) {}
+}
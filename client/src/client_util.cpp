@@ -20,6 +20,8 @@
 #include "gamepad_helper.hpp"
 #include "network.hpp"
 #include "uiohook_helper.hpp"
+#include "load_generator.hpp"
+#include <socket_options.hpp>
 #include <cstdio>
 #include <cstdlib>
 #include <string>
@@ -41,6 +43,31 @@ using namespace std::chrono;
 namespace util {
 config cfg;
 
+/* host[:port], the port of the main server is used if there's none */
+static bool parse_mirror(const std::string &value)
+{
+    server mirror;
+    auto host = value;
+    auto port = cfg.port;
+    const auto colon = value.rfind(':');
+    if (colon != std::string::npos) {
+        host = value.substr(0, colon);
+        port = uint16_t(strtol(value.substr(colon + 1).c_str(), nullptr, 0));
+    }
+    mirror.host = host + ":" + std::to_string(port);
+
+    if (host.empty() || port <= 1024) {
+        DEBUG_LOG("Invalid mirror '%s'", value.c_str());
+        return false;
+    }
+    if (netlib_resolve_host(&mirror.ip, host.c_str(), port) == -1) {
+        DEBUG_LOG("netlib_resolve_host failed for mirror %s: %s", value.c_str(), netlib_get_error());
+        return false;
+    }
+    cfg.mirrors.emplace_back(mirror);
+    return true;
+}
+
 bool parse_arguments(int argc, char **args)
 {
     if (argc < 3) {
@@ -52,6 +79,26 @@ bool parse_arguments(int argc, char **args)
         DEBUG_LOG(" --gamepad=1   enable/disable gamepad monitoring. Off by default");
         DEBUG_LOG(" --mouse=1     enable/disable mouse monitoring.  Off by default");
         DEBUG_LOG(" --keyboard=1  enable/disable keyboard monitoring. On by default");
+        DEBUG_LOG(" --mouse_rate=250 only send the newest mouse position up to this many times per second.");
+        DEBUG_LOG("               Presses and scrolling are always sent. Off (0) by default");
+        DEBUG_LOG(" --pad_idle_poll=8 poll gamepads every n ms once they weren't used for a while, 0 disables.");
+        DEBUG_LOG(" --pad_deadband=2 percent around the stick centre that counts as zero, 0 disables.");
+        DEBUG_LOG(" --pad_step=1  percent an axis has to move before it is sent again, 0 disables.");
+        DEBUG_LOG(" --flush_interval=5 hold back mouse and stick motion for up to this many ms, so it is");
+        DEBUG_LOG("               batched. Presses are always sent right away. Off (0) by default");
+        DEBUG_LOG(" --send_buffer=65536 socket send buffer size in bytes, 0 uses the system default");
+        DEBUG_LOG(" --mirror=ip[:port] also send all input to this server, can be used more than once.");
+        DEBUG_LOG("               The hooks only run once, every server gets its own connection");
+        DEBUG_LOG(" --latency_report=10 print how long input waited between the hook and the socket every");
+        DEBUG_LOG("               n seconds. Off (0) by default, SIGUSR1 prints it on demand");
+        DEBUG_LOG(" --reconnect=0 exit instead of reconnecting when the connection is lost. On by default");
+        DEBUG_LOG(" --load=4      don't hook anything, send synthetic input from this many connections instead.");
+        DEBUG_LOG("               Used for stress testing, other load options:");
+        DEBUG_LOG("   --load_mouse=1000 mouse moves per second and connection");
+        DEBUG_LOG("   --load_keys=10    key presses and releases per second and connection");
+        DEBUG_LOG("   --load_pads=1     virtual gamepads per connection with --load_pad_rate=250 updates per second");
+        DEBUG_LOG("   --load_time=0     stop after this many seconds, 0 runs until interrupted");
+        DEBUG_LOG(" --udp         send keyboard and mouse input over udp, TCP is still used for everything else");
         DEBUG_LOG(" --dinput      use direct input on windows. XInput is default");
         return false;
     }
@@ -59,6 +106,21 @@ bool parse_arguments(int argc, char **args)
     cfg.monitor_gamepad = false;
     cfg.monitor_keyboard = true;
     cfg.monitor_mouse = false;
+    cfg.mouse_rate = 0;
+    cfg.use_udp = false;
+    cfg.flush_interval = 0;
+    cfg.send_buffer = SOCKET_SEND_BUFFER;
+    cfg.pad_idle_poll = 8;
+    cfg.pad_deadband = 2;
+    cfg.pad_step = 1;
+    cfg.reconnect = true;
+    cfg.latency_report = 0;
+    cfg.load_connections = 0;
+    cfg.load_mouse_rate = 1000;
+    cfg.load_key_rate = 10;
+    cfg.load_pads = 1;
+    cfg.load_pad_rate = 250;
+    cfg.load_time = 0;
     cfg.port = 1608;
 
     auto const s = sizeof(cfg.username);
@@ -74,7 +136,8 @@ bool parse_arguments(int argc, char **args)
     }
 
     /* Resolve ip */
-    if (netlib_resolve_host(&cfg.ip, args[1], cfg.port) == -1) {
+    cfg.primary.host = std::string(args[1]) + ":" + std::to_string(cfg.port);
+    if (netlib_resolve_host(&cfg.primary.ip, args[1], cfg.port) == -1) {
         DEBUG_LOG("netlib_resolve_host failed: %s", netlib_get_error());
         DEBUG_LOG("Make sure obs studio is running with the remote connection enabled and configured");
         return false;
@@ -84,7 +147,43 @@ bool parse_arguments(int argc, char **args)
     std::string arg;
     for (auto i = 4; i < argc; i++) {
         arg = args[i];
-        if (arg.find("--gamepad") != std::string::npos)
+        const auto value = [&arg] { return strtol(arg.substr(arg.find('=') + 1).c_str(), nullptr, 0); };
+        if (arg.find("--load_mouse=") != std::string::npos)
+            cfg.load_mouse_rate = uint16_t(value());
+        else if (arg.find("--load_keys=") != std::string::npos)
+            cfg.load_key_rate = uint16_t(value());
+        else if (arg.find("--load_pads=") != std::string::npos)
+            cfg.load_pads = uint8_t(value());
+        else if (arg.find("--load_pad_rate=") != std::string::npos)
+            cfg.load_pad_rate = uint16_t(value());
+        else if (arg.find("--load_time=") != std::string::npos)
+            cfg.load_time = uint32_t(value());
+        else if (arg.find("--load=") != std::string::npos)
+            cfg.load_connections = uint16_t(value());
+        else if (arg.find("--mouse_rate=") != std::string::npos)
+            cfg.mouse_rate = uint16_t(strtol(arg.substr(arg.find('=') + 1).c_str(), nullptr, 0));
+        else if (arg.find("--pad_idle_poll=") != std::string::npos)
+            cfg.pad_idle_poll = uint16_t(strtol(arg.substr(arg.find('=') + 1).c_str(), nullptr, 0));
+        else if (arg.find("--pad_deadband=") != std::string::npos)
+            cfg.pad_deadband = uint8_t(value());
+        else if (arg.find("--pad_step=") != std::string::npos)
+            cfg.pad_step = uint8_t(value());
+        else if (arg.find("--send_buffer=") != std::string::npos)
+            cfg.send_buffer = int(value());
+        else if (arg.find("--flush_interval=") != std::string::npos)
+            cfg.flush_interval = uint16_t(strtol(arg.substr(arg.find('=') + 1).c_str(), nullptr, 0));
+        else if (arg.find("--mirror=") != std::string::npos) {
+            if (!parse_mirror(arg.substr(arg.find('=') + 1)))
+                return false;
+        } else if (arg.find("--latency_report=") != std::string::npos)
+            cfg.latency_report = uint16_t(value());
+        else if (arg.find("--reconnect=") != std::string::npos)
+            cfg.reconnect = value() != 0;
+        else if (arg == "--reconnect")
+            cfg.reconnect = true;
+        else if (arg == "--udp")
+            cfg.use_udp = true;
+        else if (arg.find("--gamepad") != std::string::npos)
             cfg.monitor_gamepad = arg.find('1') != std::string::npos;
         else if (arg.find("--mouse") != std::string::npos)
             cfg.monitor_mouse = arg.find('1') != std::string::npos;
@@ -97,13 +196,25 @@ bool parse_arguments(int argc, char **args)
     DEBUG_LOG(" Name:     %s", args[2]);
     DEBUG_LOG(" Keyboard: %s", cfg.monitor_keyboard ? "Yes" : "No");
     DEBUG_LOG(" Mouse:    %s", cfg.monitor_mouse ? "Yes" : "No");
+    if (cfg.monitor_mouse && cfg.mouse_rate)
+        DEBUG_LOG(" Mouse rate: %hu Hz", cfg.mouse_rate);
     DEBUG_LOG(" Gamepad:  %s", cfg.monitor_gamepad ? "Yes" : "No");
+    DEBUG_LOG(" UDP:      %s", cfg.use_udp ? "Yes" : "No");
+    DEBUG_LOG(" Reconnect: %s", cfg.reconnect ? "Yes" : "No");
+    if (cfg.load_connections)
+        DEBUG_LOG(" Load generator: %hu connections", cfg.load_connections);
+    if (cfg.flush_interval)
+        DEBUG_LOG(" Flush interval: %hu ms", cfg.flush_interval);
+    if (cfg.latency_report)
+        DEBUG_LOG(" Latency report: every %hu s", cfg.latency_report);
+    for (const auto &mirror : cfg.mirrors)
+        DEBUG_LOG(" Mirror:   %s", mirror.host.c_str());
 
     return true;
 }
 
 /* https://www.libsdl.org/projects/SDL_net/docs/demos/tcputil.h */
-int send_text(char *buf)
+int send_text(tcp_socket socket, const char *buf)
 {
     uint32_t len, result;
 
@@ -113,7 +224,7 @@ int send_text(char *buf)
     len = strlen(buf) + 1;
     len = netlib_swap_BE32(len);
 
-    result = netlib_tcp_send(network::sock, &len, sizeof(len));
+    result = netlib_tcp_send(socket, &len, sizeof(len));
     if (result < sizeof(len)) {
         if (netlib_get_error() && strlen(netlib_get_error())) {
             DEBUG_LOG("netlib_tcp_send failed: %s", netlib_get_error());
@@ -123,7 +234,7 @@ int send_text(char *buf)
 
     len = netlib_swap_BE32(len);
 
-    result = netlib_tcp_send(network::sock, buf, len);
+    result = netlib_tcp_send(socket, buf, len);
     if (result < len) {
         if (netlib_get_error() && strlen(netlib_get_error())) {
             DEBUG_LOG("netlib_tcp_send failed: %s", netlib_get_error());
@@ -152,13 +263,18 @@ uint32_t get_ticks()
 #endif
 }
 
-network::message recv_msg()
+uint64_t get_time_us()
+{
+    return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+network::message recv_msg(tcp_socket socket)
 {
     uint8_t msg_id;
 
-    const uint32_t read_length = netlib_tcp_recv(network::sock, &msg_id, sizeof(msg_id));
+    const int read_length = netlib_tcp_recv(socket, &msg_id, sizeof(msg_id));
 
-    if (read_length < sizeof(msg_id)) {
+    if (read_length < int(sizeof(msg_id))) {
         if (netlib_get_error() && strlen(netlib_get_error()))
             DEBUG_LOG("netlib_tcp_recv: %s", netlib_get_error());
         return network::MSG_READ_ERROR;
@@ -173,6 +289,7 @@ network::message recv_msg()
 
 void close_all()
 {
+    load::stop();
     libgamepad::stop();
     network::close();
     uiohook::stop();
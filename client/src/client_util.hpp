@@ -24,19 +24,42 @@
 #include <netlib.h>
 #include <messages.hpp>
 #include <gamepad/hook.hpp>
+#include <string>
+#include <vector>
 
 #define DEBUG_LOG(fmt, ...) printf("[%25.25s:%03d]: " fmt "\n", __FUNCTION__, __LINE__, ##__VA_ARGS__)
 #define DEBUG_LOGN(fmt, ...) printf("[%25.25s:%03d]: " fmt, __FUNCTION__, __LINE__, ##__VA_ARGS__)
 
 namespace util {
+struct server {
+    std::string host; /* As given on the command line */
+    ip_address ip;
+};
+
 typedef struct {
     bool monitor_gamepad;
     bool monitor_mouse;
     bool monitor_keyboard;
+    uint16_t mouse_rate; /* Max. mouse movement messages per second, 0 sends all of them */
+    bool use_udp;        /* Send keyboard and mouse input over udp */
+    uint16_t pad_idle_poll;  /* Ms between gamepad polls after PAD_IDLE_DELAY without input, 0 keeps polling fast */
+    uint8_t pad_deadband;    /* Percent around the stick centre that counts as zero */
+    uint8_t pad_step;        /* Percent an axis has to move before it is sent again */
+    uint16_t flush_interval; /* Max. ms motion is held back so it's batched, 0 sends right away */
+    int send_buffer;         /* Socket send buffer in bytes, 0 keeps the system default */
+    bool reconnect;          /* Try to reconnect if the connection is lost */
+    uint16_t latency_report; /* Seconds between hook to wire latency reports, 0 disables them */
+
+    /* Synthetic input instead of hooks, see load_generator.hpp */
+    uint16_t load_connections; /* Zero disables the load generator */
+    uint16_t load_mouse_rate, load_key_rate, load_pad_rate; /* Per second and connection */
+    uint8_t load_pads;                                      /* Virtual gamepads per connection */
+    uint32_t load_time;                                     /* Seconds, zero runs until interrupted */
     char username[64];
     gamepad::hook_type::type gamepad_hook_type;
     uint16_t port;
-    ip_address ip;
+    server primary;
+    std::vector<util::server> mirrors; /* Get the same input as primary, see --mirror */
 } config;
 
 extern config cfg;
@@ -55,11 +78,14 @@ void sleep_ms(uint32_t ms);
 /* Get config values and print help */
 bool parse_arguments(int argc, char **args);
 
-int send_text(char *buf);
+int send_text(tcp_socket socket, const char *buf);
 
 uint32_t get_ticks();
 
-network::message recv_msg();
+/* Monotonic, event times and MSG_TIME_PONG use this clock */
+uint64_t get_time_us();
+
+network::message recv_msg(tcp_socket socket);
 
 void close_all();
 
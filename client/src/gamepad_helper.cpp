@@ -21,12 +21,151 @@
 #include "network.hpp"
 #include "client_util.hpp"
 #include <messages.hpp>
+#include <poll_governor.hpp>
+#include <axis_filter.hpp>
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <vector>
 
 namespace libgamepad {
 
 std::shared_ptr<gamepad::hook> hook_instance;
 std::mutex buffer_mutex;
-buffer buf;
+network::frame_buffer buf;
+
+/* What the server already knows about a device, so only changes have to be sent */
+struct sent_state {
+    std::map<uint16_t, uint16_t> buttons;
+    std::map<uint16_t, float> axis;
+    uint64_t axis_time = 0, button_time = 0;
+    std::chrono::steady_clock::time_point keyframe;
+    bool valid = false;
+};
+static std::map<uint8_t, sent_state> sent; /* Device index to state, buffer_mutex has to be locked */
+
+static std::unique_ptr<poll_governor> governor;
+static std::unique_ptr<axis_filter> axis_noise; /* Stick jitter never reaches the buffer */
+
+static const size_t event_size = sizeof(uint16_t) + sizeof(float) + sizeof(uint64_t);
+
+static void write_event(buffer &buf, const gamepad::input_event *event)
+{
+    buf.write<uint16_t>(event->vc);
+    buf.write<float>(event->virtual_value);
+    buf.write<uint64_t>(event->time);
+}
+
+static void write_keyframe(network::frame_buffer &target, const std::shared_ptr<gamepad::device> &d)
+{
+    auto &out = target.data();
+    target.begin_message(3 * sizeof(uint8_t) + d->get_buttons().size() * 2 * sizeof(uint16_t) + sizeof(uint8_t) +
+                      d->get_axis().size() * (sizeof(uint16_t) + sizeof(float)) + 2 * event_size);
+    out.write<uint8_t>(network::MSG_GAMEPAD_EVENT);
+    out.write<uint8_t>(d->get_index());
+    out.write<uint8_t>(d->get_buttons().size());
+    for (const auto &btn : d->get_buttons()) {
+        out.write<uint16_t>(btn.first);
+        out.write<uint16_t>(btn.second);
+    }
+
+    out.write<uint8_t>(d->get_axis().size());
+    for (const auto &axis : d->get_axis()) {
+        out.write<uint16_t>(axis.first);
+        out.write<float>(axis.second);
+    }
+
+    write_event(out, d->last_axis_event());
+    write_event(out, d->last_button_event());
+    target.end_message();
+}
+
+/* Sends the whole device state and remembers it for later deltas */
+static void write_keyframe(const std::shared_ptr<gamepad::device> &d, sent_state &state)
+{
+    write_keyframe(buf, d);
+    state.valid = true;
+    state.keyframe = std::chrono::steady_clock::now();
+    state.buttons.clear();
+    state.axis.clear();
+    for (const auto &btn : d->get_buttons())
+        state.buttons[btn.first] = btn.second;
+    for (const auto &axis : d->get_axis())
+        state.axis[axis.first] = axis.second;
+    state.axis_time = d->last_axis_event()->time;
+    state.button_time = d->last_button_event()->time;
+}
+
+static void write_connection_event(network::frame_buffer &target, const std::shared_ptr<gamepad::device> &d,
+                                   network::message m)
+{
+    auto &out = target.data();
+    target.begin_message(2 * sizeof(uint8_t) + sizeof(uint16_t) + d->get_id().length());
+    out.write<uint8_t>(m);
+    out.write<uint8_t>(d->get_index());
+    out.write<uint16_t>(d->get_id().length());
+    out.write(d->get_id().c_str(), d->get_id().length());
+    target.end_message();
+}
+
+static void write_delta(const std::shared_ptr<gamepad::device> &d, sent_state &state)
+{
+    std::vector<std::pair<uint16_t, uint16_t>> buttons;
+    std::vector<std::pair<uint16_t, float>> axes;
+    for (const auto &btn : d->get_buttons()) {
+        auto it = state.buttons.find(btn.first);
+        if (it == state.buttons.end() || it->second != uint16_t(btn.second)) {
+            buttons.emplace_back(btn.first, uint16_t(btn.second));
+            state.buttons[btn.first] = btn.second;
+        }
+    }
+    for (const auto &axis : d->get_axis()) {
+        auto it = state.axis.find(axis.first);
+        if (it == state.axis.end() || it->second != axis.second) {
+            axes.emplace_back(axis.first, axis.second);
+            state.axis[axis.first] = axis.second;
+        }
+    }
+
+    uint8_t flags = 0;
+    if (d->last_axis_event()->time != state.axis_time)
+        flags |= GAMEPAD_DELTA_AXIS_EVENT;
+    if (d->last_button_event()->time != state.button_time)
+        flags |= GAMEPAD_DELTA_BUTTON_EVENT;
+    if (buttons.empty() && axes.empty() && !flags)
+        return;
+
+    /* Counts are sent as one byte, which covers every gamepad code */
+    buttons.resize(std::min<size_t>(buttons.size(), 0xff));
+    axes.resize(std::min<size_t>(axes.size(), 0xff));
+
+    auto &out = buf.data();
+    buf.begin_message(4 * sizeof(uint8_t) + buttons.size() * (sizeof(uint16_t) + sizeof(uint8_t)) +
+                      axes.size() * (sizeof(uint16_t) + sizeof(float)) + 2 * event_size);
+    out.write<uint8_t>(network::MSG_GAMEPAD_DELTA);
+    out.write<uint8_t>(d->get_index());
+    out.write<uint8_t>(flags);
+    out.write<uint8_t>(buttons.size());
+    for (const auto &btn : buttons) {
+        out.write<uint16_t>(btn.first);
+        out.write<uint8_t>(btn.second ? 1 : 0);
+    }
+    out.write<uint8_t>(axes.size());
+    for (const auto &axis : axes) {
+        out.write<uint16_t>(axis.first);
+        out.write<float>(axis.second);
+    }
+
+    if (flags & GAMEPAD_DELTA_AXIS_EVENT) {
+        write_event(out, d->last_axis_event());
+        state.axis_time = d->last_axis_event()->time;
+    }
+    if (flags & GAMEPAD_DELTA_BUTTON_EVENT) {
+        write_event(out, d->last_button_event());
+        state.button_time = d->last_button_event()->time;
+    }
+    buf.end_message();
+}
 
 bool start(uint16_t flags)
 {
@@ -34,43 +173,45 @@ bool start(uint16_t flags)
     ::util::sleep_ms(1000);
     hook_instance = gamepad::hook::make(flags);
     hook_instance->set_plug_and_play(true, gamepad::ms(1000));
-    hook_instance->set_sleep_time(gamepad::mcs(600));
+    governor = std::make_unique<poll_governor>(gamepad::mcs(600), gamepad::ms(::util::cfg.pad_idle_poll),
+                                               gamepad::ms(PAD_IDLE_DELAY));
+    hook_instance->set_sleep_time(governor->active());
+    axis_noise = std::make_unique<axis_filter>(::util::cfg.pad_deadband / 100.f, ::util::cfg.pad_step / 100.f);
 
     // try to load bindings, currently the file has to be provided manually
     hook_instance->load_bindings(std::string("./bindings.json"));
 
-    auto input_writer = [](const std::shared_ptr<gamepad::device> d) {
-        std::lock_guard<std::mutex> lock(buffer_mutex);
-        buf.write<uint8_t>(network::MSG_GAMEPAD_EVENT);
-        buf.write<uint8_t>(d->get_index());
-        buf.write<uint8_t>(d->get_buttons().size());
-        for (const auto &btn : d->get_buttons()) {
-            buf.write<uint16_t>(btn.first);
-            buf.write<uint16_t>(btn.second);
-        }
+    auto input_writer = [](const std::shared_ptr<gamepad::device> d, bool urgent) {
+        if (governor->on_input())
+            hook_instance->set_sleep_time(governor->active());
+        const auto captured = ::util::get_time_us();
+        /* Sent in the clock the server syncs to, like the uiohook events */
+        (urgent ? d->last_button_event() : d->last_axis_event())->time = captured / 1000;
+        std::unique_lock<std::mutex> lock(buffer_mutex);
+        auto &state = sent[uint8_t(d->get_index())];
+        const auto now = std::chrono::steady_clock::now();
+        const auto size = buf.data().write_pos();
 
-        buf.write<uint8_t>(d->get_axis().size());
-        for (const auto &axis : d->get_axis()) {
-            buf.write<uint16_t>(axis.first);
-            buf.write<float>(axis.second);
+        if (!state.valid || now - state.keyframe >= std::chrono::milliseconds(GAMEPAD_KEYFRAME_INTERVAL)) {
+            write_keyframe(d, state);
+        } else {
+            write_delta(d, state);
         }
-
-        buf.write<uint16_t>(d->last_axis_event()->vc);
-        buf.write<float>(d->last_axis_event()->virtual_value);
-        buf.write<uint64_t>(d->last_axis_event()->time);
-        buf.write<uint16_t>(d->last_button_event()->vc);
-        buf.write<float>(d->last_button_event()->virtual_value);
-        buf.write<uint64_t>(d->last_button_event()->time);
+        if (buf.data().write_pos() != size)
+            buf.captured(captured);
+        lock.unlock();
+        network::notify(urgent);
     };
 
     auto event_writer = [](const std::shared_ptr<gamepad::device> &d, network::message m) {
+        if (governor->on_input())
+            hook_instance->set_sleep_time(governor->active());
         {
             std::lock_guard<std::mutex> lock(buffer_mutex);
-            buf.write<uint8_t>(m);
-            buf.write<uint8_t>(d->get_index());
-            buf.write<uint16_t>(d->get_id().length());
-            buf.write(d->get_id().c_str(), d->get_id().length());
+            sent[uint8_t(d->get_index())].valid = false; /* Start over with a keyframe */
+            write_connection_event(buf, d, m);
         }
+        network::notify();
 
         const char *state;
         switch (m) {
@@ -86,8 +227,15 @@ bool start(uint16_t flags)
         DEBUG_LOG("Device '%s' %s", d->get_id().c_str(), state);
     };
 
-    hook_instance->set_axis_event_handler(input_writer);
-    hook_instance->set_button_event_handler(input_writer);
+    /* Sticks and triggers are motion, see network::notify */
+    hook_instance->set_axis_event_handler([input_writer](const std::shared_ptr<gamepad::device> &d) {
+        const auto *event = d->last_axis_event();
+        const bool centred = event->vc != gamepad::axis::LEFT_TRIGGER && event->vc != gamepad::axis::RIGHT_TRIGGER;
+        if (axis_noise->pass(uint8_t(d->get_index()), event->vc, event->virtual_value, centred))
+            input_writer(d, false);
+    });
+    hook_instance->set_button_event_handler(
+        [input_writer](const std::shared_ptr<gamepad::device> &d) { input_writer(d, true); });
     hook_instance->set_connect_event_handler(
         [event_writer](const std::shared_ptr<gamepad::device> &d) { event_writer(d, network::MSG_GAMEPAD_CONNECTED); });
     hook_instance->set_reconnect_event_handler([event_writer](const std::shared_ptr<gamepad::device> &d) {
@@ -99,6 +247,38 @@ bool start(uint16_t flags)
     return hook_instance->start();
 }
 
+void check_idle()
+{
+    if (hook_instance && governor && governor->check_idle()) {
+        hook_instance->set_sleep_time(governor->idle());
+        DEBUG_LOG("No gamepad input for a while, polling every %lli us", (long long)governor->idle().count());
+    }
+}
+
+void take(buffer &out, std::vector<uint64_t> &captured, network::frame_buffer *state)
+{
+    if (!state) {
+        std::lock_guard<std::mutex> lock(buffer_mutex);
+        buf.take(out, captured);
+        return;
+    }
+
+    /* Same order as in the hook callbacks */
+    std::unique_lock<std::mutex> hook_lock;
+    if (hook_instance)
+        hook_lock = std::unique_lock<std::mutex>(*hook_instance->get_mutex());
+    std::lock_guard<std::mutex> lock(buffer_mutex);
+    buf.take(out, captured);
+    if (!hook_instance)
+        return;
+    for (const auto &d : hook_instance->get_devices()) {
+        if (!d->is_valid())
+            continue;
+        write_connection_event(*state, d, network::MSG_GAMEPAD_CONNECTED);
+        write_keyframe(*state, d);
+    }
+}
+
 void stop()
 {
     if (hook_instance)
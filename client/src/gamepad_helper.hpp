@@ -18,12 +18,22 @@
 
 #pragma once
 #include <libgamepad.hpp>
-#include <buffer.hpp>
+#include "network.hpp"
 
 namespace libgamepad {
 extern std::shared_ptr<gamepad::hook> hook_instance;
 extern std::mutex buffer_mutex;
-extern buffer buf;
+extern network::frame_buffer buf;
 extern bool start(uint16_t flags);
 extern void stop();
+
+/* Slows down polling once no pad was used for a while, called by the network thread */
+extern void check_idle();
+
+/* Swaps the data of the hook and its capture times (see
+ * network::frame_buffer::captured) into out. If state is set, all connected
+ * gamepads and their current state are written into it as well, for a
+ * server that just connected. Both happen under the same lock, so state
+ * already contains everything that is in out */
+extern void take(buffer &out, std::vector<uint64_t> &captured, network::frame_buffer *state = nullptr);
 }
@@ -20,6 +20,7 @@
 #include "uiohook_helper.hpp"
 #include "gamepad_helper.hpp"
 #include "client_util.hpp"
+#include "load_generator.hpp"
 #include <signal.h>
 #include <stdio.h>
 
@@ -38,10 +39,20 @@ void sig_break__handler(int)
     util::close_all();
 }
 
+#ifdef SIGUSR1
+void sig_usr1__handler(int)
+{
+    network::report_requested = true;
+}
+#endif
+
 int main(int argc, char **argv)
 {
     signal(SIGINT, &sig_int__handler);
     signal(SIGBREAK, &sig_break__handler);
+#ifdef SIGUSR1
+    signal(SIGUSR1, &sig_usr1__handler);
+#endif
 
     if (!util::parse_arguments(argc, argv))
         return util::RET_ARGUMENT_PARSING; /* Invalid arguments */
@@ -51,6 +62,12 @@ int main(int argc, char **argv)
 
     DEBUG_LOG("Network init done.");
 
+    if (util::cfg.load_connections) {
+        const auto result = load::run();
+        netlib_quit();
+        return result;
+    }
+
     if (!util::cfg.monitor_keyboard && !util::cfg.monitor_mouse && !util::cfg.monitor_gamepad) {
         DEBUG_LOG("Nothing to monitor!");
         return util::RET_NO_HOOKS;
@@ -0,0 +1,82 @@
+/*************************************************************************
+ * This file is part of input-overlay
+ * github.con/univrsal/input-overlay
+ * Copyright 2022 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#include "latency_histogram.hpp"
+#include <algorithm>
+
+size_t latency_histogram::bucket(uint64_t value)
+{
+    if (value < 2 * HISTOGRAM_SUB_BUCKETS)
+        return size_t(value);
+
+    int msb = 63;
+    while (!(value >> msb))
+        msb--;
+    /* value >> shift is in [HISTOGRAM_SUB_BUCKETS, 2 * HISTOGRAM_SUB_BUCKETS) */
+    const auto shift = msb - 4;
+    if (shift > HISTOGRAM_MAX_SHIFT)
+        return HISTOGRAM_BUCKETS - 1;
+    return size_t(shift) * HISTOGRAM_SUB_BUCKETS + size_t(value >> shift);
+}
+
+uint64_t latency_histogram::bucket_value(size_t index)
+{
+    if (index < 2 * HISTOGRAM_SUB_BUCKETS)
+        return index;
+    const auto shift = index / HISTOGRAM_SUB_BUCKETS - 1;
+    const auto sub = index % HISTOGRAM_SUB_BUCKETS + HISTOGRAM_SUB_BUCKETS;
+    return ((sub + 1) << shift) - 1;
+}
+
+void latency_histogram::record(uint64_t value)
+{
+    m_counts[bucket(value)].fetch_add(1, std::memory_order_relaxed);
+    auto max = m_max.load(std::memory_order_relaxed);
+    while (value > max && !m_max.compare_exchange_weak(max, value, std::memory_order_relaxed))
+        ;
+}
+
+latency_histogram::summary latency_histogram::read(bool reset)
+{
+    uint32_t counts[HISTOGRAM_BUCKETS];
+    summary result;
+    for (size_t i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        counts[i] = reset ? m_counts[i].exchange(0, std::memory_order_relaxed)
+                          : m_counts[i].load(std::memory_order_relaxed);
+        result.count += counts[i];
+    }
+    result.max = reset ? m_max.exchange(0, std::memory_order_relaxed) : m_max.load(std::memory_order_relaxed);
+    if (!result.count)
+        return result;
+
+    const struct {
+        uint64_t *out;
+        double fraction;
+    } percentiles[] = {{&result.p50, 0.5}, {&result.p90, 0.9}, {&result.p99, 0.99}, {&result.p999, 0.999}};
+
+    uint64_t seen = 0;
+    size_t next = 0;
+    for (size_t i = 0; i < HISTOGRAM_BUCKETS && next < 4; i++) {
+        seen += counts[i];
+        while (next < 4 && seen >= uint64_t(percentiles[next].fraction * result.count + 0.5)) {
+            *percentiles[next].out = std::min(bucket_value(i), result.max);
+            next++;
+        }
+    }
+    return result;
+}
@@ -0,0 +1,53 @@
+/*************************************************************************
+ * This file is part of input-overlay
+ * github.con/univrsal/input-overlay
+ * Copyright 2022 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/* Values below 2 * HISTOGRAM_SUB_BUCKETS are exact, above that every power
+ * of two is split into HISTOGRAM_SUB_BUCKETS buckets, so the error stays
+ * below 1/16 of the value. With µs this covers up to ~16 s */
+#define HISTOGRAM_SUB_BUCKETS 16
+#define HISTOGRAM_MAX_SHIFT 20
+#define HISTOGRAM_BUCKETS ((HISTOGRAM_MAX_SHIFT + 2) * HISTOGRAM_SUB_BUCKETS)
+
+/* Log linear histogram similar to HdrHistogram. record() only does relaxed
+ * atomic increments, so it can be called from any thread while another one
+ * reads it */
+class latency_histogram {
+    std::atomic<uint32_t> m_counts[HISTOGRAM_BUCKETS]{};
+    std::atomic<uint64_t> m_max{0};
+
+    static size_t bucket(uint64_t value);
+    static uint64_t bucket_value(size_t index);
+
+public:
+    struct summary {
+        uint64_t count = 0;
+        uint64_t p50 = 0, p90 = 0, p99 = 0, p999 = 0, max = 0;
+    };
+
+    void record(uint64_t value);
+
+    /* Percentiles are the upper end of their bucket. With reset the counts
+     * start over, events recorded at the same time might be missing in the
+     * summary but are never counted twice */
+    summary read(bool reset);
+};
@@ -0,0 +1,281 @@
+/*************************************************************************
+ * This file is part of input-overlay
+ * github.con/univrsal/input-overlay
+ * Copyright 2022 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#include "load_generator.hpp"
+#include "client_util.hpp"
+#include "network.hpp"
+#include <socket_options.hpp>
+#include <uiohook.h>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono;
+
+namespace load {
+static std::atomic<bool> running{false};
+
+/* Key codes that are pressed at random */
+static const uint16_t keys[] = {VC_W, VC_A, VC_S, VC_D, VC_Q, VC_E, VC_R, VC_F, VC_SPACE, VC_SHIFT_L};
+
+struct counters {
+    uint64_t moves = 0, keys = 0, pads = 0, bytes = 0;
+};
+
+struct connection {
+    tcp_socket socket = nullptr;
+    std::string name;
+    network::frame_buffer out;
+    network::compact_event_state compact;
+    double mouse_due = 0, key_due = 0, pad_due = 0; /* Events that are owed, including fractions */
+    uint16_t held_key = 0;                          /* Zero if nothing is held */
+    bool pads_connected = false;
+    bool alive = false;
+};
+
+static void write_mouse_move(connection &c, double t)
+{
+    uiohook_event event{};
+    event.type = EVENT_MOUSE_MOVED;
+    event.time = util::get_time_us() / 1000;
+    event.data.mouse.x = int16_t(960 + 400 * std::cos(t));
+    event.data.mouse.y = int16_t(540 + 400 * std::sin(t));
+    c.out.begin_message(COMPACT_EVENT_MAX_SIZE);
+    network::write_compact_event(c.out.data(), c.compact, event);
+    c.out.end_message();
+}
+
+static void write_key(connection &c, std::mt19937 &rng)
+{
+    uiohook_event event{};
+    event.time = util::get_time_us() / 1000;
+    event.data.keyboard.keychar = CHAR_UNDEFINED;
+    if (c.held_key) {
+        event.type = EVENT_KEY_RELEASED;
+        event.data.keyboard.keycode = c.held_key;
+        c.held_key = 0;
+    } else {
+        event.type = EVENT_KEY_PRESSED;
+        event.data.keyboard.keycode = keys[rng() % (sizeof(keys) / sizeof(keys[0]))];
+        c.held_key = event.data.keyboard.keycode;
+    }
+    c.out.begin_message(COMPACT_EVENT_MAX_SIZE);
+    network::write_compact_event(c.out.data(), c.compact, event);
+    c.out.end_message();
+}
+
+static void write_pad_connected(connection &c, uint8_t index)
+{
+    const auto id = c.name + "_pad" + std::to_string(index);
+    auto &out = c.out.data();
+    c.out.begin_message(2 * sizeof(uint8_t) + sizeof(uint16_t) + id.length());
+    out.write<uint8_t>(network::MSG_GAMEPAD_CONNECTED);
+    out.write<uint8_t>(index);
+    out.write<uint16_t>(uint16_t(id.length()));
+    out.write(id.c_str(), id.length());
+    c.out.end_message();
+}
+
+/* Both sticks move a little, like a resting stick that isn't perfectly centered */
+static void write_pad_noise(connection &c, uint8_t index, std::mt19937 &rng)
+{
+    static const uint16_t axes[] = {0, 1, 2, 3}; /* Left and right stick x and y */
+    std::uniform_real_distribution<float> noise(-0.05f, 0.05f);
+    auto &out = c.out.data();
+    c.out.begin_message(4 * sizeof(uint8_t) + 4 * (sizeof(uint16_t) + sizeof(float)));
+    out.write<uint8_t>(network::MSG_GAMEPAD_DELTA);
+    out.write<uint8_t>(index);
+    out.write<uint8_t>(0); /* No last events */
+    out.write<uint8_t>(0); /* No buttons */
+    out.write<uint8_t>(sizeof(axes) / sizeof(axes[0]));
+    for (auto axis : axes) {
+        out.write<uint16_t>(axis);
+        out.write<float>(noise(rng));
+    }
+    c.out.end_message();
+}
+
+/* Answers time pings, so the server has latency numbers for these clients
+ * too, and ignores everything else */
+static void drain(connection &c)
+{
+    auto msg = util::recv_msg(c.socket);
+    switch (msg) {
+    case network::MSG_TIME_PING: {
+        uint64_t ping_time = 0;
+        if (netlib_tcp_recv(c.socket, &ping_time, sizeof(ping_time)) == sizeof(ping_time)) {
+            buffer pong;
+            network::write_time_pong(pong, ping_time);
+            netlib_tcp_send(c.socket, pong.get(), int(pong.write_pos()));
+        }
+        break;
+    }
+    case network::MSG_UDP_TOKEN: {
+        uint32_t token;
+        netlib_tcp_recv(c.socket, &token, sizeof(token));
+        break;
+    }
+    case network::MSG_REFRESH:
+    case network::MSG_PING_CLIENT:
+        break;
+    default:
+        DEBUG_LOG("%s was disconnected by the server (message %i)", c.name.c_str(), int(msg));
+        c.alive = false;
+    }
+}
+
+int run()
+{
+    const auto &cfg = util::cfg;
+    auto ip = cfg.primary.ip;
+    std::vector<connection> connections(cfg.load_connections);
+    auto set = netlib_alloc_socket_set(cfg.load_connections);
+    if (!set) {
+        DEBUG_LOG("netlib_alloc_socket_set failed: %s", netlib_get_error());
+        return util::RET_CONNECTION;
+    }
+
+    for (size_t i = 0; i < connections.size(); i++) {
+        auto &c = connections[i];
+        c.name = std::string(cfg.username) + "-" + std::to_string(i);
+        c.socket = netlib_tcp_open(&ip);
+        if (!c.socket || netlib_tcp_add_socket(set, c.socket) == -1 || !network::handshake(c.socket, c.name.c_str())) {
+            DEBUG_LOG("Couldn't connect %s: %s", c.name.c_str(), netlib_get_error());
+            continue;
+        }
+        network::tune_tcp_socket(c.socket, cfg.send_buffer); /* Same as real clients */
+        c.alive = true;
+    }
+
+    DEBUG_LOG("Sending synthetic input from %i connections. Per connection: %hu mouse moves/s, %hu key events/s, "
+              "%hhu gamepads with %hu updates/s each",
+              int(connections.size()), cfg.load_mouse_rate, cfg.load_key_rate, cfg.load_pads, cfg.load_pad_rate);
+
+    std::mt19937 rng(1608);
+    counters total, second;
+    const auto start = steady_clock::now();
+    auto last_tick = start, last_report = start;
+    running = true;
+
+    while (running) {
+        std::this_thread::sleep_for(milliseconds(1));
+        const auto now = steady_clock::now();
+        const auto elapsed = duration<double>(now - last_tick).count();
+        const auto t = duration<double>(now - start).count();
+        last_tick = now;
+
+        if (cfg.load_time && t >= cfg.load_time)
+            break;
+
+        while (netlib_check_socket_set(set, 0) > 0) {
+            bool any = false;
+            for (auto &c : connections) {
+                if (c.alive && netlib_socket_ready(c.socket)) {
+                    drain(c);
+                    any = true;
+                }
+            }
+            if (!any)
+                break;
+        }
+
+        size_t alive = 0;
+        for (auto &c : connections) {
+            if (!c.alive)
+                continue;
+            alive++;
+
+            if (!c.pads_connected) {
+                for (uint8_t i = 0; i < cfg.load_pads; i++)
+                    write_pad_connected(c, i);
+                c.pads_connected = true;
+            }
+
+            c.mouse_due += cfg.load_mouse_rate * elapsed;
+            c.key_due += cfg.load_key_rate * elapsed;
+            c.pad_due += cfg.load_pad_rate * elapsed;
+            for (; c.mouse_due >= 1; c.mouse_due--, second.moves++)
+                write_mouse_move(c, t);
+            for (; c.key_due >= 1; c.key_due--, second.keys++)
+                write_key(c, rng);
+            for (; c.pad_due >= 1; c.pad_due--) {
+                for (uint8_t i = 0; i < cfg.load_pads; i++, second.pads++)
+                    write_pad_noise(c, i, rng);
+            }
+
+            auto &data = c.out.data();
+            if (data.write_pos() > 0) {
+                if (netlib_tcp_send(c.socket, data.get(), int(data.write_pos())) < int(data.write_pos())) {
+                    DEBUG_LOG("Sending from %s failed: %s", c.name.c_str(), netlib_get_error());
+                    c.alive = false;
+                }
+                second.bytes += data.write_pos();
+                c.out.reset();
+            }
+        }
+
+        if (!alive) {
+            DEBUG_LOG("No connections left");
+            break;
+        }
+
+        const auto report = duration<double>(now - last_report).count();
+        if (report >= 1) {
+            DEBUG_LOG("%i connections: %.0f mouse moves/s, %.0f key events/s, %.0f gamepad updates/s, %.1f KiB/s",
+                      int(alive), second.moves / report, second.keys / report, second.pads / report,
+                      second.bytes / report / 1024);
+            total.moves += second.moves;
+            total.keys += second.keys;
+            total.pads += second.pads;
+            total.bytes += second.bytes;
+            second = {};
+            last_report = now;
+        }
+    }
+    running = false;
+
+    const auto t = duration<double>(steady_clock::now() - start).count();
+    DEBUG_LOG("Sent %llu mouse moves, %llu key events, %llu gamepad updates and %.1f KiB in %.1f s",
+              (unsigned long long)total.moves, (unsigned long long)total.keys, (unsigned long long)total.pads,
+              total.bytes / 1024.0, t);
+
+    buffer dc;
+    dc.write<uint8_t>(network::MSG_FRAME);
+    dc.write<uint16_t>(1);
+    dc.write<uint8_t>(network::MSG_CLIENT_DC);
+    for (auto &c : connections) {
+        if (c.socket) {
+            if (c.alive)
+                netlib_tcp_send(c.socket, dc.get(), int(dc.write_pos()));
+            netlib_tcp_close(c.socket);
+        }
+    }
+    netlib_free_socket_set(set);
+    return 0;
+}
+
+void stop()
+{
+    running = false;
+}
+}
@@ -19,112 +19,531 @@
 #include "network.hpp"
 #include "uiohook_helper.hpp"
 #include "client_util.hpp"
+#include <socket_options.hpp>
 #include <cstdio>
+#include <cstring>
+#include <chrono>
+#include <algorithm>
+#include <memory>
+#include <vector>
 
 #include "gamepad_helper.hpp"
 
+using namespace std::chrono;
+
 namespace network {
-tcp_socket sock = nullptr;
-netlib_socket_set set = nullptr;
 buffer buf;
 std::atomic<bool> network_loop;
-bool connected = false;
 
 std::thread network_thread;
+latency_histogram send_latency;
+std::atomic<bool> report_requested{false};
 
-bool start_connection()
+/* One server the input goes to. The first one is the host from the command
+ * line, the others come from --mirror. All of them get the same serialized
+ * input, everything else is kept per connection */
+struct connection {
+    std::string host;
+    ip_address ip{};
+    tcp_socket sock = nullptr;
+    netlib_socket_set set = nullptr;
+    std::thread listen_thread;
+    std::mutex send_mutex; /* Both the listen and the network thread send over sock */
+    bool connected = false;
+    bool resync = false;           /* Gets the full input state instead of the next batch */
+    std::atomic<bool> lost{false}; /* Set by the listen thread, the network thread then reconnects */
+    bool fatal_error = false;      /* Reconnecting wouldn't help */
+    int reconnect_delay = RECONNECT_DELAY_MIN;
+    steady_clock::time_point next_attempt;
+
+    /* Optional udp transport, see MSG_UDP_PACKET */
+    udp_socket udp = nullptr;
+    udp_packet *packet = nullptr;
+    std::atomic<uint32_t> udp_token{0}; /* Set by the listen thread once the server accepted */
+    bool udp_active = false;
+    uint32_t udp_sequence = 0;
+
+    ~connection()
+    {
+        if (packet)
+            netlib_free_packet(packet);
+        if (udp)
+            netlib_udp_close(udp);
+        if (set)
+            netlib_free_socket_set(set);
+    }
+};
+
+/* Only touched by the network thread once it runs */
+static std::vector<std::unique_ptr<connection>> connections;
+
+/* Set by the hooks, see notify() */
+static std::mutex wake_mutex;
+static std::condition_variable wake_cond;
+static bool wake_pending = false;
+static bool urgent_pending = false; /* Something other than motion is waiting */
+
+static void listen_thread_method(connection *c);
+
+void frame_buffer::begin_message(size_t size)
+{
+    if (m_open && m_buf.write_pos() - m_frame - FRAME_HEADER_SIZE + size <= FRAME_MAX_PAYLOAD)
+        return;
+    m_frame = m_buf.write_pos();
+    m_buf.write<uint8_t>(MSG_FRAME);
+    m_buf.write<uint16_t>(0);
+    m_open = true;
+}
+
+void frame_buffer::end_message()
+{
+    const auto size = uint16_t(m_buf.write_pos() - m_frame - FRAME_HEADER_SIZE);
+    memcpy(&m_buf[m_frame + 1], &size, sizeof(size));
+}
+
+void frame_buffer::take(buffer &out)
 {
-    DEBUG_LOGN("Allocating socket... ");
-    set = netlib_alloc_socket_set(1);
+    out.reset();
+    m_buf.swap(out);
+    m_captured.clear();
+    m_frame = 0;
+    m_open = false;
+}
+
+void frame_buffer::take(buffer &out, std::vector<uint64_t> &captured)
+{
+    captured.clear();
+    m_captured.swap(captured);
+    take(out);
+}
+
+void frame_buffer::reset()
+{
+    m_buf.reset();
+    m_captured.clear();
+    m_frame = 0;
+    m_open = false;
+}
+
+/* Writes a frame that only contains msg */
+static void write_message_frame(buffer &b, uint8_t msg)
+{
+    b.write<uint8_t>(MSG_FRAME);
+    b.write<uint16_t>(sizeof(msg));
+    b.write<uint8_t>(msg);
+}
 
-    if (!set) {
-        printf(" netlib_alloc_socket_set failed: %s\n", netlib_get_error());
+bool handshake(tcp_socket socket, const char *name)
+{
+    if (!util::send_text(socket, name)) {
+        DEBUG_LOG("Failed to send username (%s): %s", name, netlib_get_error());
         return false;
     }
-    printf("Done.\n");
 
-    DEBUG_LOGN("Opening socket... ");
+    buffer sync;
+    write_message_frame(sync, MSG_TIME_SYNC);
+    if (!netlib_tcp_send(socket, sync.get(), sync.write_pos()))
+        DEBUG_LOG("netlib_tcp_send: %s", netlib_get_error());
+    return true;
+}
+
+void write_time_pong(buffer &b, uint64_t ping_time)
+{
+    b.write<uint8_t>(MSG_FRAME);
+    b.write<uint16_t>(1 + 2 * sizeof(uint64_t));
+    b.write<uint8_t>(MSG_TIME_PONG);
+    b.write<uint64_t>(ping_time);
+    b.write<uint64_t>(util::get_time_us());
+}
+
+static void request_udp(connection &c)
+{
+    c.udp_token = 0;
+    c.udp_active = false;
+    c.udp_sequence = 0; /* Reconnected, the server starts over */
+    if (!c.udp)
+        c.udp = netlib_udp_open(0);
+    if (c.udp && !c.packet)
+        c.packet = netlib_alloc_packet(UDP_PACKET_SIZE);
+    if (!c.packet) {
+        DEBUG_LOG("Couldn't open udp socket, using TCP only for %s: %s", c.host.c_str(), netlib_get_error());
+        if (c.udp)
+            netlib_udp_close(c.udp);
+        c.udp = nullptr;
+        return;
+    }
+
+    buffer request;
+    write_message_frame(request, MSG_UDP_REQUEST);
+    std::lock_guard<std::mutex> lock(c.send_mutex);
+    if (!netlib_tcp_send(c.sock, request.get(), request.write_pos()))
+        DEBUG_LOG("netlib_tcp_send: %s", netlib_get_error());
+}
+
+/* Opens the socket and sends everything the server needs to know about the client */
+static bool open_connection(connection &c)
+{
+    DEBUG_LOGN("Connecting to %s... ", c.host.c_str());
 
-    sock = netlib_tcp_open(&util::cfg.ip);
+    c.sock = netlib_tcp_open(&c.ip);
 
-    if (!sock) {
+    if (!c.sock) {
         printf("netlib_tcp_open failed: %s\n", netlib_get_error());
         return false;
     }
 
     printf("Done.\n");
 
-    if (netlib_tcp_add_socket(set, sock) == -1) {
+    if (!tune_tcp_socket(c.sock, util::cfg.send_buffer))
+        DEBUG_LOG("Couldn't set socket options for %s, input might be delayed", c.host.c_str());
+
+    if (netlib_tcp_add_socket(c.set, c.sock) == -1) {
         DEBUG_LOG("netlib_tcp_add_socket failed: %s", netlib_get_error());
         return false;
     }
 
     DEBUG_LOG("Connection successful!");
 
-    /* Send client name */
-    if (!util::send_text(util::cfg.username)) {
-        DEBUG_LOG("Failed to send username (%s): %s", util::cfg.username, netlib_get_error());
+    if (!handshake(c.sock, util::cfg.username))
         return false;
+    if (util::cfg.use_udp)
+        request_udp(c);
+
+    {
+        std::lock_guard<std::mutex> lock(c.send_mutex);
+        c.connected = true;
     }
-    network_loop = true;
-    start_thread();
-    connected = true;
+    c.resync = true;
+    c.lost = false;
+    c.fatal_error = false;
+    c.reconnect_delay = RECONNECT_DELAY_MIN;
+    c.listen_thread = std::thread(listen_thread_method, &c);
     return true;
 }
 
-void start_thread()
+static void close_connection(connection &c)
+{
+    c.lost = true; /* Stops the listen thread */
+    if (c.listen_thread.joinable())
+        c.listen_thread.join();
+
+    std::lock_guard<std::mutex> lock(c.send_mutex);
+    c.connected = false;
+    if (c.sock) {
+        netlib_tcp_del_socket(c.set, c.sock);
+        netlib_tcp_close(c.sock);
+        c.sock = nullptr;
+    }
+}
+
+/* Returns false if the server couldn't be reached, it's kept anyway in
+ * case it should be retried later */
+static bool add_connection(const util::server &server)
 {
+    auto c = std::make_unique<connection>();
+    c->host = server.host;
+    c->ip = server.ip;
+    c->set = netlib_alloc_socket_set(1);
+    if (!c->set) {
+        DEBUG_LOG("netlib_alloc_socket_set failed: %s", netlib_get_error());
+        return false;
+    }
+
+    const auto result = open_connection(*c);
+    if (!result) {
+        close_connection(*c);
+        c->next_attempt = steady_clock::now() + milliseconds(c->reconnect_delay);
+    }
+    connections.emplace_back(std::move(c));
+    return result;
+}
+
+bool start_connection()
+{
+    network_loop = true; /* The listen threads run while this is set */
+
+    if (!add_connection(util::cfg.primary)) {
+        network_loop = false;
+        connections.clear();
+        return false;
+    }
+
+    /* Mirrors that can't be reached yet are retried like lost connections */
+    for (const auto &mirror : util::cfg.mirrors) {
+        if (!add_connection(mirror) && !util::cfg.reconnect) {
+            DEBUG_LOG("Couldn't connect to %s, ignoring it", mirror.host.c_str());
+            if (!connections.back()->connected)
+                connections.pop_back();
+        }
+    }
+
     network_thread = std::thread(network_thread_method);
+    return true;
+}
+
+/* The compact events and the held state for udp packets are the same for
+ * every server, only the header differs */
+static void write_udp_state(buffer &state)
+{
+    state.reset();
+    state.write<uint64_t>(util::get_time_us() / 1000);
+    uiohook::write_held_state(state);
+}
+
+/* Sends the keyboard and mouse frames in data as one udp packet, returns
+ * false if they don't fit */
+static bool send_udp(connection &c, buffer &state, buffer &data)
+{
+    const size_t prefix = sizeof(uint8_t) + 2 * sizeof(uint32_t);
+    if (prefix + state.write_pos() + data.write_pos() > UDP_PACKET_SIZE)
+        return false;
+
+    const uint8_t id = MSG_UDP_PACKET;
+    const uint32_t token = c.udp_token;
+    auto *out = c.packet->data;
+    memcpy(out, &id, sizeof(id));
+    memcpy(out + sizeof(id), &token, sizeof(token));
+    memcpy(out + sizeof(id) + sizeof(token), &c.udp_sequence, sizeof(c.udp_sequence));
+    memcpy(out + prefix, state.get(), state.write_pos());
+    memcpy(out + prefix + state.write_pos(), data.get(), data.write_pos());
+    c.packet->len = int(prefix + state.write_pos() + data.write_pos());
+    c.packet->address = c.ip;
+    if (!netlib_udp_send(c.udp, -1, c.packet))
+        DEBUG_LOG("netlib_udp_send: %s", netlib_get_error());
+    c.udp_sequence++;
+    return true;
+}
+
+void notify(bool urgent)
+{
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex);
+        wake_pending = true;
+        urgent_pending = urgent_pending || urgent;
+    }
+    wake_cond.notify_one();
+}
+
+static bool listen(connection &c, uint32_t timeout);
+
+static void listen_thread_method(connection *c)
+{
+    while (network_loop && !c->lost) {
+        if (!listen(*c, LISTEN_TIMEOUT)) {
+            c->lost = true;
+            notify();
+            break;
+        }
+    }
+}
+
+/* Closes lost connections and reopens them once their delay is over,
+ * returns false if there's no server left to send to */
+static bool update_connections()
+{
+    const auto now = steady_clock::now();
+    for (auto it = connections.begin(); it != connections.end();) {
+        auto &c = **it;
+        if (c.connected && c.lost) {
+            close_connection(c);
+            if (!util::cfg.reconnect || c.fatal_error) {
+                DEBUG_LOG("Disconnected from %s", c.host.c_str());
+                it = connections.erase(it);
+                continue;
+            }
+            DEBUG_LOG("Connection to %s lost, reconnecting in %i ms", c.host.c_str(), c.reconnect_delay);
+            c.next_attempt = now + milliseconds(c.reconnect_delay);
+        } else if (!c.connected && now >= c.next_attempt && !open_connection(c)) {
+            close_connection(c);
+            c.reconnect_delay = std::min(c.reconnect_delay * 2, RECONNECT_DELAY_MAX);
+            c.next_attempt = steady_clock::now() + milliseconds(c.reconnect_delay);
+            DEBUG_LOG("Reconnecting to %s in %i ms", c.host.c_str(), c.reconnect_delay);
+        }
+        ++it;
+    }
+
+    if (connections.empty()) {
+        DEBUG_LOG("Received quit signal");
+        network_loop = false; // The rest will be taken care of in the main thread
+    }
+    return network_loop;
+}
+
+static void print_latency(steady_clock::time_point since)
+{
+    const auto s = send_latency.read(true);
+    const auto seconds = duration_cast<milliseconds>(steady_clock::now() - since).count() / 1000.0;
+    DEBUG_LOG("Hook to wire latency over %.1f s, %llu events: p50 %.2f ms, p90 %.2f ms, p99 %.2f ms, "
+              "p99.9 %.2f ms, max %.2f ms",
+              seconds, (unsigned long long)s.count, s.p50 / 1000.0, s.p90 / 1000.0, s.p99 / 1000.0, s.p999 / 1000.0,
+              s.max / 1000.0);
+}
+
+/* Sends b with one call, so it leaves in as few segments as possible now
+ * that Nagle's algorithm is off. send_mutex has to be locked */
+static bool send_all(connection &c, buffer &b)
+{
+    if (b.write_pos() > 0 && !netlib_tcp_send(c.sock, b.get(), b.write_pos())) {
+        DEBUG_LOG("netlib_tcp_send: %s", netlib_get_error());
+        return false;
+    }
+    return true;
+}
+
+static void append(buffer &out, buffer &b)
+{
+    if (b.write_pos() > 0)
+        out.write(b.get(), b.write_pos());
 }
 
 void network_thread_method()
 {
-    int listen_counter = 0;
+    buffer pad_data, hook_data, udp_state, compact_reset;
+    buffer tcp_batch, udp_batch, resync_batch; /* What is actually sent, see below */
+    std::vector<uint64_t> pad_captured, hook_captured;
+    frame_buffer resync_data;
+    auto last_flush = steady_clock::now();
+    auto last_report = last_flush;
+    bool busy = false;
+    bool reset_pending = false; /* The compact encoding was reset since the last batch */
+
+    write_message_frame(compact_reset, MSG_COMPACT_RESET);
 
     while (network_loop) {
-        if (++listen_counter >= 10000) {
-            listen_counter = 0;
-            if (!listen()) /* Has a timeout of 1ms*/
-            {
-                DEBUG_LOG("Received quit signal");
-                network_loop = false; // The rest will be taken care of in the main thread
-                break;
+        {
+            /* Held back mouse movement and the scroll reset need to be checked
+             * again soon, lost connections once their delay is over */
+            auto deadline = steady_clock::now() + (busy ? milliseconds(1) : milliseconds(IDLE_TIMEOUT));
+            for (const auto &c : connections) {
+                if (!c->connected)
+                    deadline = std::min(deadline, c->next_attempt);
             }
+            std::unique_lock<std::mutex> lock(wake_mutex);
+            wake_cond.wait_until(lock, deadline, [] { return wake_pending || !network_loop; });
+            wake_pending = false;
         }
+        if (!network_loop || !update_connections())
+            break;
 
-        /* Copy buffered data from hooks */
+        /* Lets motion pile up for a bit, so it shares one packet. Anything
+         * else ends the wait and takes the motion with it */
+        if (util::cfg.flush_interval) {
+            const auto due = last_flush + milliseconds(util::cfg.flush_interval);
+            std::unique_lock<std::mutex> lock(wake_mutex);
+            wake_cond.wait_until(lock, due, [] { return urgent_pending || !network_loop; });
+        }
+        {
+            std::lock_guard<std::mutex> lock(wake_mutex);
+            urgent_pending = false;
+            wake_pending = false;
+        }
+
+        const bool resync = std::any_of(connections.begin(), connections.end(),
+                                        [](const std::unique_ptr<connection> &c) { return c->connected && c->resync; });
+        resync_data.reset();
+
+        /* Take the data of the hooks, they get the empty buffers from the
+         * last iteration back, so nothing is copied while they have to wait */
         if (util::cfg.monitor_gamepad) {
-            std::lock_guard<std::mutex> lock(libgamepad::buffer_mutex);
-            if (libgamepad::buf.write_pos() > 0) {
-                buf.write(libgamepad::buf.get(), libgamepad::buf.write_pos());
-                libgamepad::buf.reset();
-            }
+            libgamepad::check_idle();
+            libgamepad::take(pad_data, pad_captured, resync ? &resync_data : nullptr);
         }
 
+        bool batch_reset = false;
         if (util::cfg.monitor_keyboard || util::cfg.monitor_mouse) {
             std::lock_guard<std::mutex> lock(uiohook::buffer_mutex);
-            if (uiohook::buf.write_pos() > 0) {
-                buf.write(uiohook::buf.get(), uiohook::buf.write_pos());
-                uiohook::buf.reset();
+            uiohook::flush_mouse_move();
+            uiohook::buf.take(hook_data, hook_captured);
+            if (hook_data.write_pos() > 0) {
+                batch_reset = reset_pending;
+                reset_pending = false;
             }
-        }
 
-        /* Reset scroll wheel if no scroll event happened for a bit */
-        if (uiohook::last_scroll_time > 0 && util::get_ticks() - uiohook::last_scroll_time >= SCROLL_TIMEOUT) {
-            buf.write<uint8_t>(MSG_MOUSE_WHEEL_RESET);
-            uiohook::last_scroll_time = 0;
+            /* Every batch starts over in udp mode, so lost packets don't affect later ones */
+            bool udp_any = false;
+            for (auto &c : connections) {
+                if (c->connected && c->udp_token && !c->udp_active)
+                    c->udp_active = true;
+                udp_any = udp_any || (c->connected && c->udp_active);
+            }
+            if (batch_reset && udp_any)
+                write_udp_state(udp_state);
+
+            /* A new server starts with an empty compact state, so all of them
+             * continue from there */
+            if (resync)
+                uiohook::write_resync(resync_data);
+            if (udp_any || resync) {
+                uiohook::reset_compact_state();
+                reset_pending = true;
+            }
+            busy = uiohook::has_pending_move();
         }
 
-        /* Send any data written to the buffer */
-        if (buf.write_pos() > 0) {
-            if (!netlib_tcp_send(sock, buf.get(), buf.write_pos())) {
-                DEBUG_LOG("netlib_tcp_send: %s", netlib_get_error());
-                break;
+        /* Everything is serialized once, only how it's sent differs per server.
+         * The parts are joined, so every server gets one send per batch. buf
+         * goes first, the compact reset has to arrive before the events. The
+         * server resets for every udp packet, so it has to for batches that
+         * don't fit as well */
+        const bool has_data = buf.write_pos() > 0 || pad_data.write_pos() > 0 || hook_data.write_pos() > 0;
+        tcp_batch.reset();
+        udp_batch.reset();
+        bool sent = false;
+        for (auto &c : connections) {
+            if (!c->connected || (!has_data && !c->resync))
+                continue;
+
+            std::lock_guard<std::mutex> lock(c->send_mutex);
+            bool ok;
+            if (c->resync) {
+                /* The resync already contains the state after this batch */
+                resync_batch.reset();
+                append(resync_batch, buf);
+                append(resync_batch, resync_data.data());
+                ok = send_all(*c, resync_batch);
+                c->resync = false;
+            } else if (batch_reset && c->udp_active && send_udp(*c, udp_state, hook_data)) {
+                if (!udp_batch.write_pos()) {
+                    append(udp_batch, buf);
+                    append(udp_batch, pad_data);
+                }
+                ok = send_all(*c, udp_batch);
+                sent = sent || ok;
+            } else {
+                if (!tcp_batch.write_pos()) {
+                    append(tcp_batch, buf);
+                    if (batch_reset)
+                        append(tcp_batch, compact_reset);
+                    append(tcp_batch, pad_data);
+                    append(tcp_batch, hook_data);
+                }
+                ok = send_all(*c, tcp_batch);
+                sent = sent || ok;
+            }
+            if (!ok) {
+                c->lost = true; /* Handled in update_connections() */
+                notify();
             }
-            buf.reset();
         }
+        if (has_data)
+            last_flush = steady_clock::now();
 
-        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        /* Input that only went to a resyncing server or nowhere isn't counted */
+        if (sent) {
+            const auto now = util::get_time_us();
+            for (const auto time : pad_captured)
+                send_latency.record(now > time ? now - time : 0);
+            for (const auto time : hook_captured)
+                send_latency.record(now > time ? now - time : 0);
+        }
+        if (report_requested.exchange(false) ||
+            (util::cfg.latency_report && steady_clock::now() - last_report >= seconds(util::cfg.latency_report))) {
+            print_latency(last_report);
+            last_report = steady_clock::now();
+        }
+        buf.reset();
+        pad_data.reset();
+        hook_data.reset();
     }
 
     DEBUG_LOG("Network loop exited");
@@ -134,32 +553,56 @@ void network_thread_method()
     }
 }
 
-int numready = 0;
-bool listen()
+/* Reads and answers one server message, waits up to timeout ms for it */
+static bool listen(connection &c, uint32_t timeout)
 {
-    numready = netlib_check_socket_set(set, 0);
+    const auto numready = netlib_check_socket_set(c.set, timeout);
 
     if (numready == -1) {
         DEBUG_LOG("netlib_check_socket_set failed: %s", netlib_get_error());
         return false;
     }
 
-    if (numready && netlib_socket_ready(sock)) {
-        auto msg = util::recv_msg();
+    if (numready && netlib_socket_ready(c.sock)) {
+        auto msg = util::recv_msg(c.sock);
 
         switch (msg) {
         case MSG_NAME_NOT_UNIQUE:
-            DEBUG_LOG("Nickname is already in use. Disconnecting...");
+            DEBUG_LOG("Nickname is already in use on %s. Disconnecting...", c.host.c_str());
             return false;
         case MSG_NAME_INVALID:
-            DEBUG_LOG("Nickname is not valid. Disconnecting...");
+            DEBUG_LOG("Nickname is not valid on %s. Disconnecting...", c.host.c_str());
+            c.fatal_error = true;
             return false;
         case MSG_SERVER_SHUTDOWN:
-            DEBUG_LOG("Server is shutting down.");
+            DEBUG_LOG("Server %s is shutting down.", c.host.c_str());
             return false;
         case MSG_READ_ERROR:
-            DEBUG_LOG("Couldn't read message.");
+            DEBUG_LOG("Couldn't read message from %s.", c.host.c_str());
             return false;
+        case MSG_UDP_TOKEN: {
+            uint32_t token = 0;
+            if (netlib_tcp_recv(c.sock, &token, sizeof(token)) < int(sizeof(token)) || !token) {
+                DEBUG_LOG("Couldn't read udp token.");
+                return false;
+            }
+            c.udp_token = token;
+            DEBUG_LOG("Sending keyboard and mouse input to %s over udp", c.host.c_str());
+            return true;
+        }
+        case MSG_TIME_PING: {
+            uint64_t ping_time = 0;
+            if (netlib_tcp_recv(c.sock, &ping_time, sizeof(ping_time)) < int(sizeof(ping_time))) {
+                DEBUG_LOG("Couldn't read time ping.");
+                return false;
+            }
+            buffer pong;
+            write_time_pong(pong, ping_time);
+            std::lock_guard<std::mutex> lock(c.send_mutex);
+            if (!netlib_tcp_send(c.sock, pong.get(), pong.write_pos()))
+                DEBUG_LOG("netlib_tcp_send: %s", netlib_get_error());
+            return true;
+        }
         case MSG_REFRESH:;    /* fallthrough */
         case MSG_PING_CLIENT: /* NO-OP needed */
             return true;
@@ -182,21 +625,27 @@ bool init()
 
 void close()
 {
-    if (!network_loop)
+    if (!network_loop && !network_thread.joinable())
         return;
     network_loop = false;
+    notify();
+    if (network_thread.joinable())
+        network_thread.join();
 
-    /* Tell server we're disconnecting */
-    if (connected) {
-        buf.reset();
-        buf.write<uint8_t>(MSG_CLIENT_DC);
-        netlib_tcp_send(sock, buf.get(), buf.write_pos());
+    /* Tell the servers we're disconnecting */
+    buffer dc;
+    write_message_frame(dc, MSG_CLIENT_DC);
+    for (auto &c : connections) {
+        std::lock_guard<std::mutex> lock(c->send_mutex);
+        if (c->connected)
+            netlib_tcp_send(c->sock, dc.get(), dc.write_pos());
     }
 
     /* Give server time to process DC message */
     util::sleep_ms(100);
-    network_thread.join();
-    netlib_tcp_close(sock);
+    for (auto &c : connections)
+        close_connection(*c);
+    connections.clear();
     netlib_quit();
 }
 }
@@ -20,24 +20,80 @@
 #include <netlib.h>
 #include <thread>
 #include <buffer.hpp>
+#include <messages.hpp>
 #include <mutex>
 #include <atomic>
+#include <condition_variable>
+#include <vector>
+#include "latency_histogram.hpp"
+
+/* How long the listen thread blocks on the socket, so it notices when it should quit */
+#define LISTEN_TIMEOUT 100 /* ms */
+/* The network thread wakes up on its own this often even without input */
+#define IDLE_TIMEOUT 1000 /* ms */
+/* Waiting time before reconnecting, doubled after every failed attempt */
+#define RECONNECT_DELAY_MIN 500 /* ms */
+#define RECONNECT_DELAY_MAX 30000
 
 namespace network {
-extern tcp_socket sock;
-extern netlib_socket_set set;
-extern bool connected;
-extern bool state;
+/* Buffer that only holds complete frames (see FRAME_HEADER_SIZE), messages
+ * are appended to the current frame until it would grow too large */
+class frame_buffer {
+    buffer m_buf;
+    std::vector<uint64_t> m_captured; /* When the events in m_buf were captured, in µs */
+    size_t m_frame = 0;               /* Start of the current frame */
+    bool m_open = false;
+
+public:
+    /* Has to be called before writing a message of at most size bytes */
+    void begin_message(size_t size);
+
+    /* Updates the size of the current frame after a message was written */
+    void end_message();
+
+    void reset();
+
+    /* Swaps the contents into out and continues with the old buffer of out,
+     * which is reset, so no data has to be copied */
+    void take(buffer &out);
+
+    /* Same, but also hands over the capture times, see captured() */
+    void take(buffer &out, std::vector<uint64_t> &captured);
+
+    /* Remembers when an event that was written was captured by its hook,
+     * the network thread turns it into the hook to wire latency */
+    void captured(uint64_t time) { m_captured.push_back(time); }
+
+    buffer &data() { return m_buf; }
+};
+
 extern std::atomic<bool> network_loop;
-/* Set to true by other threads */
-/* Set to true to prevent other threads from modifying data, which is about to be sent */
+/* Written by the network thread, goes to every server */
 extern buffer buf;
 extern std::thread network_thread;
 
+/* Time between capturing an event in the hook and sending it in µs */
+extern latency_histogram send_latency;
+/* Set to print the histogram (see --latency_report), safe in signal handlers */
+extern std::atomic<bool> report_requested;
+
 bool init();
+
+/* Connects to the server and all mirrors (see --mirror) and starts the
+ * network thread. Fails if the server can't be reached, mirrors are
+ * retried later */
 bool start_connection();
-void start_thread();
-bool listen();
+
+/* Sends the name and asks for time pings, the first thing every connection does */
+bool handshake(tcp_socket socket, const char *name);
+
+/* Answer to MSG_TIME_PING as a frame */
+void write_time_pong(buffer &b, uint64_t ping_time);
+
+/* Wakes the network thread up, called by the hooks after they wrote something.
+ * Motion isn't urgent and waits for the flush interval (see --flush_interval),
+ * everything else is sent right away */
+void notify(bool urgent = true);
 
 void network_thread_method();
 
@@ -20,14 +20,119 @@
 #include "network.hpp"
 #include "client_util.hpp"
 #include <cstdarg>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
 #include <cstdio>
 #include <util.hpp>
 
 namespace uiohook {
-uint32_t last_scroll_time;
 std::atomic<bool> hook_state;
 std::mutex buffer_mutex;
-buffer buf;
+network::frame_buffer buf;
+static network::compact_event_state compact_state;
+/* Same layout as the server's input_bitset, so pressing and releasing
+ * never allocates. Out of range codes are ignored */
+template<size_t N> class held_codes {
+    uint64_t m_words[(N + 63) / 64]{};
+
+public:
+    void set(size_t code, bool state)
+    {
+        if (code >= N)
+            return;
+        const auto bit = uint64_t(1) << (code % 64);
+        if (state)
+            m_words[code / 64] |= bit;
+        else
+            m_words[code / 64] &= ~bit;
+    }
+
+    /* Calls f(code) for every held code in ascending order */
+    template<class F> void for_each(F f) const
+    {
+        for (size_t i = 0; i < sizeof(m_words) / sizeof(m_words[0]); i++) {
+            for (auto word = m_words[i]; word; word &= word - 1) {
+                size_t bit = 0;
+                while (!((word >> bit) & 1u))
+                    bit++;
+                f(i * 64 + bit);
+            }
+        }
+    }
+};
+
+static held_codes<0x10000> held_keys;
+static held_codes<0x100> held_buttons;
+
+void write_held_state(buffer &out)
+{
+    /* Only 255 fit, more than that can't be held down anyway. The count is
+     * patched in once the codes are written */
+    auto write = [&out](const auto &codes, bool wide) {
+        const auto count_pos = out.write_pos();
+        size_t count = 0;
+        out.write<uint8_t>(0);
+        codes.for_each([&](size_t code) {
+            if (count == 0xff)
+                return;
+            if (wide)
+                out.write<uint16_t>(uint16_t(code));
+            else
+                out.write<uint8_t>(uint8_t(code));
+            count++;
+        });
+        out[count_pos] = uint8_t(count);
+    };
+    write(held_keys, true);
+    write(held_buttons, false);
+}
+
+void reset_compact_state()
+{
+    compact_state = {};
+}
+
+static void write_event(const uiohook_event *event, uint64_t captured)
+{
+    buf.begin_message(COMPACT_EVENT_MAX_SIZE);
+    network::write_compact_event(buf.data(), compact_state, *event);
+    buf.end_message();
+    buf.captured(captured);
+}
+
+/* Only the newest position is kept when mouse_rate is set, since positions
+ * are absolute no movement gets lost in between */
+static uiohook_event pending_move{};
+static uint64_t pending_move_captured = 0;
+static bool move_pending = false;
+static std::chrono::steady_clock::time_point last_move;
+
+bool has_pending_move()
+{
+    return move_pending;
+}
+
+void flush_mouse_move(bool force)
+{
+    if (!move_pending)
+        return;
+    const auto now = std::chrono::steady_clock::now();
+    if (!force && now - last_move < std::chrono::microseconds(1000000 / util::cfg.mouse_rate))
+        return;
+    write_event(&pending_move, pending_move_captured);
+    move_pending = false;
+    last_move = now;
+}
+
+void write_resync(network::frame_buffer &out)
+{
+    out.begin_message(sizeof(uint8_t) + sizeof(uint8_t) + 0xff * sizeof(uint16_t) + sizeof(uint8_t) + 0xff);
+    out.data().write<uint8_t>(network::MSG_HELD_STATE);
+    write_held_state(out.data());
+    out.end_message();
+}
+
 static void logger_proc(unsigned int level, void *, const char *format, va_list args)
 
 {
@@ -59,7 +164,10 @@ static void logger(unsigned int level, const char *format, ...)
 
 void dispatch_proc(uiohook_event *const event, void *)
 {
-    std::lock_guard<std::mutex> lock(buffer_mutex);
+    /* The server converts this into its own time, see MSG_TIME_SYNC */
+    const auto captured = util::get_time_us();
+    event->time = captured / 1000;
+    std::unique_lock<std::mutex> lock(buffer_mutex);
     switch (event->type) {
     case EVENT_HOOK_ENABLED:
         DEBUG_LOG("uiohook started");
@@ -72,34 +180,44 @@ void dispatch_proc(uiohook_event *const event, void *)
     case EVENT_MOUSE_PRESSED:
     case EVENT_MOUSE_RELEASED:
         if (util::cfg.monitor_mouse) {
-            buf.write<uint8_t>(network::MSG_UIOHOOK_EVENT);
-            buf.write<uiohook_event>(*event);
+            if (event->type == EVENT_MOUSE_PRESSED || event->type == EVENT_MOUSE_RELEASED)
+                held_buttons.set(event->data.mouse.button, event->type == EVENT_MOUSE_PRESSED);
+            flush_mouse_move(true); /* Keep the order, so the press happens at the right position */
+            write_event(event, captured);
         }
         break;
     case EVENT_MOUSE_WHEEL:
         if (util::cfg.monitor_mouse) {
-            last_scroll_time = util::get_ticks();
-            buf.write<uint8_t>(network::MSG_UIOHOOK_EVENT);
-            buf.write<uiohook_event>(*event);
+            flush_mouse_move(true);
+            write_event(event, captured);
         }
         break;
     case EVENT_MOUSE_MOVED:
     case EVENT_MOUSE_DRAGGED:
         if (util::cfg.monitor_mouse) {
-            buf.write<uint8_t>(network::MSG_UIOHOOK_EVENT);
-            buf.write<uiohook_event>(*event);
+            if (util::cfg.mouse_rate) {
+                pending_move = *event;
+                pending_move_captured = captured;
+                move_pending = true;
+                flush_mouse_move();
+            } else {
+                write_event(event, captured);
+            }
         }
         break;
     case EVENT_KEY_TYPED:
     case EVENT_KEY_PRESSED:
     case EVENT_KEY_RELEASED:
         if (util::cfg.monitor_keyboard) {
-            buf.write<uint8_t>(network::MSG_UIOHOOK_EVENT);
-            buf.write<uiohook_event>(*event);
+            if (event->type == EVENT_KEY_PRESSED || event->type == EVENT_KEY_RELEASED)
+                held_keys.set(event->data.keyboard.keycode, event->type == EVENT_KEY_PRESSED);
+            write_event(event, captured);
         }
         break;
     default:;
     }
+    lock.unlock();
+    network::notify(event->type != EVENT_MOUSE_MOVED && event->type != EVENT_MOUSE_DRAGGED);
 }
 
 bool start()
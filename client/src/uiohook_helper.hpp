@@ -20,11 +20,9 @@
 #include <uiohook.h>
 #include <atomic>
 #include <mutex>
-#include <buffer.hpp>
+#include "network.hpp"
 
-#define SCROLL_TIMEOUT 120
 namespace uiohook {
-extern uint32_t last_scroll_time;
 
 inline uint16_t util_mouse_fix(int m)
 {
@@ -39,7 +37,27 @@ inline uint16_t util_mouse_fix(int m)
 
 extern std::atomic<bool> hook_state;
 extern std::mutex buffer_mutex;
-extern buffer buf;
+extern network::frame_buffer buf;
+
+/* Writes the held back mouse movement if it's due or force is set.
+ * buffer_mutex has to be locked */
+void flush_mouse_move(bool force = false);
+
+/* True if flush_mouse_move() still has something to write.
+ * buffer_mutex has to be locked */
+bool has_pending_move();
+
+/* Writes the held keys and mouse buttons for an udp packet.
+ * buffer_mutex has to be locked */
+void write_held_state(buffer &out);
+
+/* Starts the compact encoding over, so the next batch of events doesn't
+ * depend on earlier ones. buffer_mutex has to be locked */
+void reset_compact_state();
+
+/* Writes the held keys and buttons (MSG_HELD_STATE) into out for a server
+ * that just connected. buffer_mutex has to be locked */
+void write_resync(network::frame_buffer &out);
 
 void dispatch_proc(uiohook_event *event, void *);
 bool start();
@@ -0,0 +1,138 @@
+/*************************************************************************
+ * This file is part of input-overlay
+ * github.con/univrsal/input-overlay
+ * Copyright 2022 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+// Decoder for the binary websocket format (see src/network/websocket_server.hpp).
+// Connect with
+//     let ws = new WebSocket("ws://localhost:16899/binary");
+//     ws.binaryType = "arraybuffer";
+//     ws.onmessage = (msg) => {
+//         if (typeof msg.data === "string") // The state snapshot sent on connect
+//             handle_event(JSON.parse(msg.data));
+//         else
+//             decode_binary_event(msg.data).forEach(handle_event);
+//     };
+// or request the "input-overlay-binary" subprotocol on any path. The returned
+// objects have the same fields as the JSON messages.
+
+const bin_kinds = { uiohook: 1, pad_input: 2, pad_state: 3 };
+const bin_events = [ "", "key_typed", "key_pressed", "key_released", "mouse_clicked", "mouse_pressed",
+                     "mouse_released", "mouse_moved", "mouse_dragged", "mouse_wheel" ];
+const bin_pad_states = [ "", "gamepad_connected", "gamepad_disconnected", "gamepad_reconnected" ];
+const bin_text = new TextDecoder("utf-8");
+
+class binary_reader {
+    constructor(view, offset)
+    {
+        this.view = view;
+        this.pos = offset;
+    }
+
+    u8() { return this.view.getUint8(this.pos++); }
+    u16() { this.pos += 2; return this.view.getUint16(this.pos - 2, true); }
+    i16() { this.pos += 2; return this.view.getInt16(this.pos - 2, true); }
+    u32() { this.pos += 4; return this.view.getUint32(this.pos - 4, true); }
+    i32() { this.pos += 4; return this.view.getInt32(this.pos - 4, true); }
+    f32() { this.pos += 4; return this.view.getFloat32(this.pos - 4, true); }
+
+    str()
+    {
+        const length = this.u8();
+        const bytes = new Uint8Array(this.view.buffer, this.view.byteOffset + this.pos, length);
+        this.pos += length;
+        return bin_text.decode(bytes);
+    }
+}
+
+function decode_uiohook(r, e)
+{
+    e.event_type = bin_events[r.u8()] || "";
+    e.mask = r.u16();
+    e.time = r.u32();
+    if (e.event_type.startsWith("key_")) {
+        e.keycode = r.u16();
+        e.rawcode = r.u16();
+        const keychar = r.u16();
+        if (e.event_type === "key_typed")
+            e.char = String.fromCharCode(keychar);
+    } else if (e.event_type === "mouse_wheel") {
+        e.clicks = r.u16();
+        e.type = r.u8();
+        e.amount = r.u16();
+        e.rotation = r.i16();
+        e.direction = r.u8();
+        e.x = r.i16();
+        e.y = r.i16();
+    } else {
+        e.button = r.u16();
+        e.clicks = r.u16();
+        e.x = r.i16();
+        e.y = r.i16();
+    }
+}
+
+function decode_pad_input(r, e)
+{
+    e.event_type = (r.u8() & 1) ? "gamepad_axis" : "gamepad_button";
+    e.device_index = r.u8();
+    e.time = r.u32();
+    e.virtual_code = r.u16();
+    e.virtual_value = r.f32();
+    e.native_code = r.u16();
+    e.native_value = r.i32();
+    e.device_name = r.str();
+}
+
+function decode_pad_state(r, e)
+{
+    e.event_type = bin_pad_states[r.u8()] || "";
+    e.time = r.u32();
+    e.device_name = r.str();
+}
+
+// Returns an array, a message contains more than one record if the
+// connection asked for batching (?batch=1 or "batch": true when subscribing).
+// Records of unknown kinds are skipped so newer plugins stay compatible.
+function decode_binary_event(buffer)
+{
+    const view = buffer instanceof DataView ? buffer : new DataView(buffer);
+    let events = [];
+    let offset = 0;
+
+    while (offset + 3 <= view.byteLength) {
+        const length = view.getUint16(offset, true);
+        if (length < 3 || offset + length > view.byteLength)
+            break;
+        let r = new binary_reader(view, offset + 2);
+        const kind = r.u8();
+        let e = { event_source: r.str() };
+
+        if (kind === bin_kinds.uiohook)
+            decode_uiohook(r, e);
+        else if (kind === bin_kinds.pad_input)
+            decode_pad_input(r, e);
+        else if (kind === bin_kinds.pad_state)
+            decode_pad_state(r, e);
+        else
+            e = null;
+
+        if (e)
+            events.push(e);
+        offset += length;
+    }
+    return events;
+}
@@ -0,0 +1,65 @@
+/*************************************************************************
+ * This file is part of input-overlay
+ * github.con/univrsal/input-overlay
+ * Copyright 2022 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#pragma once
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+
+/* Keeps stick noise from turning into events. Values inside the deadband
+ * around the centre count as the centre, any other value only passes once
+ * it is at least one step away from the last value that passed. Returning
+ * to the centre and full deflection always pass, so neither end gets
+ * swallowed. Deadband and step are fractions of the distance from the
+ * centre to full deflection.
+ * Sticks are 0 to 1 with the centre at 0.5, triggers 0 to 1 with the
+ * centre at 0. Only meant to be used from the gamepad hook thread */
+class axis_filter {
+    float m_deadband, m_step;
+    std::unordered_map<uint32_t, float> m_last; /* Device index and axis code to the last value that passed */
+
+public:
+    axis_filter(float deadband, float step) : m_deadband(deadband), m_step(step) {}
+
+    bool enabled() const { return m_deadband > 0.f || m_step > 0.f; }
+
+    /* True if the axis moved enough to be reported, centred is false for triggers */
+    bool pass(uint8_t device, uint16_t axis, float value, bool centred)
+    {
+        if (!enabled())
+            return true;
+        /* Filtered as -1 to 1 around the centre, so both ends are 1 away from it */
+        if (centred)
+            value = value * 2.f - 1.f;
+        if (std::fabs(value) < m_deadband)
+            value = 0.f;
+
+        const auto key = uint32_t(device) << 16 | axis;
+        const auto it = m_last.find(key);
+        if (it == m_last.end()) {
+            m_last.emplace(key, value);
+            return true;
+        }
+
+        const auto delta = std::fabs(value - it->second);
+        if (delta == 0.f || (delta < m_step && value != 0.f && std::fabs(value) < 1.f))
+            return false;
+        it->second = value;
+        return true;
+    }
+};
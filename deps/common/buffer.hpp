@@ -20,6 +20,7 @@
 #include <malloc.h>
 #include <cassert>
 #include <cstring>
+#include <utility>
 
 typedef unsigned char byte;
 class buffer {
@@ -47,6 +48,16 @@ public:
         m_write_pos = 0;
     }
 
+    /* Only exchanges the pointers, so one side can keep writing while the
+     * other one sends what was written so far */
+    void swap(buffer &other)
+    {
+        std::swap(m_buf, other.m_buf);
+        std::swap(m_length, other.m_length);
+        std::swap(m_write_pos, other.m_write_pos);
+        std::swap(m_read_pos, other.m_read_pos);
+    }
+
     void resize(size_t new_size)
     {
         assert(new_size < 0xffff);
@@ -63,31 +74,38 @@ public:
         m_write_pos += size;
     }
 
+    /* Replaces the contents of the buffer */
+    void assign(const void *data, size_t size)
+    {
+        reset();
+        write(data, size);
+    }
+
     void read(void **dest, size_t size)
     {
-        if (size + m_read_pos < m_length) {
+        if (size + m_read_pos <= m_write_pos) {
             *dest = reinterpret_cast<void *>(m_buf + m_read_pos);
+            m_read_pos += size;
         }
     }
 
-    template<class T> T *write(const T &val)
+    template<class T> void write(const T &val)
     {
         if (m_write_pos + sizeof(T) >= m_length)
             resize(m_write_pos + sizeof(T) * 1.5);
         memcpy(m_buf + m_write_pos, &val, sizeof(T));
-        auto *res = reinterpret_cast<T *>(m_buf + m_write_pos);
         m_write_pos += sizeof(T);
-        return res;
     }
 
-    template<class T> T *read()
+    /* Copied out, since nothing in the buffer is aligned. False and out is
+     * left alone if there aren't enough bytes left */
+    template<class T> bool read(T &out)
     {
-        if (sizeof(T) + m_read_pos < m_length) {
-            auto result = reinterpret_cast<T *>(m_buf + m_read_pos);
-            m_read_pos += sizeof(T);
-            return result;
-        }
-        return nullptr;
+        if (sizeof(T) + m_read_pos > m_write_pos)
+            return false;
+        memcpy(&out, m_buf + m_read_pos, sizeof(T));
+        m_read_pos += sizeof(T);
+        return true;
     }
 
     byte &operator[](size_t idx) { return m_buf[idx]; }
@@ -48,6 +48,8 @@
 #define CFG_MOUSE_TYPE "mouse_type"
 #define CFG_DIRECTION "direction"
 #define CFG_TRIGGER_MODE "trigger_mode"
+#define CFG_HISTORY_LENGTH "history_length"
+#define CFG_STAT "stat"
 
 /* Misc */
 #define PAD_COUNT 4
@@ -104,5 +106,17 @@ enum element_type {
     /* Shows game pad number 1 through 4 */
     ET_GAMEPAD_ID,
     ET_DPAD_STICK,
-    ET_MOUSE_MOVEMENT
+    ET_MOUSE_MOVEMENT,
+    /* Last key and mouse button presses */
+    ET_INPUT_HISTORY,
+    /* A number from the key press statistics */
+    ET_INPUT_STATS
+};
+
+enum input_stat {
+    IS_APM,         /* Presses per minute */
+    IS_PRESSES,     /* Presses since the source was loaded */
+    IS_KEY_PRESSES, /* Presses of the element's key code */
+    IS_KEY_HOLD,    /* Average hold time of the element's key code in ms */
+    IS_MAX
 };
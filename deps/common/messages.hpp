@@ -5,6 +5,9 @@
  * github.com/univrsal/input-overlay
  */
 #pragma once
+#include <cstdint>
+#include <uiohook.h>
+#include "buffer.hpp"
 
 namespace network {
 enum message : char {
@@ -15,7 +18,7 @@ enum message : char {
     MSG_SERVER_SHUTDOWN,
     MSG_PING_CLIENT,
     MSG_UIOHOOK_EVENT,
-    MSG_MOUSE_WHEEL_RESET,
+    MSG_MOUSE_WHEEL_RESET, /* Not sent anymore, the server times the wheel out on its own */
     MSG_GAMEPAD_EVENT,
     MSG_GAMEPAD_CONNECTED,
     MSG_GAMEPAD_RECONNECTED,
@@ -23,6 +26,235 @@ enum message : char {
     MSG_CLIENT_DC,
     MSG_REFRESH,
     MSG_END_BUFFER,
+    MSG_FRAME,
+    MSG_UIOHOOK_COMPACT,
+    MSG_GAMEPAD_DELTA,
+    MSG_UDP_REQUEST,
+    MSG_UDP_TOKEN,
+    MSG_UDP_PACKET,
+    MSG_COMPACT_RESET,
+    MSG_TIME_SYNC,
+    MSG_TIME_PING,
+    MSG_TIME_PONG,
+    MSG_HELD_STATE,
     MSG_LAST
 };
+
+/* Clients send their messages in frames: MSG_FRAME, the payload size as an
+ * uint16_t and the payload, which is made up of complete messages. That way
+ * the server knows when a message was split across two reads */
+#define FRAME_HEADER_SIZE 3
+#define FRAME_MAX_PAYLOAD 0x4000
+
+/* Optional UDP transport for keyboard and mouse input. The client asks for it
+ * with MSG_UDP_REQUEST over TCP and the server answers with MSG_UDP_TOKEN and
+ * an uint32_t token. Each datagram (MSG_UDP_PACKET) is then made up of:
+ *  - uint32_t: token, uint32_t: sequence number, uint64_t: client time in ms
+ *  - uint8_t: number of held keys, then an uint16_t key code for each
+ *  - uint8_t: number of held mouse buttons, then an uint8_t for each
+ *  - frames, like over TCP
+ * Late or repeated packets are dropped and the held keys and buttons fix up
+ * any press or release that got lost. Both sides reset their
+ * compact_event_state for every packet, MSG_COMPACT_RESET does the same for
+ * event batches that were too large and went over TCP instead. Everything
+ * else, including gamepads, stays on TCP */
+#define UDP_PACKET_SIZE 0x2000
+#define UDP_HEADER_SIZE (1 + 2 * sizeof(uint32_t) + sizeof(uint64_t))
+
+/* Clock sync. Clients that understand it send MSG_TIME_SYNC after their name,
+ * the server then sends MSG_TIME_PING with its time in ns as an uint64_t every
+ * TIME_SYNC_INTERVAL ms. The client answers with a framed MSG_TIME_PONG, which
+ * contains the server time from the ping and its own time in µs, so the server
+ * can estimate the round trip time and the offset between both clocks. Event
+ * times of these clients are in ms of the same clock */
+#define TIME_SYNC_INTERVAL 1000
+
+/* Sent by clients after they reconnected (MSG_HELD_STATE), contains the held
+ * keys and mouse buttons like an udp packet header. Connected gamepads follow
+ * as MSG_GAMEPAD_CONNECTED and a full MSG_GAMEPAD_EVENT each, so the server
+ * doesn't have to wait until everything was pressed again */
+
+/* Gamepad state changes (MSG_GAMEPAD_DELTA), a full MSG_GAMEPAD_EVENT is
+ * still sent every GAMEPAD_KEYFRAME_INTERVAL ms so the server can resync:
+ *  - uint8_t: device index
+ *  - uint8_t: GAMEPAD_DELTA_* flags
+ *  - uint8_t: button count, then uint16_t code and uint8_t state for each
+ *  - uint8_t: axis count, then uint16_t code and float value for each
+ *  - last axis and/or button event (uint16_t vc, float value, uint64_t time)
+ *    if the flag for it is set */
+#define GAMEPAD_KEYFRAME_INTERVAL 1000
+#define GAMEPAD_DELTA_AXIS_EVENT (1 << 0)
+#define GAMEPAD_DELTA_BUTTON_EVENT (1 << 1)
+
+/* Compact uiohook events (MSG_UIOHOOK_COMPACT), independent of the struct
+ * layout of the platform:
+ *  - uint8_t: COMPACT_EVENT_VERSION << 4 | event type
+ *  - varint: milliseconds since the previous event
+ *  - varint: modifier mask
+ *  - keys: keycode, rawcode and for typed events the keychar as varints
+ *  - mouse buttons: button, clicks, x and y delta
+ *  - mouse movement: x and y delta
+ *  - wheel: clicks, x and y delta, type, amount, rotation, direction
+ * Deltas are zigzag encoded varints relative to the last mouse position, so
+ * both sides have to keep a compact_event_state per connection */
+#define COMPACT_EVENT_VERSION 1
+#define COMPACT_EVENT_MAX_SIZE 40 /* Including the message id */
+
+struct compact_event_state {
+    uint64_t time = 0;
+    int16_t x = 0, y = 0;
+};
+
+inline void write_varint(buffer &buf, uint64_t value)
+{
+    while (value >= 0x80) {
+        buf.write<uint8_t>(uint8_t(value) | 0x80);
+        value >>= 7;
+    }
+    buf.write<uint8_t>(uint8_t(value));
+}
+
+inline bool read_varint(buffer &buf, uint64_t &value)
+{
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        uint8_t next;
+        if (!buf.read(next))
+            return false;
+        value |= uint64_t(next & 0x7f) << shift;
+        if (!(next & 0x80))
+            return true;
+    }
+    return false;
+}
+
+inline uint32_t zigzag(int32_t value)
+{
+    return (uint32_t(value) << 1) ^ uint32_t(value >> 31);
+}
+
+inline int32_t unzigzag(uint32_t value)
+{
+    return int32_t(value >> 1) ^ -int32_t(value & 1);
+}
+
+inline void write_compact_event(buffer &buf, compact_event_state &state, const uiohook_event &event)
+{
+    auto write_pos = [&](int16_t x, int16_t y) {
+        write_varint(buf, zigzag(x - state.x));
+        write_varint(buf, zigzag(y - state.y));
+        state.x = x;
+        state.y = y;
+    };
+
+    buf.write<uint8_t>(MSG_UIOHOOK_COMPACT);
+    buf.write<uint8_t>(uint8_t(COMPACT_EVENT_VERSION << 4 | (event.type & 0xf)));
+    write_varint(buf, event.time > state.time ? event.time - state.time : 0);
+    if (event.time > state.time)
+        state.time = event.time;
+    write_varint(buf, event.mask);
+
+    switch (event.type) {
+    case EVENT_KEY_TYPED:
+    case EVENT_KEY_PRESSED:
+    case EVENT_KEY_RELEASED:
+        write_varint(buf, event.data.keyboard.keycode);
+        write_varint(buf, event.data.keyboard.rawcode);
+        if (event.type == EVENT_KEY_TYPED)
+            write_varint(buf, event.data.keyboard.keychar);
+        break;
+    case EVENT_MOUSE_CLICKED:
+    case EVENT_MOUSE_PRESSED:
+    case EVENT_MOUSE_RELEASED:
+        write_varint(buf, event.data.mouse.button);
+        write_varint(buf, event.data.mouse.clicks);
+        write_pos(event.data.mouse.x, event.data.mouse.y);
+        break;
+    case EVENT_MOUSE_MOVED:
+    case EVENT_MOUSE_DRAGGED:
+        write_pos(event.data.mouse.x, event.data.mouse.y);
+        break;
+    case EVENT_MOUSE_WHEEL:
+        write_varint(buf, event.data.wheel.clicks);
+        write_pos(event.data.wheel.x, event.data.wheel.y);
+        write_varint(buf, event.data.wheel.type);
+        write_varint(buf, event.data.wheel.amount);
+        write_varint(buf, zigzag(event.data.wheel.rotation));
+        write_varint(buf, event.data.wheel.direction);
+        break;
+    default:;
+    }
+}
+
+/* Reads the event after the MSG_UIOHOOK_COMPACT id, returns false if the
+ * data was incomplete or from an unknown version */
+inline bool read_compact_event(buffer &buf, compact_event_state &state, uiohook_event &event)
+{
+    uint64_t values[6];
+    auto read = [&](int count) {
+        for (int i = 0; i < count; i++) {
+            if (!read_varint(buf, values[i]))
+                return false;
+        }
+        return true;
+    };
+    auto read_pos = [&](uint64_t dx, uint64_t dy, int16_t &x, int16_t &y) {
+        state.x = int16_t(state.x + unzigzag(uint32_t(dx)));
+        state.y = int16_t(state.y + unzigzag(uint32_t(dy)));
+        x = state.x;
+        y = state.y;
+    };
+
+    uint8_t header;
+    if (!buf.read(header) || header >> 4 != COMPACT_EVENT_VERSION || !read(2))
+        return false;
+
+    event = {};
+    event.type = event_type(header & 0xf);
+    state.time += values[0];
+    event.time = state.time;
+    event.mask = uint16_t(values[1]);
+
+    switch (event.type) {
+    case EVENT_KEY_TYPED:
+    case EVENT_KEY_PRESSED:
+    case EVENT_KEY_RELEASED:
+        if (!read(event.type == EVENT_KEY_TYPED ? 3 : 2))
+            return false;
+        event.data.keyboard.keycode = uint16_t(values[0]);
+        event.data.keyboard.rawcode = uint16_t(values[1]);
+        event.data.keyboard.keychar = event.type == EVENT_KEY_TYPED ? uint16_t(values[2]) : CHAR_UNDEFINED;
+        break;
+    case EVENT_MOUSE_CLICKED:
+    case EVENT_MOUSE_PRESSED:
+    case EVENT_MOUSE_RELEASED:
+        if (!read(4))
+            return false;
+        event.data.mouse.button = uint16_t(values[0]);
+        event.data.mouse.clicks = uint16_t(values[1]);
+        read_pos(values[2], values[3], event.data.mouse.x, event.data.mouse.y);
+        break;
+    case EVENT_MOUSE_MOVED:
+    case EVENT_MOUSE_DRAGGED:
+        if (!read(2))
+            return false;
+        read_pos(values[0], values[1], event.data.mouse.x, event.data.mouse.y);
+        break;
+    case EVENT_MOUSE_WHEEL:
+        if (!read(3))
+            return false;
+        event.data.wheel.clicks = uint16_t(values[0]);
+        read_pos(values[1], values[2], event.data.wheel.x, event.data.wheel.y);
+        if (!read(4))
+            return false;
+        event.data.wheel.type = uint8_t(values[0]);
+        event.data.wheel.amount = uint16_t(values[1]);
+        event.data.wheel.rotation = int16_t(unzigzag(uint32_t(values[2])));
+        event.data.wheel.direction = uint8_t(values[3]);
+        break;
+    default:
+        return false;
+    }
+    return true;
+}
 }
@@ -0,0 +1,72 @@
+/*************************************************************************
+ * This file is part of input-overlay
+ * github.con/univrsal/input-overlay
+ * Copyright 2022 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#define PAD_IDLE_DELAY 2000 /* Ms without gamepad input before polling slows down */
+
+/* Decides how long a polling thread sleeps between polls. While input keeps
+ * arriving the short interval is used, once nothing happened for a while
+ * the thread backs off to the long one. The first input after idling brings
+ * it straight back to the short interval */
+class poll_governor {
+public:
+    typedef std::chrono::microseconds interval;
+
+private:
+    typedef std::chrono::steady_clock clock;
+
+    interval m_active, m_idle;
+    clock::duration m_idle_after;
+    std::atomic<clock::rep> m_last_input;
+    std::atomic<bool> m_idling{false};
+
+public:
+    poll_governor(interval active, interval idle, std::chrono::milliseconds idle_after)
+        : m_active(active),
+          m_idle(idle),
+          m_idle_after(idle_after),
+          m_last_input(clock::now().time_since_epoch().count())
+    {
+    }
+
+    interval active() const { return m_active; }
+    interval idle() const { return m_idle; }
+    interval current() const { return m_idling ? m_idle : m_active; }
+
+    /* Call for every input, true if the poll interval has to be changed to active() */
+    bool on_input()
+    {
+        m_last_input.store(clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+        return m_idling.exchange(false);
+    }
+
+    /* Call periodically, true if the poll interval has to be changed to idle() */
+    bool check_idle()
+    {
+        if (m_idling || m_idle <= m_active)
+            return false;
+        const auto last = clock::time_point(clock::duration(m_last_input.load(std::memory_order_relaxed)));
+        if (clock::now() - last < m_idle_after)
+            return false;
+        return !m_idling.exchange(true);
+    }
+};
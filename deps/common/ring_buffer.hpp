@@ -0,0 +1,147 @@
+/*************************************************************************
+ * This file is part of input-overlay
+ * github.con/univrsal/input-overlay
+ * Copyright 2022 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+/* What write() does if the data doesn't fit */
+enum ring_overflow {
+    RING_REJECT,   /* Nothing is written and write() returns false */
+    RING_OVERWRITE /* The oldest data is dropped, only safe with one thread */
+};
+
+/* Fixed size byte ring buffer. Never allocates, so bursts can't make it grow.
+ * With RING_REJECT one thread can write while another one reads. Typed reads
+ * copy the bytes out, so they don't depend on the alignment of the data */
+template<size_t N, ring_overflow Policy = RING_REJECT> class ring_buffer {
+    static_assert(N && (N & (N - 1)) == 0, "Capacity has to be a power of two");
+
+    /* Positions only ever grow, the offset in m_data is pos & (N - 1) */
+    alignas(64) std::atomic<size_t> m_head{0}; /* Next byte to read, written by the reader */
+    alignas(64) std::atomic<size_t> m_tail{0}; /* Next byte to write, written by the writer */
+    alignas(64) uint8_t m_data[N];
+
+    void copy_out(void *dest, size_t pos, size_t size) const
+    {
+        const auto offset = pos & (N - 1);
+        const auto first = size < N - offset ? size : N - offset;
+        memcpy(dest, m_data + offset, first);
+        memcpy(static_cast<uint8_t *>(dest) + first, m_data, size - first);
+    }
+
+public:
+    static constexpr size_t capacity() { return N; }
+
+    size_t size() const { return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire); }
+    size_t space() const { return N - size(); }
+    bool empty() const { return size() == 0; }
+
+    /* Writer */
+    bool write(const void *data, size_t size)
+    {
+        if (size > N)
+            return false;
+        const auto tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head.load(std::memory_order_acquire) + size > N) {
+            if (Policy == RING_REJECT)
+                return false;
+            m_head.store(tail + size - N, std::memory_order_relaxed);
+        }
+
+        const auto offset = tail & (N - 1);
+        const auto first = size < N - offset ? size : N - offset;
+        memcpy(m_data + offset, data, first);
+        memcpy(m_data, static_cast<const uint8_t *>(data) + first, size - first);
+        m_tail.store(tail + size, std::memory_order_release);
+        return true;
+    }
+
+    template<class T> bool write(const T &val)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "Only plain data can be written");
+        return write(&val, sizeof(T));
+    }
+
+    /* Free space that can be filled directly, e.g. by recv(). Call commit()
+     * with the number of bytes that were actually written */
+    uint8_t *write_span(size_t &size)
+    {
+        const auto tail = m_tail.load(std::memory_order_relaxed);
+        const auto offset = tail & (N - 1);
+        const auto available = N - (tail - m_head.load(std::memory_order_acquire));
+        size = available < N - offset ? available : N - offset;
+        return m_data + offset;
+    }
+
+    void commit(size_t size) { m_tail.store(m_tail.load(std::memory_order_relaxed) + size, std::memory_order_release); }
+
+    /* Reader */
+    bool peek(void *dest, size_t size, size_t offset = 0) const
+    {
+        if (offset + size > this->size())
+            return false;
+        copy_out(dest, m_head.load(std::memory_order_relaxed) + offset, size);
+        return true;
+    }
+
+    template<class T> bool peek(T &out, size_t offset = 0) const
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "Only plain data can be read");
+        return peek(&out, sizeof(T), offset);
+    }
+
+    bool read(void *dest, size_t size)
+    {
+        if (!peek(dest, size))
+            return false;
+        skip(size);
+        return true;
+    }
+
+    template<class T> bool read(T &out) { return read(&out, sizeof(T)); }
+
+    /* Hands the next size bytes to sink(const uint8_t *, size_t) in at most two
+     * pieces without copying them first, then drops them */
+    template<class F> bool consume(size_t size, F &&sink)
+    {
+        if (size > this->size())
+            return false;
+        const auto head = m_head.load(std::memory_order_relaxed);
+        const auto offset = head & (N - 1);
+        const auto first = size < N - offset ? size : N - offset;
+        sink(m_data + offset, first);
+        if (size > first)
+            sink(m_data, size - first);
+        m_head.store(head + size, std::memory_order_release);
+        return true;
+    }
+
+    void skip(size_t size)
+    {
+        const auto available = this->size();
+        m_head.store(m_head.load(std::memory_order_relaxed) + (size < available ? size : available),
+                     std::memory_order_release);
+    }
+
+    /* Reader only, drops everything */
+    void clear() { m_head.store(m_tail.load(std::memory_order_acquire), std::memory_order_release); }
+};
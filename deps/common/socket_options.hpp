@@ -0,0 +1,71 @@
+/*************************************************************************
+ * This file is part of input-overlay
+ * github.con/univrsal/input-overlay
+ * Copyright 2022 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#pragma once
+#include <netlib.h>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#endif
+
+/* Send buffer of tuned tcp sockets, input messages are small so this is
+ * mostly about not blocking when a batch of gamepad keyframes goes out */
+#define SOCKET_SEND_BUFFER (64 * 1024)
+
+namespace network {
+#ifdef _WIN32
+typedef SOCKET native_socket;
+#else
+typedef int native_socket;
+#endif
+
+/* netlib doesn't expose the native handle of its sockets, this mirrors the
+ * start of its private tcp and udp socket structs (the same ones SDL_net uses) */
+struct netlib_socket_layout {
+    int ready;
+    native_socket channel;
+};
+
+inline native_socket native_handle(void *socket)
+{
+    return static_cast<netlib_socket_layout *>(socket)->channel;
+}
+
+/* Input has to go out right away, so Nagle's algorithm is turned off. Every
+ * send is already one batch of messages, so this doesn't cause tiny packets.
+ * send_buffer is in bytes, zero keeps the system default. Returns false if
+ * an option couldn't be set, the socket still works in that case */
+inline bool tune_tcp_socket(tcp_socket socket, int send_buffer = SOCKET_SEND_BUFFER)
+{
+    const auto fd = native_handle(socket);
+    const int nodelay = 1;
+    bool result = setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char *>(&nodelay),
+                             sizeof(nodelay)) == 0;
+    if (send_buffer > 0) {
+        result = setsockopt(fd, SOL_SOCKET, SO_SNDBUF, reinterpret_cast<const char *>(&send_buffer),
+                            sizeof(send_buffer)) == 0 &&
+                 result;
+    }
+    return result;
+}
+}
@@ -17,12 +17,14 @@
  *************************************************************************/
 
 #include "io_settings_dialog.hpp"
+#include "ui_events.hpp"
 #include "../network/io_server.hpp"
 #include "../network/remote_connection.hpp"
 #include "ui_io_settings_dialog.h"
 #include "../util/config.hpp"
 #include "../util/lang.h"
 #include "../util/obs_util.hpp"
+#include "../util/source_costs.hpp"
 #include "../hook/gamepad_hook_helper.hpp"
 #include <libgamepad.hpp>
 #include <QDesktopServices>
@@ -100,10 +102,13 @@ io_settings_dialog::io_settings_dialog(QWidget *parent) : QDialog(parent, Qt::Di
         text.replace(pos, strlen("%s"), network::local_ip);
     ui->lbl_status->setText(text.c_str());
 
-    /* Check for new connections every 250ms */
-    m_refresh = new QTimer(this);
-    connect(m_refresh, SIGNAL(timeout()), SLOT(RefreshUi()));
-    m_refresh->start(250);
+    /* The hooks and the server post changes from their own threads */
+    connect(this, &io_settings_dialog::ChangesPosted, this, &io_settings_dialog::HandleChanges, Qt::QueuedConnection);
+
+    /* Latency stats change all the time, nobody posts them */
+    m_latency = new QTimer(this);
+    connect(m_latency, &QTimer::timeout, this, &io_settings_dialog::RefreshLatency);
+    connect(m_latency, &QTimer::timeout, this, &io_settings_dialog::RefreshCosts);
 
     /* Add current open windows to filter list */
     if (io_config::enable_input_control)
@@ -154,7 +159,21 @@ io_settings_dialog::io_settings_dialog(QWidget *parent) : QDialog(parent, Qt::Di
 void io_settings_dialog::showEvent(QShowEvent *event)
 {
     Q_UNUSED(event)
+    /* Nothing was posted while hidden, so everything has to be checked once */
+    m_pending = 0;
+    m_listening = true;
     RefreshUi();
+    /* Sources only measure themselves while someone is looking */
+    source_costs::enabled = true;
+    m_latency->start(1000);
+}
+
+void io_settings_dialog::hideEvent(QHideEvent *event)
+{
+    Q_UNUSED(event)
+    m_listening = false;
+    source_costs::enabled = false;
+    m_latency->stop();
 }
 
 void io_settings_dialog::toggleShowHide()
@@ -163,80 +182,175 @@ void io_settings_dialog::toggleShowHide()
     load_bindings();
 }
 
+void io_settings_dialog::post_changes(uint32_t changes)
+{
+    if (!m_listening)
+        return;
+    /* Only the first change since the last HandleChanges posts an event */
+    if (m_pending.fetch_or(changes) == 0)
+        emit ChangesPosted();
+}
+
+void io_settings_dialog::HandleChanges()
+{
+    const auto changes = m_pending.exchange(0);
+    if (changes & ui_events::CHANGE_CLIENTS) {
+        refresh_clients(false);
+        RefreshLatency();
+    }
+    if (changes & ui_events::CHANGE_PADS)
+        refresh_pads();
+    if (changes & ui_events::CHANGE_PAD_INPUT)
+        refresh_pad_input();
+}
+
 void io_settings_dialog::RefreshUi()
+{
+    refresh_clients(true);
+    RefreshLatency();
+    refresh_pads();
+    refresh_pad_input();
+}
+
+void io_settings_dialog::refresh_clients(bool force)
 {
     /* Populate client list */
-    if (network::network_flag && network::server_instance) {
-        std::lock_guard<std::mutex> lock(network::mutex);
-        if (network::server_instance->clients_changed()) {
-            ui->box_connections->clear();
-            QStringList list;
-            std::vector<const char *> names;
-            /* I'd do it differently, but including Qt headers and obs headers
-         * creates conflicts with LOG_WARNING...
-         */
-            network::server_instance->get_clients(names);
+    if (!network::network_flag || !network::server_instance)
+        return;
+    std::lock_guard<traced_mutex> lock(network::mutex);
+    if (!network::server_instance || (!force && !network::server_instance->clients_changed()))
+        return;
 
-            for (auto &name : names)
-                list.append(name);
-            ui->box_connections->addItems(list);
-        }
+    ui->box_connections->clear();
+    QStringList list;
+    std::vector<const char *> names;
+    /* I'd do it differently, but including Qt headers and obs headers
+     * creates conflicts with LOG_WARNING...
+     */
+    network::server_instance->get_clients(names);
+
+    for (auto &name : names)
+        list.append(name);
+    ui->box_connections->addItems(list);
+    for (int i = 0; i < ui->box_connections->count(); i++) {
+        auto *item = ui->box_connections->item(i);
+        item->setData(Qt::UserRole, item->text());
     }
+}
 
-    if (libgamepad::state) {
-        gamepad::device_list devs;
-        {
-            auto &mutex = *libgamepad::hook_instance->get_mutex();
-            std::lock_guard<std::mutex> lock(mutex);
-            devs = libgamepad::hook_instance->get_devices();
-        }
+void io_settings_dialog::RefreshLatency()
+{
+    if (!network::network_flag || !network::server_instance || ui->box_connections->count() == 0)
+        return;
+    std::lock_guard<traced_mutex> lock(network::mutex);
+    if (!network::server_instance)
+        return;
 
-        /* Fill device list */
-        if (int(devs.size()) != ui->cb_device->count()) {
-            auto selected = ui->cb_device->currentIndex();
-            ui->cb_device->clear();
-            for (const auto &dev : devs) {
-                ui->cb_device->addItem(utf8_to_qt(dev->get_name().c_str()),
-                                       QVariant::fromValue(utf8_to_qt(dev->get_id().c_str())));
-            }
-            ui->cb_device->setCurrentIndex(selected);
+    /* Latency of each client, the stats have their own lock */
+    for (int i = 0; i < ui->box_connections->count(); i++) {
+        auto *item = ui->box_connections->item(i);
+        const auto name = item->data(Qt::UserRole).toString();
+        auto client = network::server_instance->get_client(name.toStdString());
+        if (!client)
+            continue;
+        const auto info = client->latency();
+        QString text;
+        if (info.synced) {
+            text = QString::asprintf(T_REMOTE_LATENCY, qPrintable(name), info.p50, info.p99, info.jitter,
+                                     info.events_per_second, info.rtt);
+        } else {
+            text = QString::asprintf(T_REMOTE_LATENCY_UNKNOWN, qPrintable(name));
+        }
+        if (const auto dropped = client->limiter().dropped_frames()) {
+            text += QString::asprintf(T_REMOTE_DROPPED, (unsigned long long)dropped,
+                                      (unsigned long long)client->limiter().dropped_bytes() / 1024);
         }
+        item->setText(text);
+    }
+}
+
+void io_settings_dialog::RefreshCosts()
+{
+    const auto costs = source_costs::collect();
+    while (ui->box_costs->count() > int(costs.size()))
+        delete ui->box_costs->takeItem(ui->box_costs->count() - 1);
+
+    /* Items are reused so the selection and scroll position survive a refresh */
+    for (size_t i = 0; i < costs.size(); i++) {
+        const auto &c = costs[i];
+        const auto gpu = c.gpu < 0 ? QString(T_COSTS_GPU_UNKNOWN) : QString::asprintf("%.1f", c.gpu);
+        const auto text = QString::asprintf(T_COSTS_ENTRY, c.name.c_str(), c.tick, c.render, qPrintable(gpu),
+                                            c.elements, c.draw_calls, c.bytes / 1024.f);
+        if (int(i) < ui->box_costs->count())
+            ui->box_costs->item(int(i))->setText(text);
+        else
+            ui->box_costs->addItem(text);
+    }
+}
+
+void io_settings_dialog::refresh_pads()
+{
+    if (!libgamepad::state)
+        return;
 
-        // Select something if nothing is selected
-        if (ui->cb_device->currentText().isEmpty() && !devs.empty()) {
-            ui->cb_device->setCurrentIndex(0);
+    gamepad::device_list devs;
+    {
+        auto &mutex = *libgamepad::hook_instance->get_mutex();
+        std::lock_guard<std::mutex> lock(mutex);
+        devs = libgamepad::hook_instance->get_devices();
+    }
+
+    /* Fill device list */
+    if (int(devs.size()) != ui->cb_device->count()) {
+        auto selected = ui->cb_device->currentIndex();
+        ui->cb_device->clear();
+        for (const auto &dev : devs) {
+            ui->cb_device->addItem(utf8_to_qt(dev->get_name().c_str()),
+                                   QVariant::fromValue(utf8_to_qt(dev->get_id().c_str())));
         }
+        ui->cb_device->setCurrentIndex(selected);
+    }
 
-        libgamepad::last_input_mutex.lock();
-        if (m_last_gamepad_input < libgamepad::last_input_time) {
-            m_last_gamepad_input = libgamepad::last_input_time;
-            auto mylineEdits = ui->scrollArea->findChildren<QWidget *>();
-            QListIterator<QWidget *> it(mylineEdits);
-            QWidget *lineEditField;
-            while (it.hasNext()) {
-                lineEditField = it.next();
-                if (auto lineE = qobject_cast<QLineEdit *>(lineEditField)) {
-                    if (lineE->hasFocus()) {
-                        // LT and RT are the same axis in DInput, so we save the polarity here
-                        if (libgamepad::flags & gamepad::hook_type::DIRECT_INPUT &&
-                            (lineE->objectName() == "txt_lt" || lineE->objectName() == "txt_rt")) {
-                            /* Set the binding of this textbox */
-                            if (libgamepad::last_input_value != 0) { // 0 is both left and right trigger
-                                lineE->setText((libgamepad::last_input_value < 0 ? "-" : "+") +
-                                               QString::number(libgamepad::last_input));
-                            }
-                        } else {
-                            /* Set the binding of this textbox */
-                            lineE->setText(QString::number(libgamepad::last_input));
-                        }
+    // Select something if nothing is selected
+    if (ui->cb_device->currentText().isEmpty() && !devs.empty()) {
+        ui->cb_device->setCurrentIndex(0);
+    }
+}
 
-                        break;
+void io_settings_dialog::refresh_pad_input()
+{
+    if (!libgamepad::state)
+        return;
+
+    libgamepad::last_input_mutex.lock();
+    if (m_last_gamepad_input < libgamepad::last_input_time) {
+        m_last_gamepad_input = libgamepad::last_input_time;
+        auto mylineEdits = ui->scrollArea->findChildren<QWidget *>();
+        QListIterator<QWidget *> it(mylineEdits);
+        QWidget *lineEditField;
+        while (it.hasNext()) {
+            lineEditField = it.next();
+            if (auto lineE = qobject_cast<QLineEdit *>(lineEditField)) {
+                if (lineE->hasFocus()) {
+                    // LT and RT are the same axis in DInput, so we save the polarity here
+                    if (libgamepad::flags & gamepad::hook_type::DIRECT_INPUT &&
+                        (lineE->objectName() == "txt_lt" || lineE->objectName() == "txt_rt")) {
+                        /* Set the binding of this textbox */
+                        if (libgamepad::last_input_value != 0) { // 0 is both left and right trigger
+                            lineE->setText((libgamepad::last_input_value < 0 ? "-" : "+") +
+                                           QString::number(libgamepad::last_input));
+                        }
+                    } else {
+                        /* Set the binding of this textbox */
+                        lineE->setText(QString::number(libgamepad::last_input));
                     }
+
+                    break;
                 }
             }
         }
-        libgamepad::last_input_mutex.unlock();
     }
+    libgamepad::last_input_mutex.unlock();
 }
 
 void io_settings_dialog::CbRemoteStateChanged(int state)
@@ -357,9 +471,12 @@ void io_settings_dialog::FormAccepted()
 
 io_settings_dialog::~io_settings_dialog()
 {
+    m_listening = false;
+    if (settings_dialog == this)
+        settings_dialog = nullptr;
+    m_latency->stop();
     delete ui;
-    m_refresh->stop();
-    delete m_refresh;
+    delete m_latency;
 }
 
 void io_settings_dialog::OpenGitHub()
@@ -638,3 +755,11 @@ void io_settings_dialog::load_binding_from_ui(std::shared_ptr<gamepad::cfg::bind
         }
     }
 }
+
+namespace ui_events {
+void notify(uint32_t changes)
+{
+    if (settings_dialog)
+        settings_dialog->post_changes(changes);
+}
+}
@@ -19,6 +19,7 @@
 #pragma once
 
 #include <QDialog>
+#include <atomic>
 #include <mutex>
 #include <memory>
 
@@ -42,12 +43,27 @@ public:
 
     void showEvent(QShowEvent *event) override;
 
+    void hideEvent(QHideEvent *event) override;
+
     void toggleShowHide();
 
+    /* Called through ui_events::notify, possibly from another thread */
+    void post_changes(uint32_t changes);
+
+Q_SIGNALS:
+
+    void ChangesPosted();
+
 private Q_SLOTS:
 
     void RefreshUi();
 
+    void HandleChanges();
+
+    void RefreshLatency();
+
+    void RefreshCosts();
+
     void FormAccepted();
 
     void CbRemoteStateChanged(int state);
@@ -86,9 +102,14 @@ private:
     void load_bindings();
     void load_binding_to_ui(const std::shared_ptr<gamepad::cfg::binding> &binding);
     void load_binding_from_ui(std::shared_ptr<gamepad::cfg::binding> binding);
+    void refresh_clients(bool force);
+    void refresh_pads();
+    void refresh_pad_input();
     uint64_t m_last_gamepad_input = 0;
     Ui::io_config_dialog *ui;
-    QTimer *m_refresh = nullptr;
+    QTimer *m_latency = nullptr; /* Only runs while the dialog is visible */
+    std::atomic<bool> m_listening{false};
+    std::atomic<uint32_t> m_pending{0};
     std::vector<std::string> m_bindings_to_remove;
 };
 
@@ -0,0 +1,35 @@
+/*************************************************************************
+ * This file is part of input-overlay
+ * github.con/univrsal/input-overlay
+ * Copyright 2022 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+
+/* Lets the hooks and the server tell the settings dialog that something
+ * changed without including any Qt headers */
+namespace ui_events {
+enum change : uint32_t {
+    CHANGE_CLIENTS = 1 << 0,
+    CHANGE_PADS = 1 << 1,
+    CHANGE_PAD_INPUT = 1 << 2,
+};
+
+/* Safe to call from any thread, does nothing while the dialog is hidden.
+ * Notifications are coalesced until the dialog got around to handling them */
+void notify(uint32_t changes);
+}
@@ -0,0 +1,32 @@
+/*************************************************************************
+ * This file is part of input-overlay
+ * github.con/univrsal/input-overlay
+ * Copyright 2022 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#pragma once
+
+/* Alternative to libuiohook's XRecord hook on Linux. Reads keyboards and
+ * mice straight from /dev/input/event*, so it also works under Wayland and
+ * doesn't cost an X round trip per event. The user has to be able to read
+ * the device nodes, usually by being in the input group */
+namespace uiohook {
+namespace evdev {
+/* Returns false if no keyboard or mouse could be opened */
+bool start();
+
+void stop();
+}
+}
@@ -0,0 +1,500 @@
+/*************************************************************************
+ * This file is part of input-overlay
+ * github.con/univrsal/input-overlay
+ * Copyright 2022 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#include "evdev_helper.hpp"
+#include "uiohook_helper.hpp"
+#include "../util/log.h"
+#include "../util/thread_priority.hpp"
+#include <linux/input.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/ioctl.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <ctime>
+#include <map>
+#include <string>
+#include <thread>
+#include <util/threading.h>
+
+#define INPUT_DIR "/dev/input"
+#define EVENTS_PER_READ 64
+
+namespace uiohook {
+namespace evdev {
+static std::thread thread;
+static std::atomic<bool> flag{false};
+static int epoll_fd = -1, stop_fd = -1, watch_fd = -1;
+static std::map<int, std::string> devices; /* fd to path, only used by the evdev thread */
+
+/* Kernel codes up to KEY_KPDOT are the same as uiohook's (set 1 scan codes) */
+static uint16_t to_vc(uint16_t code)
+{
+    if (code <= KEY_KPDOT)
+        return code;
+    switch (code) {
+    case KEY_F11:
+        return VC_F11;
+    case KEY_F12:
+        return VC_F12;
+    case KEY_KPENTER:
+        return VC_KP_ENTER;
+    case KEY_RIGHTCTRL:
+        return VC_CONTROL_R;
+    case KEY_KPSLASH:
+        return VC_KP_DIVIDE;
+    case KEY_SYSRQ:
+        return VC_PRINTSCREEN;
+    case KEY_RIGHTALT:
+        return VC_ALT_R;
+    case KEY_HOME:
+        return VC_HOME;
+    case KEY_UP:
+        return VC_UP;
+    case KEY_PAGEUP:
+        return VC_PAGE_UP;
+    case KEY_LEFT:
+        return VC_LEFT;
+    case KEY_RIGHT:
+        return VC_RIGHT;
+    case KEY_END:
+        return VC_END;
+    case KEY_DOWN:
+        return VC_DOWN;
+    case KEY_PAGEDOWN:
+        return VC_PAGE_DOWN;
+    case KEY_INSERT:
+        return VC_INSERT;
+    case KEY_DELETE:
+        return VC_DELETE;
+    case KEY_KPEQUAL:
+        return VC_KP_EQUALS;
+    case KEY_PAUSE:
+        return VC_PAUSE;
+    case KEY_LEFTMETA:
+        return VC_META_L;
+    case KEY_RIGHTMETA:
+        return VC_META_R;
+    case KEY_COMPOSE:
+        return VC_CONTEXT_MENU;
+    case KEY_MUTE:
+        return VC_VOLUME_MUTE;
+    case KEY_VOLUMEDOWN:
+        return VC_VOLUME_DOWN;
+    case KEY_VOLUMEUP:
+        return VC_VOLUME_UP;
+    case KEY_NEXTSONG:
+        return VC_MEDIA_NEXT;
+    case KEY_PLAYPAUSE:
+        return VC_MEDIA_PLAY;
+    case KEY_PREVIOUSSONG:
+        return VC_MEDIA_PREVIOUS;
+    case KEY_STOPCD:
+        return VC_MEDIA_STOP;
+    default:
+        break;
+    }
+    if (code >= KEY_F13 && code <= KEY_F15)
+        return uint16_t(VC_F13 + (code - KEY_F13));
+    if (code >= KEY_F16 && code <= KEY_F24)
+        return uint16_t(VC_F16 + (code - KEY_F16));
+    return VC_UNDEFINED;
+}
+
+static uint16_t to_button(uint16_t code)
+{
+    switch (code) {
+    case BTN_LEFT:
+        return MOUSE_BUTTON1;
+    case BTN_RIGHT:
+        return MOUSE_BUTTON2;
+    case BTN_MIDDLE:
+        return MOUSE_BUTTON3;
+    case BTN_SIDE:
+        return MOUSE_BUTTON4;
+    case BTN_EXTRA:
+        return MOUSE_BUTTON5;
+    default:
+        return 0;
+    }
+}
+
+static uint16_t key_mask(uint16_t vc)
+{
+    switch (vc) {
+    case VC_SHIFT_L:
+        return MASK_SHIFT_L;
+    case VC_SHIFT_R:
+        return MASK_SHIFT_R;
+    case VC_CONTROL_L:
+        return MASK_CTRL_L;
+    case VC_CONTROL_R:
+        return MASK_CTRL_R;
+    case VC_ALT_L:
+        return MASK_ALT_L;
+    case VC_ALT_R:
+        return MASK_ALT_R;
+    case VC_META_L:
+        return MASK_META_L;
+    case VC_META_R:
+        return MASK_META_R;
+    default:
+        return 0;
+    }
+}
+
+/* State shared by all devices, uiohook reports one virtual pointer and a
+ * single modifier mask as well */
+static uint16_t mask = 0;
+static int32_t mouse_x = 0, mouse_y = 0;
+static int32_t rel_x = 0, rel_y = 0, wheel_v = 0, wheel_h = 0;
+static bool moved_since_press = false;
+
+/* Kernel timestamps are on CLOCK_MONOTONIC, see open_device */
+static uint64_t event_ns(const input_event &ev)
+{
+    return uint64_t(ev.input_event_sec) * 1000000000 + uint64_t(ev.input_event_usec) * 1000;
+}
+
+static void post(uiohook_event &event, uint64_t time)
+{
+    event.mask = mask;
+    push_event(&event, time);
+}
+
+static void post_key(const input_event &ev)
+{
+    const auto vc = to_vc(ev.code);
+    if (vc == VC_UNDEFINED)
+        return;
+    /* Auto repeat (2) is reported as another press, like the X11 hook does */
+    const auto pressed = ev.value != 0;
+    if (pressed)
+        mask |= key_mask(vc);
+    else
+        mask &= ~key_mask(vc);
+
+    uiohook_event event{};
+    event.type = pressed ? EVENT_KEY_PRESSED : EVENT_KEY_RELEASED;
+    event.data.keyboard.keycode = vc;
+    event.data.keyboard.rawcode = ev.code;
+    event.data.keyboard.keychar = CHAR_UNDEFINED;
+    post(event, event_ns(ev));
+}
+
+static void post_button(const input_event &ev, uint16_t button)
+{
+    const auto button_mask = uint16_t(MASK_BUTTON1 << (button - 1));
+    uiohook_event event{};
+    event.data.mouse.button = button;
+    event.data.mouse.clicks = 1;
+    event.data.mouse.x = int16_t(mouse_x);
+    event.data.mouse.y = int16_t(mouse_y);
+
+    if (ev.value) {
+        mask |= button_mask;
+        moved_since_press = false;
+        event.type = EVENT_MOUSE_PRESSED;
+        post(event, event_ns(ev));
+    } else {
+        mask &= ~button_mask;
+        event.type = EVENT_MOUSE_RELEASED;
+        post(event, event_ns(ev));
+        if (!moved_since_press) {
+            event.type = EVENT_MOUSE_CLICKED;
+            post(event, event_ns(ev));
+        }
+    }
+}
+
+static void post_wheel(int32_t amount, uint8_t direction, uint64_t time)
+{
+    uiohook_event event{};
+    event.type = EVENT_MOUSE_WHEEL;
+    event.data.wheel.clicks = 1;
+    event.data.wheel.type = WHEEL_UNIT_SCROLL;
+    event.data.wheel.amount = 3;
+    event.data.wheel.rotation = int16_t(-amount); /* Kernel reports up as positive */
+    event.data.wheel.direction = direction;
+    event.data.wheel.x = int16_t(mouse_x);
+    event.data.wheel.y = int16_t(mouse_y);
+    post(event, time);
+}
+
+/* Relative motion and wheel steps are collected until the end of the
+ * report, so a report becomes a single move and at most one wheel event
+ * per axis */
+static void end_report(const input_event &ev)
+{
+    const auto time = event_ns(ev);
+    if (rel_x || rel_y) {
+        /* There's no screen size to clamp to under Wayland, uiohook
+         * coordinates are 16 bit though */
+        mouse_x = std::max<int32_t>(SHRT_MIN, std::min<int32_t>(SHRT_MAX, mouse_x + rel_x));
+        mouse_y = std::max<int32_t>(SHRT_MIN, std::min<int32_t>(SHRT_MAX, mouse_y + rel_y));
+        rel_x = rel_y = 0;
+        moved_since_press = true;
+
+        uiohook_event event{};
+        event.type = (mask & (MASK_BUTTON1 | MASK_BUTTON2 | MASK_BUTTON3 | MASK_BUTTON4 | MASK_BUTTON5))
+                         ? EVENT_MOUSE_DRAGGED
+                         : EVENT_MOUSE_MOVED;
+        event.data.mouse.x = int16_t(mouse_x);
+        event.data.mouse.y = int16_t(mouse_y);
+        post(event, time);
+    }
+    if (wheel_v) {
+        post_wheel(wheel_v, WHEEL_VERTICAL_DIRECTION, time);
+        wheel_v = 0;
+    }
+    if (wheel_h) {
+        post_wheel(wheel_h, WHEEL_HORIZONTAL_DIRECTION, time);
+        wheel_h = 0;
+    }
+}
+
+static void handle(const input_event &ev)
+{
+    switch (ev.type) {
+    case EV_KEY:
+        if (const auto button = to_button(ev.code)) {
+            if (ev.value != 2)
+                post_button(ev, button);
+        } else {
+            post_key(ev);
+        }
+        break;
+    case EV_REL:
+        if (ev.code == REL_X)
+            rel_x += ev.value;
+        else if (ev.code == REL_Y)
+            rel_y += ev.value;
+        else if (ev.code == REL_WHEEL)
+            wheel_v += ev.value;
+        else if (ev.code == REL_HWHEEL)
+            wheel_h += ev.value;
+        break;
+    case EV_SYN:
+        if (ev.code == SYN_REPORT)
+            end_report(ev);
+        break;
+    default:;
+    }
+}
+
+static bool test_bit(const unsigned long *bits, int bit)
+{
+    const auto per_long = int(sizeof(unsigned long) * 8);
+    return (bits[bit / per_long] >> (bit % per_long)) & 1ul;
+}
+
+/* Only keyboards and relative pointers, gamepads are libgamepad's job and
+ * touchpads/tablets only report absolute positions */
+static bool is_wanted(int fd)
+{
+    unsigned long ev_bits[(EV_MAX + 1) / (sizeof(unsigned long) * 8) + 1]{};
+    unsigned long key_bits[(KEY_MAX + 1) / (sizeof(unsigned long) * 8) + 1]{};
+    unsigned long rel_bits[(REL_MAX + 1) / (sizeof(unsigned long) * 8) + 1]{};
+    if (ioctl(fd, EVIOCGBIT(0, sizeof(ev_bits)), ev_bits) < 0)
+        return false;
+
+    if (test_bit(ev_bits, EV_KEY) && ioctl(fd, EVIOCGBIT(EV_KEY, sizeof(key_bits)), key_bits) >= 0 &&
+        test_bit(key_bits, KEY_A) && test_bit(key_bits, KEY_SPACE))
+        return true;
+    return test_bit(ev_bits, EV_REL) && ioctl(fd, EVIOCGBIT(EV_REL, sizeof(rel_bits)), rel_bits) >= 0 &&
+           test_bit(rel_bits, REL_X) && test_bit(rel_bits, REL_Y);
+}
+
+static void open_device(const std::string &path)
+{
+    for (const auto &device : devices) {
+        if (device.second == path)
+            return;
+    }
+
+    const int fd = open(path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0)
+        return; /* Usually no permission, or not a device we can read */
+    if (!is_wanted(fd)) {
+        close(fd);
+        return;
+    }
+
+    /* Same clock as os_gettime_ns, so event times can be compared */
+    int clock = CLOCK_MONOTONIC;
+    ioctl(fd, EVIOCSCLOCKID, &clock);
+
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = fd;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+        close(fd);
+        return;
+    }
+
+    char name[256] = "unknown";
+    ioctl(fd, EVIOCGNAME(sizeof(name)), name);
+    binfo("Reading input from %s (%s)", path.c_str(), name);
+    devices[fd] = path;
+}
+
+static void close_device(int fd)
+{
+    const auto it = devices.find(fd);
+    if (it == devices.end())
+        return;
+    binfo("Stopped reading input from %s", it->second.c_str());
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+    devices.erase(it);
+}
+
+static void scan_devices()
+{
+    DIR *dir = opendir(INPUT_DIR);
+    if (!dir)
+        return;
+    while (const auto *entry = readdir(dir)) {
+        if (strncmp(entry->d_name, "event", 5) == 0)
+            open_device(std::string(INPUT_DIR "/") + entry->d_name);
+    }
+    closedir(dir);
+}
+
+/* udev creates the node first and fixes its permissions afterwards, so
+ * attribute changes are retried as well */
+static void handle_hotplug()
+{
+    alignas(inotify_event) char buf[4096];
+    ssize_t len;
+    while ((len = read(watch_fd, buf, sizeof(buf))) > 0) {
+        for (char *ptr = buf; ptr < buf + len;) {
+            const auto *event = reinterpret_cast<inotify_event *>(ptr);
+            if (event->len && strncmp(event->name, "event", 5) == 0)
+                open_device(std::string(INPUT_DIR "/") + event->name);
+            ptr += sizeof(inotify_event) + event->len;
+        }
+    }
+}
+
+static void read_device(int fd)
+{
+    input_event events[EVENTS_PER_READ];
+    for (;;) {
+        const auto len = read(fd, events, sizeof(events));
+        if (len < 0) {
+            if (errno != EAGAIN && errno != EINTR)
+                close_device(fd); /* ENODEV once it's unplugged */
+            return;
+        }
+        for (size_t i = 0; i < size_t(len) / sizeof(input_event); i++)
+            handle(events[i]);
+        if (size_t(len) < sizeof(events))
+            return;
+    }
+}
+
+static void thread_method()
+{
+    os_set_thread_name("inputovrly-evdev");
+    util_set_thread_priority(THREAD_INPUT, "evdev");
+    epoll_event events[16];
+
+    while (flag) {
+        const auto count = epoll_wait(epoll_fd, events, 16, -1);
+        for (int i = 0; i < count && flag; i++) {
+            const auto fd = events[i].data.fd;
+            if (fd == stop_fd)
+                break;
+            if (fd == watch_fd)
+                handle_hotplug();
+            else
+                read_device(fd);
+        }
+    }
+}
+
+static void cleanup()
+{
+    while (!devices.empty())
+        close_device(devices.begin()->first);
+    for (auto *fd : {&watch_fd, &stop_fd, &epoll_fd}) {
+        if (*fd >= 0)
+            close(*fd);
+        *fd = -1;
+    }
+}
+
+bool start()
+{
+    if (flag)
+        return true;
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    stop_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epoll_fd < 0 || stop_fd < 0) {
+        berr("Failed to create evdev epoll instance");
+        cleanup();
+        return false;
+    }
+
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = stop_fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, stop_fd, &ev);
+
+    watch_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (watch_fd >= 0 && inotify_add_watch(watch_fd, INPUT_DIR, IN_CREATE | IN_ATTRIB) >= 0) {
+        ev.data.fd = watch_fd;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, watch_fd, &ev);
+    } else {
+        bwarn("Can't watch " INPUT_DIR ", devices that are plugged in later won't be used");
+    }
+
+    scan_devices();
+    if (devices.empty()) {
+        bwarn("No readable keyboard or mouse in " INPUT_DIR ", is the user in the input group?");
+        cleanup();
+        return false;
+    }
+
+    mask = 0;
+    flag = true;
+    thread = std::thread(thread_method);
+    return true;
+}
+
+void stop()
+{
+    if (!flag)
+        return;
+    flag = false;
+    const uint64_t one = 1;
+    if (write(stop_fd, &one, sizeof(one)) < 0)
+        bwarn("Failed to wake evdev thread");
+    if (thread.joinable())
+        thread.join();
+    cleanup();
+}
+}
+}
@@ -1,9 +1,17 @@
 #include "gamepad_hook_helper.hpp"
 #include <libgamepad.hpp>
-#include "../network/websocket_server.hpp"
+#include "../util/input_hub.hpp"
 #include "../util/obs_util.hpp"
 #include "../util/log.h"
 #include "../util/config.hpp"
+#include "../util/input_data.hpp"
+#include "../util/load_profile.hpp"
+#include "../util/thread_priority.hpp"
+#include "../gui/ui_events.hpp"
+#include <poll_governor.hpp>
+#include <axis_filter.hpp>
+#include <obs-module.h>
+#include <util/platform.h>
 
 namespace libgamepad {
 
@@ -13,7 +21,35 @@ uint16_t last_input;
 int last_input_value;
 uint64_t last_input_time;
 uint16_t flags;
-std::mutex last_input_mutex;
+IO_TRACED_MUTEX(last_input_mutex, "libgamepad::last_input_mutex");
+
+/* Polls fast while a pad is used and slows down after it was left alone */
+static std::unique_ptr<poll_governor> governor;
+/* Drops stick jitter before anything is locked or serialized */
+static std::unique_ptr<axis_filter> axis_noise;
+
+static void on_pad_input()
+{
+    /* libgamepad owns its thread, so it's scheduled on its first event */
+    static thread_local bool scheduled = false;
+    if (!scheduled) {
+        util_set_thread_priority(THREAD_INPUT, "gamepad");
+        IO_TRACE_THREAD("inputovrly-gamepad");
+        scheduled = true;
+    }
+    if (governor->on_input())
+        hook_instance->set_sleep_time(governor->active());
+}
+
+/* The hook thread only calls back on input, so backing off is checked once per frame */
+static void check_pad_idle(void *, float)
+{
+    if (governor->check_idle()) {
+        hook_instance->set_sleep_time(governor->idle());
+        bdebug("No gamepad input for a while, polling every %lli us",
+               static_cast<long long>(governor->idle().count()));
+    }
+}
 
 void start_pad_hook()
 {
@@ -23,7 +59,10 @@ void start_pad_hook()
     flags |= io_config::use_dinput ? gamepad::hook_type::DIRECT_INPUT : gamepad::hook_type::NATIVE_DEFAULT;
     hook_instance = gamepad::hook::make(flags);
     hook_instance->set_plug_and_play(true, gamepad::ms(1000));
-    hook_instance->set_sleep_time(gamepad::mcs(1000)); // todo: maybe change to 0.1 ms
+    governor = std::make_unique<poll_governor>(gamepad::mcs(1000), gamepad::ms(io_config::pad_idle_poll),
+                                               gamepad::ms(PAD_IDLE_DELAY));
+    hook_instance->set_sleep_time(governor->active());
+    axis_noise = std::make_unique<axis_filter>(io_config::pad_axis_deadband / 100.f, io_config::pad_axis_step / 100.f);
 
 #if defined(WIN32)
     binfo("Using '%s' gamepad backend", flags & gamepad::hook_type::DIRECT_INPUT ? "Direct Input" : "XInput");
@@ -54,36 +93,72 @@ void start_pad_hook()
     gamepad::set_logger(log_pipe, nullptr);
 
     hook_instance->set_axis_event_handler([](const std::shared_ptr<gamepad::device> &d) {
-        std::lock_guard<std::mutex> lock(last_input_mutex);
+        IO_TRACE_ZONE("gamepad axis");
+        auto *event = d->last_axis_event();
+        const bool centred = event->vc != gamepad::axis::LEFT_TRIGGER && event->vc != gamepad::axis::RIGHT_TRIGGER;
+        if (!axis_noise->pass(uint8_t(d->get_index()), event->vc, event->virtual_value, centred))
+            return;
+        /* libgamepad's clock isn't os_gettime_ns(), the event is stamped when it arrives */
+        event->time = os_gettime_ns() / 1000000;
+        std::lock_guard<traced_mutex> lock(last_input_mutex);
         last_input = d->last_axis_event()->native_id;
         last_input_value = d->last_axis_event()->value;
         last_input_time = d->last_axis_event()->time;
-        wss::dispatch_gamepad_event(d->last_axis_event(), d, true, "local");
+        on_pad_input();
+        local_data::data.bump_generation();
+        ui_events::notify(ui_events::CHANGE_PAD_INPUT);
+        input_hub::publish_pad(HUB_LOCAL, uint8_t(d->get_index()), true, input_hub::pad_input_of(*event));
     });
     hook_instance->set_button_event_handler([](const std::shared_ptr<gamepad::device> &d) {
-        std::lock_guard<std::mutex> lock(last_input_mutex);
+        IO_TRACE_ZONE("gamepad button");
+        d->last_button_event()->time = os_gettime_ns() / 1000000;
+        std::lock_guard<traced_mutex> lock(last_input_mutex);
         last_input = d->last_button_event()->native_id;
         last_input_time = d->last_button_event()->time;
-        wss::dispatch_gamepad_event(d->last_button_event(), d, false, "local");
+        on_pad_input();
+        local_data::data.bump_generation();
+        ui_events::notify(ui_events::CHANGE_PAD_INPUT);
+        input_hub::publish_pad(HUB_LOCAL, uint8_t(d->get_index()), false,
+                               input_hub::pad_input_of(*d->last_button_event()));
     });
 
     hook_instance->set_connect_event_handler([](const std::shared_ptr<gamepad::device> &d) {
         binfo("'%s' connected", d->get_name().c_str());
-        wss::dispatch_gamepad_event(d, WSS_PAD_CONNECTED, "local");
+        on_pad_input();
+        local_data::data.bump_generation();
+        ui_events::notify(ui_events::CHANGE_PADS);
+        input_hub::publish_pad_state(HUB_LOCAL, uint8_t(d->get_index()), input_hub::KIND_PAD_CONNECTED, d->get_id());
     });
     hook_instance->set_disconnect_event_handler([](const std::shared_ptr<gamepad::device> &d) {
         binfo("'%s' disconnected", d->get_name().c_str());
-        wss::dispatch_gamepad_event(d, WSS_PAD_DISCONNECTED, "local");
+        local_data::data.bump_generation();
+        ui_events::notify(ui_events::CHANGE_PADS);
+        input_hub::publish_pad_state(HUB_LOCAL, uint8_t(d->get_index()), input_hub::KIND_PAD_DISCONNECTED, d->get_id());
     });
     hook_instance->set_reconnect_event_handler([](const std::shared_ptr<gamepad::device> &d) {
         binfo("'%s' reconnected", d->get_name().c_str());
-        wss::dispatch_gamepad_event(d, WSS_PAD_RECONNECTED, "local");
+        on_pad_input();
+        local_data::data.bump_generation();
+        ui_events::notify(ui_events::CHANGE_PADS);
+        input_hub::publish_pad_state(HUB_LOCAL, uint8_t(d->get_index()), input_hub::KIND_PAD_RECONNECTED, d->get_id());
     });
 
-    hook_instance->load_bindings(std::string(qt_to_utf8(util_get_data_file("gamepad_bindings.json"))));
+    load_profile::stages profile;
+    {
+        load_profile::scope s(profile, "bindings");
+        hook_instance->load_bindings(std::string(qt_to_utf8(util_get_data_file("gamepad_bindings.json"))));
+    }
+
+    bool started;
+    {
+        load_profile::scope s(profile, "start");
+        started = hook_instance->start();
+    }
+    load_profile::report("Starting gamepad hook", profile);
 
-    if (hook_instance->start()) {
+    if (started) {
         binfo("gamepad hook started");
+        obs_add_tick_callback(check_pad_idle, nullptr);
         state = true;
     } else {
         bwarn("gamepad hook couldn't be started");
@@ -93,6 +168,7 @@ void start_pad_hook()
 void end_pad_hook()
 {
     if (state) {
+        obs_remove_tick_callback(check_pad_idle, nullptr);
         hook_instance->save_bindings(std::string(qt_to_utf8(util_get_data_file("gamepad_bindings.json"))));
         hook_instance->stop();
     }
@@ -18,6 +18,7 @@
 
 #pragma once
 
+#include "../util/trace.hpp"
 #include <mutex>
 #include <memory>
 
@@ -30,7 +31,7 @@ extern uint16_t flags;
 extern uint16_t last_input;
 extern int last_input_value;
 extern uint64_t last_input_time;
-extern std::mutex last_input_mutex;
+extern traced_mutex last_input_mutex;
 extern std::shared_ptr<gamepad::hook> hook_instance;
 extern bool state;
 
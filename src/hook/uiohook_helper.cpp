@@ -0,0 +1,103 @@
+/*************************************************************************
+ * This file is part of input-overlay
+ * github.con/univrsal/input-overlay
+ * Copyright 2022 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#include "uiohook_helper.hpp"
+#include "../util/spsc_queue.hpp"
+#include "../util/log.h"
+#include "../util/pipeline_stats.hpp"
+#include "../util/thread_priority.hpp"
+#include "../util/trace.hpp"
+#include <thread>
+#include <util/threading.h>
+
+#define EVENT_QUEUE_SIZE 4096
+
+namespace uiohook {
+struct captured_event {
+    uiohook_event event;
+    uint64_t captured; /* ns */
+};
+
+/* Filled by the hook thread, which is the only producer since libuiohook
+ * runs all of its hooks on one thread */
+static spsc_queue<captured_event, EVENT_QUEUE_SIZE> event_queue;
+static os_sem_t *event_sem = nullptr;
+static std::thread consumer_thread;
+static std::atomic<bool> consumer_flag{false};
+static std::atomic<uint64_t> dropped_events{0};
+
+void push_event(const uiohook_event *event, uint64_t captured)
+{
+    if (!consumer_flag)
+        return;
+    captured_event item{*event, captured ? captured : os_gettime_ns()};
+    item.event.time = item.captured / 1000000;
+    if (event_queue.push(item)) {
+        os_sem_post(event_sem);
+    } else {
+        dropped_events.fetch_add(1, std::memory_order_relaxed);
+        pipeline_stats::count(pipeline_stats::COUNTER_DROPS);
+    }
+}
+
+static void consumer_method()
+{
+    os_set_thread_name("inputovrly-uiohook");
+    IO_TRACE_THREAD("inputovrly-uiohook");
+    util_set_thread_priority(THREAD_INPUT, "uiohook consumer");
+    uint64_t reported_drops = 0;
+    captured_event item{};
+
+    while (os_sem_wait(event_sem) == 0 && consumer_flag) {
+        while (event_queue.pop(item)) {
+            pipeline_stats::scope stats(pipeline_stats::STAGE_HOOK);
+            IO_TRACE_ZONE("uiohook event");
+            process_event(&item.event, item.captured);
+        }
+
+        const auto drops = dropped_events.load(std::memory_order_relaxed);
+        if (drops != reported_drops) {
+            bwarn("uiohook event queue was full, dropped %llu events in total", (unsigned long long)drops);
+            reported_drops = drops;
+        }
+    }
+}
+
+void start_consumer()
+{
+    if (consumer_flag)
+        return;
+    if (!event_sem && os_sem_init(&event_sem, 0) != 0) {
+        berr("Failed to create uiohook event semaphore");
+        return;
+    }
+    consumer_flag = true;
+    consumer_thread = std::thread(consumer_method);
+}
+
+void stop_consumer()
+{
+    if (!consumer_flag)
+        return;
+    consumer_flag = false;
+    os_sem_post(event_sem);
+    if (consumer_thread.joinable())
+        consumer_thread.join();
+    /* The semaphore is kept around, the hook thread might still be about to post to it */
+}
+}
@@ -18,33 +18,36 @@
 
 #pragma once
 #include "../util/input_data.hpp"
-#include "../network/websocket_server.hpp"
+#include "../util/input_hub.hpp"
 #include <mutex>
+#include <atomic>
+#include <cstring>
 #include <netlib.h>
 #include <uiohook.h>
 #include <util/platform.h>
-#define SCROLL_TIMEOUT 120000000
 
 namespace uiohook {
-extern uint64_t last_scroll_time;
 extern bool state;
 
-inline void check_wheel()
+/* Runs on the consumer thread, applies the event and publishes it to the
+ * consumers. captured is the os_gettime_ns() time the event was captured at */
+inline void process_event(uiohook_event *event, uint64_t captured)
 {
-    if (last_scroll_time && os_gettime_ns() - last_scroll_time >= SCROLL_TIMEOUT) {
-        last_scroll_time = 0;
-        local_data::data.last_wheel_event = {};
-    }
+    local_data::data.dispatch_uiohook_event(event, captured);
+    input_hub::publish_uiohook(HUB_LOCAL, *event, captured);
 }
 
-inline void process_event(uiohook_event *event)
-{
-    std::lock_guard<std::mutex> lock(local_data::data_mutex);
-    local_data::data.dispatch_uiohook_event(event);
-    if (event->type == EVENT_MOUSE_WHEEL)
-        last_scroll_time = os_gettime_ns();
-    wss::dispatch_uiohook_event(event, "local");
-}
+/* Called from the hook callback, only queues the event so the OS hook
+ * returns as quickly as possible. Events are dropped if the queue is full.
+ * Backends that know when the OS saw the event pass it as captured (on the
+ * os_gettime_ns() clock), otherwise the time of the call is used. The
+ * event's own time is replaced with captured in ms, libuiohook's clock
+ * differs between platforms */
+void push_event(const uiohook_event *event, uint64_t captured = 0);
+
+void start_consumer();
+
+void stop_consumer();
 
 void start();
 
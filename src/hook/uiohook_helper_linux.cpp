@@ -17,6 +17,10 @@
  *************************************************************************/
 
 #include "uiohook_helper.hpp"
+#include "evdev_helper.hpp"
+#include "../util/config.hpp"
+#include "../util/log.h"
+#include "../util/thread_priority.hpp"
 #include <cstdarg>
 #include <obs-module.h>
 #include <uiohook.h>
@@ -29,7 +33,6 @@ namespace uiohook {
         https://github.com/kwhat/libuiohook/blob/master/src/demo_hook_async.c
 */
 
-uint64_t last_scroll_time = 0; /* System time at last scroll event */
 bool state = false;
 std::mutex data_mutex;
 
@@ -37,9 +40,11 @@ static pthread_t hook_thread;
 static pthread_mutex_t hook_running_mutex;
 static pthread_mutex_t hook_control_mutex;
 static pthread_cond_t hook_control_cond;
+static bool hook_started = false; /* hook_thread is running, evdev doesn't use it */
 
 void *hook_thread_proc(void *arg)
 {
+    util_set_thread_priority(THREAD_INPUT, "uiohook");
     int status = hook_run();
     if (status != UIOHOOK_SUCCESS) {
         *(int *)arg = status;
@@ -79,7 +84,7 @@ void dispatch_proc(uiohook_event *event, void *)
         pthread_mutex_unlock(&hook_running_mutex);
     default:; /* Prevent missing case error */
     }
-    process_event(event);
+    push_event(event);
 }
 
 int hook_enable()
@@ -91,24 +96,9 @@ int hook_enable()
     /* Set the initial status. */
     int status = UIOHOOK_FAILURE;
 
-    /* Create the thread attribute. */
-    pthread_attr_t hook_thread_attr;
-    pthread_attr_init(&hook_thread_attr);
-
-    /* Get the policy and priority for the thread attr. */
-    int policy;
-    pthread_attr_getschedpolicy(&hook_thread_attr, &policy);
-    int priority = sched_get_priority_max(policy);
-
+    /* The thread sets its own priority, see hook_thread_proc */
     int *hook_thread_status = (int *)malloc(sizeof(int));
-    if (pthread_create(&hook_thread, &hook_thread_attr, hook_thread_proc, hook_thread_status) == 0) {
-        /* Some POSIX revisions do not support pthread_setschedprio so we will
-         * use pthread_setschedparam instead. */
-        struct sched_param param = {.sched_priority = priority};
-        if (pthread_setschedparam(hook_thread, SCHED_OTHER, &param) != 0) {
-            blog(LOG_WARNING, "[input-overlay] %s [%u]: Could not set thread priority %i for thread 0x%lX!",
-                 __FUNCTION__, __LINE__, priority, (unsigned long)hook_thread);
-        }
+    if (pthread_create(&hook_thread, nullptr, hook_thread_proc, hook_thread_status) == 0) {
         /* Wait for the thread to indicate that it has passed the
            initialization portion by blocking until either a EVENT_HOOK_ENABLED
            event is received or the thread terminates.
@@ -144,6 +134,19 @@ int hook_enable()
 
 void stop()
 {
+    /* The hook thread uses the control mutexes until it exits, so it has to
+     * be gone before they're destroyed */
+    if (hook_started) {
+        if (hook_stop() != UIOHOOK_SUCCESS) {
+            berr("Couldn't stop uiohook, leaving it running");
+            return;
+        }
+        pthread_join(hook_thread, nullptr);
+        hook_started = false;
+    }
+    state = false;
+    evdev::stop();
+    stop_consumer();
     pthread_mutex_destroy(&hook_running_mutex);
     pthread_mutex_destroy(&hook_control_mutex);
     pthread_cond_destroy(&hook_control_cond);
@@ -151,6 +154,8 @@ void stop()
 
 void start()
 {
+    if (state)
+        return; /* Still running, stop couldn't shut it down */
     pthread_mutex_init(&hook_running_mutex, nullptr);
     pthread_mutex_init(&hook_control_mutex, nullptr);
     pthread_cond_init(&hook_control_cond, nullptr);
@@ -161,11 +166,20 @@ void start()
     /* Set the event callback for uiohook events. */
     hook_set_dispatch_proc(&dispatch_proc, nullptr);
 
+    start_consumer();
+    if (io_config::use_evdev) {
+        if (evdev::start()) {
+            state = true;
+            return;
+        }
+        bwarn("Couldn't read any devices in /dev/input, falling back to XRecord");
+    }
+
     const auto status = hook_enable();
     switch (status) {
     case UIOHOOK_SUCCESS:
-        /* We no longer block, so we need to explicitly wait for the thread to die. */
-        state = true;
+        /* We no longer block, so stop has to explicitly wait for the thread to die. */
+        state = hook_started = true;
         break;
     case UIOHOOK_ERROR_OUT_OF_MEMORY:
         blog(LOG_ERROR, "[input-overlay] Failed to allocate memory. (%#X)\n", status);
@@ -205,6 +219,9 @@ void start()
         blog(LOG_ERROR, "[input-overlay] An unknown hook error occurred. (%#X)\n", status);
         break;
     }
+
+    if (!state)
+        stop_consumer();
 }
 
 }
@@ -17,8 +17,16 @@
  *************************************************************************/
 
 #include "uiohook_helper.hpp"
+#include "../util/config.hpp"
+#include "../util/log.h"
+#include "../util/thread_priority.hpp"
 #include <cstdarg>
+#include <thread>
 #include <obs-module.h>
+#include <util/threading.h>
+
+#define RAW_INPUT_CLASS "input-overlay-raw-input"
+#define RAW_INPUT_BUFFER (16 * 1024)
 
 namespace uiohook {
 /*
@@ -27,7 +35,6 @@ namespace uiohook {
     https://github.com/kwhat/libuiohook/blob/master/src/demo_hook_async.c
 */
 
-uint64_t last_scroll_time = 0; /* System time at last scroll event */
 bool state = false;
 std::mutex data_mutex;
 
@@ -35,6 +42,7 @@ static HANDLE hook_thread;
 static HANDLE hook_running_mutex;
 static HANDLE hook_control_mutex;
 static HANDLE hook_control_cond;
+static bool hook_started = false; /* hook_thread is running, Raw Input doesn't use it */
 
 void dispatch_proc(uiohook_event *const event, void *)
 {
@@ -50,11 +58,12 @@ void dispatch_proc(uiohook_event *const event, void *)
         ResetEvent(hook_control_cond);
     default:; /* Prevent missing case error */
     }
-    process_event(event);
+    push_event(event);
 }
 
 DWORD WINAPI hook_thread_proc(const LPVOID arg)
 {
+    util_set_thread_priority(THREAD_INPUT, "uiohook");
     /* Set the hook status. */
     const auto status = hook_run();
     if (status != UIOHOOK_SUCCESS) {
@@ -81,8 +90,380 @@ static void logger_proc(unsigned int level, void *user_data, const char *format,
 }
 }
 
+/*
+    Raw Input backend, replaces the low level hooks so a high polling rate
+    mouse doesn't run through the system wide hook chain for every report.
+    Input is read in batches with GetRawInputBuffer on a message only window
+    and motion is coalesced into one move per batch
+*/
+namespace raw_input {
+static std::thread thread;
+static DWORD thread_id = 0;
+static HANDLE ready_event = nullptr;
+static bool registered = false;
+static size_t data_offset = 0; /* Under WOW64 buffered headers have 64 bit handles */
+
+/* Only used by the raw input thread */
+static uint16_t mask = 0;
+static POINT cursor{};
+static bool pending_motion = false, moved_since_press = false;
+static int32_t wheel_v = 0, wheel_h = 0;
+static uint16_t wheel_amount = 3;
+
+/* Make codes are set 1 scan codes like uiohook's, extended keys have their
+ * own virtual codes */
+static uint16_t to_vc(const RAWKEYBOARD &kb)
+{
+    if (kb.VKey == VK_PAUSE)
+        return VC_PAUSE; /* Sent as E1 1D, which would be left control */
+    if (!(kb.Flags & RI_KEY_E0)) {
+        if (kb.MakeCode <= 0x53)
+            return kb.MakeCode;
+        if (kb.MakeCode == 0x57)
+            return VC_F11;
+        if (kb.MakeCode == 0x58)
+            return VC_F12;
+        return VC_UNDEFINED;
+    }
+
+    switch (kb.MakeCode) {
+    case 0x1C:
+        return VC_KP_ENTER;
+    case 0x1D:
+        return VC_CONTROL_R;
+    case 0x35:
+        return VC_KP_DIVIDE;
+    case 0x37:
+        return VC_PRINTSCREEN;
+    case 0x38:
+        return VC_ALT_R;
+    case 0x47:
+        return VC_HOME;
+    case 0x48:
+        return VC_UP;
+    case 0x49:
+        return VC_PAGE_UP;
+    case 0x4B:
+        return VC_LEFT;
+    case 0x4D:
+        return VC_RIGHT;
+    case 0x4F:
+        return VC_END;
+    case 0x50:
+        return VC_DOWN;
+    case 0x51:
+        return VC_PAGE_DOWN;
+    case 0x52:
+        return VC_INSERT;
+    case 0x53:
+        return VC_DELETE;
+    case 0x5B:
+        return VC_META_L;
+    case 0x5C:
+        return VC_META_R;
+    case 0x5D:
+        return VC_CONTEXT_MENU;
+    case 0x20:
+        return VC_VOLUME_MUTE;
+    case 0x2E:
+        return VC_VOLUME_DOWN;
+    case 0x30:
+        return VC_VOLUME_UP;
+    case 0x19:
+        return VC_MEDIA_NEXT;
+    case 0x22:
+        return VC_MEDIA_PLAY;
+    case 0x10:
+        return VC_MEDIA_PREVIOUS;
+    case 0x24:
+        return VC_MEDIA_STOP;
+    default:
+        return VC_UNDEFINED;
+    }
+}
+
+static uint16_t key_mask(uint16_t vc)
+{
+    switch (vc) {
+    case VC_SHIFT_L:
+        return MASK_SHIFT_L;
+    case VC_SHIFT_R:
+        return MASK_SHIFT_R;
+    case VC_CONTROL_L:
+        return MASK_CTRL_L;
+    case VC_CONTROL_R:
+        return MASK_CTRL_R;
+    case VC_ALT_L:
+        return MASK_ALT_L;
+    case VC_ALT_R:
+        return MASK_ALT_R;
+    case VC_META_L:
+        return MASK_META_L;
+    case VC_META_R:
+        return MASK_META_R;
+    default:
+        return 0;
+    }
+}
+
+static void post(uiohook_event &event, uint64_t time)
+{
+    event.mask = mask;
+    push_event(&event, time);
+}
+
+static void post_wheel(int32_t rotation, uint8_t direction, uint64_t time)
+{
+    uiohook_event event{};
+    event.type = EVENT_MOUSE_WHEEL;
+    event.data.wheel.clicks = 1;
+    event.data.wheel.type = WHEEL_UNIT_SCROLL;
+    event.data.wheel.amount = wheel_amount;
+    event.data.wheel.rotation = int16_t(rotation);
+    event.data.wheel.direction = direction;
+    event.data.wheel.x = int16_t(cursor.x);
+    event.data.wheel.y = int16_t(cursor.y);
+    post(event, time);
+}
+
+/* Sends the motion and wheel steps collected so far, called before every
+ * button or key so the order of events is kept */
+static void flush(uint64_t time)
+{
+    if (pending_motion) {
+        /* Raw deltas are unaccelerated, the cursor position is what the
+         * low level hook would have reported */
+        GetCursorPos(&cursor);
+        pending_motion = false;
+        moved_since_press = true;
+
+        uiohook_event event{};
+        event.type = (mask & (MASK_BUTTON1 | MASK_BUTTON2 | MASK_BUTTON3 | MASK_BUTTON4 | MASK_BUTTON5))
+                         ? EVENT_MOUSE_DRAGGED
+                         : EVENT_MOUSE_MOVED;
+        event.data.mouse.x = int16_t(cursor.x);
+        event.data.mouse.y = int16_t(cursor.y);
+        post(event, time);
+    }
+
+    /* High resolution wheels report fractions of a step, the rest is kept */
+    if (const auto steps = wheel_v / WHEEL_DELTA) {
+        post_wheel(-steps, WHEEL_VERTICAL_DIRECTION, time);
+        wheel_v -= steps * WHEEL_DELTA;
+    }
+    if (const auto steps = wheel_h / WHEEL_DELTA) {
+        post_wheel(steps, WHEEL_HORIZONTAL_DIRECTION, time);
+        wheel_h -= steps * WHEEL_DELTA;
+    }
+}
+
+static void post_button(uint16_t button, bool pressed, uint64_t time)
+{
+    const auto button_mask = uint16_t(MASK_BUTTON1 << (button - 1));
+    uiohook_event event{};
+    event.data.mouse.button = button;
+    event.data.mouse.clicks = 1;
+    event.data.mouse.x = int16_t(cursor.x);
+    event.data.mouse.y = int16_t(cursor.y);
+
+    if (pressed) {
+        mask |= button_mask;
+        moved_since_press = false;
+        event.type = EVENT_MOUSE_PRESSED;
+        post(event, time);
+    } else {
+        mask &= ~button_mask;
+        event.type = EVENT_MOUSE_RELEASED;
+        post(event, time);
+        if (!moved_since_press) {
+            event.type = EVENT_MOUSE_CLICKED;
+            post(event, time);
+        }
+    }
+}
+
+static void handle_mouse(const RAWMOUSE &mouse, uint64_t time)
+{
+    if ((mouse.usFlags & MOUSE_MOVE_ABSOLUTE) || mouse.lLastX || mouse.lLastY)
+        pending_motion = true;
+
+    const auto flags = mouse.usButtonFlags;
+    if (flags & RI_MOUSE_WHEEL)
+        wheel_v += SHORT(mouse.usButtonData);
+    if (flags & RI_MOUSE_HWHEEL)
+        wheel_h += SHORT(mouse.usButtonData);
+
+    /* RI_MOUSE_BUTTON_1_DOWN, RI_MOUSE_BUTTON_1_UP, RI_MOUSE_BUTTON_2_DOWN... */
+    for (uint16_t i = 0; i < 5; i++) {
+        const auto down = flags & (1 << (i * 2)), up = flags & (1 << (i * 2 + 1));
+        if (!down && !up)
+            continue;
+        flush(time);
+        post_button(i + 1, down != 0, time);
+    }
+}
+
+static void handle_keyboard(const RAWKEYBOARD &kb, uint64_t time)
+{
+    if (kb.VKey == 0xFF)
+        return; /* Fake key that's part of an escape sequence */
+    const auto vc = to_vc(kb);
+    if (vc == VC_UNDEFINED)
+        return;
+    flush(time);
+
+    const auto pressed = !(kb.Flags & RI_KEY_BREAK);
+    if (pressed)
+        mask |= key_mask(vc);
+    else
+        mask &= ~key_mask(vc);
+
+    uiohook_event event{};
+    event.type = pressed ? EVENT_KEY_PRESSED : EVENT_KEY_RELEASED;
+    event.data.keyboard.keycode = vc;
+    event.data.keyboard.rawcode = kb.VKey;
+    event.data.keyboard.keychar = CHAR_UNDEFINED;
+    post(event, time);
+}
+
+static void read_buffer()
+{
+    alignas(8) static uint8_t buffer[RAW_INPUT_BUFFER];
+    const auto time = os_gettime_ns(); /* Buffered input has no time of its own */
+
+    for (;;) {
+        UINT size = sizeof(buffer);
+        const auto count = GetRawInputBuffer(reinterpret_cast<RAWINPUT *>(buffer), &size, sizeof(RAWINPUTHEADER));
+        if (count == 0 || count == UINT(-1))
+            break;
+
+        auto *input = reinterpret_cast<RAWINPUT *>(buffer);
+        for (UINT i = 0; i < count; i++, input = NEXTRAWINPUTBLOCK(input)) {
+            const auto *data = reinterpret_cast<const uint8_t *>(&input->data) + data_offset;
+            if (input->header.dwType == RIM_TYPEMOUSE)
+                handle_mouse(*reinterpret_cast<const RAWMOUSE *>(data), time);
+            else if (input->header.dwType == RIM_TYPEKEYBOARD)
+                handle_keyboard(*reinterpret_cast<const RAWKEYBOARD *>(data), time);
+        }
+    }
+    flush(time);
+}
+
+static bool register_devices(HWND target, DWORD flags)
+{
+    /* Generic desktop page, mouse and keyboard usages */
+    RAWINPUTDEVICE devices[2] = {{0x01, 0x02, flags, target}, {0x01, 0x06, flags, target}};
+    return RegisterRawInputDevices(devices, 2, sizeof(RAWINPUTDEVICE)) != FALSE;
+}
+
+static void thread_method()
+{
+    os_set_thread_name("inputovrly-rawinput");
+    util_set_thread_priority(THREAD_INPUT, "raw input");
+
+    WNDCLASSEX wc{};
+    wc.cbSize = sizeof(wc);
+    wc.lpfnWndProc = DefWindowProc;
+    wc.hInstance = GetModuleHandle(nullptr);
+    wc.lpszClassName = TEXT(RAW_INPUT_CLASS);
+    RegisterClassEx(&wc);
+
+    /* Creating the window also creates this thread's message queue */
+    const auto window =
+        CreateWindowEx(0, wc.lpszClassName, nullptr, 0, 0, 0, 0, 0, HWND_MESSAGE, nullptr, wc.hInstance, nullptr);
+    registered = window && register_devices(window, RIDEV_INPUTSINK);
+    if (!registered)
+        berr("Failed to register raw input devices (%#lX)", (unsigned long)GetLastError());
+    thread_id = GetCurrentThreadId();
+    SetEvent(ready_event);
+
+    MSG msg;
+    bool running = registered;
+    while (running) {
+        MsgWaitForMultipleObjects(0, nullptr, FALSE, INFINITE, QS_ALLINPUT);
+        read_buffer();
+
+        /* WM_INPUT of buffered reads is left in the queue, new ones might
+         * have arrived in between so the buffer is read once more */
+        while (PeekMessage(&msg, nullptr, 0, 0, PM_REMOVE)) {
+            if (msg.message == WM_QUIT) {
+                running = false;
+                break;
+            }
+            if (msg.message == WM_INPUT) {
+                read_buffer();
+                continue;
+            }
+            TranslateMessage(&msg);
+            DispatchMessage(&msg);
+        }
+    }
+
+    if (registered)
+        register_devices(nullptr, RIDEV_REMOVE);
+    if (window)
+        DestroyWindow(window);
+    UnregisterClass(wc.lpszClassName, wc.hInstance);
+}
+
+/* Returns false if the devices couldn't be registered */
+bool start()
+{
+    if (thread.joinable())
+        return true;
+
+#ifndef _WIN64
+    BOOL wow64 = FALSE;
+    IsWow64Process(GetCurrentProcess(), &wow64);
+    data_offset = wow64 ? 8 : 0;
+#endif
+    UINT lines = 3;
+    if (SystemParametersInfo(SPI_GETWHEELSCROLLLINES, 0, &lines, 0))
+        wheel_amount = uint16_t(lines);
+    mask = 0;
+    pending_motion = moved_since_press = false;
+    wheel_v = wheel_h = 0;
+    GetCursorPos(&cursor);
+
+    ready_event = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+    thread = std::thread(thread_method);
+    WaitForSingleObject(ready_event, INFINITE);
+    CloseHandle(ready_event);
+    ready_event = nullptr;
+
+    if (!registered) {
+        thread.join();
+        return false;
+    }
+    binfo("Reading mouse and keyboard input through Raw Input");
+    return true;
+}
+
+void stop()
+{
+    if (!thread.joinable())
+        return;
+    PostThreadMessage(thread_id, WM_QUIT, 0, 0);
+    thread.join();
+    registered = false;
+}
+}
+
 void stop()
 {
+    /* The hook thread uses the control mutexes until it exits, so it has to
+     * be gone before they're closed */
+    if (hook_started) {
+        if (hook_stop() != UIOHOOK_SUCCESS) {
+            berr("Couldn't stop uiohook, leaving it running");
+            return;
+        }
+        WaitForSingleObject(hook_thread, INFINITE);
+        hook_started = false;
+    }
+    state = false;
+    raw_input::stop();
+    stop_consumer();
     CloseHandle(hook_thread);
     CloseHandle(hook_running_mutex);
     CloseHandle(hook_control_mutex);
@@ -104,15 +485,6 @@ int hook_enable()
     hook_thread =
         CreateThread(nullptr, 0, (LPTHREAD_START_ROUTINE)hook_thread_proc, hook_thread_status, 0, &hook_thread_id);
     if (hook_thread != INVALID_HANDLE_VALUE) {
-
-        /* Attempt to set the thread priority to time critical. */
-        if (SetThreadPriority(hook_thread, THREAD_PRIORITY_TIME_CRITICAL) == 0) {
-            blog(LOG_WARNING,
-                 "[input-overlay] %s [%u]: Could not set thread priority %li for hook thread %#p! (%#lX)\n",
-                 __FUNCTION__, __LINE__, (long)THREAD_PRIORITY_TIME_CRITICAL, hook_thread,
-                 (unsigned long)GetLastError());
-        }
-
         /* Wait for the thread to indicate that it has passed the
          * initialization portion by blocking until either a EVENT_HOOK_ENABLED
          * event is received or the thread terminates.
@@ -149,6 +521,8 @@ int hook_enable()
 
 void start()
 {
+    if (state)
+        return; /* Still running, stop couldn't shut it down */
     hook_running_mutex = CreateMutex(nullptr, FALSE, TEXT("hook_running_mutex"));
     hook_control_mutex = CreateMutex(nullptr, FALSE, TEXT("hook_control_mutex"));
     hook_control_cond = CreateEvent(nullptr, TRUE, FALSE, TEXT("hook_control_cond"));
@@ -159,11 +533,20 @@ void start()
     /* Set the event callback for uiohook events. */
     hook_set_dispatch_proc(&dispatch_proc, nullptr);
 
+    start_consumer();
+    if (io_config::use_raw_input) {
+        if (raw_input::start()) {
+            state = true;
+            return;
+        }
+        bwarn("Raw Input isn't available, falling back to the low level hooks");
+    }
+
     const auto status = hook_enable();
     switch (status) {
     case UIOHOOK_SUCCESS:
-        /* We no longer block, so we need to explicitly wait for the thread to die. */
-        state = true;
+        /* We no longer block, so stop has to explicitly wait for the thread to die. */
+        state = hook_started = true;
         break;
     case UIOHOOK_ERROR_OUT_OF_MEMORY:
         blog(LOG_ERROR, "[input-overlay] Failed to allocate memory. (%#X)\n", status);
@@ -203,5 +586,8 @@ void start()
         blog(LOG_ERROR, "[input-overlay] An unknown hook error occurred. (%#X)\n", status);
         break;
     }
+
+    if (!state)
+        stop_consumer();
 }
 }
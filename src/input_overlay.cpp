@@ -31,6 +31,13 @@
 #include "util/config.hpp"
 #include "util/lang.h"
 #include "util/log.h"
+#include "util/loader.hpp"
+#include "util/load_profile.hpp"
+#include "util/pipeline_stats.hpp"
+#include "util/services.hpp"
+#include "util/timer_wheel.hpp"
+#include "util/trace.hpp"
+#include "util/window_helper.hpp"
 #include "plugin-macros.generated.h"
 
 #ifdef LINUX
@@ -42,45 +49,77 @@ extern void cleanupDisplay();
 OBS_DECLARE_MODULE()
 OBS_MODULE_USE_DEFAULT_LOCALE("input-overlay", "en-US")
 
+static void frontend_event(enum obs_frontend_event event, void *)
+{
+    /* Layout loads are reported once the whole scene collection is there */
+    switch (event) {
+    case OBS_FRONTEND_EVENT_SCENE_COLLECTION_CHANGING:
+        load_profile::hold();
+        break;
+    case OBS_FRONTEND_EVENT_FINISHED_LOADING:
+    case OBS_FRONTEND_EVENT_SCENE_COLLECTION_CHANGED:
+        load_profile::release();
+        break;
+    default:;
+    }
+}
+
 bool obs_module_load()
 {
     binfo("Loading v%s build time %s", PLUGIN_VERSION, BUILD_TIME);
-    io_config::set_defaults();
-    io_config::load();
+    trace::start();
+    load_profile::stages profile;
+    {
+        load_profile::scope s(profile, "config");
+        io_config::set_defaults();
+        io_config::load();
+    }
 
-    if (io_config::enable_overlay_source)
+    {
+        load_profile::scope s(profile, "threads");
+        timers::start();
+        loader::start();
+        pipeline_stats::start();
+    }
+    if (io_config::enable_overlay_source) {
+        load_profile::scope s(profile, "sources");
         sources::register_overlay_source();
+    }
 
-    if (io_config::enable_uiohook)
-        uiohook::start();
-
-    if (io_config::enable_gamepad_hook)
-        libgamepad::start_pad_hook();
+    /* Hooks and the remote server are started by the first source or websocket client */
+    {
+        load_profile::scope s(profile, "services");
+        services::start();
+    }
 
-    if (io_config::enable_websocket_server)
+    if (io_config::enable_websocket_server) {
+        load_profile::scope s(profile, "websocket");
         wss::start();
-
-    if (io_config::enable_remote_connections) {
-        network::local_input = io_config::enable_gamepad_hook || io_config::enable_uiohook;
-        network::start_network(io_config::server_port);
     }
 
     /* Input filtering via focused window title */
-    if (io_config::enable_input_control)
+    if (io_config::enable_input_control) {
+        load_profile::scope s(profile, "filters");
         io_config::io_window_filters.read_from_config();
+    }
 
     /* UI registration from
      * https://github.com/Palakis/obs-websocket/
      */
-    const auto menu_action = static_cast<QAction *>(obs_frontend_add_tools_menu_qaction(T_MENU_OPEN_SETTINGS));
-    obs_frontend_push_ui_translation(obs_module_get_string);
-    const auto main_window = static_cast<QMainWindow *>(obs_frontend_get_main_window());
-    settings_dialog = new io_settings_dialog(main_window);
-    obs_frontend_pop_ui_translation();
-
-    const auto menu_cb = [] { settings_dialog->toggleShowHide(); };
-    QAction::connect(menu_action, &QAction::triggered, menu_cb);
+    {
+        load_profile::scope s(profile, "ui");
+        const auto menu_action = static_cast<QAction *>(obs_frontend_add_tools_menu_qaction(T_MENU_OPEN_SETTINGS));
+        obs_frontend_push_ui_translation(obs_module_get_string);
+        const auto main_window = static_cast<QMainWindow *>(obs_frontend_get_main_window());
+        settings_dialog = new io_settings_dialog(main_window);
+        obs_frontend_pop_ui_translation();
+
+        const auto menu_cb = [] { settings_dialog->toggleShowHide(); };
+        QAction::connect(menu_action, &QAction::triggered, menu_cb);
+    }
+    obs_frontend_add_event_callback(frontend_event, nullptr);
 
+    load_profile::report("Module load", profile);
     return true;
 }
 
@@ -89,10 +128,14 @@ void obs_module_unload()
     /* Save config values again */
     io_config::save();
 
-    libgamepad::end_pad_hook();
-    uiohook::stop();
-    network::close_network();
+    obs_frontend_remove_event_callback(frontend_event, nullptr);
     wss::stop();
+    services::stop();
+    pipeline_stats::stop();
+    loader::stop();
+    timers::stop();
+    trace::stop();
+    StopWindowWatcher();
 
 #ifdef LINUX
     cleanupDisplay();
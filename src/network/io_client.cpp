@@ -18,12 +18,14 @@
 
 #include "io_client.hpp"
 #include "../util/log.h"
-#include "websocket_server.hpp"
+#include "../util/input_hub.hpp"
+#include <util/platform.h>
 
 namespace network {
 io_client::io_client(const std::string &name, tcp_socket socket) : m_holder()
 {
     m_name = name;
+    m_channel = input_hub::channel(name);
     m_socket = socket;
     m_valid = true;
 }
@@ -50,94 +52,132 @@ input_data *io_client::get_data()
     return &m_holder;
 }
 
-bool io_client::read_event(buffer &buf, const message msg)
+bool io_client::read_event(buffer &buf, const message msg, bool apply)
 {
     auto flag = true;
-    auto read_string = [](buffer &buf) {
-        std::string result;
-        auto *len = buf.read<uint16_t>();
-        if (len) {
-            result.reserve(*len);
-            void *str = nullptr;
-            buf.read(&str, result.length());
-            if (str)
-                result.insert(0, static_cast<char *>(str), *len);
-        }
-        return result;
+    auto passes = [apply](const uiohook_event &event) {
+        return apply || event.type == EVENT_KEY_RELEASED || event.type == EVENT_MOUSE_RELEASED;
+    };
+    /* Points into buf, so nothing is allocated for every connection event */
+    auto read_string = [](buffer &buf, std::string_view &out) {
+        uint16_t len;
+        void *str = nullptr;
+        if (!buf.read(len))
+            return false;
+        buf.read(&str, len);
+        out = str ? std::string_view(static_cast<char *>(str), len) : std::string_view();
+        return str || !len;
     };
 
     if (msg == MSG_UIOHOOK_EVENT) {
-        auto *event = buf.read<uiohook_event>();
-        if (event) {
-            m_holder.dispatch_uiohook_event(event);
-            wss::dispatch_uiohook_event(event, m_name);
-        } else {
+        uiohook_event event;
+        if (!buf.read(event)) {
             flag = false;
+        } else if (passes(event)) {
+            event.time = m_latency.add_event(event.time, os_gettime_ns());
+            m_holder.dispatch_uiohook_event(&event, event.time * 1000000);
+            input_hub::publish_uiohook(m_channel, event, event.time * 1000000);
+        }
+    } else if (msg == MSG_UIOHOOK_COMPACT) {
+        uiohook_event event;
+        if (!read_compact_event(buf, *m_decoder, event)) {
+            flag = false;
+        } else if (passes(event)) {
+            event.time = m_latency.add_event(event.time, os_gettime_ns());
+            m_holder.dispatch_uiohook_event(&event, event.time * 1000000);
+            input_hub::publish_uiohook(m_channel, event, event.time * 1000000);
         }
     } else if (msg == MSG_GAMEPAD_EVENT) {
-        flag = dispatch_gamepad_input(buf);
+        std::lock_guard<traced_mutex> lock(m_mutex);
+        flag = dispatch_gamepad_input(buf, apply);
+    } else if (msg == MSG_GAMEPAD_DELTA) {
+        std::lock_guard<traced_mutex> lock(m_mutex);
+        flag = dispatch_gamepad_delta(buf, apply);
     } else if (msg == MSG_GAMEPAD_CONNECTED) {
-        auto *index = buf.read<uint8_t>();
-        auto name = read_string(buf);
+        std::lock_guard<traced_mutex> lock(m_mutex);
+        uint8_t index;
+        std::string_view name;
 
-        if (!index) {
+        if (!buf.read(index) || !read_string(buf, name)) {
             flag = false;
             berr("Couldn't read gamepad device index");
         } else if (auto existing_pad = get_pad(name)) {
-            binfo("'%s' (id %i) reconnected to '%s'", name.c_str(), *index, m_name.c_str());
-            existing_pad->set_index(*index);
-            existing_pad->set_id(name);
+            binfo("'%.*s' (id %i) reconnected to '%s'", int(name.size()), name.data(), index, m_name.c_str());
+            if (existing_pad->get_index() != index) {
+                auto &slot = m_gamepads[index];
+                if (slot && slot != existing_pad)
+                    m_gamepad_index.erase(slot->get_id());
+                m_gamepads.erase(existing_pad->get_index());
+                m_pad_event_times.erase(existing_pad->get_index());
+                existing_pad->set_index(index);
+                m_gamepads[index] = existing_pad;
+                m_pad_event_times[index] = {};
+            }
             existing_pad->set_valid();
-            wss::dispatch_gamepad_event(existing_pad, WSS_PAD_RECONNECTED, m_name);
+            m_holder.bump_generation();
+            input_hub::publish_pad_state(m_channel, index, input_hub::KIND_PAD_RECONNECTED, existing_pad->get_id());
         } else {
-            binfo("'%s' (id %i) connected to '%s'", name.c_str(), *index, m_name.c_str());
+            /* The only place the id is copied, everything after this uses the index */
+            binfo("'%.*s' (id %i) connected to '%s'", int(name.size()), name.data(), index, m_name.c_str());
             auto new_pad = std::make_shared<gamepad::device>();
-            new_pad->set_index(*index);
-            new_pad->set_id(name);
+            new_pad->set_index(index);
+            new_pad->set_id(std::string(name));
             new_pad->set_valid();
-            m_gamepads[*index] = new_pad;
-            wss::dispatch_gamepad_event(new_pad, WSS_PAD_CONNECTED, m_name);
+            auto &slot = m_gamepads[index];
+            if (slot)
+                m_gamepad_index.erase(slot->get_id()); /* Replaced, so it can't be found anymore */
+            slot = new_pad;
+            m_pad_event_times[index] = {};
+            m_gamepad_index.emplace(new_pad->get_id(), new_pad);
+            m_holder.bump_generation();
+            input_hub::publish_pad_state(m_channel, index, input_hub::KIND_PAD_CONNECTED, new_pad->get_id());
         }
-    } else if (msg == MSG_GAMEPAD_RECONNECTED) {
-        auto *index = buf.read<uint8_t>();
-        auto name = read_string(buf);
-        if (index) {
-            auto pad = get_pad(name);
-            if (pad) {
-                // We just keep devices in the list so we don't have to do anything here
-                binfo("'%s' (id %i) reconnected to '%s'", name.c_str(), *index, m_name.c_str());
-                pad->set_valid();
-                wss::dispatch_gamepad_event(pad, WSS_PAD_CONNECTED, m_name);
+    } else if (msg == MSG_GAMEPAD_RECONNECTED || msg == MSG_GAMEPAD_DISCONNECTED) {
+        std::lock_guard<traced_mutex> lock(m_mutex);
+        const bool connected = msg == MSG_GAMEPAD_RECONNECTED;
+        uint8_t index;
+        std::string_view name;
+        if (buf.read(index) && read_string(buf, name)) {
+            // We just keep devices in the list so we don't have to do anything here
+            if (auto pad = get_pad(name)) {
+                binfo("'%.*s' (id %i) %s '%s'", int(name.size()), name.data(), index,
+                      connected ? "reconnected to" : "disconnected from", m_name.c_str());
+                if (connected)
+                    pad->set_valid();
+                else
+                    pad->invalidate();
+                m_holder.bump_generation();
+                input_hub::publish_pad_state(m_channel, uint8_t(pad->get_index()),
+                                             connected ? input_hub::KIND_PAD_CONNECTED
+                                                       : input_hub::KIND_PAD_DISCONNECTED,
+                                             pad->get_id());
             } else {
-                berr("Received reconnect event from '%s' with invalid gamepad name '%s' (id %i)", m_name.c_str(),
-                     name.c_str(), *index);
+                berr("Received %s event from '%s' with invalid gamepad name '%.*s' (id %i)",
+                     connected ? "reconnect" : "disconnect", m_name.c_str(), int(name.size()), name.data(), index);
             }
         } else {
             flag = false;
             berr("Couldn't read gamepad device index");
         }
-    } else if (msg == MSG_GAMEPAD_DISCONNECTED) {
-        auto *index = buf.read<uint8_t>();
-        auto name = read_string(buf);
-        if (index) {
-            auto pad = get_pad(name);
-            if (pad) {
-                // We just keep devices in the list so we don't have to do anything here
-                pad->invalidate();
-                binfo("'%s' (id %i) disconnected from '%s'", name.c_str(), *index, m_name.c_str());
-                wss::dispatch_gamepad_event(pad, WSS_PAD_DISCONNECTED, m_name);
-            } else {
-                berr("Received disconnect event from '%s' with invalid gamepad name '%s' (id %i)", m_name.c_str(),
-                     name.c_str(), *index);
-            }
+    } else if (msg == MSG_MOUSE_WHEEL_RESET) {
+        m_holder.reset_wheel();
+    } else if (msg == MSG_COMPACT_RESET) {
+        *m_decoder = {};
+    } else if (msg == MSG_HELD_STATE) {
+        udp_held_state held;
+        if (read_held_state(buf, held)) {
+            binfo("%s reconnected with %i held keys and %i held mouse buttons", name(), held.key_count,
+                  held.button_count);
+            sync_held_state(held, os_gettime_ns() / 1000000);
         } else {
             flag = false;
-            berr("Couldn't read gamepad device index");
         }
-    } else if (msg == MSG_MOUSE_WHEEL_RESET) {
-        m_holder.m_mutex.lock();
-        m_holder.last_wheel_event = {};
-        m_holder.m_mutex.unlock();
+    } else if (msg == MSG_TIME_PONG) {
+        uint64_t ping_time, client_time;
+        if (buf.read(ping_time) && buf.read(client_time))
+            m_latency.add_clock_sample(ping_time, client_time, os_gettime_ns());
+        else
+            flag = false;
     }
 
     if (!flag)
@@ -146,6 +186,160 @@ bool io_client::read_event(buffer &buf, const message msg)
     return flag;
 }
 
+int io_client::receive()
+{
+    /* Only reads up to the end of the ring, the poller reports the socket
+     * again if there's more */
+    size_t space;
+    auto *span = m_recv.write_span(space);
+    if (!space) {
+        /* Can't happen with frames, since they're parsed as soon as they're complete */
+        berr("Receive buffer of %s is full, dropping %i bytes", name(), int(m_recv.size()));
+        m_recv.clear();
+        span = m_recv.write_span(space);
+    }
+
+    const int read = netlib_tcp_recv(m_socket, span, int(space));
+    if (read > 0)
+        m_recv.commit(size_t(read));
+    return read;
+}
+
+bool io_client::next_frame(buffer &out)
+{
+    const auto available = m_recv.size();
+    uint8_t id;
+    uint16_t payload;
+
+    if (!m_recv.peek(id))
+        return false;
+
+    out.reset();
+    auto append = [&out](const uint8_t *data, size_t size) { out.write(data, size); };
+
+    if (id != MSG_FRAME) {
+        /* Older clients don't send frames, so just parse whatever arrived */
+        m_recv.consume(available, append);
+        return true;
+    }
+
+    if (!m_recv.peek(payload, 1))
+        return false;
+
+    if (payload > FRAME_MAX_PAYLOAD) {
+        berr("%s sent a frame with %hu bytes, which is more than the limit of %i bytes", name(), payload,
+             FRAME_MAX_PAYLOAD);
+        m_recv.clear();
+        mark_invalid();
+        return false;
+    }
+
+    if (available < size_t(FRAME_HEADER_SIZE + payload))
+        return false;
+
+    m_recv.skip(FRAME_HEADER_SIZE);
+    m_recv.consume(payload, append);
+    return true;
+}
+
+void io_client::enable_udp(uint32_t token)
+{
+    m_udp_token = token;
+    m_udp_received = false;
+}
+
+bool io_client::begin_udp_packet(buffer &packet, udp_held_state &held, bool &accepted)
+{
+    uint32_t sequence;
+    uint64_t time;
+    if (!packet.read(sequence) || !packet.read(time) || !read_held_state(packet, held))
+        return false;
+
+    /* Sequence numbers wrap around, so compare the difference */
+    accepted = !m_udp_received || int32_t(sequence - m_udp_sequence) > 0;
+    if (accepted) {
+        m_udp_received = true;
+        m_udp_sequence = sequence;
+        m_udp_time = time;
+        m_udp_compact_state = {};
+        m_decoder = &m_udp_compact_state;
+    }
+    return true;
+}
+
+bool io_client::read_held_state(buffer &buf, udp_held_state &held)
+{
+    uint8_t key_count, button_count;
+    if (!buf.read(key_count))
+        return false;
+    for (held.key_count = 0; held.key_count < key_count; held.key_count++) {
+        if (!buf.read(held.keys[held.key_count]))
+            return false;
+    }
+
+    if (!buf.read(button_count))
+        return false;
+    for (held.button_count = 0; held.button_count < button_count; held.button_count++) {
+        if (!buf.read(held.buttons[held.button_count]))
+            return false;
+    }
+    return true;
+}
+
+void io_client::apply_held_state(const udp_held_state &held)
+{
+    sync_held_state(held, m_latency.to_server_time(m_udp_time, os_gettime_ns()));
+}
+
+void io_client::sync_held_state(const udp_held_state &held, uint64_t time)
+{
+    key_state keys{};
+    mouse_state buttons{};
+    for (int i = 0; i < held.key_count; i++)
+        keys.set(held.keys[i], true);
+    for (int i = 0; i < held.button_count; i++)
+        buttons.set(held.buttons[i], true);
+
+    auto dispatch = [this, time](event_type type, uint16_t code) {
+        uiohook_event event{};
+        event.type = type;
+        event.time = time;
+        if (type == EVENT_KEY_PRESSED || type == EVENT_KEY_RELEASED) {
+            event.data.keyboard.keycode = code;
+            event.data.keyboard.keychar = CHAR_UNDEFINED;
+        } else {
+            event.data.mouse.button = code;
+            event.data.mouse.x = m_holder.last_mouse_movement.x;
+            event.data.mouse.y = m_holder.last_mouse_movement.y;
+        }
+        m_holder.dispatch_uiohook_event(&event, time * 1000000);
+        input_hub::publish_uiohook(m_channel, event, time * 1000000);
+    };
+
+    /* Only this thread writes to m_holder, so it can be read directly */
+    m_holder.keyboard.for_each([&](size_t code) {
+        if (!keys[code])
+            dispatch(EVENT_KEY_RELEASED, uint16_t(code));
+    });
+    m_holder.mouse.for_each([&](size_t code) {
+        if (!buttons[code])
+            dispatch(EVENT_MOUSE_RELEASED, uint16_t(code));
+    });
+    for (int i = 0; i < held.key_count; i++) {
+        if (!m_holder.keyboard[held.keys[i]])
+            dispatch(EVENT_KEY_PRESSED, held.keys[i]);
+    }
+    for (int i = 0; i < held.button_count; i++) {
+        if (!m_holder.mouse[held.buttons[i]])
+            dispatch(EVENT_MOUSE_PRESSED, held.buttons[i]);
+    }
+}
+
+latency_info io_client::latency() const
+{
+    return m_latency.info(os_gettime_ns());
+}
+
 bool io_client::valid() const
 {
     return m_valid;
@@ -156,34 +350,30 @@ void io_client::mark_invalid()
     m_valid = false;
 }
 
-std::shared_ptr<gamepad::device> io_client::get_pad(const std::string &id)
+std::shared_ptr<gamepad::device> io_client::get_pad(std::string_view id)
 {
-    for (auto &pad : m_gamepads) {
-        if (pad.second->get_id() == id)
-            return pad.second;
-    }
-    return nullptr;
+    const auto it = m_gamepad_index.find(id);
+    return it == m_gamepad_index.end() ? nullptr : it->second;
 }
 
-bool io_client::dispatch_gamepad_input(buffer &buf)
+bool io_client::dispatch_gamepad_input(buffer &buf, bool apply)
 {
-    auto *index = buf.read<uint8_t>();
-    if (!index) {
+    uint8_t index;
+    if (!buf.read(index)) {
         berr("Failed to read gamepad index");
         return false;
     }
-    auto pad = m_gamepads.find(*index);
+    auto pad = m_gamepads.find(index);
 
     auto read_buttons = [&] {
-        auto *count = buf.read<uint8_t>();
+        uint8_t count = 0;
         auto &buttons = pad->second->get_buttons();
         bool result = true;
-        if (count) {
-            for (int i = 0; i < *count; i++) {
-                auto *vc = buf.read<uint16_t>();
-                auto *vv = buf.read<uint16_t>();
-                if (vc && vv) {
-                    buttons[*vc] = *vv;
+        if (buf.read(count)) {
+            for (int i = 0; i < count; i++) {
+                uint16_t vc, vv;
+                if (buf.read(vc) && buf.read(vv)) {
+                    buttons[vc] = vv;
                 } else {
                     result = false;
                     break;
@@ -194,15 +384,15 @@ bool io_client::dispatch_gamepad_input(buffer &buf)
     };
 
     auto read_axis = [&] {
-        auto *count = buf.read<uint8_t>();
+        uint8_t count = 0;
         auto &axis = pad->second->get_axis();
         bool result = true;
-        if (count) {
-            for (int i = 0; i < *count; i++) {
-                auto *vc = buf.read<uint16_t>();
-                auto *vv = buf.read<float>();
-                if (vc && vv) {
-                    axis[*vc] = *vv;
+        if (buf.read(count)) {
+            for (int i = 0; i < count; i++) {
+                uint16_t vc;
+                float vv;
+                if (buf.read(vc) && buf.read(vv)) {
+                    axis[vc] = vv;
                 } else {
                     result = false;
                     break;
@@ -212,38 +402,96 @@ bool io_client::dispatch_gamepad_input(buffer &buf)
         return result;
     };
 
-    auto handle_last_event = [&](gamepad::input_event *output, bool is_axis) {
-        auto *vc = buf.read<uint16_t>();
-        auto *vv = buf.read<float>();
-        auto *time = buf.read<uint64_t>();
-
-        if (vc && vv && time) {
-            if (*time > output->time) {
-                output->virtual_value = *vv;
-                output->vc = *vc;
-                output->time = *time;
-                wss::dispatch_gamepad_event(output, pad->second, is_axis, m_name.c_str());
-            }
-            return true;
-        }
+    if (pad == m_gamepads.end()) {
+        berr("'%s' received gamepad input events for non existing gamepad (id %i)", m_name.c_str(), index);
         return false;
-    };
+    }
 
+    if (!read_buttons() || !read_axis()) {
+        berr("'%s' received invalid gamepad package (id %i)", m_name.c_str(), index);
+        return false;
+    }
+    if (apply)
+        m_holder.bump_generation();
+
+    return read_last_event(buf, pad->second, pad->second->last_axis_event(), true, apply) &&
+           read_last_event(buf, pad->second, pad->second->last_button_event(), false, apply);
+}
+
+bool io_client::dispatch_gamepad_delta(buffer &buf, bool apply)
+{
+    uint8_t index, flags;
+    if (!buf.read(index) || !buf.read(flags)) {
+        berr("Failed to read gamepad delta header");
+        return false;
+    }
+
+    auto pad = m_gamepads.find(index);
     if (pad == m_gamepads.end()) {
-        berr("'%s' received gamepad input events for non existing gamepad (id %i)", m_name.c_str(), *index);
+        berr("'%s' received gamepad input events for non existing gamepad (id %i)", m_name.c_str(), index);
         return false;
     }
 
-    if (!read_buttons() || !read_axis()) {
-        berr("'%s' received invalid gamepad package (id %i)", m_name.c_str(), *index);
+    /* Only the codes that changed are sent, everything else keeps its value.
+     * So dropped deltas are still written, later ones build on them */
+    auto &buttons = pad->second->get_buttons();
+    uint8_t count;
+    bool valid = buf.read(count);
+    for (int i = 0; valid && i < count; i++) {
+        uint16_t vc;
+        uint8_t vv;
+        valid = buf.read(vc) && buf.read(vv);
+        if (valid)
+            buttons[vc] = vv;
+    }
+
+    auto &axis = pad->second->get_axis();
+    valid = valid && buf.read(count);
+    for (int i = 0; valid && i < count; i++) {
+        uint16_t vc;
+        float vv;
+        valid = buf.read(vc) && buf.read(vv);
+        if (valid)
+            axis[vc] = vv;
+    }
+
+    if (!valid) {
+        berr("'%s' received invalid gamepad delta (id %i)", m_name.c_str(), index);
         return false;
     }
+    if (apply)
+        m_holder.bump_generation();
+
+    if ((flags & GAMEPAD_DELTA_AXIS_EVENT) &&
+        !read_last_event(buf, pad->second, pad->second->last_axis_event(), true, apply))
+        return false;
+    if ((flags & GAMEPAD_DELTA_BUTTON_EVENT) &&
+        !read_last_event(buf, pad->second, pad->second->last_button_event(), false, apply))
+        return false;
+    return true;
+}
+
+bool io_client::read_last_event(buffer &buf, const std::shared_ptr<gamepad::device> &pad,
+                                gamepad::input_event *output, bool is_axis, bool apply)
+{
+    uint16_t vc;
+    float vv;
+    uint64_t time;
 
-    if (handle_last_event(pad->second->last_axis_event(), true) &&
-        handle_last_event(pad->second->last_button_event(), false)) {
+    if (buf.read(vc) && buf.read(vv) && buf.read(time)) {
+        if (!apply)
+            return true;
+        auto &times = m_pad_event_times[uint8_t(pad->get_index())];
+        auto &newest = is_axis ? times.axis : times.button;
+        if (time > newest) {
+            newest = time;
+            output->virtual_value = vv;
+            output->vc = vc;
+            output->time = m_latency.to_server_time(time, os_gettime_ns());
+            input_hub::publish_pad(m_channel, uint8_t(pad->get_index()), is_axis, input_hub::pad_input_of(*output));
+        }
         return true;
     }
-
     berr("Couldn't read gamepad last events.");
     return false;
 }
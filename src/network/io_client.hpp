@@ -19,12 +19,28 @@
 #pragma once
 
 #include "../util/input_data.hpp"
+#include "latency_stats.hpp"
+#include "rate_limiter.hpp"
+#include "../util/trace.hpp"
 #include <buffer.hpp>
+#include <ring_buffer.hpp>
 #include <messages.hpp>
 #include <netlib.h>
 #include <map>
+#include <mutex>
+#include <string_view>
+
+/* Big enough for a full frame and whatever arrived after it */
+#define RECV_BUFFER_SIZE 0x8000
 
 namespace network {
+/* Keys and mouse buttons that were held down when an udp packet was sent */
+struct udp_held_state {
+    uint16_t keys[0xff];
+    uint8_t buttons[0xff];
+    uint8_t key_count = 0, button_count = 0;
+};
+
 class io_client {
 public:
     io_client(const std::string &name, tcp_socket socket);
@@ -34,22 +50,95 @@ public:
     tcp_socket socket() const;
     const char *name() const;
     input_data *get_data();
-    bool read_event(buffer &buf, message msg);
+    /* Without apply the message is only decoded, so the decoder state stays
+     * in sync, and thrown away. Releases still go through, so nothing stays
+     * held down */
+    bool read_event(buffer &buf, message msg, bool apply = true);
+
+    /* Reads everything that's available on the socket into the receive
+     * buffer. Returns the result of netlib_tcp_recv */
+    int receive();
+
+    /* Moves the next complete frame out of the receive buffer into out,
+     * returns false if there's none */
+    bool next_frame(buffer &out);
+
+    uint32_t udp_token() const { return m_udp_token; }
+    void enable_udp(uint32_t token);
+
+    /* Reads the header of an udp packet after the token. Returns false if the
+     * packet is broken, accepted is false for late or repeated packets.
+     * Compact events of accepted packets are decoded with their own state
+     * until end_udp_packet, so TCP batches that are split over several
+     * reads keep theirs */
+    bool begin_udp_packet(buffer &packet, udp_held_state &held, bool &accepted);
+    void end_udp_packet() { m_decoder = &m_compact_state; }
+
+    /* Presses and releases keys and buttons so they match the packet */
+    void apply_held_state(const udp_held_state &held);
+
+    /* Reads the held keys and buttons of MSG_HELD_STATE or an udp packet */
+    static bool read_held_state(buffer &buf, udp_held_state &held);
     void mark_invalid();
     bool valid() const;
 
+    /* Set once the client sent MSG_TIME_SYNC */
+    bool time_sync() const { return m_time_sync; }
+    void enable_time_sync() { m_time_sync = true; }
+    latency_info latency() const;
+
+    /* Only used by the network thread, apart from the drop counters */
+    rate_limiter &limiter() { return m_limiter; }
+    const rate_limiter &limiter() const { return m_limiter; }
+
+    /* Guards the gamepads of this client, which are written by the network
+     * thread. Keyboard and mouse go through the sequence lock of m_holder */
+    traced_mutex &mutex() { return m_mutex; }
+
+    /* mutex() has to be locked for both */
     std::map<uint8_t, std::shared_ptr<gamepad::device>> &gamepads() { return m_gamepads; }
-    std::shared_ptr<gamepad::device> get_pad(const std::string &id);
+    std::shared_ptr<gamepad::device> get_pad(std::string_view id);
 
 private:
-    bool dispatch_gamepad_input(buffer &buf);
+    void sync_held_state(const udp_held_state &held, uint64_t time); /* time in server ms */
+    bool dispatch_gamepad_input(buffer &buf, bool apply);
+    bool dispatch_gamepad_delta(buffer &buf, bool apply);
+    bool read_last_event(buffer &buf, const std::shared_ptr<gamepad::device> &pad, gamepad::input_event *output,
+                         bool is_axis, bool apply);
     input_data m_holder;
+    IO_TRACED_MUTEX(m_mutex, "io_client::m_mutex");
+    compact_event_state m_compact_state;     /* Decoder state for MSG_UIOHOOK_COMPACT over TCP */
+    compact_event_state m_udp_compact_state; /* Reset for every udp packet */
+    compact_event_state *m_decoder = &m_compact_state;
+    latency_stats m_latency;
+    rate_limiter m_limiter;
+    bool m_time_sync = false;
+
+    /* UDP transport, see MSG_UDP_PACKET */
+    uint32_t m_udp_token = 0;
+    uint32_t m_udp_sequence = 0;
+    uint64_t m_udp_time = 0; /* Client time of the newest packet */
+    bool m_udp_received = false;
+
     tcp_socket m_socket;
     /* Set to false if this client should be disconnected on next round_trip */
     bool m_valid;
     std::string m_name;
+    uint16_t m_channel; /* See input_hub */
+
+    /* Received data, incomplete frames stay in here until the rest arrives */
+    ring_buffer<RECV_BUFFER_SIZE> m_recv;
 
     /* Manually managed */
     std::map<uint8_t, std::shared_ptr<gamepad::device>> m_gamepads;
+    /* Client time of the newest axis/button event per index, keyframes repeat
+     * the last events and these are in client time, unlike the device's.
+     * Reset whenever the pad in a slot changes */
+    struct pad_event_times {
+        uint64_t axis = 0, button = 0;
+    };
+    std::map<uint8_t, pad_event_times> m_pad_event_times;
+    /* Id to gamepad, the transparent comparator allows lookups with views into the receive buffer */
+    std::map<std::string, std::shared_ptr<gamepad::device>, std::less<>> m_gamepad_index;
 };
 }
@@ -18,22 +18,22 @@
 
 #include "io_server.hpp"
 #include "remote_connection.hpp"
+#include "../gui/ui_events.hpp"
 #include "../util/config.hpp"
 #include "../util/lang.h"
+#include "../util/pipeline_stats.hpp"
 #include <algorithm>
 #include <obs-module.h>
+#include <socket_options.hpp>
 #include <util/platform.h>
 
 #include "../util/log.h"
 
-static netlib_socket_set sockets = nullptr;
-
 namespace network {
-std::mutex mutex;
+IO_TRACED_MUTEX(mutex, "network::mutex");
 
 io_server::io_server(const uint16_t port) : m_server(nullptr)
 {
-    sockets = nullptr;
     m_ip.port = port;
     m_last_refresh = os_gettime_ns();
 }
@@ -41,6 +41,10 @@ io_server::io_server(const uint16_t port) : m_server(nullptr)
 io_server::~io_server()
 {
     m_clients.clear();
+    if (m_packet)
+        netlib_free_packet(m_packet);
+    if (m_udp)
+        netlib_udp_close(m_udp);
 }
 
 bool io_server::init()
@@ -56,10 +60,28 @@ bool io_server::init()
               ipaddr & 0xff, m_ip.port);
 
         m_server = netlib_tcp_open(&m_ip);
-        m_buffer.resize(1024); // Most likely will never need more than 1K
+        m_buffer.resize(RECV_BUFFER_SIZE + 1); /* Holds one frame at a time, so it never has to grow */
         if (!m_server) {
             berr("netlib_tcp_open failed: %s", netlib_get_error());
             flag = false;
+        } else if (!m_poller.init() || !m_poller.add(m_server)) {
+            flag = false;
+        } else {
+            /* Clients fall back to TCP if this doesn't work */
+            m_udp = netlib_udp_open(m_ip.port);
+            m_packet = m_udp ? netlib_alloc_packet(UDP_PACKET_SIZE) : nullptr;
+            if (!m_packet || !m_poller.add(m_udp)) {
+                bwarn("Couldn't open udp port %hu, remote clients will only use TCP: %s", m_ip.port,
+                      netlib_get_error());
+                if (m_packet)
+                    netlib_free_packet(m_packet);
+                if (m_udp)
+                    netlib_udp_close(m_udp);
+                m_packet = nullptr;
+                m_udp = nullptr;
+            } else {
+                m_udp_buffer.resize(UDP_PACKET_SIZE + 1);
+            }
         }
     }
     return flag;
@@ -67,8 +89,18 @@ bool io_server::init()
 
 void io_server::listen(int &numready)
 {
-    if (create_sockets())
-        numready = netlib_check_socket_set(sockets, LISTEN_TIMEOUT);
+    const int timeout = std::min<int>(LISTEN_TIMEOUT, io_config::server_refresh_rate);
+    numready = m_poller.wait(timeout, m_ready);
+}
+
+bool io_server::is_ready(poll_socket socket) const
+{
+    return std::find(m_ready.begin(), m_ready.end(), socket) != m_ready.end();
+}
+
+bool io_server::server_ready() const
+{
+    return is_ready(m_server);
 }
 
 tcp_socket io_server::socket() const
@@ -78,45 +110,201 @@ tcp_socket io_server::socket() const
 
 void io_server::update_clients()
 {
-    std::lock_guard<std::mutex> lock(mutex);
+    IO_TRACE_ZONE("read clients");
+    /* Clients are only added and removed on this thread, so the list can be
+     * used without locking. Each client locks on its own while writing, so
+     * sources reading other clients don't have to wait */
+    if (m_udp && is_ready(m_udp))
+        receive_udp();
 
     for (const auto &client : m_clients) {
-        if (netlib_socket_ready(client->socket())) {
-            /* Receive input data */
-            m_buffer.reset();
-            const int read = netlib_tcp_recv(client->socket(), static_cast<void *>(m_buffer.get()), m_buffer.length());
+        if (!is_ready(client->socket()))
+            continue;
+
+        /* Idle polls would drown out the time spent on actual input */
+        pipeline_stats::scope stats(pipeline_stats::STAGE_NETWORK);
+        /* A closed connection stays readable, so zero has to drop the client as well */
+        if (client->receive() <= 0) {
+            berr("Failed to receive buffer from %s. Closed connection", client->name());
+            client->mark_invalid();
+            continue;
+        }
 
-            if (read < 0) {
-                berr("Failed to receive buffer from %s. Closed connection", client->name());
-                client->mark_invalid();
-                continue;
-            }
+        const auto now = os_gettime_ns();
+        while (client->valid() && client->next_frame(m_buffer)) {
+            const bool throttled = !client->limiter().accept_bytes(m_buffer.write_pos(), now);
+            if (throttled)
+                drop_input(client.get(), m_buffer.write_pos(), now);
+            read_messages(client.get(), throttled);
+        }
+        check_limits(client.get(), now);
+    }
+}
+
+void io_server::drop_input(io_client *client, size_t size, uint64_t now)
+{
+    pipeline_stats::count(pipeline_stats::COUNTER_DROPS);
+    if (client->limiter().drop(size, now))
+        bwarn("%s is over the rate limit, dropping its input", client->name());
+}
+
+void io_server::check_limits(io_client *client, uint64_t now)
+{
+    if (client->valid() && client->limiter().exceeded(now)) {
+        berr("Disconnecting %s, it was over the rate limit for %i ms (%llu frames and %llu bytes dropped)",
+             client->name(), THROTTLE_DISCONNECT_TIME, (unsigned long long)client->limiter().dropped_frames(),
+             (unsigned long long)client->limiter().dropped_bytes());
+        client->mark_invalid();
+    }
+}
 
-            auto msg = read_msg_from_buffer(m_buffer);
-            while (msg != MSG_INVALID) {
-                switch (msg) {
-                case MSG_UIOHOOK_EVENT:
-                case MSG_GAMEPAD_EVENT:
-                case MSG_GAMEPAD_CONNECTED:
-                case MSG_GAMEPAD_RECONNECTED:
-                case MSG_GAMEPAD_DISCONNECTED:
-                case MSG_MOUSE_WHEEL_RESET:
-                    if (!client->read_event(m_buffer, msg))
-                        berr("Failed to receive event data from %s.", client->name());
-                    break;
-                case MSG_CLIENT_DC:
-                    client->mark_invalid();
-                    break;
-                default:
-                case MSG_END_BUFFER:
-                case MSG_INVALID:
-                    break;
-                }
-                if (int(m_buffer.read_pos()) < read)
-                    break;
-                msg = read_msg_from_buffer(m_buffer);
+void io_server::read_messages(io_client *client, bool throttled)
+{
+    const auto now = os_gettime_ns();
+    auto msg = read_msg_from_buffer(m_buffer);
+    while (msg != MSG_INVALID) {
+        switch (msg) {
+        case MSG_UIOHOOK_EVENT:
+        case MSG_UIOHOOK_COMPACT:
+        case MSG_GAMEPAD_EVENT:
+        case MSG_GAMEPAD_DELTA:
+            /* Compact events and gamepad deltas build on the ones before, so
+             * messages over the limit are still decoded and only their input
+             * is thrown away */
+            if (!throttled && !client->limiter().accept_message(now)) {
+                drop_input(client, m_buffer.write_pos() - m_buffer.read_pos(), now);
+                throttled = true;
+            }
+            if (!client->read_event(m_buffer, msg, !throttled)) {
+                berr("Failed to receive event data from %s.", client->name());
+                return;
             }
+            break;
+        case MSG_GAMEPAD_CONNECTED:
+        case MSG_GAMEPAD_RECONNECTED:
+        case MSG_GAMEPAD_DISCONNECTED:
+        case MSG_MOUSE_WHEEL_RESET:
+        case MSG_HELD_STATE:
+            /* Rare and needed to keep the state right, these always go through */
+            if (!throttled)
+                client->limiter().accept_message(now);
+            /* fallthrough */
+        case MSG_TIME_PONG:
+            if (!client->read_event(m_buffer, msg)) {
+                /* The rest of the frame can't be trusted anymore */
+                berr("Failed to receive event data from %s.", client->name());
+                return;
+            }
+            break;
+        case MSG_COMPACT_RESET:
+            client->read_event(m_buffer, msg);
+            break;
+        case MSG_UDP_REQUEST:
+            enable_udp(client);
+            break;
+        case MSG_TIME_SYNC:
+            client->enable_time_sync();
+            send_time_ping(client); /* Don't wait for the next interval */
+            break;
+        case MSG_CLIENT_DC:
+            client->mark_invalid();
+            return;
+        case MSG_END_BUFFER:
+            return;
+        default:
+            berr("Received unexpected message %i from %s.", int(msg), client->name());
+            return;
+        }
+        msg = read_msg_from_buffer(m_buffer);
+    }
+}
+
+void io_server::enable_udp(io_client *client)
+{
+    if (!m_udp)
+        return; /* The client just keeps using TCP */
+
+    /* Only has to tell clients apart, the connection isn't encrypted anyway */
+    static uint32_t counter = 0;
+    uint32_t token;
+    do {
+        token = uint32_t(os_gettime_ns() * 2654435761u) ^ ++counter;
+    } while (!token || std::any_of(m_clients.begin(), m_clients.end(),
+                                   [token](const std::shared_ptr<io_client> &c) { return c->udp_token() == token; }));
+
+    uint8_t reply[1 + sizeof(token)] = {MSG_UDP_TOKEN};
+    memcpy(reply + 1, &token, sizeof(token));
+    if (netlib_tcp_send(client->socket(), reply, sizeof(reply)) < int(sizeof(reply))) {
+        client->mark_invalid();
+        return;
+    }
+    client->enable_udp(token);
+    binfo("%s is sending input over udp", client->name());
+}
+
+void io_server::send_time_ping(io_client *client)
+{
+    /* Taken as late as possible, anything before sending ends up in the round trip time */
+    uint8_t ping[1 + sizeof(uint64_t)] = {MSG_TIME_PING};
+    const uint64_t now = os_gettime_ns();
+    memcpy(ping + 1, &now, sizeof(now));
+    if (netlib_tcp_send(client->socket(), ping, sizeof(ping)) < int(sizeof(ping)))
+        client->mark_invalid();
+}
+
+void io_server::receive_udp()
+{
+    udp_held_state held;
+
+    /* Receiving doesn't block, so drain everything that arrived */
+    while (netlib_udp_recv(m_udp, m_packet) > 0) {
+        m_udp_buffer.assign(m_packet->data, m_packet->len);
+        uint8_t id;
+        uint32_t token;
+        if (!m_udp_buffer.read(id) || id != MSG_UDP_PACKET || !m_udp_buffer.read(token) || !token)
+            continue;
+
+        const auto it = std::find_if(m_clients.begin(), m_clients.end(),
+                                     [&](const std::shared_ptr<io_client> &c) { return c->udp_token() == token; });
+        if (it == m_clients.end() || !(*it)->valid())
+            continue;
+
+        /* The token has to come from the same computer as the TCP connection */
+        auto client = *it;
+        const auto *peer = netlib_tcp_get_peer_address(client->socket());
+        if (!peer || peer->host != m_packet->address.host)
+            continue;
+
+        const auto now = os_gettime_ns();
+        const bool throttled = !client->limiter().accept_bytes(m_packet->len, now);
+        if (throttled) {
+            drop_input(client.get(), m_packet->len, now);
+            check_limits(client.get(), now);
+            if (!client->valid())
+                continue;
         }
+
+        bool accepted = false;
+        if (!client->begin_udp_packet(m_udp_buffer, held, accepted)) {
+            berr("Received broken udp packet from %s.", client->name());
+            continue;
+        }
+        if (!accepted)
+            continue;
+
+        while (m_udp_buffer.read_pos() < m_udp_buffer.write_pos()) {
+            uint8_t frame_id;
+            uint16_t size;
+            void *payload = nullptr;
+            if (m_udp_buffer.read(frame_id) && frame_id == MSG_FRAME && m_udp_buffer.read(size))
+                m_udp_buffer.read(&payload, size);
+            if (!payload)
+                break;
+            m_buffer.assign(payload, size);
+            read_messages(client.get(), throttled);
+        }
+        client->end_udp_packet();
+        client->apply_held_state(held);
     }
 }
 
@@ -154,46 +342,59 @@ void io_server::ping_clients()
 
 void io_server::round_trip()
 {
-    mutex.lock();
+    if (m_clients.empty())
+        return;
+    IO_TRACE_ZONE("round trip");
 
-    if (!m_clients.empty()) {
-        const auto old = server_instance->num_clients();
-        const auto it = std::remove_if(m_clients.begin(), m_clients.end(), [](const std::shared_ptr<io_client> &o) {
+    {
+        std::lock_guard<traced_mutex> lock(mutex);
+        const auto old = num_clients();
+        const auto it = std::remove_if(m_clients.begin(), m_clients.end(), [this](const std::shared_ptr<io_client> &o) {
             if (!o->valid()) {
                 binfo("%s disconnected.", o->name());
+                m_poller.remove(o->socket());
+                m_client_index.erase(o->name());
                 return true;
             }
             return false;
         });
         m_clients.erase(it, m_clients.end());
 
-        if ((os_gettime_ns() - m_last_refresh) / (1000 * 1000) > io_config::server_refresh_rate) {
-            for (auto &client : m_clients) {
-                if (!send_message(client->socket(), MSG_REFRESH))
-                    client->mark_invalid();
-            }
-            m_last_refresh = os_gettime_ns();
+        if (old != num_clients()) {
+            m_clients_changed = true;
+            ui_events::notify(ui_events::CHANGE_CLIENTS);
         }
+    }
 
-        if (old != server_instance->num_clients())
-            m_clients_changed = true;
+    /* Sending can block, so this happens without holding the lock. Only this
+     * thread changes the list */
+    if ((os_gettime_ns() - m_last_refresh) / (1000 * 1000) > io_config::server_refresh_rate) {
+        for (auto &client : m_clients) {
+            if (!send_message(client->socket(), MSG_REFRESH))
+                client->mark_invalid();
+        }
+        m_last_refresh = os_gettime_ns();
     }
 
-    mutex.unlock();
+    /* Only clients that asked for it know what to do with these */
+    if ((os_gettime_ns() - m_last_time_ping) / (1000 * 1000) >= TIME_SYNC_INTERVAL) {
+        for (auto &client : m_clients) {
+            if (client->time_sync() && client->valid())
+                send_time_ping(client.get());
+        }
+        m_last_time_ping = os_gettime_ns();
+    }
 }
 
 std::shared_ptr<io_client> io_server::get_client(const std::string &id)
 {
-    for (auto &client : m_clients) {
-        if (client->name() == id)
-            return client;
-    }
-    return nullptr;
+    const auto it = m_client_index.find(id);
+    return it == m_client_index.end() ? nullptr : it->second;
 }
 
 void io_server::add_client(tcp_socket socket, char *name)
 {
-    std::lock_guard<std::mutex> lock(mutex);
+    std::lock_guard<traced_mutex> lock(mutex);
 
     fix_name(name);
 
@@ -213,22 +414,25 @@ void io_server::add_client(tcp_socket socket, char *name)
 
     bdebug("Received connection from '%s'.", name);
 
+    if (!m_poller.add(socket)) {
+        netlib_tcp_close(socket);
+        return;
+    }
+
+    /* Time pings have to go out right away, otherwise they measure Nagle's algorithm */
+    if (!tune_tcp_socket(socket))
+        bwarn("Couldn't set socket options for '%s'", name);
+
     m_clients_changed = true;
-    m_clients.emplace_back(new io_client(name, socket));
+    auto client = std::make_shared<io_client>(name, socket);
+    m_clients.emplace_back(client);
+    m_client_index[client->name()] = client;
+    ui_events::notify(ui_events::CHANGE_CLIENTS);
 }
 
 bool io_server::unique_name(char *name)
 {
-    if (!name)
-        return false;
-    auto flag = true;
-    for (auto &client : m_clients) {
-        if (!strcmp(name, client->name())) {
-            flag = false;
-            break;
-        }
-    }
-    return flag;
+    return name && m_client_index.find(name) == m_client_index.end();
 }
 
 /* Only works with pre-allocated char arrays */
@@ -242,34 +446,14 @@ void io_server::fix_name(char *name)
     }
 }
 
-bool io_server::create_sockets()
-{
-    if (sockets && int(m_last_client_count) == num_clients())
-        return true; // No reason to reallocate
-    if (sockets)
-        netlib_free_socket_set(sockets);
-
-    sockets = netlib_alloc_socket_set(num_clients() + 1);
-    m_last_client_count = num_clients();
-    if (!sockets) {
-        berr("netlib_alloc_socket_set failed with %i clients.", num_clients() + 1);
-        network_flag = false;
-        return false;
-    }
-
-    netlib_tcp_add_socket(sockets, m_server);
-
-    for (const auto &client : m_clients)
-        netlib_tcp_add_socket(sockets, client->socket());
-
-    return true;
-}
 std::shared_ptr<gamepad::device> io_server::get_client_device_by_id(const std::string &client_id,
                                                                     const std::string &device_id)
 {
     auto client = get_client(client_id);
-    if (client)
+    if (client) {
+        std::lock_guard<traced_mutex> lock(client->mutex());
         return client->get_pad(device_id);
+    }
     return nullptr;
 }
 }
@@ -19,19 +19,22 @@
 #pragma once
 
 #include "io_client.hpp"
+#include "socket_poller.hpp"
+#include "../util/trace.hpp"
 #include <memory>
 #include <mutex>
 #include <netlib.h>
 #include <obs-module.h>
 #include <vector>
+#include <unordered_map>
 #include <buffer.hpp>
 
-#ifdef _WIN32
-#endif
-#define LISTEN_TIMEOUT 25
+/* Sockets wake the network thread up on their own, this only limits how long
+ * clients wait for round_trip when nothing is sent */
+#define LISTEN_TIMEOUT 100
 
 namespace network {
-extern std::mutex mutex;
+extern traced_mutex mutex;
 
 class io_server {
 public:
@@ -44,6 +47,7 @@ public:
     void listen(int &numready);
 
     tcp_socket socket() const;
+    bool server_ready() const;
     void add_client(tcp_socket socket, char *name);
     void update_clients();
     void get_clients(std::vector<const char *> &v);
@@ -70,14 +74,27 @@ private:
 
     static void fix_name(char *name);
 
-    bool create_sockets();
+    bool is_ready(poll_socket socket) const;
+    /* Throttled frames are only decoded, see io_client::read_event */
+    void read_messages(io_client *client, bool throttled);
+    void drop_input(io_client *client, size_t size, uint64_t now);
+    void check_limits(io_client *client, uint64_t now);
+    void receive_udp();
+    void enable_udp(io_client *client);
+    static void send_time_ping(io_client *client);
 
     uint64_t m_last_refresh = 0;
-    buffer m_buffer;                /* Used for temporarily storing sent data */
+    uint64_t m_last_time_ping = 0;
+    buffer m_buffer;                /* Frame that is currently being parsed */
     bool m_clients_changed = false; /* Set to true on connection/disconnect and false after get_clients() */
     ip_address m_ip{};
     tcp_socket m_server;
-    std::vector<std::shared_ptr<io_client>> m_clients; /* map client name to client instance */
-    size_t m_last_client_count = 0;
+    std::vector<std::shared_ptr<io_client>> m_clients;
+    std::unordered_map<std::string, std::shared_ptr<io_client>> m_client_index; /* Client name to client */
+    socket_poller m_poller;
+    udp_socket m_udp = nullptr; /* Optional, see MSG_UDP_PACKET */
+    udp_packet *m_packet = nullptr;
+    buffer m_udp_buffer;
+    std::vector<poll_socket> m_ready; /* Readable sockets of the last listen() */
 };
 }
@@ -0,0 +1,109 @@
+/*************************************************************************
+ * This file is part of input-overlay
+ * github.con/univrsal/input-overlay
+ * Copyright 2022 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#include "latency_stats.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace network {
+void latency_stats::add_clock_sample(uint64_t ping_time, uint64_t client_time, uint64_t now)
+{
+    if (now < ping_time)
+        return;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto &sample = m_clock[m_clock_pos];
+    sample.rtt = (now - ping_time) / 1000;
+    /* Assumes that both directions take equally long */
+    sample.offset = int64_t(client_time) - int64_t((ping_time + now) / 2000);
+    m_clock_pos = (m_clock_pos + 1) % CLOCK_SAMPLE_COUNT;
+    m_clock_count = std::min<size_t>(m_clock_count + 1, CLOCK_SAMPLE_COUNT);
+    m_rtt = sample.rtt;
+
+    /* The sample with the lowest round trip time has the smallest error, only
+     * recent ones are used so clock drift doesn't matter */
+    const auto *best = std::min_element(m_clock, m_clock + m_clock_count,
+                                        [](const clock_sample &a, const clock_sample &b) { return a.rtt < b.rtt; });
+    m_offset = best->offset;
+    m_synced = true;
+}
+
+uint64_t latency_stats::to_server_time(uint64_t client_time, uint64_t now) const
+{
+    if (!m_synced)
+        return now / 1000000;
+    return uint64_t(int64_t(client_time) - m_offset / 1000);
+}
+
+uint64_t latency_stats::add_event(uint64_t client_time, uint64_t now)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_window_start || now - m_window_start >= 1000000000) {
+        if (m_window_start)
+            m_events_per_second = float(m_window_events * 1e9 / double(now - m_window_start));
+        m_window_start = now;
+        m_window_events = 0;
+    }
+    m_window_events++;
+
+    if (!m_synced)
+        return now / 1000000;
+
+    /* Event times only have ms precision, so this is up to 1ms too high */
+    const auto sent = int64_t(client_time) * 1000 - m_offset;
+    const auto latency = std::max(0.f, float(int64_t(now / 1000) - sent) / 1000.f);
+
+    m_samples[m_sample_pos] = latency;
+    m_sample_pos = (m_sample_pos + 1) % LATENCY_SAMPLE_COUNT;
+    m_sample_count = std::min<size_t>(m_sample_count + 1, LATENCY_SAMPLE_COUNT);
+
+    /* Interarrival jitter like in RFC 3550 */
+    if (m_last_latency >= 0)
+        m_jitter += (std::fabs(latency - m_last_latency) - m_jitter) / 16.f;
+    m_last_latency = latency;
+    return uint64_t(sent / 1000);
+}
+
+latency_info latency_stats::info(uint64_t now) const
+{
+    latency_info result;
+    float samples[LATENCY_SAMPLE_COUNT];
+    size_t count;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        result.synced = m_synced;
+        result.rtt = m_rtt / 1000.f;
+        result.jitter = m_jitter;
+        /* Nothing arrived in the last two windows */
+        if (m_window_start && now - m_window_start < 2000000000)
+            result.events_per_second = m_events_per_second;
+        count = m_sample_count;
+        std::copy(m_samples, m_samples + count, samples);
+    }
+
+    if (count) {
+        auto *p50 = samples + count / 2;
+        auto *p99 = samples + std::min(count - 1, count * 99 / 100);
+        std::nth_element(samples, p50, samples + count);
+        result.p50 = *p50;
+        std::nth_element(samples, p99, samples + count);
+        result.p99 = *p99;
+    }
+    return result;
+}
+}
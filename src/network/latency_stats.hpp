@@ -0,0 +1,74 @@
+/*************************************************************************
+ * This file is part of input-overlay
+ * github.con/univrsal/input-overlay
+ * Copyright 2022 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <mutex>
+
+#define LATENCY_SAMPLE_COUNT 512 /* Events used for the percentiles */
+#define CLOCK_SAMPLE_COUNT 8     /* Pongs used for the clock offset */
+
+namespace network {
+/* Everything in ms */
+struct latency_info {
+    bool synced = false;
+    float rtt = 0, p50 = 0, p99 = 0, jitter = 0;
+    float events_per_second = 0;
+};
+
+/* Estimates the clock offset of a client from MSG_TIME_PONG and keeps track of
+ * how long its events took to arrive. Written by the network thread, info()
+ * is called from the settings dialog */
+class latency_stats {
+    struct clock_sample {
+        int64_t offset; /* Client clock minus server clock in µs */
+        uint64_t rtt;   /* µs */
+    };
+
+    mutable std::mutex m_mutex;
+    clock_sample m_clock[CLOCK_SAMPLE_COUNT]{};
+    size_t m_clock_count = 0, m_clock_pos = 0;
+    int64_t m_offset = 0;
+    uint64_t m_rtt = 0;
+    bool m_synced = false;
+
+    float m_samples[LATENCY_SAMPLE_COUNT]{};
+    size_t m_sample_count = 0, m_sample_pos = 0;
+    float m_jitter = 0, m_last_latency = -1;
+
+    uint64_t m_window_start = 0, m_window_events = 0;
+    float m_events_per_second = 0;
+
+public:
+    /* ping_time is the server time of the ping in ns, client_time the
+     * client time of the reply in µs and now the server time in ns */
+    void add_clock_sample(uint64_t ping_time, uint64_t client_time, uint64_t now);
+
+    /* Takes the client time of an event in ms and returns it in server time
+     * (os_gettime_ns() in ms). Without an offset estimate the arrival time is
+     * used instead */
+    uint64_t add_event(uint64_t client_time, uint64_t now);
+
+    /* Same without recording anything, only safe on the network thread */
+    uint64_t to_server_time(uint64_t client_time, uint64_t now) const;
+
+    latency_info info(uint64_t now) const;
+};
+}
@@ -1,19 +1,31 @@
 #include "mg.hpp"
 
+#include <algorithm>
 #include <atomic>
-#include <deque>
-#include <mutex>
+#include <chrono>
+#include <map>
 #include <thread>
+#include <tuple>
 #include <vector>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
 #include "../util/config.hpp"
+#include "../util/input_hub.hpp"
+#include "../util/key_stats.hpp"
+#include "../util/pipeline_stats.hpp"
 #include "../util/log.h"
+#include "../util/services.hpp"
 #include "../util/settings.h"
+#include "../util/thread_priority.hpp"
+#include "../util/trace.hpp"
 
 #ifdef _WIN32
 #include "../util/obs_util.hpp"
 #else
 #include <util/threading.h>
 #endif
+#include <util/platform.h>
 
 extern "C" {
 #include <mongoose.h>
@@ -21,51 +33,449 @@ extern "C" {
 
 namespace mg {
 struct mg_mgr mgr {};
-std::vector<struct mg_connection *> web_sockets;
-std::deque<std::string> message_queue;
-std::mutex poll_mutex;
+/* What a client sent in its last subscribe message, empty lists match everything */
+struct subscription {
+    uint32_t events = WSS_EV_ALL;
+    std::vector<std::string> sources, devices;
+    bool batch = false;
+
+    static bool contains(const std::vector<std::string> &list, const std::string &value)
+    {
+        return list.empty() || std::find(list.begin(), list.end(), value) != list.end();
+    }
+
+    bool matches(const wss::event &e) const
+    {
+        return (events & e.bits) && contains(sources, e.source) && (e.device.empty() || contains(devices, e.device));
+    }
+};
+
+struct web_socket {
+    struct mg_connection *connection;
+    bool binary;
+    subscription filter;
+    std::string batch; /* Only used if filter.batch is set */
+    uint64_t dropped = 0;
+
+    bool is_open() const { return !connection->is_draining && !connection->is_closing; }
+    size_t pending() const { return connection->send.len + batch.size(); }
+
+    void send(const std::string &data)
+    {
+        mg_ws_send(connection, data.c_str(), data.length(), binary ? WEBSOCKET_OP_BINARY : WEBSOCKET_OP_TEXT);
+    }
+
+    void add(const std::string &data)
+    {
+        if (!filter.batch) {
+            send(data);
+            return;
+        }
+        if (binary) {
+            batch += data; /* Records carry their own length */
+        } else {
+            batch += batch.empty() ? '[' : ',';
+            batch += data;
+        }
+        if (batch.size() >= WSS_BATCH_LIMIT)
+            flush();
+    }
+
+    /* JSON for both kinds of connections */
+    void add_text(const std::string &data)
+    {
+        if (!binary) {
+            add(data);
+            return;
+        }
+        flush();
+        mg_ws_send(connection, data.c_str(), data.length(), WEBSOCKET_OP_TEXT);
+    }
+
+    void flush()
+    {
+        if (batch.empty())
+            return;
+        if (!binary)
+            batch += ']';
+        send(batch);
+        batch.clear();
+    }
+};
+
+/* Only used by the mg thread. Connections are removed in MG_EV_CLOSE, the
+ * only point before mongoose frees them, so everything in here is alive */
+std::vector<web_socket> web_sockets;
+/* Union of all subscribed events, so unwanted events aren't even converted */
+static std::atomic<uint32_t> subscribed_events{0};
+static size_t slow_bytes = 0, max_bytes = 0;
+static std::atomic<size_t> client_count{0}, deepest_queue{0};
+static std::atomic<uint64_t> dropped_motion{0}, slow_disconnects{0};
+/* Written to by on_publish, at most once until the mg thread woke up */
+static std::atomic<struct mg_connection *> wakeup_pipe{nullptr};
+static std::atomic<bool> wakeup_pending{false};
+static std::atomic<uint64_t> dropped_events{0};
+/* Only used by the mg thread */
+static input_hub::cursor hub;
+static input_hub::event hub_events[WSS_HUB_BATCH];
+
+static void update_subscriptions()
+{
+    uint32_t events = 0;
+    for (const auto &s : web_sockets)
+        events |= s.filter.events;
+    subscribed_events = events;
+}
+
+/* Motion is only sent at a capped rate, a stream keeps the newest value
+ * that arrived since it was last sent */
+using clock = std::chrono::steady_clock;
+using motion_key = std::tuple<std::string, std::string, uint32_t, uint16_t>;
+struct motion_stream {
+    wss::event latest;
+    bool pending = false;
+    clock::time_point last_sent;
+};
+
+static std::map<motion_key, motion_stream> motion_streams; /* Only used by the mg thread */
+static clock::duration mouse_interval{}, axis_interval{};
+
+/* Key press statistics per hub channel, only used by the mg thread */
+static std::map<uint16_t, key_stats> channel_stats;
+static clock::time_point last_input_stats;
+static std::string input_stats_scratch;
+static const auto input_stats_interval = std::chrono::milliseconds(WSS_INPUT_STATS_INTERVAL);
+
+static clock::duration rate_to_interval(uint16_t rate)
+{
+    if (rate == 0)
+        return clock::duration::zero();
+    return std::chrono::duration_cast<clock::duration>(std::chrono::seconds(1)) / rate;
+}
+
+/* Zero for discrete events, which are never held back */
+static clock::duration motion_interval(const wss::event &e)
+{
+    if (!e.is_motion())
+        return clock::duration::zero();
+    return (e.bits & WSS_EV_PAD_AXIS) ? axis_interval : mouse_interval;
+}
+
+/* Each format is serialized at most once, and only if a client gets it */
+static void send_event(const wss::event &e)
+{
+    const std::string *text = nullptr, *binary = nullptr;
+    for (auto &socket : web_sockets) {
+        if (!socket.is_open() || !socket.filter.matches(e))
+            continue;
+        /* The newest position will follow once the client catches up */
+        if (slow_bytes && e.is_motion() && socket.pending() >= slow_bytes) {
+            socket.dropped++;
+            dropped_motion.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        auto *&data = socket.binary ? binary : text;
+        if (!data)
+            data = socket.binary ? &wss::serialize_binary(e) : &wss::serialize_text(e);
+        if (!data->empty())
+            socket.add(*data);
+    }
+}
+
+/* Sends held back motion that is due, or all of it for one source */
+static void flush_motion(const clock::time_point &now, const std::string *source)
+{
+    for (auto &[key, stream] : motion_streams) {
+        if (!stream.pending)
+            continue;
+        const auto due = source ? stream.latest.source == *source
+                                : now - stream.last_sent >= motion_interval(stream.latest);
+        if (!due)
+            continue;
+        send_event(stream.latest);
+        stream.pending = false;
+        stream.last_sent = now;
+    }
+}
+
+/* Ms until the first held back motion is due, WSS_IDLE_POLL if there's none.
+ * Without a wakeup pipe the old 5 ms poll is the only way to notice events */
+static int poll_timeout(const clock::time_point &now)
+{
+    auto timeout = clock::duration(std::chrono::milliseconds(wakeup_pipe.load() ? WSS_IDLE_POLL : 5));
+    if (subscribed_events.load(std::memory_order_relaxed) & WSS_EV_INPUT_STATS)
+        timeout = std::min(timeout, last_input_stats + input_stats_interval - now);
+    for (const auto &[key, stream] : motion_streams) {
+        if (stream.pending)
+            timeout = std::min(timeout, stream.last_sent + motion_interval(stream.latest) - now);
+    }
+    const auto ms = std::chrono::ceil<std::chrono::milliseconds>(timeout).count();
+    return int(std::max<int64_t>(ms, 0));
+}
+
+static void process_event(wss::event &e, const clock::time_point &now)
+{
+    const auto interval = motion_interval(e);
+    if (interval == clock::duration::zero()) {
+        /* Held back motion of the same source goes first so e.g. a click
+         * doesn't arrive before the position it happened at */
+        flush_motion(now, &e.source);
+        send_event(e);
+        return;
+    }
+
+    auto &stream = motion_streams[motion_key(e.source, e.device, e.bits, e.pad.vc)];
+    if (now - stream.last_sent >= interval) {
+        send_event(e);
+        stream.pending = false;
+        stream.last_sent = now;
+    } else {
+        stream.latest = std::move(e);
+        stream.pending = true;
+    }
+}
+
+static void send_input_stats(const clock::time_point &now)
+{
+    if (now - last_input_stats < input_stats_interval)
+        return;
+    last_input_stats = now;
+    const auto time = os_gettime_ns();
+    for (const auto &[channel, stats] : channel_stats) {
+        const auto &source = wss::source_name(channel);
+        bool serialized = false;
+        for (auto &socket : web_sockets) {
+            if (!socket.is_open() || !(socket.filter.events & WSS_EV_INPUT_STATS) ||
+                !subscription::contains(socket.filter.sources, source))
+                continue;
+            if (!serialized) {
+                wss::serialize_input_stats(source, stats, time, input_stats_scratch);
+                serialized = true;
+            }
+            socket.add_text(input_stats_scratch);
+        }
+    }
+}
+
+static web_socket *find_socket(struct mg_connection *c)
+{
+    for (auto &s : web_sockets) {
+        if (s.connection == c)
+            return &s;
+    }
+    return nullptr;
+}
+
+static void remove_socket(struct mg_connection *c)
+{
+    const auto it = std::find_if(web_sockets.begin(), web_sockets.end(),
+                                 [c](const web_socket &s) { return s.connection == c; });
+    if (it == web_sockets.end())
+        return; /* Plain http request */
+    web_sockets.erase(it);
+    services::release();
+    update_subscriptions();
+    client_count.store(web_sockets.size(), std::memory_order_relaxed);
+}
+
+static std::vector<std::string> read_list(const QJsonValue &value)
+{
+    std::vector<std::string> list;
+    for (const auto &item : value.toArray())
+        list.emplace_back(item.toString().toStdString());
+    return list;
+}
+
+/* {"subscribe": {"events": [...], "sources": [...], "devices": [...], "batch": true}},
+ * everything is optional. Events are event_type names or "keyboard", "mouse"
+ * and "gamepad". Returns false if the message isn't a subscription */
+static bool parse_subscription(const struct mg_str &data, subscription &out)
+{
+    const auto doc = QJsonDocument::fromJson(QByteArray(data.ptr, int(data.len)));
+    if (!doc.isObject() || !doc.object()["subscribe"].isObject())
+        return false;
+    const auto obj = doc.object()["subscribe"].toObject();
+
+    const auto batch = out.batch;
+    out = {};
+    if (obj.contains("events")) {
+        out.events = 0;
+        for (const auto &name : read_list(obj["events"])) {
+            const auto bits = wss::event_bits(name);
+            if (!bits)
+                bwarn("Websocket client subscribed to unknown event '%s'", name.c_str());
+            out.events |= bits;
+        }
+    }
+    out.sources = read_list(obj["sources"]);
+    out.devices = read_list(obj["devices"]);
+    out.batch = obj["batch"].toBool(batch);
+    return true;
+}
+
+static bool is_stats_request(const struct mg_str &data)
+{
+    const auto doc = QJsonDocument::fromJson(QByteArray(data.ptr, int(data.len)));
+    return doc.isObject() && doc.object().contains("stats");
+}
+
+/* Either /binary or the subprotocol in Sec-WebSocket-Protocol */
+static bool wants_binary(struct mg_http_message *hm, bool &protocol)
+{
+    protocol = false;
+    if (auto *header = mg_http_get_header(hm, "Sec-WebSocket-Protocol"))
+        protocol = mg_strstr(*header, mg_str(WSS_BINARY_PROTOCOL)) != nullptr;
+    return protocol || mg_http_match_uri(hm, WSS_BINARY_PATH);
+}
 std::thread thread_handle;
 std::atomic<bool> thread_flag;
+static std::string snapshot, stats; /* Only used by the mg thread */
 
 void event_handler(struct mg_connection *c, int ev, void *ev_data, void *)
 {
     if (ev == MG_EV_HTTP_MSG) {
         auto *hm = (struct mg_http_message *)ev_data;
-        if (mg_http_match_uri(hm, "/")) {
+        if (mg_http_match_uri(hm, WSS_STATE_PATH)) {
+            /* Held keys, buttons and pads, so late clients start with the right state */
+            char source[128] = "local";
+            mg_http_get_var(&hm->query, "source", source, sizeof(source));
+            if (wss::serialize_snapshot(source, snapshot))
+                mg_http_reply(c, 200, "Content-Type: application/json\r\nAccess-Control-Allow-Origin: *\r\n", "%s",
+                              snapshot.c_str());
+            else
+                mg_http_reply(c, 404, "Access-Control-Allow-Origin: *\r\n", "Unknown source\n");
+        } else if (mg_http_match_uri(hm, WSS_STATS_PATH)) {
+            pipeline_stats::serialize(stats);
+            mg_http_reply(c, 200, "Content-Type: application/json\r\nAccess-Control-Allow-Origin: *\r\n", "%s",
+                          stats.c_str());
+        } else if (mg_http_match_uri(hm, "/") || mg_http_match_uri(hm, WSS_BINARY_PATH)) {
             // Upgrade to websocket. From now on, a connection is a full-duplex
             // Websocket connection, which will receive MG_EV_WS_MSG events.
-            mg_ws_upgrade(c, hm, nullptr);
+            bool protocol;
+            const auto binary = wants_binary(hm, protocol);
+            /* Browsers close the connection if a requested protocol isn't confirmed */
+            if (protocol)
+                mg_ws_upgrade(c, hm, "Sec-WebSocket-Protocol: %s\r\n", WSS_BINARY_PROTOCOL);
+            else
+                mg_ws_upgrade(c, hm, nullptr);
 
-            if (web_sockets.empty()) // we don't want stale events
-                message_queue.clear();
-            web_sockets.emplace_back(c);
+            if (web_sockets.empty()) { // we don't want stale events
+                hub.skip();
+                motion_streams.clear();
+            }
+            web_socket socket{c, binary, {}, {}};
+            /* Also possible with ?batch=1, for clients that don't send subscriptions */
+            char batch[4];
+            socket.filter.batch = mg_http_get_var(&hm->query, "batch", batch, sizeof(batch)) > 0 && batch[0] == '1';
+            web_sockets.push_back(std::move(socket));
+            services::acquire(); /* Released in remove_socket */
+            update_subscriptions();
+            client_count.store(web_sockets.size(), std::memory_order_relaxed);
+
+            /* The state of ?source= (local by default) as the first message,
+             * always as JSON since it doesn't have a binary form */
+            char source[128] = "local";
+            mg_http_get_var(&hm->query, "source", source, sizeof(source));
+            if (wss::serialize_snapshot(source, snapshot))
+                mg_ws_send(c, snapshot.c_str(), snapshot.length(), WEBSOCKET_OP_TEXT);
         }
     } else if (ev == MG_EV_WS_MSG) {
-        // Just echo data
         auto *wm = (struct mg_ws_message *)ev_data;
-        mg_ws_send(c, wm->data.ptr, wm->data.len, WEBSOCKET_OP_TEXT);
+        auto *socket = find_socket(c);
+        subscription filter;
+        if (socket)
+            filter.batch = socket->filter.batch;
+        if (socket && parse_subscription(wm->data, filter)) {
+            socket->flush();
+            socket->filter = std::move(filter);
+            update_subscriptions();
+        } else if (is_stats_request(wm->data)) {
+            /* Always JSON, also for binary clients */
+            pipeline_stats::serialize(stats);
+            mg_ws_send(c, stats.c_str(), stats.length(), WEBSOCKET_OP_TEXT);
+        } else {
+            // Just echo data
+            mg_ws_send(c, wm->data.ptr, wm->data.len, WEBSOCKET_OP_TEXT);
+        }
+    } else if (ev == MG_EV_CLOSE) {
+        /* c is freed right after this */
+        remove_socket(c);
     }
 }
 
+static void wakeup()
+{
+    if (auto *pipe = wakeup_pipe.load())
+        mg_mgr_wakeup(pipe, nullptr, 0);
+}
+
+/* Runs on the producer threads */
+static void on_publish()
+{
+    if (subscribed_events.load(std::memory_order_relaxed) && !wakeup_pending.exchange(true))
+        wakeup();
+}
+
 void thread_method()
 {
     os_set_thread_name("inputovrly-mg");
+    IO_TRACE_THREAD("inputovrly-mg");
+    util_set_thread_priority(THREAD_NETWORK, "websocket");
+
+    wss::event e;
+    uint64_t reported_drops = hub.dropped();
+    hub.skip();
 
     while (thread_flag) {
-        mg_mgr_poll(&mgr, 5);
-        poll_mutex.lock();
-        while (!message_queue.empty()) {
-            auto &msg = message_queue.back();
-            for (auto socket : web_sockets) {
-                if (!socket->is_draining && !socket->is_closing)
-                    mg_ws_send(socket, msg.c_str(), msg.length(), WEBSOCKET_OP_TEXT);
+        {
+            IO_TRACE_ZONE("websocket poll");
+            mg_mgr_poll(&mgr, poll_timeout(clock::now()));
+        }
+        IO_TRACE_ZONE("websocket send");
+        /* Cleared before draining, so anything queued from here on wakes us again */
+        wakeup_pending.store(false, std::memory_order_seq_cst);
+        const auto now = clock::now();
+        const bool input_stats = subscribed_events.load(std::memory_order_relaxed) & WSS_EV_INPUT_STATS;
+        /* Oldest first, nothing is locked while sending */
+        for (size_t count; (count = hub.read(hub_events, WSS_HUB_BATCH)) > 0;) {
+            for (size_t i = 0; i < count; i++) {
+                const auto &in = hub_events[i];
+                if (input_stats && in.type == input_hub::KIND_UIOHOOK)
+                    channel_stats[in.channel].add(in.uiohook, in.time);
+                if (wss::from_hub(in, e))
+                    process_event(e, now);
+            }
+        }
+        flush_motion(now, nullptr);
+        if (input_stats)
+            send_input_stats(now);
+        else
+            channel_stats.clear();
+        size_t deepest = 0;
+        for (auto &socket : web_sockets) {
+            if (!socket.is_open())
+                continue;
+            socket.flush();
+            const auto depth = socket.pending();
+            if (max_bytes && depth >= max_bytes) {
+                bwarn("Disconnecting websocket client with %zu bytes waiting to be sent, dropped %llu motion "
+                      "events before",
+                      depth, (unsigned long long)socket.dropped);
+                /* Closed by mongoose in a later poll, MG_EV_CLOSE removes it */
+                socket.connection->is_draining = 1;
+                slow_disconnects.fetch_add(1, std::memory_order_relaxed);
+                continue;
             }
-            message_queue.pop_back();
+            deepest = std::max(deepest, depth);
+        }
+        deepest_queue.store(deepest, std::memory_order_relaxed);
+
+        const auto drops = hub.dropped();
+        if (drops != reported_drops) {
+            bwarn("Websocket server couldn't keep up, dropped %llu events in total", (unsigned long long)drops);
+            dropped_events.store(drops, std::memory_order_relaxed);
+            reported_drops = drops;
         }
-        poll_mutex.unlock();
-        const auto it = std::remove_if(web_sockets.begin(), web_sockets.end(),
-                                       [](const struct mg_connection *o) { return o->is_closing || o->is_draining; });
-        web_sockets.erase(it, web_sockets.end());
     }
 }
 
@@ -81,14 +491,23 @@ bool start(const std::string &addr)
                 bdebug("%s", str.c_str());
         },
         nullptr);
+    mouse_interval = rate_to_interval(io_config::wss_mouse_rate);
+    axis_interval = rate_to_interval(io_config::wss_axis_rate);
+    slow_bytes = io_config::wss_slow_bytes;
+    max_bytes = io_config::wss_max_bytes;
     mg_mgr_init(&mgr);
     auto *nc = mg_http_listen(&mgr, addr.c_str(), event_handler, nullptr);
     if (!nc) {
         berr("Failed to start mongoose listener");
         return false;
     }
+    /* mongoose drains the pipe on its own, nothing to handle */
+    wakeup_pipe = mg_mkpipe(&mgr, [](struct mg_connection *, int, void *, void *) {}, nullptr);
+    if (!wakeup_pipe)
+        bwarn("Failed to create mongoose wakeup pipe, websocket events will be delayed");
 
     thread_handle = std::thread(thread_method);
+    input_hub::add_listener(on_publish);
     return true;
 }
 
@@ -98,19 +517,29 @@ void stop()
         return;
     binfo("Stopping web socket server running on %ld", CGET_INT(S_WSS_PORT));
     thread_flag = false;
+    input_hub::remove_listener(on_publish);
+    wakeup();
     if (thread_handle.joinable())
         thread_handle.join();
+    wakeup_pipe = nullptr;
+    /* Closes every connection, so MG_EV_CLOSE releases each socket that is still registered */
     mg_mgr_free(&mgr);
+    web_sockets.clear();
+}
+
+bool wants(uint32_t bits)
+{
+    return thread_flag && (subscribed_events & bits);
 }
 
-void queue_message(const std::string &msg)
+uint64_t dropped_messages()
 {
-    if (!msg.empty())
-        message_queue.emplace_back(msg);
+    return dropped_events.load(std::memory_order_relaxed);
 }
 
-bool can_queue_message()
+send_stats get_send_stats()
 {
-    return thread_flag && !web_sockets.empty();
+    return {client_count.load(std::memory_order_relaxed), deepest_queue.load(std::memory_order_relaxed),
+            dropped_motion.load(std::memory_order_relaxed), slow_disconnects.load(std::memory_order_relaxed)};
 }
 }
@@ -1,13 +1,59 @@
 #pragma once
-#include <mutex>
+#include <cstdint>
 #include <string>
+#include "wss_events.hpp"
+
+/* Ms the mg thread sleeps if nothing is published or held back, publishing
+ * an event wakes it up right away */
+#define WSS_IDLE_POLL 500
+
+/* Hub events the mg thread reads at once */
+#define WSS_HUB_BATCH 256
+
+/* Websocket clients get binary records (see websocket_server.hpp) instead of
+ * JSON if they connect to this path or ask for this subprotocol */
+#define WSS_BINARY_PATH "/binary"
+#define WSS_BINARY_PROTOCOL "input-overlay-binary"
+
+/* GET /state?source=name returns the held keys, buttons and gamepads of a
+ * source as JSON, websocket clients get the same as their first message */
+#define WSS_STATE_PATH "/state"
+
+/* GET /stats returns the pipeline stats (see pipeline_stats.hpp), websocket
+ * clients get them as a reply to {"stats": true} */
+#define WSS_STATS_PATH "/stats"
+
+/* Clients subscribed to "input_stats" get the key press statistics of every
+ * source they're subscribed to this often (ms), as JSON also on binary
+ * connections. They're collected from the first such subscription on and
+ * dropped once nobody is subscribed anymore */
+#define WSS_INPUT_STATS_INTERVAL 1000
+
+/* Batching clients get everything queued during one poll as a single frame,
+ * a JSON array or concatenated binary records. A batch is sent early once
+ * it gets this large */
+#define WSS_BATCH_LIMIT (64 * 1024)
 
 // Separate mongoose interface as it seems to clash with libgamepad headers
 // probably some directinput stuff
 namespace mg {
-extern std::mutex poll_mutex;
 bool start(const std::string &addr);
 void stop();
-void queue_message(const std::string &msg);
-bool can_queue_message();
+
+/* Whether any client is subscribed to one of the event bits, lock free */
+bool wants(uint32_t bits);
+
+/* Hub events that were overwritten before the mg thread read them */
+uint64_t dropped_messages();
+
+/* Slow clients first lose motion once they have wss_slow_bytes waiting to be
+ * sent, and are disconnected at wss_max_bytes */
+struct send_stats {
+    size_t clients;
+    size_t deepest_queue;    /* Bytes waiting for the slowest client */
+    uint64_t dropped_motion; /* In total, over all clients */
+    uint64_t slow_disconnects;
+};
+
+send_stats get_send_stats();
 }
\ No newline at end of file
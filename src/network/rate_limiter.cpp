@@ -0,0 +1,85 @@
+/*************************************************************************
+ * This file is part of input-overlay
+ * github.con/univrsal/input-overlay
+ * Copyright 2022 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#include "rate_limiter.hpp"
+#include "../util/config.hpp"
+#include <algorithm>
+
+namespace network {
+void token_bucket::set_rate(double rate, double burst)
+{
+    m_rate = rate;
+    m_burst = burst;
+    m_tokens = burst;
+    m_last = 0;
+}
+
+bool token_bucket::take(double amount, uint64_t now)
+{
+    if (m_rate <= 0)
+        return true;
+
+    if (m_last)
+        m_tokens = std::min(m_burst, m_tokens + (now - m_last) / 1e9 * m_rate);
+    m_last = now;
+
+    if (m_tokens < amount)
+        return false;
+    m_tokens -= amount;
+    return true;
+}
+
+rate_limiter::rate_limiter()
+{
+    /* Allows bursts of up to one second */
+    m_messages.set_rate(io_config::client_message_rate, io_config::client_message_rate);
+    m_bytes.set_rate(io_config::client_byte_rate, io_config::client_byte_rate);
+}
+
+bool rate_limiter::accept_bytes(size_t size, uint64_t now)
+{
+    return m_bytes.take(double(size), now);
+}
+
+bool rate_limiter::accept_message(uint64_t now)
+{
+    return m_messages.take(1, now);
+}
+
+bool rate_limiter::drop(size_t size, uint64_t now)
+{
+    const auto started = !throttled(now);
+    if (started)
+        m_throttled_since = now;
+    m_last_drop = now;
+    m_dropped_frames.fetch_add(1, std::memory_order_relaxed);
+    m_dropped_bytes.fetch_add(size, std::memory_order_relaxed);
+    return started;
+}
+
+bool rate_limiter::throttled(uint64_t now) const
+{
+    /* A second without drops ends the throttling */
+    return m_throttled_since && now - m_last_drop < 1000000000;
+}
+
+bool rate_limiter::exceeded(uint64_t now) const
+{
+    return throttled(now) && (now - m_throttled_since) / 1000000 >= THROTTLE_DISCONNECT_TIME;
+}
+}
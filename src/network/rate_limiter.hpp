@@ -0,0 +1,69 @@
+/*************************************************************************
+ * This file is part of input-overlay
+ * github.con/univrsal/input-overlay
+ * Copyright 2022 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+/* Clients that drop input for this long without a break are disconnected */
+#define THROTTLE_DISCONNECT_TIME 5000 /* ms */
+
+namespace network {
+/* Refills rate tokens per second up to burst, a rate of zero never runs out */
+class token_bucket {
+    double m_tokens = 0, m_rate = 0, m_burst = 0;
+    uint64_t m_last = 0;
+
+public:
+    void set_rate(double rate, double burst);
+    bool take(double amount, uint64_t now);
+};
+
+/* Limits messages and bytes per second of one client, see
+ * io_config::client_message_rate and io_config::client_byte_rate. Input over
+ * the limit is still decoded, since compact events build on the ones before,
+ * but thrown away, so a flooding client only costs the time it takes to
+ * parse its frames */
+class rate_limiter {
+    token_bucket m_messages, m_bytes;
+    std::atomic<uint64_t> m_dropped_frames{0}, m_dropped_bytes{0};
+    uint64_t m_throttled_since = 0, m_last_drop = 0;
+
+public:
+    rate_limiter();
+
+    /* Called for every frame or udp packet before it is parsed */
+    bool accept_bytes(size_t size, uint64_t now);
+
+    /* Called for every message, the input of the rest of the frame is dropped if it fails */
+    bool accept_message(uint64_t now);
+
+    /* Counts a frame that wasn't accepted, returns true if the client
+     * wasn't throttled before */
+    bool drop(size_t size, uint64_t now);
+
+    /* True once the client has been over the limit for THROTTLE_DISCONNECT_TIME */
+    bool exceeded(uint64_t now) const;
+    bool throttled(uint64_t now) const;
+
+    uint64_t dropped_frames() const { return m_dropped_frames; }
+    uint64_t dropped_bytes() const { return m_dropped_bytes; }
+};
+}
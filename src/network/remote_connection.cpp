@@ -24,6 +24,7 @@
 #include <thread>
 
 #include "../util/log.h"
+#include "../util/thread_priority.hpp"
 
 #if __linux__
 #include <ifaddrs.h>
@@ -98,13 +99,20 @@ void close_network()
     if (network_flag) {
         network_flag = false;
         network_thread.join();
-        delete server_instance;
+        {
+            /* Sources look the server up under this lock */
+            std::lock_guard<traced_mutex> lock(mutex);
+            delete server_instance;
+            server_instance = nullptr;
+        }
         netlib_quit();
     }
 }
 
 void network_handler()
 {
+    util_set_thread_priority(THREAD_NETWORK, "remote connection");
+    IO_TRACE_THREAD("inputovrly-network");
     tcp_socket sock;
 
     while (network_flag) {
@@ -113,16 +121,14 @@ void network_handler()
         server_instance->listen(numready);
 
         if (numready == -1) {
-            berr("netlib_check_sockets failed: %s", netlib_get_error());
+            berr("Waiting for client sockets failed");
             break;
         }
 
-        if (!numready) {
-            os_sleepto_ns(100000); /* Should be fast enough */
+        if (!numready)
             continue;
-        }
 
-        if (netlib_socket_ready(server_instance->socket())) {
+        if (server_instance->server_ready()) {
             numready--;
             binfo("Received connection...");
 
@@ -196,10 +202,10 @@ char *read_text(tcp_socket sock, char **buf)
 
 message read_msg_from_buffer(buffer &buf)
 {
-    auto id = buf.read<uint8_t>();
+    uint8_t id;
 
-    if (id && *id <= MSG_LAST)
-        return message(*id);
+    if (buf.read(id) && id <= MSG_LAST)
+        return message(id);
     return MSG_INVALID;
 }
 }
@@ -0,0 +1,163 @@
+/*************************************************************************
+ * This file is part of input-overlay
+ * github.con/univrsal/input-overlay
+ * Copyright 2022 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#include "socket_poller.hpp"
+#include "../util/log.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <socket_options.hpp>
+
+#ifndef _WIN32
+#include <unistd.h>
+#if __APPLE__
+#include <sys/event.h>
+#else
+#include <sys/epoll.h>
+#endif
+#endif
+
+#define MAX_EVENTS 64
+
+namespace network {
+#ifdef _WIN32
+socket_poller::~socket_poller() = default;
+
+bool socket_poller::init()
+{
+    return true;
+}
+
+bool socket_poller::add(poll_socket socket)
+{
+    WSAPOLLFD fd{};
+    fd.fd = native_handle(socket);
+    fd.events = POLLRDNORM;
+    m_fds.emplace_back(fd);
+    m_sockets.emplace_back(socket);
+    return true;
+}
+
+void socket_poller::remove(poll_socket socket)
+{
+    const auto it = std::find(m_sockets.begin(), m_sockets.end(), socket);
+    if (it == m_sockets.end())
+        return;
+    m_fds.erase(m_fds.begin() + (it - m_sockets.begin()));
+    m_sockets.erase(it);
+}
+
+int socket_poller::wait(int timeout_ms, std::vector<poll_socket> &ready)
+{
+    ready.clear();
+    if (m_fds.empty())
+        return 0;
+
+    const auto result = WSAPoll(m_fds.data(), ULONG(m_fds.size()), timeout_ms);
+    if (result == SOCKET_ERROR) {
+        berr("WSAPoll failed with error %i", WSAGetLastError());
+        return -1;
+    }
+
+    for (size_t i = 0; i < m_fds.size() && int(ready.size()) < result; i++) {
+        if (m_fds[i].revents)
+            ready.emplace_back(m_sockets[i]);
+    }
+    return int(ready.size());
+}
+#else
+socket_poller::~socket_poller()
+{
+    if (m_fd >= 0)
+        close(m_fd);
+}
+
+bool socket_poller::init()
+{
+#if __APPLE__
+    m_fd = kqueue();
+#else
+    m_fd = epoll_create1(EPOLL_CLOEXEC);
+#endif
+    if (m_fd < 0) {
+        berr("Failed to create socket poller: %s", strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+bool socket_poller::add(poll_socket socket)
+{
+#if __APPLE__
+    struct kevent change {};
+    EV_SET(&change, native_handle(socket), EVFILT_READ, EV_ADD, 0, 0, socket);
+    const auto result = kevent(m_fd, &change, 1, nullptr, 0, nullptr);
+#else
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.ptr = socket;
+    const auto result = epoll_ctl(m_fd, EPOLL_CTL_ADD, native_handle(socket), &event);
+#endif
+    if (result < 0) {
+        berr("Failed to add socket to poller: %s", strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+void socket_poller::remove(poll_socket socket)
+{
+#if __APPLE__
+    struct kevent change {};
+    EV_SET(&change, native_handle(socket), EVFILT_READ, EV_DELETE, 0, 0, nullptr);
+    kevent(m_fd, &change, 1, nullptr, 0, nullptr);
+#else
+    epoll_ctl(m_fd, EPOLL_CTL_DEL, native_handle(socket), nullptr);
+#endif
+}
+
+int socket_poller::wait(int timeout_ms, std::vector<poll_socket> &ready)
+{
+    ready.clear();
+#if __APPLE__
+    struct kevent events[MAX_EVENTS];
+    timespec timeout{timeout_ms / 1000, (timeout_ms % 1000) * 1000000L};
+    const auto count = kevent(m_fd, nullptr, 0, events, MAX_EVENTS, &timeout);
+#else
+    epoll_event events[MAX_EVENTS];
+    const auto count = epoll_wait(m_fd, events, MAX_EVENTS, timeout_ms);
+#endif
+    if (count < 0) {
+        if (errno == EINTR)
+            return 0;
+        berr("Waiting for sockets failed: %s", strerror(errno));
+        return -1;
+    }
+
+    for (int i = 0; i < count; i++) {
+#if __APPLE__
+        ready.emplace_back(static_cast<poll_socket>(events[i].udata));
+#else
+        ready.emplace_back(static_cast<poll_socket>(events[i].data.ptr));
+#endif
+    }
+    return count;
+}
+#endif
+}
@@ -0,0 +1,56 @@
+/*************************************************************************
+ * This file is part of input-overlay
+ * github.con/univrsal/input-overlay
+ * Copyright 2022 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#pragma once
+
+#include <netlib.h>
+#include <vector>
+#ifdef _WIN32
+#include <winsock2.h>
+#endif
+
+namespace network {
+/* Either a tcp_socket or an udp_socket, netlib uses the same layout for both */
+typedef void *poll_socket;
+
+/* Waits for incoming data on netlib sockets with the native readiness API
+ * of each platform (epoll on Linux, kqueue on macOS, WSAPoll on Windows).
+ * Unlike netlib socket sets sockets can be added and removed one by one and
+ * wait() returns as soon as any of them becomes readable */
+class socket_poller {
+public:
+    socket_poller() = default;
+    ~socket_poller();
+
+    bool init();
+    bool add(poll_socket socket);
+    void remove(poll_socket socket);
+
+    /* Blocks for at most timeout_ms, ready is filled with all readable
+     * sockets. Returns the number of ready sockets or -1 on error */
+    int wait(int timeout_ms, std::vector<poll_socket> &ready);
+
+private:
+#ifdef _WIN32
+    std::vector<poll_socket> m_sockets; /* Same order as m_fds */
+    std::vector<WSAPOLLFD> m_fds;
+#else
+    int m_fd = -1; /* epoll or kqueue descriptor */
+#endif
+};
+}
@@ -1,10 +1,19 @@
 #include "websocket_server.hpp"
 #include "../util/config.hpp"
 #include "../util/settings.h"
-#include "../util/obs_util.hpp"
+#include "../util/json_writer.hpp"
+#include "../util/binary_writer.hpp"
+#include "../util/input_data.hpp"
+#include "../util/input_hub.hpp"
+#include "../util/key_stats.hpp"
+#include "../hook/gamepad_hook_helper.hpp"
+#include "io_server.hpp"
+#include "remote_connection.hpp"
+#include <cstring>
+#include <map>
+#include <vector>
+#include <util/platform.h>
 #include "mg.hpp"
-#include <QJsonObject>
-#include <QJsonDocument>
 
 namespace wss {
 bool start()
@@ -20,126 +29,378 @@ void stop()
     mg::stop();
 }
 
-QString serialize_uiohook(const uiohook_event *e, const std::string &source_name)
-{
-    QJsonObject obj;
-    auto ev_to_str = [](int e) {
-        switch (e) {
-        case EVENT_KEY_TYPED:
-            return "key_typed";
-        case EVENT_KEY_PRESSED:
-            return "key_pressed";
-        case EVENT_KEY_RELEASED:
-            return "key_released";
-        case EVENT_MOUSE_CLICKED:
-            return "mouse_clicked";
-        case EVENT_MOUSE_PRESSED:
-            return "mouse_pressed";
-        case EVENT_MOUSE_RELEASED:
-            return "mouse_released";
-        case EVENT_MOUSE_MOVED:
-            return "mouse_moved";
-        case EVENT_MOUSE_DRAGGED:
-            return "mouse_dragged";
-        case EVENT_MOUSE_WHEEL:
-            return "mouse_wheel";
-        default:
-            return "";
-        }
-    };
+/* Only used by the mg thread, so formatting doesn't allocate once they have
+ * grown large enough */
+static std::string scratch, binary_scratch;
+
+static const char *ev_to_str(int e)
+{
+    switch (e) {
+    case EVENT_KEY_TYPED:
+        return "key_typed";
+    case EVENT_KEY_PRESSED:
+        return "key_pressed";
+    case EVENT_KEY_RELEASED:
+        return "key_released";
+    case EVENT_MOUSE_CLICKED:
+        return "mouse_clicked";
+    case EVENT_MOUSE_PRESSED:
+        return "mouse_pressed";
+    case EVENT_MOUSE_RELEASED:
+        return "mouse_released";
+    case EVENT_MOUSE_MOVED:
+        return "mouse_moved";
+    case EVENT_MOUSE_DRAGGED:
+        return "mouse_dragged";
+    case EVENT_MOUSE_WHEEL:
+        return "mouse_wheel";
+    default:
+        return "";
+    }
+}
+
+static uint8_t ev_to_bin(int e)
+{
+    switch (e) {
+    case EVENT_KEY_TYPED:
+        return BIN_KEY_TYPED;
+    case EVENT_KEY_PRESSED:
+        return BIN_KEY_PRESSED;
+    case EVENT_KEY_RELEASED:
+        return BIN_KEY_RELEASED;
+    case EVENT_MOUSE_CLICKED:
+        return BIN_MOUSE_CLICKED;
+    case EVENT_MOUSE_PRESSED:
+        return BIN_MOUSE_PRESSED;
+    case EVENT_MOUSE_RELEASED:
+        return BIN_MOUSE_RELEASED;
+    case EVENT_MOUSE_MOVED:
+        return BIN_MOUSE_MOVED;
+    case EVENT_MOUSE_DRAGGED:
+        return BIN_MOUSE_DRAGGED;
+    case EVENT_MOUSE_WHEEL:
+        return BIN_MOUSE_WHEEL;
+    default:
+        return 0;
+    }
+}
+
+uint32_t event_bits(std::string_view name)
+{
+    if (name == "keyboard")
+        return (1u << BIN_KEY_TYPED) | (1u << BIN_KEY_PRESSED) | (1u << BIN_KEY_RELEASED);
+    if (name == "mouse")
+        return ((1u << (BIN_MOUSE_WHEEL + 1)) - 1) & ~((1u << BIN_MOUSE_CLICKED) - 1);
+    if (name == "gamepad")
+        return WSS_EV_PAD_AXIS | WSS_EV_PAD_BUTTON | WSS_EV_PAD_CONNECTED | WSS_EV_PAD_DISCONNECTED |
+               WSS_EV_PAD_RECONNECTED;
+    if (name == "gamepad_axis")
+        return WSS_EV_PAD_AXIS;
+    if (name == "gamepad_button")
+        return WSS_EV_PAD_BUTTON;
+    if (name == WSS_PAD_CONNECTED)
+        return WSS_EV_PAD_CONNECTED;
+    if (name == WSS_PAD_DISCONNECTED)
+        return WSS_EV_PAD_DISCONNECTED;
+    if (name == WSS_PAD_RECONNECTED)
+        return WSS_EV_PAD_RECONNECTED;
+    if (name == "input_stats")
+        return WSS_EV_INPUT_STATS;
+    for (int e = EVENT_KEY_TYPED; e <= EVENT_MOUSE_WHEEL; e++) {
+        if (name == ev_to_str(e))
+            return 1u << ev_to_bin(e);
+    }
+    return 0;
+}
+
+static const char *bit_to_state(uint32_t bits)
+{
+    if (bits & WSS_EV_PAD_CONNECTED)
+        return WSS_PAD_CONNECTED;
+    if (bits & WSS_EV_PAD_DISCONNECTED)
+        return WSS_PAD_DISCONNECTED;
+    return WSS_PAD_RECONNECTED;
+}
+
+static uint8_t bit_to_bin(uint32_t bits)
+{
+    if (bits & WSS_EV_PAD_CONNECTED)
+        return BIN_PAD_CONNECTED;
+    if (bits & WSS_EV_PAD_DISCONNECTED)
+        return BIN_PAD_DISCONNECTED;
+    return BIN_PAD_RECONNECTED;
+}
 
+static const std::string &binary_uiohook(const uiohook_event *e, const std::string &source_name)
+{
+    const auto type = ev_to_bin(e->type);
+    binary_writer bin(binary_scratch, WSS_BIN_UIOHOOK);
+    if (!type) {
+        binary_scratch.clear();
+        return binary_scratch;
+    }
+    bin.str(source_name).u8(type).u16(e->mask).u32(uint32_t(e->time));
     switch (e->type) {
     case EVENT_KEY_TYPED:
-        obj["char"] = QString(e->data.keyboard.keychar);
-        /* fallthrough */
     case EVENT_KEY_PRESSED:
     case EVENT_KEY_RELEASED:
-        obj["event_source"] = utf8_to_qt(source_name.c_str());
-        obj["event_type"] = QString(ev_to_str(e->type));
-        obj["time"] = int(e->time);
-        obj["mask"] = e->mask;
-        obj["keycode"] = e->data.keyboard.keycode;
-        obj["rawcode"] = e->data.keyboard.rawcode;
+        bin.u16(e->data.keyboard.keycode).u16(e->data.keyboard.rawcode).u16(e->data.keyboard.keychar);
+        break;
+    case EVENT_MOUSE_WHEEL:
+        bin.u16(e->data.wheel.clicks)
+            .u8(uint8_t(e->data.wheel.type))
+            .u16(e->data.wheel.amount)
+            .i16(int16_t(e->data.wheel.rotation))
+            .u8(uint8_t(e->data.wheel.direction))
+            .i16(e->data.wheel.x)
+            .i16(e->data.wheel.y);
+        break;
+    default:
+        bin.u16(e->data.mouse.button).u16(e->data.mouse.clicks).i16(e->data.mouse.x).i16(e->data.mouse.y);
+    }
+    return bin.end();
+}
+
+static const std::string &serialize_uiohook(const uiohook_event *e, const std::string &source_name)
+{
+    json_writer json(scratch);
+    switch (e->type) {
+    case EVENT_KEY_TYPED:
+    case EVENT_KEY_PRESSED:
+    case EVENT_KEY_RELEASED:
+        json.field("event_source", source_name)
+            .field("event_type", ev_to_str(e->type))
+            .field("time", int64_t(e->time))
+            .field("mask", e->mask)
+            .field("keycode", e->data.keyboard.keycode)
+            .field("rawcode", e->data.keyboard.rawcode);
+        if (e->type == EVENT_KEY_TYPED)
+            json.char_field("char", e->data.keyboard.keychar);
         break;
     case EVENT_MOUSE_CLICKED:
     case EVENT_MOUSE_PRESSED:
     case EVENT_MOUSE_RELEASED:
     case EVENT_MOUSE_MOVED:
     case EVENT_MOUSE_DRAGGED:
-        obj["event_source"] = utf8_to_qt(source_name.c_str());
-        obj["event_type"] = QString(ev_to_str(e->type));
-        obj["time"] = int(e->time);
-        obj["mask"] = e->mask;
-        obj["button"] = e->data.mouse.button;
-        obj["clicks"] = e->data.mouse.clicks;
-        obj["x"] = e->data.mouse.x;
-        obj["y"] = e->data.mouse.y;
+        json.field("event_source", source_name)
+            .field("event_type", ev_to_str(e->type))
+            .field("time", int64_t(e->time))
+            .field("mask", e->mask)
+            .field("button", int(e->data.mouse.button))
+            .field("clicks", int(e->data.mouse.clicks))
+            .field("x", int(e->data.mouse.x))
+            .field("y", int(e->data.mouse.y));
         break;
     case EVENT_MOUSE_WHEEL:
-        obj["event_source"] = utf8_to_qt(source_name.c_str());
-        obj["event_type"] = QString(ev_to_str(e->type));
-        obj["time"] = int(e->time);
-        obj["mask"] = e->mask;
-        obj["clicks"] = e->data.wheel.clicks;
-        obj["type"] = e->data.wheel.type;
-        obj["amount"] = e->data.wheel.amount;
-        obj["rotation"] = e->data.wheel.rotation;
-        obj["direction"] = e->data.wheel.direction;
-        obj["x"] = e->data.wheel.x;
-        obj["y"] = e->data.wheel.y;
+        json.field("event_source", source_name)
+            .field("event_type", ev_to_str(e->type))
+            .field("time", int64_t(e->time))
+            .field("mask", e->mask)
+            .field("clicks", int(e->data.wheel.clicks))
+            .field("type", int(e->data.wheel.type))
+            .field("amount", int(e->data.wheel.amount))
+            .field("rotation", int(e->data.wheel.rotation))
+            .field("direction", int(e->data.wheel.direction))
+            .field("x", int(e->data.wheel.x))
+            .field("y", int(e->data.wheel.y));
         break;
     default:;
     }
-    QJsonDocument doc(obj);
-    return QString(doc.toJson(QJsonDocument::Compact));
+    return json.end();
 }
 
-void dispatch_uiohook_event(const uiohook_event *e, const std::string &source_name)
+const std::string &serialize_text(const event &e)
 {
-    std::lock_guard<std::mutex> lock(mg::poll_mutex);
-    if (mg::can_queue_message())
-        mg::queue_message(qt_to_utf8(serialize_uiohook(e, source_name)));
+    if (e.is_uiohook())
+        return serialize_uiohook(&e.uiohook, e.source);
+
+    json_writer json(scratch);
+    if (e.is_pad_input()) {
+        json.field("event_source", e.source)
+            .field("event_type", (e.bits & WSS_EV_PAD_AXIS) ? "gamepad_axis" : "gamepad_button")
+            .field("device_name", e.device)
+            .field("device_index", int(e.device_index))
+            .field("time", int64_t(e.pad.time))
+            .field("virtual_code", int(e.pad.vc))
+            .field("virtual_value", double(e.pad.virtual_value))
+            .field("native_code", int(e.pad.native_id))
+            .field("native_value", int(e.pad.value));
+    } else {
+        json.field("event_source", e.source)
+            .field("event_type", bit_to_state(e.bits))
+            .field("device_name", e.device)
+            .field("time", int64_t(e.pad.time));
+    }
+    return json.end();
 }
 
-void dispatch_gamepad_event(const gamepad::input_event *e, const std::shared_ptr<gamepad::device> &device, bool is_axis,
-                            const std::string &source_name)
+const std::string &serialize_binary(const event &e)
 {
-    std::lock_guard<std::mutex> lock(mg::poll_mutex);
-    if (!mg::can_queue_message())
-        return;
-    QJsonObject obj;
-    obj["event_source"] = source_name.c_str();
-    obj["event_type"] = is_axis ? "gamepad_axis" : "gamepad_button";
-    obj["device_name"] = utf8_to_qt(device->get_id().c_str());
-    obj["device_index"] = device->get_index();
-    obj["time"] = int(e->time);
-    obj["virtual_code"] = e->vc;
-    obj["virtual_value"] = e->virtual_value;
-    obj["native_code"] = e->native_id;
-    obj["native_value"] = e->value;
+    if (e.is_uiohook())
+        return binary_uiohook(&e.uiohook, e.source);
 
-    QJsonDocument doc(obj);
-    QString str(doc.toJson(QJsonDocument::Compact));
+    if (e.is_pad_input()) {
+        binary_writer bin(binary_scratch, WSS_BIN_PAD_INPUT);
+        bin.str(e.source)
+            .u8((e.bits & WSS_EV_PAD_AXIS) ? 1 : 0)
+            .u8(e.device_index)
+            .u32(uint32_t(e.pad.time))
+            .u16(e.pad.vc)
+            .f32(e.pad.virtual_value)
+            .u16(e.pad.native_id)
+            .i32(e.pad.value)
+            .str(e.device);
+        return bin.end();
+    }
+    binary_writer bin(binary_scratch, WSS_BIN_PAD_STATE);
+    bin.str(e.source).u8(bit_to_bin(e.bits)).u32(uint32_t(e.pad.time)).str(e.device);
+    return bin.end();
+}
 
-    mg::queue_message(qt_to_utf8(str));
+static void write_pad(json_writer &json, const std::shared_ptr<gamepad::device> &pad)
+{
+    char code[8];
+    json.begin_object().field("device_name", pad->get_id()).field("device_index", int(pad->get_index()));
+    json.begin_array("buttons");
+    for (const auto &button : pad->get_buttons()) {
+        if (button.second)
+            json.field(nullptr, int(button.first));
+    }
+    json.end_array().begin_object("axes");
+    for (const auto &axis : pad->get_axis()) {
+        snprintf(code, sizeof(code), "%u", unsigned(axis.first));
+        json.field(code, double(axis.second));
+    }
+    json.end_object().end_object();
 }
 
-void dispatch_gamepad_event(const std::shared_ptr<gamepad::device> &device, const char *state,
-                            const std::string &source_name)
+bool serialize_snapshot(const std::string &source, std::string &out)
 {
-    std::lock_guard<std::mutex> lock(mg::poll_mutex);
-    if (!mg::can_queue_message())
-        return;
-    QJsonObject obj;
-    obj["event_source"] = source_name.c_str();
-    obj["event_type"] = state;
-    obj["device_name"] = utf8_to_qt(device->get_id().c_str());
-    obj["time"] = int(gamepad::hook::ms_ticks());
+    const auto local = source.empty() || source == "local";
+    std::shared_ptr<network::io_client> client;
+    input_state state;
 
-    QJsonDocument doc(obj);
-    QString str(doc.toJson(QJsonDocument::Compact));
+    if (local) {
+        local_data::data.read(state);
+    } else {
+        if (!io_config::enable_remote_connections || !network::server_instance)
+            return false;
+        std::lock_guard<traced_mutex> lock(network::mutex);
+        client = network::server_instance->get_client(source);
+        if (!client)
+            return false;
+        client->get_data()->read(state);
+    }
 
-    mg::queue_message(qt_to_utf8(str));
+    json_writer json(out);
+    json.field("event_source", local ? std::string("local") : source)
+        .field("event_type", "snapshot")
+        .field("time", int64_t(os_gettime_ns() / 1000000));
+    json.begin_array("keys");
+    state.keyboard.for_each([&](size_t code) { json.field(nullptr, int64_t(code)); });
+    json.end_array().begin_array("mouse_buttons");
+    state.mouse.for_each([&](size_t code) { json.field(nullptr, int64_t(code)); });
+    json.end_array()
+        .field("mouse_x", int(state.last_mouse_movement.x))
+        .field("mouse_y", int(state.last_mouse_movement.y));
+
+    json.begin_array("gamepads");
+    if (local && libgamepad::hook_instance) {
+        std::lock_guard<std::mutex> lock(*libgamepad::hook_instance->get_mutex());
+        for (const auto &pad : libgamepad::hook_instance->get_devices()) {
+            if (pad->is_valid())
+                write_pad(json, pad);
+        }
+    } else if (client) {
+        std::lock_guard<traced_mutex> lock(client->mutex());
+        for (const auto &pad : client->gamepads())
+            write_pad(json, pad.second);
+    }
+    json.end_array().end();
+    return true;
+}
+
+/* Only used by the mg thread. Ids never change their name, devices only
+ * with a connect event */
+static std::vector<std::string> channel_names;
+static std::map<std::pair<uint16_t, uint8_t>, std::string> device_names;
+
+const std::string &source_name(uint16_t channel)
+{
+    while (channel_names.size() <= channel)
+        channel_names.emplace_back(input_hub::channel_name(uint16_t(channel_names.size())));
+    return channel_names[channel];
 }
 
-}
\ No newline at end of file
+void serialize_input_stats(const std::string &source, const key_stats &stats, uint64_t now, std::string &out)
+{
+    json_writer json(out);
+    json.field("event_source", source)
+        .field("event_type", "input_stats")
+        .field("time", int64_t(now / 1000000))
+        .field("apm", int64_t(stats.apm(now)))
+        .field("presses", int64_t(stats.presses()));
+    /* Upper bounds of the hold histogram buckets in ms, 0 for the last, open ended one */
+    json.begin_array("hold_buckets");
+    for (int i = 0; i < STATS_HOLD_BUCKETS; i++)
+        json.field(nullptr, int64_t(key_stats::hold_bucket_limit(i)));
+    json.end_array().begin_array("keys");
+    for (const auto &[code, k] : stats.keys()) {
+        json.begin_object()
+            .field("keycode", code)
+            .field("presses", int64_t(k.presses))
+            .field("held", k.held_since != 0)
+            .field("average_hold", int64_t(k.average_hold()));
+        json.begin_array("holds");
+        for (const auto count : k.hold_histogram)
+            json.field(nullptr, int64_t(count));
+        json.end_array().end_object();
+    }
+    json.end_array().end();
+}
+
+static uint32_t hub_bits(const input_hub::event &e)
+{
+    switch (e.type) {
+    case input_hub::KIND_UIOHOOK: {
+        const auto type = ev_to_bin(e.uiohook.type);
+        return type ? 1u << type : 0;
+    }
+    case input_hub::KIND_PAD_AXIS:
+        return WSS_EV_PAD_AXIS;
+    case input_hub::KIND_PAD_BUTTON:
+        return WSS_EV_PAD_BUTTON;
+    case input_hub::KIND_PAD_CONNECTED:
+        return WSS_EV_PAD_CONNECTED;
+    case input_hub::KIND_PAD_RECONNECTED:
+        return WSS_EV_PAD_RECONNECTED;
+    case input_hub::KIND_PAD_DISCONNECTED:
+        return WSS_EV_PAD_DISCONNECTED;
+    default:
+        return 0;
+    }
+}
+
+bool from_hub(const input_hub::event &in, event &out)
+{
+    const auto bits = hub_bits(in);
+    if (!bits || !mg::wants(bits))
+        return false;
+    out.bits = bits;
+    out.source = source_name(in.channel);
+    out.device_index = in.device_index;
+    if (in.type == input_hub::KIND_UIOHOOK) {
+        out.device.clear();
+        out.uiohook = in.uiohook;
+        out.pad = {}; /* Part of the motion key */
+        return true;
+    }
+
+    auto &device = device_names[{in.channel, in.device_index}];
+    if (in.is_pad_state() || device.empty())
+        device = input_hub::device_name(in.channel, in.device_index);
+    out.device = device;
+    out.pad = {in.pad.time, in.pad.vc, in.pad.native_id, in.pad.virtual_value, in.pad.value};
+    return true;
+}
+}
@@ -2,18 +2,30 @@
 #include <uiohook.h>
 #include <string>
 #include <libgamepad.hpp>
+#include "wss_events.hpp"
 
-#define WSS_PAD_CONNECTED "gamepad_connected"
-#define WSS_PAD_DISCONNECTED "gamepad_disconnected"
-#define WSS_PAD_RECONNECTED "gamepad_reconnected"
+/* Binary format, sent instead of JSON to clients that connect to
+ * WSS_BINARY_PATH or request WSS_BINARY_PROTOCOL. Each websocket message is
+ * one little-endian record:
+ *   u16 record length (including itself), u8 kind, u8 source length, source
+ * followed by a payload depending on the kind:
+ *   WSS_BIN_UIOHOOK: u8 event (wss::bin_event), u16 mask, u32 time, then
+ *     keys:  u16 keycode, u16 rawcode, u16 keychar
+ *     mouse: u16 button, u16 clicks, i16 x, i16 y
+ *     wheel: u16 clicks, u8 type, u16 amount, i16 rotation, u8 direction, i16 x, i16 y
+ *   WSS_BIN_PAD_INPUT: u8 flags (1 = axis), u8 device index, u32 time, u16 virtual code,
+ *     f32 virtual value, u16 native code, i32 native value, u8 name length, name
+ *   WSS_BIN_PAD_STATE: u8 state (wss::bin_pad_state), u32 time, u8 name length, name
+ * Times are ms on the os_gettime_ns() clock for every source, the binary
+ * records only carry the low 32 bits of it.
+ * Strings are UTF-8. data/overlay_render/js/binary.js decodes this into the
+ * same objects the JSON messages contain */
+#define WSS_BIN_UIOHOOK 1
+#define WSS_BIN_PAD_INPUT 2
+#define WSS_BIN_PAD_STATE 3
 
+/* Events come from input_hub, the mg thread reads them on its own */
 namespace wss {
 bool start();
 void stop();
-
-void dispatch_uiohook_event(const uiohook_event *, const std::string &source_name);
-void dispatch_gamepad_event(const gamepad::input_event *e, const std::shared_ptr<gamepad::device> &device, bool is_axis,
-                            const std::string &source_name);
-void dispatch_gamepad_event(const std::shared_ptr<gamepad::device> &device, const char *state,
-                            const std::string &source_name);
 }
\ No newline at end of file
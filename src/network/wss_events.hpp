@@ -0,0 +1,91 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <uiohook.h>
+
+/* Event names, bits and the queued events shared by the websocket
+ * serialization and the mg thread, kept apart since mongoose can't see the
+ * libgamepad headers */
+#define WSS_PAD_CONNECTED "gamepad_connected"
+#define WSS_PAD_DISCONNECTED "gamepad_disconnected"
+#define WSS_PAD_RECONNECTED "gamepad_reconnected"
+
+namespace input_hub {
+struct event;
+}
+
+class key_stats;
+
+namespace wss {
+/* Fixed wire codes, so the format doesn't depend on uiohook's enum */
+enum bin_event : uint8_t {
+    BIN_KEY_TYPED = 1,
+    BIN_KEY_PRESSED,
+    BIN_KEY_RELEASED,
+    BIN_MOUSE_CLICKED,
+    BIN_MOUSE_PRESSED,
+    BIN_MOUSE_RELEASED,
+    BIN_MOUSE_MOVED,
+    BIN_MOUSE_DRAGGED,
+    BIN_MOUSE_WHEEL
+};
+
+enum bin_pad_state : uint8_t { BIN_PAD_CONNECTED = 1, BIN_PAD_DISCONNECTED, BIN_PAD_RECONNECTED };
+
+/* One bit per event_type, used for subscriptions. The uiohook events use
+ * 1 << bin_event */
+#define WSS_EV_PAD_AXIS (1u << 10)
+#define WSS_EV_PAD_BUTTON (1u << 11)
+#define WSS_EV_PAD_CONNECTED (1u << 12)
+#define WSS_EV_PAD_DISCONNECTED (1u << 13)
+#define WSS_EV_PAD_RECONNECTED (1u << 14)
+#define WSS_EV_ALL 0x7ffeu
+/* Periodic key press statistics, only sent to clients that ask for them */
+#define WSS_EV_INPUT_STATS (1u << 15)
+
+/* Bits for an event_type name or one of the groups "keyboard", "mouse" and
+ * "gamepad", zero if the name is unknown */
+uint32_t event_bits(std::string_view name);
+
+/* Copy of gamepad::input_event, or only the time for connects and disconnects */
+struct pad_input {
+    uint64_t time;
+    uint16_t vc, native_id;
+    float virtual_value;
+    int32_t value;
+};
+
+/* An event as the mg thread keeps it, it's only serialized once it's
+ * actually sent */
+struct event {
+    uint32_t bits = 0; /* One WSS_EV bit */
+    std::string source, device;
+    uint8_t device_index = 0;
+    uiohook_event uiohook{};
+    pad_input pad{};
+
+    bool is_uiohook() const { return bits < WSS_EV_PAD_AXIS; }
+    bool is_pad_input() const { return bits & (WSS_EV_PAD_AXIS | WSS_EV_PAD_BUTTON); }
+    bool is_motion() const { return bits & ((1u << BIN_MOUSE_MOVED) | (1u << BIN_MOUSE_DRAGGED) | WSS_EV_PAD_AXIS); }
+};
+
+/* Fills out from an input_hub event, false if no client is subscribed to
+ * it. Only used by the mg thread */
+bool from_hub(const input_hub::event &in, event &out);
+
+/* Name of a hub channel as sources are called in events. Only used by the mg thread */
+const std::string &source_name(uint16_t channel);
+
+/* Key press statistics of a source as JSON with event_type "input_stats" */
+void serialize_input_stats(const std::string &source, const key_stats &stats, uint64_t now, std::string &out);
+
+/* Both return an empty string for events without a representation */
+const std::string &serialize_text(const event &e);
+const std::string &serialize_binary(const event &e);
+
+/* Current held keys, buttons, mouse position and gamepads of a source ("local"
+ * or a remote client name) as JSON with event_type "snapshot". Returns false
+ * if there's no such source */
+bool serialize_snapshot(const std::string &source, std::string &out);
+}
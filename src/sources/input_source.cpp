@@ -22,6 +22,9 @@
 #include "../util/obs_util.hpp"
 #include "../util/settings.h"
 #include "../util/config.hpp"
+#include "../util/services.hpp"
+#include "../util/pipeline_stats.hpp"
+#include "../util/recorder.hpp"
 #include "../network/io_server.hpp"
 #include "../network/remote_connection.hpp"
 #include <QFile>
@@ -33,7 +36,7 @@ bool overlay_settings::use_local_input()
     return selected_source.empty() || selected_source == T_LOCAL_SOURCE;
 }
 
-input_source::input_source(obs_source_t *source, obs_data_t *settings) : m_source(source)
+input_source::input_source(obs_source_t *source, obs_data_t *settings) : m_source(source), m_costs(source)
 {
     m_overlay = std::make_unique<overlay>(&m_settings);
     obs_source_update(m_source, settings);
@@ -49,23 +52,49 @@ input_source::input_source(obs_source_t *source, obs_data_t *settings) : m_sourc
     }
 }
 
-input_source::~input_source() = default;
+input_source::~input_source()
+{
+    if (m_uses_hooks)
+        services::release();
+}
 
 inline void input_source::update(obs_data_t *settings)
 {
     m_settings.selected_source = obs_data_get_string(settings, S_INPUT_SOURCE);
 
+    const std::string replay_file = obs_data_get_string(settings, S_REPLAY_FILE);
+    m_settings.replay = replay_file.empty() ? nullptr
+                                            : replay::get(replay_file, obs_data_get_bool(settings, S_REPLAY_MAX_SPEED),
+                                                          obs_data_get_bool(settings, S_REPLAY_LOOP));
+    const bool needs_hooks = !m_settings.replay;
+    if (needs_hooks != m_uses_hooks) {
+        m_uses_hooks = needs_hooks;
+        if (m_uses_hooks)
+            services::acquire();
+        else
+            services::release();
+    }
+
     m_settings.gamepad_id = obs_data_get_string(settings, S_CONTROLLER_ID);
-    if (m_settings.use_local_input() && libgamepad::hook_instance) {
+    if (m_settings.replay) {
+        m_settings.gamepad = m_settings.replay->get_pad(m_settings.gamepad_id);
+    } else if (m_settings.use_local_input() && libgamepad::hook_instance) {
         libgamepad::hook_instance->get_mutex()->lock();
         m_settings.gamepad = libgamepad::hook_instance->get_device_by_id(m_settings.gamepad_id);
         libgamepad::hook_instance->get_mutex()->unlock();
-    } else if (io_config::enable_remote_connections) {
-        std::lock_guard<std::mutex> lock(network::mutex);
+    } else if (io_config::enable_remote_connections && network::server_instance) {
+        std::lock_guard<traced_mutex> lock(network::mutex);
         m_settings.gamepad =
             network::server_instance->get_client_device_by_id(m_settings.selected_source, m_settings.gamepad_id);
     }
 
+    m_settings.use_render_cache = obs_data_get_bool(settings, S_RENDER_CACHE);
+    m_settings.bake_static = obs_data_get_bool(settings, S_BAKE_STATIC);
+    m_settings.pad_jitter_delay = uint16_t(obs_data_get_int(settings, S_PAD_JITTER_DELAY));
+    /* Percent of the stick radius, refresh_data applies changes */
+    m_settings.pad_response.deadzone[0] = obs_data_get_int(settings, S_CONTROLLER_L_DEAD_ZONE) / 100.f;
+    m_settings.pad_response.deadzone[1] = obs_data_get_int(settings, S_CONTROLLER_R_DEAD_ZONE) / 100.f;
+    m_settings.pad_response.curve = float(obs_data_get_double(settings, S_PAD_RESPONSE_CURVE));
     m_settings.mouse_sens = obs_data_get_int(settings, S_MOUSE_SENS);
 
     if ((m_settings.use_center = obs_data_get_bool(settings, S_MONITOR_USE_CENTER))) {
@@ -77,6 +106,20 @@ inline void input_source::update(obs_data_t *settings)
 
 inline void input_source::tick(float seconds)
 {
+    pipeline_stats::scope stats(pipeline_stats::STAGE_TICK);
+    IO_TRACE_ZONE("source tick");
+    m_costs.begin_tick();
+    /* Layout flags decide which properties are visible */
+    if (m_overlay->poll_load())
+        obs_source_update_properties(m_source);
+
+    /* Picks up changes made in the layout config tool without having to select the file again */
+    m_settings.file_check_timer += seconds;
+    if (m_settings.file_check_timer >= 1) {
+        m_overlay->reload_if_changed();
+        m_settings.file_check_timer = 0.0f;
+    }
+
     if (m_overlay->is_loaded()) {
         m_overlay->refresh_data();
         m_overlay->tick(seconds);
@@ -89,12 +132,14 @@ inline void input_source::tick(float seconds)
         } else {
             m_settings.gamepad_check_timer += seconds;
             if (m_settings.gamepad_check_timer >= 1) {
-                if (m_settings.use_local_input() && libgamepad::hook_instance) {
+                if (m_settings.replay) {
+                    m_settings.gamepad = m_settings.replay->get_pad(m_settings.gamepad_id);
+                } else if (m_settings.use_local_input() && libgamepad::hook_instance) {
                     libgamepad::hook_instance->get_mutex()->lock();
                     m_settings.gamepad = libgamepad::hook_instance->get_device_by_id(m_settings.gamepad_id);
                     libgamepad::hook_instance->get_mutex()->unlock();
                 } else if (network::network_flag) {
-                    std::lock_guard<std::mutex> lock(network::mutex);
+                    std::lock_guard<traced_mutex> lock(network::mutex);
                     m_settings.gamepad = network::server_instance->get_client_device_by_id(m_settings.selected_source,
                                                                                            m_settings.gamepad_id);
                 }
@@ -102,19 +147,25 @@ inline void input_source::tick(float seconds)
             }
         }
     }
+    m_costs.end_tick(uint32_t(m_overlay->element_count()));
 }
 
 inline void input_source::render(gs_effect_t *effect) const
 {
+    pipeline_stats::scope stats(pipeline_stats::STAGE_RENDER);
+    IO_TRACE_ZONE("source render");
     if (!m_overlay->get_texture() || !m_overlay->get_texture()->texture)
         return;
 
+    m_costs.begin_render();
     if (m_settings.layout_file.empty() || !m_overlay->is_loaded()) {
         gs_effect_set_texture(gs_effect_get_param_by_name(effect, "image"), m_overlay->get_texture()->texture);
         gs_draw_sprite(m_overlay->get_texture()->texture, 0, cx, cy);
+        source_costs::count_draw();
     } else {
         m_overlay->draw(effect);
     }
+    m_costs.end_render();
 }
 
 bool use_monitor_center_changed(obs_properties_t *props, obs_property_t *, obs_data_t *data)
@@ -130,16 +181,20 @@ bool reload_pads(obs_properties_t *, obs_property_t *property, void *data)
     auto *src = static_cast<input_source *>(data);
     obs_property_list_clear(property);
 
-    if (src->m_settings.use_local_input() && libgamepad::hook_instance) {
+    if (src->m_settings.replay) {
+        for (const auto &id : src->m_settings.replay->pad_ids())
+            obs_property_list_add_string(property, id.c_str(), id.c_str());
+    } else if (src->m_settings.use_local_input() && libgamepad::hook_instance) {
         libgamepad::hook_instance->get_mutex()->lock();
         for (const auto &pad : libgamepad::hook_instance->get_devices())
             obs_property_list_add_string(property, pad->get_id().c_str(), pad->get_id().c_str());
         libgamepad::hook_instance->get_mutex()->unlock();
-    } else if (io_config::enable_remote_connections) {
+    } else if (io_config::enable_remote_connections && network::server_instance) {
         // Add remote gamepads
-        std::lock_guard<std::mutex> lock(network::mutex);
+        std::lock_guard<traced_mutex> lock(network::mutex);
         auto client = network::server_instance->get_client(src->m_settings.selected_source);
         if (client) {
+            std::lock_guard<traced_mutex> client_lock(client->mutex());
             for (const auto &pad : client->gamepads())
                 obs_property_list_add_string(property, pad.second->get_id().c_str(), pad.second->get_id().c_str());
         }
@@ -158,9 +213,8 @@ bool file_changed(void *d, obs_properties_t *props, obs_property_t *, obs_data_t
     /* Only reload config file if path changed */
     if (src->m_settings.layout_file != config || src->m_settings.image_file != old_image_file) {
         src->m_settings.layout_file = config;
-        if (!src->m_overlay->load()) {
-            src->m_settings.layout_flags = 0;
-        }
+        /* The properties are refreshed again once loading finished, see tick */
+        src->m_overlay->load();
     }
 
     auto const &flags = src->m_settings.layout_flags;
@@ -172,6 +226,8 @@ bool file_changed(void *d, obs_properties_t *props, obs_property_t *, obs_data_t
     obs_property_set_visible(GET_PROPS(S_MONITOR_USE_CENTER), flags & OF_MOUSE);
     obs_property_set_visible(GET_PROPS(S_MOUSE_DEAD_ZONE), flags & OF_MOUSE);
     obs_property_set_visible(GET_PROPS(S_RELOAD_PAD_DEVICES), flags & OF_GAMEPAD);
+    obs_property_set_visible(GET_PROPS(S_PAD_JITTER_DELAY), flags & OF_GAMEPAD);
+    obs_property_set_visible(GET_PROPS(S_PAD_RESPONSE_CURVE), flags & (OF_LEFT_STICK | OF_RIGHT_STICK | OF_GAMEPAD));
     reload_pads(nullptr, GET_PROPS(S_CONTROLLER_ID), src);
 
     return true;
@@ -179,8 +235,9 @@ bool file_changed(void *d, obs_properties_t *props, obs_property_t *, obs_data_t
 
 bool reload_connections(obs_properties_t *, obs_property_t *property, void *)
 {
-    std::lock_guard<std::mutex> lock(network::mutex);
-    network::server_instance->get_clients(property, network::local_input);
+    std::lock_guard<traced_mutex> lock(network::mutex);
+    if (network::server_instance)
+        network::server_instance->get_clients(property, network::local_input);
     return true;
 }
 
@@ -213,6 +270,9 @@ obs_properties_t *get_properties_for_overlay(void *data)
             network::server_instance->get_clients(list, network::local_input);
         }
     }
+    obs_properties_add_bool(props, S_RENDER_CACHE, T_RENDER_CACHE);
+    obs_properties_add_bool(props, S_BAKE_STATIC, T_BAKE_STATIC);
+
     /* Mouse stuff */
     obs_properties_add_int_slider(props, S_MOUSE_SENS, T_MOUSE_SENS, 1, 500, 1);
 
@@ -230,6 +290,17 @@ obs_properties_t *get_properties_for_overlay(void *data)
 
     auto *btn = obs_properties_add_button2(props, S_RELOAD_PAD_DEVICES, T_RELOAD_PAD_DEVICES, reload_pads, src);
     obs_property_set_visible(btn, false);
+    obs_properties_add_int_slider(props, S_CONTROLLER_L_DEAD_ZONE, T_CONROLLER_L_DEADZONE, 0, 90, 1);
+    obs_properties_add_int_slider(props, S_CONTROLLER_R_DEAD_ZONE, T_CONROLLER_R_DEADZONE, 0, 90, 1);
+    obs_properties_add_float_slider(props, S_PAD_RESPONSE_CURVE, T_PAD_RESPONSE_CURVE, 0.25, 4, 0.05);
+    obs_properties_add_int_slider(props, S_PAD_JITTER_DELAY, T_PAD_JITTER_DELAY, 0, 100, 1);
+
+    /* Replay */
+    const auto filter_recordings = util_file_filter(T_FILTER_RECORDINGS, "*." RECORDING_EXTENSION);
+    obs_properties_add_path(props, S_REPLAY_FILE, T_REPLAY_FILE, OBS_PATH_FILE, qt_to_utf8(filter_recordings),
+                            nullptr);
+    obs_properties_add_bool(props, S_REPLAY_MAX_SPEED, T_REPLAY_MAX_SPEED);
+    obs_properties_add_bool(props, S_REPLAY_LOOP, T_REPLAY_LOOP);
 
     obs_property_set_visible(GET_PROPS(S_CONTROLLER_L_DEAD_ZONE), flags & OF_LEFT_STICK);
     obs_property_set_visible(GET_PROPS(S_CONTROLLER_R_DEAD_ZONE), flags & OF_RIGHT_STICK);
@@ -239,6 +310,8 @@ obs_properties_t *get_properties_for_overlay(void *data)
     obs_property_set_visible(GET_PROPS(S_MONITOR_USE_CENTER), flags & OF_MOUSE);
     obs_property_set_visible(GET_PROPS(S_MOUSE_DEAD_ZONE), flags & OF_MOUSE);
     obs_property_set_visible(GET_PROPS(S_RELOAD_PAD_DEVICES), flags & OF_GAMEPAD);
+    obs_property_set_visible(GET_PROPS(S_PAD_JITTER_DELAY), flags & OF_GAMEPAD);
+    obs_property_set_visible(GET_PROPS(S_PAD_RESPONSE_CURVE), flags & (OF_LEFT_STICK | OF_RIGHT_STICK | OF_GAMEPAD));
     reload_pads(nullptr, GET_PROPS(S_CONTROLLER_ID), src);
     return props;
 }
@@ -259,7 +332,11 @@ void register_overlay_source()
     si.destroy = [](void *data) { delete static_cast<input_source *>(data); };
     si.get_width = [](void *data) { return static_cast<input_source *>(data)->m_settings.cx; };
     si.get_height = [](void *data) { return static_cast<input_source *>(data)->m_settings.cy; };
-    si.get_defaults = [](obs_data_t *settings) { UNUSED_PARAMETER(settings); };
+    si.get_defaults = [](obs_data_t *settings) {
+        obs_data_set_default_bool(settings, S_BAKE_STATIC, true);
+        obs_data_set_default_bool(settings, S_REPLAY_LOOP, true);
+        obs_data_set_default_double(settings, S_PAD_RESPONSE_CURVE, 1.0);
+    };
     si.update = [](void *data, obs_data_t *settings) { static_cast<input_source *>(data)->update(settings); };
     si.video_tick = [](void *data, float seconds) { static_cast<input_source *>(data)->tick(seconds); };
     si.video_render = [](void *data, gs_effect_t *effect) { static_cast<input_source *>(data)->render(effect); };
@@ -19,7 +19,10 @@
 #pragma once
 
 #include "../util/overlay.hpp"
+#include "../util/axis_response.hpp"
 #include "../util/input_data.hpp"
+#include "../util/replay.hpp"
+#include "../util/source_costs.hpp"
 #include <obs-module.h>
 #include <string>
 
@@ -36,7 +39,9 @@ public:
     std::string image_file;
     std::string layout_file;
 
-    input_data data{};                        /* Copy of input data used for visualization          */
+    pad_view pad{};                           /* Copy of the selected gamepad, see input_channel    */
+    processed_axes axes{};                    /* pad.axis after pad_response, what elements draw    */
+    axis_response pad_response{};             /* Stick deadzones and response curve                 */
     uint32_t cx = 0, cy = 0;                  /* Source width/height                                */
     bool use_center = false;                  /* true if monitor center is used for mouse movement	*/
     uint32_t monitor_w = 0, monitor_h = 0;    /* Monitor size used for mouse movement               */
@@ -47,7 +52,18 @@ public:
     std::string selected_source;      /* Name of client or empty for local computer         */
     uint8_t layout_flags = 0;         /* See overlay_flags in layout_constants.hpp          */
     float gamepad_check_timer = 0.0f; /* Counter to check if selected game pad is connected */
+    float file_check_timer = 0.0f;    /* Counter to check if the layout or image was modified */
     std::string gamepad_id;
+    bool use_render_cache = false;   /* Render into a texture and only redraw on changes   */
+    bool bake_static = true;         /* Draw released buttons once into a background       */
+    uint16_t pad_jitter_delay = 0;   /* Ms axis values are delayed by to interpolate them  */
+    std::shared_ptr<replay::player> replay; /* Used instead of the selected source if set     */
+
+    /* Keyboard and mouse state of the selected source, shared with all other
+     * sources reading the same computer. See input_cache */
+    const input_state *input = &input_cache::empty;
+    /* Events since the last frame, used to show presses that were shorter than a frame */
+    const input_cache::frame_events *events = &input_cache::no_events;
     /* clang-format: on */
 
     bool use_local_input();
@@ -60,6 +76,8 @@ public:
     uint32_t cx = 0, cy = 0;
     std::unique_ptr<overlay> m_overlay{};
     overlay_settings m_settings;
+    bool m_uses_hooks = false; /* Holds a services reference, replays don't need one */
+    mutable source_costs::meter m_costs;
 
     input_source(obs_source_t *source, obs_data_t *settings);
 
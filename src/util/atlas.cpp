@@ -0,0 +1,108 @@
+/*************************************************************************
+ * This file is part of input-overlay
+ * github.con/univrsal/input-overlay
+ * Copyright 2022 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#include "atlas.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <layout_constants.h>
+#include <util/bmem.h>
+extern "C" {
+#include <graphics/image-file.h>
+}
+
+/* Same spacing as the layouts use, keeps filtering from bleeding neighbours in */
+#define ATLAS_PADDING CFG_INNER_BORDER
+
+namespace atlas {
+static bool same_rect(const gs_rect &a, const gs_rect &b)
+{
+    return a.x == b.x && a.y == b.y && a.cx == b.cx && a.cy == b.cy;
+}
+
+plan pack(const std::vector<gs_rect> &regions)
+{
+    plan p;
+    p.index.reserve(regions.size());
+    for (const auto &r : regions) {
+        const auto it = std::find_if(p.from.begin(), p.from.end(), [&r](const gs_rect &o) { return same_rect(o, r); });
+        p.index.emplace_back(size_t(it - p.from.begin()));
+        if (it == p.from.end())
+            p.from.emplace_back(r);
+    }
+    p.to.resize(p.from.size());
+
+    /* Shelves filled with the tallest regions first, about as wide as a square of the total area */
+    std::vector<size_t> order(p.from.size());
+    int area = 0, width = 0;
+    for (size_t i = 0; i < order.size(); i++) {
+        order[i] = i;
+        area += (p.from[i].cx + ATLAS_PADDING) * (p.from[i].cy + ATLAS_PADDING);
+        width = std::max(width, p.from[i].cx);
+    }
+    width = std::max(width, int(std::ceil(std::sqrt(double(area)))));
+    std::sort(order.begin(), order.end(), [&p](size_t a, size_t b) { return p.from[a].cy > p.from[b].cy; });
+
+    int x = 0, y = 0, shelf = 0;
+    for (const auto i : order) {
+        const auto &r = p.from[i];
+        if (x > 0 && x + r.cx > width) {
+            y += shelf + ATLAS_PADDING;
+            x = 0;
+            shelf = 0;
+        }
+        p.to[i] = {x, y, r.cx, r.cy};
+        p.cx = std::max(p.cx, uint32_t(x + r.cx));
+        x += r.cx + ATLAS_PADDING;
+        shelf = std::max(shelf, r.cy);
+    }
+    p.cy = uint32_t(y + shelf);
+    return p;
+}
+
+bool apply(gs_image_file_t *image, const plan &p)
+{
+    if (!image->loaded || image->is_animated_gif || !image->texture_data || gs_get_format_bpp(image->format) != 32)
+        return false;
+    if (!p.cx || !p.cy || uint64_t(p.cx) * p.cy >= uint64_t(image->cx) * image->cy)
+        return false;
+
+    auto *data = static_cast<uint8_t *>(bzalloc(size_t(p.cx) * p.cy * 4));
+    for (size_t i = 0; i < p.from.size(); i++) {
+        const auto &from = p.from[i];
+        const auto &to = p.to[i];
+        /* Parts outside of the original image stay transparent */
+        const auto x0 = std::max(from.x, 0), y0 = std::max(from.y, 0);
+        const auto x1 = std::min(from.x + from.cx, int(image->cx));
+        const auto y1 = std::min(from.y + from.cy, int(image->cy));
+        if (x1 <= x0 || y1 <= y0)
+            continue;
+        for (auto y = y0; y < y1; y++) {
+            const auto *src = image->texture_data + (size_t(y) * image->cx + x0) * 4;
+            auto *dst = data + (size_t(to.y + y - from.y) * p.cx + size_t(to.x + x0 - from.x)) * 4;
+            memcpy(dst, src, size_t(x1 - x0) * 4);
+        }
+    }
+
+    bfree(image->texture_data);
+    image->texture_data = data;
+    image->cx = p.cx;
+    image->cy = p.cy;
+    return true;
+}
+}
@@ -0,0 +1,43 @@
+/*************************************************************************
+ * This file is part of input-overlay
+ * github.con/univrsal/input-overlay
+ * Copyright 2022 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#pragma once
+
+#include <graphics/graphics.h>
+#include <vector>
+
+typedef struct gs_image_file gs_image_file_t;
+
+/* Repacks the parts of a layout image that elements actually use into a
+ * smaller image, so unused areas and padding don't take up GPU memory */
+namespace atlas {
+struct plan {
+    uint32_t cx = 0, cy = 0;
+    std::vector<gs_rect> from; /* Used regions of the original image, without duplicates */
+    std::vector<gs_rect> to;   /* Where each of them ends up */
+    std::vector<size_t> index; /* Index into from/to of every region passed to pack */
+};
+
+/* Only depends on the regions, so every source using the same layout gets the same plan */
+plan pack(const std::vector<gs_rect> &regions);
+
+/* Replaces the decoded pixels with the packed image, has to happen before
+ * the texture is created. Fails if the image can't be repacked or wouldn't
+ * get smaller */
+bool apply(gs_image_file_t *image, const plan &p);
+}
@@ -0,0 +1,64 @@
+/*************************************************************************
+ * This file is part of input-overlay
+ * github.con/univrsal/input-overlay
+ * Copyright 2022 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#pragma once
+
+#include "input_data.hpp"
+#include <algorithm>
+#include <cmath>
+
+/* Stick and trigger values after the deadzone and response curve of a
+ * source, computed once per change instead of in every element. Indexed
+ * by element_side */
+struct processed_axes {
+    float x[2]{}, y[2]{}; /* Sticks, -1 to 1 with 0 in the center */
+    float trigger[2]{};   /* 0 released, 1 fully pressed */
+};
+
+/* Per source axis settings. The sticks get a radial deadzone, so moving
+ * along one axis doesn't snap the other one to zero, and are rescaled so
+ * the edge of the deadzone maps to 0 and full deflection to 1. Both sticks
+ * and triggers then go through curve, values below 1 make small movements
+ * more visible, values above 1 less */
+struct axis_response {
+    float deadzone[2]{}; /* Fraction of the stick radius, below 1 */
+    float curve = 1.f;
+
+    bool operator==(const axis_response &o) const
+    {
+        return deadzone[0] == o.deadzone[0] && deadzone[1] == o.deadzone[1] && curve == o.curve;
+    }
+
+    void apply(const axis_state &raw, processed_axes &out) const
+    {
+        /* Raw sticks are 0 to 1 with the center at 0.5 */
+        const float x[2] = {raw[gamepad::axis::LEFT_STICK_X] * 2 - 1, raw[gamepad::axis::RIGHT_STICK_X] * 2 - 1};
+        const float y[2] = {raw[gamepad::axis::LEFT_STICK_Y] * 2 - 1, raw[gamepad::axis::RIGHT_STICK_Y] * 2 - 1};
+        const float t[2] = {raw[gamepad::axis::LEFT_TRIGGER], raw[gamepad::axis::RIGHT_TRIGGER]};
+
+        /* Fixed size and no branches, so the compiler can keep both sides in one register */
+        for (size_t i = 0; i < 2; i++) {
+            const auto length = std::sqrt(x[i] * x[i] + y[i] * y[i]);
+            const auto live = std::max(std::min(length, 1.f) - deadzone[i], 0.f) / (1.f - deadzone[i]);
+            const auto scale = length > 0.f ? std::pow(live, curve) / length : 0.f;
+            out.x[i] = x[i] * scale;
+            out.y[i] = y[i] * scale;
+            out.trigger[i] = std::pow(std::min(std::max(t[i], 0.f), 1.f), curve);
+        }
+    }
+};
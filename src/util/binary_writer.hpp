@@ -0,0 +1,77 @@
+/*************************************************************************
+ * This file is part of input-overlay
+ * github.con/univrsal/input-overlay
+ * Copyright 2022 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+/* Builds one record of the binary websocket format described in
+ * websocket_server.hpp. Everything is little-endian, the length prefix is
+ * filled in by end() */
+class binary_writer {
+    std::string &m_out;
+
+    template<class T> binary_writer &put(T value, int bytes)
+    {
+        for (int i = 0; i < bytes; i++)
+            m_out += char((static_cast<uint64_t>(value) >> (8 * i)) & 0xff);
+        return *this;
+    }
+
+public:
+    /* out is cleared, keep it around between events so its memory is reused */
+    binary_writer(std::string &out, uint8_t kind) : m_out(out)
+    {
+        m_out.clear();
+        m_out.append(2, '\0');
+        u8(kind);
+    }
+
+    const std::string &end()
+    {
+        const auto length = uint16_t(m_out.size());
+        m_out[0] = char(length & 0xff);
+        m_out[1] = char(length >> 8);
+        return m_out;
+    }
+
+    binary_writer &u8(uint8_t value) { return put(value, 1); }
+    binary_writer &u16(uint16_t value) { return put(value, 2); }
+    binary_writer &i16(int16_t value) { return put(uint16_t(value), 2); }
+    binary_writer &u32(uint32_t value) { return put(value, 4); }
+    binary_writer &i32(int32_t value) { return put(uint32_t(value), 4); }
+
+    binary_writer &f32(float value)
+    {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        return u32(bits);
+    }
+
+    /* u8 length followed by the bytes, longer strings are cut off */
+    binary_writer &str(std::string_view value)
+    {
+        const auto length = value.size() > 0xff ? size_t(0xff) : value.size();
+        u8(uint8_t(length));
+        m_out.append(value.data(), length);
+        return *this;
+    }
+};
@@ -28,6 +28,8 @@ input_filter io_window_filters; /* Global filters */
 std::mutex filter_mutex;        /* Thread safety for writing/reading filters */
 bool use_dinput = false;
 bool use_js = true;
+bool use_evdev = false;
+bool use_raw_input = false;
 bool enable_input_control = false;
 bool enable_websocket_server = false;
 bool enable_remote_connections = false;
@@ -40,6 +42,25 @@ int filter_mode = 0;
 uint16_t server_refresh_rate = 250;
 uint16_t server_port = 1608;
 uint16_t wss_port = 16899;
+uint16_t wss_mouse_rate = 120;
+uint16_t wss_axis_rate = 120;
+uint32_t wss_slow_bytes = 256 * 1024;
+uint32_t wss_max_bytes = 8 * 1024 * 1024;
+uint32_t client_message_rate = 20000;
+uint32_t client_byte_rate = 1024 * 1024;
+uint16_t pad_idle_poll = 8;
+uint8_t pad_axis_deadband = 2;
+uint8_t pad_axis_step = 1;
+int input_thread_priority = 0;
+int network_thread_priority = 0;
+uint32_t thread_affinity = 0;
+bool lazy_start = true;
+uint16_t idle_stop_delay = 30;
+bool trim_atlas = false;
+bool pipeline_stats = false;
+uint16_t pipeline_stats_log = 10;
+bool record_input = false;
+std::string record_path;
 
 void set_defaults()
 {
@@ -57,6 +78,27 @@ void set_defaults()
     CDEF_INT(S_REFRESH, filter_mode);
     CDEF_BOOL(S_USE_DINPUT, use_dinput);
     CDEF_BOOL(S_USE_JS, use_dinput);
+    CDEF_BOOL(S_USE_EVDEV, use_evdev);
+    CDEF_BOOL(S_USE_RAW_INPUT, use_raw_input);
+    CDEF_INT(S_CLIENT_MESSAGE_RATE, client_message_rate);
+    CDEF_INT(S_CLIENT_BYTE_RATE, client_byte_rate);
+    CDEF_INT(S_PAD_IDLE_POLL, pad_idle_poll);
+    CDEF_INT(S_PAD_AXIS_DEADBAND, pad_axis_deadband);
+    CDEF_INT(S_PAD_AXIS_STEP, pad_axis_step);
+    CDEF_INT(S_WSS_MOUSE_RATE, wss_mouse_rate);
+    CDEF_INT(S_WSS_AXIS_RATE, wss_axis_rate);
+    CDEF_INT(S_WSS_SLOW_BYTES, wss_slow_bytes);
+    CDEF_INT(S_WSS_MAX_BYTES, wss_max_bytes);
+    CDEF_INT(S_INPUT_THREAD_PRIORITY, input_thread_priority);
+    CDEF_INT(S_NETWORK_THREAD_PRIORITY, network_thread_priority);
+    CDEF_INT(S_THREAD_AFFINITY, thread_affinity);
+    CDEF_BOOL(S_LAZY_START, lazy_start);
+    CDEF_INT(S_IDLE_STOP_DELAY, idle_stop_delay);
+    CDEF_BOOL(S_TRIM_ATLAS, trim_atlas);
+    CDEF_BOOL(S_PIPELINE_STATS, pipeline_stats);
+    CDEF_INT(S_PIPELINE_STATS_LOG, pipeline_stats_log);
+    CDEF_BOOL(S_RECORD_INPUT, record_input);
+    CDEF_STR(S_RECORD_PATH, "");
 }
 
 void load()
@@ -78,6 +120,28 @@ void load()
     server_refresh_rate = CGET_INT(S_REFRESH);
     use_dinput = CGET_BOOL(S_USE_DINPUT);
     use_js = CGET_BOOL(S_USE_JS);
+    use_evdev = CGET_BOOL(S_USE_EVDEV);
+    use_raw_input = CGET_BOOL(S_USE_RAW_INPUT);
+    client_message_rate = uint32_t(CGET_INT(S_CLIENT_MESSAGE_RATE));
+    client_byte_rate = uint32_t(CGET_INT(S_CLIENT_BYTE_RATE));
+    pad_idle_poll = uint16_t(CGET_INT(S_PAD_IDLE_POLL));
+    pad_axis_deadband = uint8_t(CGET_INT(S_PAD_AXIS_DEADBAND));
+    pad_axis_step = uint8_t(CGET_INT(S_PAD_AXIS_STEP));
+    wss_mouse_rate = uint16_t(CGET_INT(S_WSS_MOUSE_RATE));
+    wss_axis_rate = uint16_t(CGET_INT(S_WSS_AXIS_RATE));
+    wss_slow_bytes = uint32_t(CGET_INT(S_WSS_SLOW_BYTES));
+    wss_max_bytes = uint32_t(CGET_INT(S_WSS_MAX_BYTES));
+    input_thread_priority = int(CGET_INT(S_INPUT_THREAD_PRIORITY));
+    network_thread_priority = int(CGET_INT(S_NETWORK_THREAD_PRIORITY));
+    thread_affinity = uint32_t(CGET_INT(S_THREAD_AFFINITY));
+    lazy_start = CGET_BOOL(S_LAZY_START);
+    idle_stop_delay = uint16_t(CGET_INT(S_IDLE_STOP_DELAY));
+    trim_atlas = CGET_BOOL(S_TRIM_ATLAS);
+    pipeline_stats = CGET_BOOL(S_PIPELINE_STATS);
+    pipeline_stats_log = uint16_t(CGET_INT(S_PIPELINE_STATS_LOG));
+    record_input = CGET_BOOL(S_RECORD_INPUT);
+    const auto *path = CGET_STR(S_RECORD_PATH);
+    record_path = path ? path : "";
 }
 
 void save()
@@ -94,8 +158,29 @@ void save()
     CSET_BOOL(S_REGEX, regex);
     CSET_BOOL(S_USE_DINPUT, use_dinput);
     CSET_BOOL(S_USE_JS, use_js);
+    CSET_BOOL(S_USE_EVDEV, use_evdev);
+    CSET_BOOL(S_USE_RAW_INPUT, use_raw_input);
     CSET_INT(S_WSS_PORT, wss_port);
     CSET_BOOL(S_ENABLE_WSS, enable_websocket_server);
+    CSET_INT(S_CLIENT_MESSAGE_RATE, client_message_rate);
+    CSET_INT(S_CLIENT_BYTE_RATE, client_byte_rate);
+    CSET_INT(S_PAD_IDLE_POLL, pad_idle_poll);
+    CSET_INT(S_PAD_AXIS_DEADBAND, pad_axis_deadband);
+    CSET_INT(S_PAD_AXIS_STEP, pad_axis_step);
+    CSET_INT(S_WSS_MOUSE_RATE, wss_mouse_rate);
+    CSET_INT(S_WSS_AXIS_RATE, wss_axis_rate);
+    CSET_INT(S_WSS_SLOW_BYTES, wss_slow_bytes);
+    CSET_INT(S_WSS_MAX_BYTES, wss_max_bytes);
+    CSET_INT(S_INPUT_THREAD_PRIORITY, input_thread_priority);
+    CSET_INT(S_NETWORK_THREAD_PRIORITY, network_thread_priority);
+    CSET_INT(S_THREAD_AFFINITY, thread_affinity);
+    CSET_BOOL(S_LAZY_START, lazy_start);
+    CSET_INT(S_IDLE_STOP_DELAY, idle_stop_delay);
+    CSET_BOOL(S_TRIM_ATLAS, trim_atlas);
+    CSET_BOOL(S_PIPELINE_STATS, pipeline_stats);
+    CSET_INT(S_PIPELINE_STATS_LOG, pipeline_stats_log);
+    CSET_BOOL(S_RECORD_INPUT, record_input);
+    CSET_STR(S_RECORD_PATH, record_path.c_str());
 }
 
 }
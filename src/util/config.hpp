@@ -20,6 +20,7 @@
 
 #include "input_filter.hpp"
 #include <mutex>
+#include <string>
 #include <util/config-file.h>
 
 #define CDEF_STR(id, value) config_set_default_string(io_config::instance, S_REGION, id, value)
@@ -46,6 +47,8 @@ extern std::mutex filter_mutex;
 /* Global boolean config values */
 extern bool use_dinput;
 extern bool use_js;
+extern bool use_evdev; /* Read /dev/input directly instead of XRecord, Linux only */
+extern bool use_raw_input; /* Raw Input instead of the low level hooks, Windows only */
 extern bool enable_input_control;
 extern bool enable_remote_connections;
 extern bool enable_gamepad_hook;
@@ -59,6 +62,30 @@ extern bool log_flag;
 extern uint16_t server_refresh_rate;
 extern uint16_t server_port;
 extern uint16_t wss_port;
+extern uint16_t wss_mouse_rate; /* Mouse moves per second sent to websockets, zero sends all of them */
+extern uint16_t wss_axis_rate;  /* Same for every gamepad axis */
+extern uint32_t wss_slow_bytes; /* Unsent bytes after which a client gets no more motion, zero disables it */
+extern uint32_t wss_max_bytes;  /* Unsent bytes after which a client is disconnected, zero disables it */
+extern uint32_t client_message_rate; /* Per remote client and second, zero disables the limit */
+extern uint32_t client_byte_rate;
+/* Gamepad polling */
+extern uint16_t pad_idle_poll; /* Ms between polls while no pad is used, zero always polls fast */
+extern uint8_t pad_axis_deadband; /* Percent of an axis around the centre that counts as zero */
+extern uint8_t pad_axis_step;     /* Percent an axis has to move before it is reported again */
+/* Thread scheduling, see thread_priority.hpp */
+extern int input_thread_priority;   /* Hook and gamepad threads, 0 normal (default), 1 high, 2 real-time */
+extern int network_thread_priority; /* Websocket and remote connection threads */
+extern uint32_t thread_affinity;    /* CPU mask for all of them, zero lets the OS decide */
+/* Hooks and remote server only run while sources or websocket clients use them, see services.hpp */
+extern bool lazy_start;
+extern uint16_t idle_stop_delay; /* Seconds without users before they are stopped */
+extern bool trim_atlas;          /* Repack the used parts of layout images, see atlas.hpp */
+/* Per stage timings and event rates, see pipeline_stats.hpp */
+extern bool pipeline_stats;
+extern uint16_t pipeline_stats_log; /* Seconds between log lines, zero only serves them to websockets */
+/* Recordings of the local input while the hooks run, see recorder.hpp */
+extern bool record_input;
+extern std::string record_path; /* Directory, empty uses the recordings folder next to the other data files */
 
 extern void set_defaults();
 
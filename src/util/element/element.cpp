@@ -36,18 +36,59 @@ uint16_t element::get_keycode() const
     return m_keycode;
 }
 
-void element::read_mapping(const QJsonObject &obj)
+gs_rect element::atlas_region(const element_desc &desc)
 {
-    auto map = obj[CFG_MAPPING].toArray();
-    m_mapping.x = map[0].toInt();
-    m_mapping.y = map[1].toInt();
-    m_mapping.cx = map[2].toInt();
-    m_mapping.cy = map[3].toInt();
+    /* Has to match the rects the elements derive from their mapping in load */
+    gs_rect r = {desc.mapping[0], desc.mapping[1], desc.mapping[2], desc.mapping[3]};
+    switch (desc.type) {
+    case ET_KEYBOARD_KEY:
+    case ET_MOUSE_BUTTON:
+    case ET_GAMEPAD_BUTTON:
+    case ET_ANALOG_STICK:
+    case ET_TRIGGER:
+        r.cy = 2 * r.cy + CFG_INNER_BORDER; /* Pressed state below */
+        break;
+    case ET_WHEEL:
+        r.cx = 4 * r.cx + 3 * CFG_INNER_BORDER;
+        break;
+    case ET_GAMEPAD_ID:
+        r.cx = 5 * r.cx + 4 * CFG_INNER_BORDER;
+        break;
+    case ET_DPAD_STICK:
+        r.cx = 9 * r.cx + 8 * CFG_INNER_BORDER;
+        break;
+    default:;
+    }
+    return r;
 }
 
-void element::read_pos(const QJsonObject &obj)
+element_desc element::read_desc(const QJsonObject &obj)
 {
-    const auto p = obj[CFG_POS].toArray();
-    m_pos.x = p[0].toInt();
-    m_pos.y = p[1].toInt();
+    element_desc desc{};
+    desc.type = obj[CFG_TYPE].toInt();
+    desc.id = 0x811c9dc5;
+    for (const auto c : obj[CFG_ID].toString().toUtf8()) {
+        desc.id ^= uint8_t(c);
+        desc.id *= 0x01000193;
+    }
+    const auto pos = obj[CFG_POS].toArray();
+    const auto map = obj[CFG_MAPPING].toArray();
+    for (int i = 0; i < 2; i++)
+        desc.pos[i] = pos[i].toInt();
+    for (int i = 0; i < 4; i++)
+        desc.mapping[i] = map[i].toInt();
+
+    desc.keycode = static_cast<uint16_t>(obj[CFG_KEY_CODE].toInt());
+    desc.side = static_cast<uint8_t>(obj[CFG_SIDE].toInt());
+    desc.mouse_type = static_cast<uint8_t>(obj[CFG_MOUSE_TYPE].toInt());
+    desc.trigger_mode = obj[CFG_TRIGGER_MODE].toBool();
+    desc.direction = static_cast<uint8_t>(obj[CFG_DIRECTION].toInt());
+    desc.stat = static_cast<uint8_t>(obj[CFG_STAT].toInt());
+    if (desc.type == ET_ANALOG_STICK)
+        desc.radius = static_cast<uint8_t>(obj[CFG_STICK_RADIUS].toInt());
+    else if (desc.type == ET_MOUSE_MOVEMENT)
+        desc.radius = static_cast<uint8_t>(obj[CFG_MOUSE_RADIUS].toInt());
+    else if (desc.type == ET_INPUT_HISTORY)
+        desc.radius = static_cast<uint8_t>(obj[CFG_HISTORY_LENGTH].toInt());
+    return desc;
 }
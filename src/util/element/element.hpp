@@ -21,10 +21,32 @@
 #include <graphics/graphics.h>
 #include <graphics/vec2.h>
 #include <QJsonObject>
+#include <cstdint>
+#include <type_traits>
 #include <layout_constants.h>
 
 typedef struct gs_image_file gs_image_file_t;
 
+/* Everything an element reads from the layout. Parsed once from the JSON and
+ * stored as is in the layout cache, so bump LAYOUT_CACHE_VERSION when
+ * changing it */
+struct element_desc {
+    int32_t type;
+    uint32_t id; /* FNV-1a of the element id, to match elements when the layout is reloaded */
+    int32_t pos[2];
+    int32_t mapping[4];
+    uint16_t keycode;
+    uint8_t side;
+    uint8_t radius; /* Stick or mouse movement radius, input history length */
+    uint8_t mouse_type;
+    uint8_t trigger_mode;
+    uint8_t direction;
+    uint8_t stat; /* What an input stats element shows, see input_stat */
+};
+
+static_assert(std::is_trivially_copyable<element_desc>::value && sizeof(element_desc) == 40,
+              "element_desc is written to the layout cache as is");
+
 namespace sources {
 class overlay_settings;
 }
@@ -37,7 +59,13 @@ public:
 
     element(element_type type);
 
-    virtual void load(const QJsonObject &obj) = 0;
+    /* All string keyed lookups happen here, load only copies fields */
+    static element_desc read_desc(const QJsonObject &obj);
+
+    /* Part of the image the element draws from, including all of its states */
+    static gs_rect atlas_region(const element_desc &desc);
+
+    virtual void load(const element_desc &desc) = 0;
 
     virtual void draw(gs_effect_t *effect, gs_image_file_t *m_image, sources::overlay_settings *settings) = 0;
 
@@ -48,10 +76,6 @@ public:
     virtual void tick(float, sources::overlay_settings *) {}
 
 protected:
-    void read_mapping(const QJsonObject &obj);
-
-    void read_pos(const QJsonObject &obj);
-
     vec2 m_pos = {};
     gs_rect m_mapping = {};
 
@@ -21,11 +21,11 @@
 
 #include "../../sources/input_source.hpp"
 
-void element_analog_stick::load(const QJsonObject &obj)
+void element_analog_stick::load(const element_desc &desc)
 {
-    element_texture::load(obj);
-    m_side = static_cast<element_side>(obj[CFG_SIDE].toInt());
-    m_radius = static_cast<uint8_t>(obj[CFG_STICK_RADIUS].toInt());
+    element_texture::load(desc);
+    m_side = static_cast<element_side>(desc.side);
+    m_radius = desc.radius;
     m_keycode = VC_STICK_DATA;
     m_pressed = m_mapping;
     m_pressed.y = m_mapping.y + m_mapping.cy + CFG_INNER_BORDER;
@@ -35,15 +35,14 @@ void element_analog_stick::draw(gs_effect_t *effect, gs_image_file_t *image, sou
 {
     auto pos = m_pos;
     gs_rect *temp;
+    const size_t side = m_side == element_side::LEFT ? 0 : 1;
 
-    if (m_side == element_side::LEFT) {
-        pos.y += ((settings->data.gamepad_axis[gamepad::axis::LEFT_STICK_Y] * 2) - 1) * m_radius;
-        pos.x += ((settings->data.gamepad_axis[gamepad::axis::LEFT_STICK_X] * 2) - 1) * m_radius;
-        temp = settings->data.gamepad_buttons[gamepad::button::L_THUMB] ? &m_pressed : &m_mapping;
-    } else {
-        pos.y += ((settings->data.gamepad_axis[gamepad::axis::RIGHT_STICK_Y] * 2) - 1) * m_radius;
-        pos.x += ((settings->data.gamepad_axis[gamepad::axis::RIGHT_STICK_X] * 2) - 1) * m_radius;
-        temp = settings->data.gamepad_buttons[gamepad::button::R_THUMB] ? &m_pressed : &m_mapping;
-    }
+    /* Deadzone and response curve are already applied, see axis_response */
+    pos.x += settings->axes.x[side] * m_radius;
+    pos.y += settings->axes.y[side] * m_radius;
+    if (side == 0)
+        temp = settings->pad.buttons[gamepad::button::L_THUMB] ? &m_pressed : &m_mapping;
+    else
+        temp = settings->pad.buttons[gamepad::button::R_THUMB] ? &m_pressed : &m_mapping;
     element_texture::draw(effect, image, temp, &pos);
 }
@@ -34,7 +34,7 @@ class element_analog_stick : public element_texture {
 public:
     element_analog_stick() : element_texture(ET_ANALOG_STICK), m_side() {}
 
-    void load(const QJsonObject &obj) override;
+    void load(const element_desc &desc) override;
 
     void draw(gs_effect_t *effect, gs_image_file_t *image, sources::overlay_settings *settings) override;
 
@@ -20,34 +20,49 @@
 
 #include "../../sources/input_source.hpp"
 
-void element_button::load(const QJsonObject &obj)
+void element_button::load(const element_desc &desc)
 {
-    element_texture::load(obj);
-    m_keycode = static_cast<uint16_t>(obj[CFG_KEY_CODE].toInt());
+    element_texture::load(desc);
+    m_keycode = desc.keycode;
     m_pressed = m_mapping;
     m_pressed.y = m_mapping.y + m_mapping.cy + CFG_INNER_BORDER;
 }
 
+bool element_keyboard_key::pressed(sources::overlay_settings *settings) const
+{
+    return settings->input->keyboard[m_keycode] || settings->events->keys_pressed[m_keycode];
+}
+
 void element_keyboard_key::draw(gs_effect_t *effect, gs_image_file_t *image, sources::overlay_settings *settings)
 {
-    if (settings->data.keyboard[m_keycode])
-        element_texture::draw(effect, image, &m_pressed);
+    if (pressed(settings))
+        draw_pressed(effect, image);
     else
         element_button::draw(effect, image, nullptr);
 }
 
+bool element_mouse_button::pressed(sources::overlay_settings *settings) const
+{
+    return settings->input->mouse[m_keycode] || settings->events->buttons_pressed[m_keycode];
+}
+
 void element_mouse_button::draw(gs_effect_t *effect, gs_image_file_t *image, sources::overlay_settings *settings)
 {
-    if (settings->data.mouse[m_keycode])
-        element_texture::draw(effect, image, &m_pressed);
+    if (pressed(settings))
+        draw_pressed(effect, image);
     else
         element_button::draw(effect, image, nullptr);
 }
 
+bool element_gamepad_button::pressed(sources::overlay_settings *settings) const
+{
+    return settings->pad.buttons[m_keycode];
+}
+
 void element_gamepad_button::draw(gs_effect_t *effect, gs_image_file_t *image, sources::overlay_settings *settings)
 {
-    if (settings->data.gamepad_buttons[m_keycode])
-        element_texture::draw(effect, image, &m_pressed);
+    if (pressed(settings))
+        draw_pressed(effect, image);
     else
         element_button::draw(effect, image, nullptr);
 }
@@ -25,12 +25,18 @@ class element_button : public element_texture {
 public:
     explicit element_button(element_type t) : element_texture(t), m_pressed() {}
 
-    void load(const QJsonObject &objc) override;
+    void load(const element_desc &desc) override;
     void draw(gs_effect_t *effect, gs_image_file_t *image, sources::overlay_settings *settings) override
     {
         element_texture::draw(effect, image, settings);
     }
 
+    /* Pressed sprite only, the released one is part of the baked background */
+    void draw_pressed(gs_effect_t *effect, gs_image_file_t *image) const
+    {
+        element_texture::draw(effect, image, &m_pressed);
+    }
+
 protected:
     gs_rect m_pressed;
 };
@@ -40,6 +46,7 @@ public:
     element_keyboard_key() : element_button(ET_KEYBOARD_KEY) {}
 
     void draw(gs_effect_t *effect, gs_image_file_t *image, sources::overlay_settings *settings) override;
+    bool pressed(sources::overlay_settings *settings) const;
 };
 
 class element_mouse_button : public element_button {
@@ -47,6 +54,7 @@ public:
     element_mouse_button() : element_button(ET_MOUSE_BUTTON) {}
 
     void draw(gs_effect_t *effect, gs_image_file_t *image, sources::overlay_settings *settings) override;
+    bool pressed(sources::overlay_settings *settings) const;
 };
 
 class element_gamepad_button : public element_button {
@@ -54,4 +62,5 @@ public:
     element_gamepad_button() : element_button(ET_GAMEPAD_BUTTON) {}
 
     void draw(gs_effect_t *effect, gs_image_file_t *image, sources::overlay_settings *settings) override;
+    bool pressed(sources::overlay_settings *settings) const;
 };
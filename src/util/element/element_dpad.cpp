@@ -22,9 +22,9 @@
 
 element_dpad::element_dpad() : element_texture(ET_DPAD_STICK) {}
 
-void element_dpad::load(const QJsonObject &obj)
+void element_dpad::load(const element_desc &desc)
 {
-    element_texture::load(obj);
+    element_texture::load(desc);
     auto i = 1;
     for (auto &map : m_mappings) {
         map = m_mapping;
@@ -34,39 +34,37 @@ void element_dpad::load(const QJsonObject &obj)
     m_keycode = VC_DPAD_DATA;
 }
 
-inline int get_direction(std::map<uint16_t, bool> &buttons)
+inline int get_direction(const pad_button_state &buttons)
 {
-    if (buttons[gamepad::button::DPAD_UP]) {
-        if (buttons[gamepad::button::DPAD_LEFT])
-            return element_dpad::TEXTURE_TOP_LEFT;
-        if (buttons[gamepad::button::DPAD_RIGHT])
-            return element_dpad::TEXTURE_TOP_RIGHT;
-        return element_dpad::TEXTURE_UP;
-    } else if (buttons[gamepad::button::DPAD_DOWN]) {
-        if (buttons[gamepad::button::DPAD_LEFT])
-            return element_dpad::TEXTURE_BOTTOM_LEFT;
-        if (buttons[gamepad::button::DPAD_RIGHT])
-            return element_dpad::TEXTURE_BOTTOM_RIGHT;
-        return element_dpad::TEXTURE_DOWN;
-    } else if (buttons[gamepad::button::DPAD_RIGHT]) {
-        if (buttons[gamepad::button::DPAD_UP])
-            return element_dpad::TEXTURE_TOP_RIGHT;
-        if (buttons[gamepad::button::DPAD_DOWN])
-            return element_dpad::TEXTURE_BOTTOM_RIGHT;
-        return element_dpad::TEXTURE_RIGHT;
-    } else if (buttons[gamepad::button::DPAD_LEFT]) {
-        if (buttons[gamepad::button::DPAD_UP])
-            return element_dpad::TEXTURE_TOP_LEFT;
-        if (buttons[gamepad::button::DPAD_DOWN])
-            return element_dpad::TEXTURE_BOTTOM_LEFT;
-        return element_dpad::TEXTURE_LEFT;
-    }
-    return -1;
+    /* Indexed by up | down << 1 | left << 2 | right << 3. Up wins over down
+     * and right wins over left, same as checking them in that order */
+    static const int directions[16] = {
+        -1,
+        element_dpad::TEXTURE_UP,
+        element_dpad::TEXTURE_DOWN,
+        element_dpad::TEXTURE_UP,
+        element_dpad::TEXTURE_LEFT,
+        element_dpad::TEXTURE_TOP_LEFT,
+        element_dpad::TEXTURE_BOTTOM_LEFT,
+        element_dpad::TEXTURE_TOP_LEFT,
+        element_dpad::TEXTURE_RIGHT,
+        element_dpad::TEXTURE_TOP_RIGHT,
+        element_dpad::TEXTURE_BOTTOM_RIGHT,
+        element_dpad::TEXTURE_TOP_RIGHT,
+        element_dpad::TEXTURE_RIGHT,
+        element_dpad::TEXTURE_TOP_LEFT,
+        element_dpad::TEXTURE_BOTTOM_LEFT,
+        element_dpad::TEXTURE_TOP_LEFT,
+    };
+
+    const auto index = buttons[gamepad::button::DPAD_UP] | buttons[gamepad::button::DPAD_DOWN] << 1 |
+                       buttons[gamepad::button::DPAD_LEFT] << 2 | buttons[gamepad::button::DPAD_RIGHT] << 3;
+    return directions[index];
 }
 
 void element_dpad::draw(gs_effect_t *effect, gs_image_file_t *image, sources::overlay_settings *settings)
 {
-    const auto dir = get_direction(settings->data.gamepad_buttons);
+    const auto dir = get_direction(settings->pad.buttons);
 
     if (dir >= 0) {
         /* Enum starts at one (Center doesn't count)*/
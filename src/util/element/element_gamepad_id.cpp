@@ -27,9 +27,9 @@ element_gamepad_id::element_gamepad_id() : element_texture(ET_GAMEPAD_ID), m_map
     m_keycode = gamepad::button::GUIDE;
 }
 
-void element_gamepad_id::load(const QJsonObject &obj)
+void element_gamepad_id::load(const element_desc &desc)
 {
-    element_texture::load(obj);
+    element_texture::load(desc);
     auto i = 1;
     for (auto &map : m_mappings) {
         map = m_mapping;
@@ -39,7 +39,7 @@ void element_gamepad_id::load(const QJsonObject &obj)
 
 void element_gamepad_id::draw(gs_effect_t *effect, gs_image_file_t *image, sources::overlay_settings *settings)
 {
-    if (settings->data.gamepad_buttons[m_keycode])
+    if (settings->pad.buttons[m_keycode])
         element_texture::draw(effect, image, &m_mappings[ID_PRESSED]);
 
     if (settings->gamepad) {
@@ -0,0 +1,110 @@
+/*************************************************************************
+ * This file is part of input-overlay
+ * github.con/univrsal/input-overlay
+ * Copyright 2022 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#include "element_input_history.hpp"
+#include "../glyph_atlas.hpp"
+#include "../../sources/input_source.hpp"
+#include <keycodes.h>
+#include <algorithm>
+
+element_input_history::element_input_history() : element_texture(ET_INPUT_HISTORY), m_held(VC_NONE) {}
+
+void element_input_history::load(const element_desc &desc)
+{
+    element_texture::load(desc);
+    m_length = desc.radius ? std::min<uint8_t>(desc.radius, HISTORY_MAX_ENTRIES) : HISTORY_DEFAULT_ENTRIES;
+    m_direction = desc.direction > DIR_NONE && desc.direction < DIR_MAX ? static_cast<direction>(desc.direction)
+                                                                         : DIR_DOWN;
+    m_count = std::min(m_count, m_length);
+    if (!m_atlas)
+        m_atlas = glyph_atlas::acquire();
+}
+
+void element_input_history::push(uint16_t code)
+{
+    m_entries[m_head] = code;
+    m_head = (m_head + 1) % HISTORY_MAX_ENTRIES;
+    if (m_count < m_length)
+        m_count++;
+}
+
+void element_input_history::tick(float, sources::overlay_settings *settings)
+{
+    const auto *events = settings->events;
+    for (size_t i = 0; i < events->count; i++) {
+        const auto &e = events->events[i];
+        switch (e.event.type) {
+        case EVENT_KEY_PRESSED:
+            if (e.event.data.keyboard.keycode != m_held)
+                push(e.event.data.keyboard.keycode);
+            m_held = e.event.data.keyboard.keycode;
+            break;
+        case EVENT_KEY_RELEASED:
+            if (e.event.data.keyboard.keycode == m_held)
+                m_held = VC_NONE;
+            break;
+        case EVENT_MOUSE_PRESSED:
+            push(uint16_t(e.event.data.mouse.button | VC_MOUSE_MASK));
+            m_held = VC_NONE;
+            break;
+        default:;
+        }
+    }
+}
+
+void element_input_history::draw(gs_effect_t *effect, gs_image_file_t *image, sources::overlay_settings *)
+{
+    if (!m_count || !m_atlas)
+        return;
+
+    /* Backgrounds go into the overlay batch, the labels are drawn on top of them */
+    vec2 pos[HISTORY_MAX_ENTRIES];
+    const gs_rect *rects[HISTORY_MAX_ENTRIES];
+    vec2 cursor = m_pos;
+    for (uint8_t i = 0; i < m_count; i++) {
+        const auto code = m_entries[(m_head + HISTORY_MAX_ENTRIES - 1 - i) % HISTORY_MAX_ENTRIES];
+        rects[i] = m_atlas->find(code);
+        const auto cx = float(m_mapping.cx ? m_mapping.cx : rects[i]->cx);
+        const auto cy = float(m_mapping.cy ? m_mapping.cy : rects[i]->cy);
+
+        if (i > 0) {
+            const auto prev_cx = float(m_mapping.cx ? m_mapping.cx : rects[i - 1]->cx);
+            const auto prev_cy = float(m_mapping.cy ? m_mapping.cy : rects[i - 1]->cy);
+            switch (m_direction) {
+            case DIR_UP:
+                cursor.y -= cy + CFG_INNER_BORDER;
+                break;
+            case DIR_LEFT:
+                cursor.x -= cx + CFG_INNER_BORDER;
+                break;
+            case DIR_RIGHT:
+                cursor.x += prev_cx + CFG_INNER_BORDER;
+                break;
+            default:
+                cursor.y += prev_cy + CFG_INNER_BORDER;
+            }
+        }
+
+        if (m_mapping.cx && m_mapping.cy)
+            element_texture::draw(effect, image, &m_mapping, &cursor);
+        /* Centered in the entry */
+        pos[i].x = cursor.x + int(cx - rects[i]->cx) / 2;
+        pos[i].y = cursor.y + int(cy - rects[i]->cy) / 2;
+    }
+    m_atlas->draw(effect, image, rects, pos, m_count);
+}
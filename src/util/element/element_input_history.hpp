@@ -0,0 +1,54 @@
+/*************************************************************************
+ * This file is part of input-overlay
+ * github.con/univrsal/input-overlay
+ * Copyright 2022 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#pragma once
+
+#include "element_texture.hpp"
+#include <memory>
+
+#define HISTORY_MAX_ENTRIES 16
+#define HISTORY_DEFAULT_ENTRIES 5
+
+class glyph_atlas;
+
+/* Shows the last key and mouse button presses as labels from the shared
+ * glyph atlas. The mapping is an optional background from the layout
+ * image drawn behind every label, its size is also the size of an entry.
+ * Older entries are moved in the layout direction, down by default */
+class element_input_history : public element_texture {
+public:
+    element_input_history();
+
+    void load(const element_desc &desc) override;
+
+    void draw(gs_effect_t *effect, gs_image_file_t *image, sources::overlay_settings *settings) override;
+
+    void tick(float seconds, sources::overlay_settings *settings) override;
+
+private:
+    void push(uint16_t code);
+
+    std::shared_ptr<glyph_atlas> m_atlas;
+
+    /* Ring of the last presses, m_head is where the next one goes */
+    uint16_t m_entries[HISTORY_MAX_ENTRIES]{};
+    uint8_t m_head = 0, m_count = 0;
+    uint8_t m_length = HISTORY_DEFAULT_ENTRIES;
+    direction m_direction = DIR_DOWN;
+    uint16_t m_held; /* Key repeats of it don't add entries */
+};
@@ -0,0 +1,86 @@
+/*************************************************************************
+ * This file is part of input-overlay
+ * github.con/univrsal/input-overlay
+ * Copyright 2022 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#include "element_input_stats.hpp"
+#include "../glyph_atlas.hpp"
+#include "../../sources/input_source.hpp"
+#include <util/platform.h>
+
+element_input_stats::element_input_stats() : element_texture(ET_INPUT_STATS) {}
+
+void element_input_stats::load(const element_desc &desc)
+{
+    element_texture::load(desc);
+    m_keycode = desc.keycode;
+    m_stat = desc.stat < IS_MAX ? static_cast<input_stat>(desc.stat) : IS_APM;
+    if (!m_atlas)
+        m_atlas = glyph_atlas::acquire();
+}
+
+uint64_t element_input_stats::value(uint64_t now) const
+{
+    const auto *k = m_stats.find(m_keycode);
+    switch (m_stat) {
+    case IS_PRESSES:
+        return m_stats.presses();
+    case IS_KEY_PRESSES:
+        return k ? k->presses : 0;
+    case IS_KEY_HOLD:
+        return k ? k->average_hold() : 0;
+    default:
+        return m_stats.apm(now);
+    }
+}
+
+void element_input_stats::tick(float, sources::overlay_settings *settings)
+{
+    const auto *events = settings->events;
+    for (size_t i = 0; i < events->count; i++)
+        m_stats.add(events->events[i].event, events->events[i].time);
+
+    if (!m_atlas)
+        return;
+    auto v = value(os_gettime_ns());
+    int digits[STATS_MAX_DIGITS];
+    m_digit_count = 0;
+    do {
+        digits[m_digit_count++] = int(v % 10);
+        v /= 10;
+    } while (v && m_digit_count < STATS_MAX_DIGITS);
+
+    float width = 0;
+    for (uint8_t i = 0; i < m_digit_count; i++) {
+        m_digits[i] = m_atlas->digit(digits[m_digit_count - 1 - i]);
+        width += m_digits[i]->cx;
+    }
+    auto x = m_pos.x + (m_mapping.cx ? int(m_mapping.cx - width) / 2 : 0);
+    const auto y = m_pos.y + (m_mapping.cy ? (m_mapping.cy - GLYPH_HEIGHT) / 2 : 0);
+    for (uint8_t i = 0; i < m_digit_count; i++) {
+        m_digit_pos[i].x = x;
+        m_digit_pos[i].y = y;
+        x += m_digits[i]->cx;
+    }
+}
+
+void element_input_stats::draw(gs_effect_t *effect, gs_image_file_t *image, sources::overlay_settings *)
+{
+    if (m_mapping.cx && m_mapping.cy)
+        element_texture::draw(effect, image, &m_mapping, &m_pos);
+    if (m_atlas)
+        m_atlas->draw(effect, image, m_digits, m_digit_pos, m_digit_count);
+}
@@ -0,0 +1,53 @@
+/*************************************************************************
+ * This file is part of input-overlay
+ * github.con/univrsal/input-overlay
+ * Copyright 2022 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#pragma once
+
+#include "element_texture.hpp"
+#include "../key_stats.hpp"
+#include <memory>
+
+#define STATS_MAX_DIGITS 10
+
+class glyph_atlas;
+
+/* Shows one number from the key press statistics of its source, which it
+ * keeps itself from the events of every frame. The mapping is an optional
+ * background from the layout image, the digits are centered on it */
+class element_input_stats : public element_texture {
+public:
+    element_input_stats();
+
+    void load(const element_desc &desc) override;
+
+    void draw(gs_effect_t *effect, gs_image_file_t *image, sources::overlay_settings *settings) override;
+
+    void tick(float seconds, sources::overlay_settings *settings) override;
+
+private:
+    uint64_t value(uint64_t now) const;
+
+    std::shared_ptr<glyph_atlas> m_atlas;
+    key_stats m_stats;
+    input_stat m_stat = IS_APM;
+
+    /* Digits of the current value, updated on tick */
+    const gs_rect *m_digits[STATS_MAX_DIGITS]{};
+    vec2 m_digit_pos[STATS_MAX_DIGITS]{};
+    uint8_t m_digit_count = 0;
+};
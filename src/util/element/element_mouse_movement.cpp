@@ -23,11 +23,11 @@
 
 element_mouse_movement::element_mouse_movement() : element_texture(ET_MOUSE_MOVEMENT) {}
 
-void element_mouse_movement::load(const QJsonObject &obj)
+void element_mouse_movement::load(const element_desc &desc)
 {
-    element_texture::load(obj);
-    m_radius = static_cast<uint8_t>(obj[CFG_MOUSE_RADIUS].toInt());
-    m_movement_type = obj[CFG_MOUSE_TYPE].toInt() == 1 ? MM_ARROW : MM_DOT;
+    element_texture::load(desc);
+    m_radius = desc.radius;
+    m_movement_type = desc.mouse_type == 1 ? MM_ARROW : MM_DOT;
 }
 
 void element_mouse_movement::draw(gs_effect_t *effect, gs_image_file_t *image, sources::overlay_settings *)
@@ -47,8 +47,8 @@ void element_mouse_movement::tick(float, sources::overlay_settings *settings)
     } else {
         get_mouse_offset(settings, m_pos, m_offset_pos, m_radius);
     }
-    m_last_x = settings->data.last_mouse_movement.x;
-    m_last_y = settings->data.last_mouse_movement.y;
+    m_last_x = settings->input->last_mouse_movement.x;
+    m_last_y = settings->input->last_mouse_movement.y;
 }
 
 float element_mouse_movement::get_mouse_angle(sources::overlay_settings *settings)
@@ -56,11 +56,11 @@ float element_mouse_movement::get_mouse_angle(sources::overlay_settings *setting
     auto d_x = 0, d_y = 0;
 
     if (settings->use_center) {
-        d_x = settings->data.last_mouse_movement.x - settings->monitor_h;
-        d_y = settings->data.last_mouse_movement.y - settings->monitor_w;
+        d_x = settings->input->last_mouse_movement.x - settings->monitor_h;
+        d_y = settings->input->last_mouse_movement.y - settings->monitor_w;
     } else {
-        d_x = settings->data.last_mouse_movement.x - m_last_x;
-        d_y = settings->data.last_mouse_movement.y - m_last_y;
+        d_x = settings->input->last_mouse_movement.x - m_last_x;
+        d_y = settings->input->last_mouse_movement.y - m_last_y;
     }
 
     const float new_angle = (0.5 * M_PI) + (atan2f(d_y, d_x));
@@ -79,11 +79,11 @@ void element_mouse_movement::get_mouse_offset(sources::overlay_settings *setting
     auto d_x = 0, d_y = 0;
 
     if (settings->use_center) {
-        d_x = settings->data.last_mouse_movement.x - settings->monitor_h;
-        d_y = settings->data.last_mouse_movement.y - settings->monitor_w;
+        d_x = settings->input->last_mouse_movement.x - settings->monitor_h;
+        d_y = settings->input->last_mouse_movement.y - settings->monitor_w;
     } else {
-        d_x = settings->data.last_mouse_movement.x - m_last_x;
-        d_y = settings->data.last_mouse_movement.y - m_last_y;
+        d_x = settings->input->last_mouse_movement.x - m_last_x;
+        d_y = settings->input->last_mouse_movement.y - m_last_y;
 
         if (abs(d_x) < settings->mouse_deadzone)
             d_x = 0;
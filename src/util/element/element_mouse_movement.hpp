@@ -25,7 +25,7 @@ class element_mouse_movement : public element_texture {
 public:
     element_mouse_movement();
 
-    void load(const QJsonObject &obj) override;
+    void load(const element_desc &desc) override;
 
     void draw(gs_effect_t *effect, gs_image_file_t *image, sources::overlay_settings *settings) override;
 
@@ -25,9 +25,9 @@ element_wheel::element_wheel() : element_texture(ET_WHEEL), m_mappings{}
     /* NO-OP */
 }
 
-void element_wheel::load(const QJsonObject &obj)
+void element_wheel::load(const element_desc &desc)
 {
-    element_texture::load(obj);
+    element_texture::load(desc);
     auto i = 1;
     for (auto &map : m_mappings) {
         map = m_mapping;
@@ -45,9 +45,9 @@ void element_wheel::draw(gs_effect_t *effect, gs_image_file_t *image, sources::o
      * this should make sure that all necessary information is visible
      */
     element_texture::draw(effect, image, settings);
-    if (settings->data.mouse[MOUSE_BUTTON3])
+    if (settings->input->mouse[MOUSE_BUTTON3])
         element_texture::draw(effect, image, &m_mappings[WHEEL_MAP_MIDDLE]);
-    switch (settings->data.last_wheel_event.rotation) {
+    switch (settings->input->last_wheel_event.rotation) {
     case WHEEL_UP:
         element_texture::draw(effect, image, &m_mappings[WHEEL_MAP_UP]);
         break;
@@ -0,0 +1,301 @@
+/*************************************************************************
+ * This file is part of input-overlay
+ * github.con/univrsal/input-overlay
+ * Copyright 2022 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#include "element_table.hpp"
+#include "../input_data.hpp"
+
+static bool is_static(element_type type)
+{
+    return type == ET_TEXTURE || type == ET_KEYBOARD_KEY || type == ET_MOUSE_BUTTON || type == ET_GAMEPAD_BUTTON;
+}
+
+static uint8_t channels_of(element_type type)
+{
+    switch (type) {
+    case ET_KEYBOARD_KEY:
+        return IC_KEYBOARD | IC_EVENTS;
+    case ET_MOUSE_BUTTON:
+        return IC_MOUSE | IC_EVENTS;
+    case ET_WHEEL:
+    case ET_MOUSE_MOVEMENT:
+        return IC_MOUSE;
+    case ET_GAMEPAD_BUTTON:
+    case ET_GAMEPAD_ID:
+    case ET_DPAD_STICK:
+        return IC_PAD_BUTTONS;
+    case ET_TRIGGER:
+        return IC_PAD_AXES;
+    case ET_ANALOG_STICK:
+        return IC_PAD_AXES | IC_PAD_BUTTONS; /* Pressed sticks */
+    case ET_INPUT_HISTORY:
+    case ET_INPUT_STATS:
+        return IC_EVENTS;
+    default:
+        return 0;
+    }
+}
+
+template<class T> element *element_table::append(std::vector<T> &elements, element_type type)
+{
+    if (m_runs.empty() || m_runs.back().type != type) {
+        m_runs.push_back({type, elements.size(), elements.size()});
+        /* Anything after the first dynamic element is drawn on top of it, so it can't go into the background */
+        m_static_prefix = m_static_prefix && is_static(type);
+        if (m_static_prefix)
+            m_static_runs = m_runs.size();
+    }
+    elements.emplace_back();
+    m_channels |= channels_of(type);
+    m_runs.back().end = elements.size();
+    m_count++;
+    return &elements.back();
+}
+
+element *element_table::add(element_type type)
+{
+    switch (type) {
+    case ET_TEXTURE:
+        return append(m_textures, type);
+    case ET_GAMEPAD_ID:
+        return append(m_gamepad_ids, type);
+    case ET_KEYBOARD_KEY:
+        return append(m_keys, type);
+    case ET_MOUSE_BUTTON:
+        return append(m_mouse_buttons, type);
+    case ET_GAMEPAD_BUTTON:
+        return append(m_gamepad_buttons, type);
+    case ET_WHEEL:
+        return append(m_wheels, type);
+    case ET_TRIGGER:
+        return append(m_triggers, type);
+    case ET_ANALOG_STICK:
+        return append(m_sticks, type);
+    case ET_DPAD_STICK:
+        return append(m_dpads, type);
+    case ET_MOUSE_MOVEMENT:
+        return append(m_mouse_movements, type);
+    case ET_INPUT_HISTORY:
+        return append(m_histories, type);
+    case ET_INPUT_STATS:
+        return append(m_input_stats, type);
+    default:
+        return nullptr;
+    }
+}
+
+element *element_table::get(element_type type, size_t index)
+{
+    switch (type) {
+    case ET_TEXTURE:
+        return &m_textures[index];
+    case ET_GAMEPAD_ID:
+        return &m_gamepad_ids[index];
+    case ET_KEYBOARD_KEY:
+        return &m_keys[index];
+    case ET_MOUSE_BUTTON:
+        return &m_mouse_buttons[index];
+    case ET_GAMEPAD_BUTTON:
+        return &m_gamepad_buttons[index];
+    case ET_WHEEL:
+        return &m_wheels[index];
+    case ET_TRIGGER:
+        return &m_triggers[index];
+    case ET_ANALOG_STICK:
+        return &m_sticks[index];
+    case ET_DPAD_STICK:
+        return &m_dpads[index];
+    case ET_MOUSE_MOVEMENT:
+        return &m_mouse_movements[index];
+    case ET_INPUT_HISTORY:
+        return &m_histories[index];
+    case ET_INPUT_STATS:
+        return &m_input_stats[index];
+    default:
+        return nullptr;
+    }
+}
+
+element *element_table::at(size_t index)
+{
+    for (const auto &r : m_runs) {
+        const auto length = r.end - r.begin;
+        if (index < length)
+            return get(r.type, r.begin + index);
+        index -= length;
+    }
+    return nullptr;
+}
+
+/* The qualified calls let the compiler skip the vtable and inline */
+template<class T>
+static inline void draw_run(std::vector<T> &elements, size_t begin, size_t end, gs_effect_t *effect,
+                            gs_image_file_t *image, sources::overlay_settings *settings)
+{
+    for (auto i = begin; i < end; i++)
+        elements[i].T::draw(effect, image, settings);
+}
+
+template<class T>
+static inline void draw_default_run(std::vector<T> &elements, size_t begin, size_t end, gs_effect_t *effect,
+                                    gs_image_file_t *image)
+{
+    for (auto i = begin; i < end; i++)
+        elements[i].element_texture::draw(effect, image, nullptr);
+}
+
+template<class T>
+static inline void draw_pressed_run(std::vector<T> &elements, size_t begin, size_t end, gs_effect_t *effect,
+                                    gs_image_file_t *image, sources::overlay_settings *settings)
+{
+    for (auto i = begin; i < end; i++) {
+        if (elements[i].T::pressed(settings))
+            elements[i].draw_pressed(effect, image);
+    }
+}
+
+template<class T>
+static inline void tick_all(std::vector<T> &elements, float seconds, sources::overlay_settings *settings)
+{
+    for (auto &e : elements)
+        e.T::tick(seconds, settings);
+}
+
+void element_table::draw(gs_effect_t *effect, gs_image_file_t *image, sources::overlay_settings *settings)
+{
+    for (const auto &r : m_runs)
+        draw_one_run(r, effect, image, settings);
+}
+
+void element_table::draw_static(gs_effect_t *effect, gs_image_file_t *image)
+{
+    for (size_t i = 0; i < m_static_runs; i++) {
+        const auto &r = m_runs[i];
+        switch (r.type) {
+        case ET_TEXTURE:
+            draw_default_run(m_textures, r.begin, r.end, effect, image);
+            break;
+        case ET_KEYBOARD_KEY:
+            draw_default_run(m_keys, r.begin, r.end, effect, image);
+            break;
+        case ET_MOUSE_BUTTON:
+            draw_default_run(m_mouse_buttons, r.begin, r.end, effect, image);
+            break;
+        case ET_GAMEPAD_BUTTON:
+            draw_default_run(m_gamepad_buttons, r.begin, r.end, effect, image);
+            break;
+        default:;
+        }
+    }
+}
+
+void element_table::draw_dynamic(gs_effect_t *effect, gs_image_file_t *image, sources::overlay_settings *settings)
+{
+    for (size_t i = 0; i < m_runs.size(); i++) {
+        const auto &r = m_runs[i];
+        if (i >= m_static_runs) {
+            draw_one_run(r, effect, image, settings);
+            continue;
+        }
+        /* Released buttons and textures are already in the background */
+        switch (r.type) {
+        case ET_KEYBOARD_KEY:
+            draw_pressed_run(m_keys, r.begin, r.end, effect, image, settings);
+            break;
+        case ET_MOUSE_BUTTON:
+            draw_pressed_run(m_mouse_buttons, r.begin, r.end, effect, image, settings);
+            break;
+        case ET_GAMEPAD_BUTTON:
+            draw_pressed_run(m_gamepad_buttons, r.begin, r.end, effect, image, settings);
+            break;
+        default:;
+        }
+    }
+}
+
+void element_table::draw_one_run(const run &r, gs_effect_t *effect, gs_image_file_t *image,
+                                 sources::overlay_settings *settings)
+{
+    switch (r.type) {
+    case ET_TEXTURE:
+        draw_run(m_textures, r.begin, r.end, effect, image, settings);
+        break;
+    case ET_GAMEPAD_ID:
+        draw_run(m_gamepad_ids, r.begin, r.end, effect, image, settings);
+        break;
+    case ET_KEYBOARD_KEY:
+        draw_run(m_keys, r.begin, r.end, effect, image, settings);
+        break;
+    case ET_MOUSE_BUTTON:
+        draw_run(m_mouse_buttons, r.begin, r.end, effect, image, settings);
+        break;
+    case ET_GAMEPAD_BUTTON:
+        draw_run(m_gamepad_buttons, r.begin, r.end, effect, image, settings);
+        break;
+    case ET_WHEEL:
+        draw_run(m_wheels, r.begin, r.end, effect, image, settings);
+        break;
+    case ET_TRIGGER:
+        draw_run(m_triggers, r.begin, r.end, effect, image, settings);
+        break;
+    case ET_ANALOG_STICK:
+        draw_run(m_sticks, r.begin, r.end, effect, image, settings);
+        break;
+    case ET_DPAD_STICK:
+        draw_run(m_dpads, r.begin, r.end, effect, image, settings);
+        break;
+    case ET_MOUSE_MOVEMENT:
+        draw_run(m_mouse_movements, r.begin, r.end, effect, image, settings);
+        break;
+    case ET_INPUT_HISTORY:
+        draw_run(m_histories, r.begin, r.end, effect, image, settings);
+        break;
+    case ET_INPUT_STATS:
+        draw_run(m_input_stats, r.begin, r.end, effect, image, settings);
+        break;
+    default:;
+    }
+}
+
+void element_table::tick(float seconds, sources::overlay_settings *settings)
+{
+    /* Only mouse movement, input history and stats do anything on tick, order doesn't matter */
+    tick_all(m_mouse_movements, seconds, settings);
+    tick_all(m_histories, seconds, settings);
+    tick_all(m_input_stats, seconds, settings);
+}
+
+void element_table::clear()
+{
+    m_textures.clear();
+    m_keys.clear();
+    m_mouse_buttons.clear();
+    m_gamepad_buttons.clear();
+    m_wheels.clear();
+    m_triggers.clear();
+    m_sticks.clear();
+    m_dpads.clear();
+    m_gamepad_ids.clear();
+    m_mouse_movements.clear();
+    m_histories.clear();
+    m_input_stats.clear();
+    m_runs.clear();
+    m_static_runs = 0;
+    m_static_prefix = true;
+    m_count = 0;
+    m_channels = 0;
+}
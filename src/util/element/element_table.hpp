@@ -0,0 +1,88 @@
+/*************************************************************************
+ * This file is part of input-overlay
+ * github.con/univrsal/input-overlay
+ * Copyright 2022 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#pragma once
+
+#include "element_analog_stick.hpp"
+#include "element_button.hpp"
+#include "element_dpad.hpp"
+#include "element_gamepad_id.hpp"
+#include "element_input_history.hpp"
+#include "element_input_stats.hpp"
+#include "element_mouse_movement.hpp"
+#include "element_mouse_wheel.hpp"
+#include "element_trigger.hpp"
+#include <vector>
+
+/* All elements of a layout stored by value in one array per type, so drawing
+ * and ticking iterates contiguous memory and calls the element methods
+ * directly instead of through the vtable. Draw order is kept as runs of
+ * consecutive elements of the same type, in the order of the layout file.
+ * The runs at the start that only hold textures and buttons are static,
+ * in their released state they can be drawn once into a background */
+class element_table {
+public:
+    /* Returns the new element, which is only valid until the next call, or
+     * nullptr if the type is invalid */
+    element *add(element_type type);
+
+    void draw(gs_effect_t *effect, gs_image_file_t *image, sources::overlay_settings *settings);
+    /* Static runs in their default state */
+    void draw_static(gs_effect_t *effect, gs_image_file_t *image);
+    /* Everything that differs from what draw_static drew */
+    void draw_dynamic(gs_effect_t *effect, gs_image_file_t *image, sources::overlay_settings *settings);
+    bool has_static() const { return m_static_runs > 0; }
+    void tick(float seconds, sources::overlay_settings *settings);
+    /* Input stats change without new input (the rate goes down), so they are ticked every frame */
+    bool ticks_always() const { return !m_input_stats.empty(); }
+    /* input_channel bits of everything the elements read */
+    uint8_t channels() const { return m_channels; }
+    void clear();
+    /* Element at index in layout order, nullptr if out of range */
+    element *at(size_t index);
+    size_t size() const { return m_count; }
+
+private:
+    struct run {
+        element_type type;
+        size_t begin, end;
+    };
+
+    template<class T> element *append(std::vector<T> &elements, element_type type);
+    element *get(element_type type, size_t index);
+    void draw_one_run(const run &r, gs_effect_t *effect, gs_image_file_t *image, sources::overlay_settings *settings);
+
+    std::vector<element_texture> m_textures;
+    std::vector<element_keyboard_key> m_keys;
+    std::vector<element_mouse_button> m_mouse_buttons;
+    std::vector<element_gamepad_button> m_gamepad_buttons;
+    std::vector<element_wheel> m_wheels;
+    std::vector<element_trigger> m_triggers;
+    std::vector<element_analog_stick> m_sticks;
+    std::vector<element_dpad> m_dpads;
+    std::vector<element_gamepad_id> m_gamepad_ids;
+    std::vector<element_mouse_movement> m_mouse_movements;
+    std::vector<element_input_history> m_histories;
+    std::vector<element_input_stats> m_input_stats;
+
+    std::vector<run> m_runs;
+    size_t m_static_runs = 0; /* Leading runs that can be baked */
+    bool m_static_prefix = true;
+    size_t m_count = 0;
+    uint8_t m_channels = 0;
+};
@@ -17,6 +17,8 @@
  *************************************************************************/
 
 #include "element_texture.hpp"
+#include "../sprite_batch.hpp"
+#include "../source_costs.hpp"
 
 extern "C" {
 #include <graphics/image-file.h>
@@ -32,10 +34,11 @@ element_texture::element_texture(const element_type type) : element(type)
     /* NO-OP */
 }
 
-void element_texture::load(const QJsonObject &obj)
+void element_texture::load(const element_desc &desc)
 {
-    read_pos(obj);
-    read_mapping(obj);
+    m_pos.x = desc.pos[0];
+    m_pos.y = desc.pos[1];
+    m_mapping = {desc.mapping[0], desc.mapping[1], desc.mapping[2], desc.mapping[3]};
 }
 
 void element_texture::draw(gs_effect_t *effect, gs_image_file_t *image, sources::overlay_settings *settings)
@@ -51,16 +54,27 @@ void element_texture::draw(gs_effect_t *effect, gs_image_file_t *image, const gs
 
 void element_texture::draw(gs_effect_t *effect, gs_image_file_t *image, const gs_rect *rect, const vec2 *pos)
 {
+    if (auto *batch = sprite_batch::current()) {
+        batch->add(rect, pos);
+        return;
+    }
+
     gs_matrix_push();
     gs_effect_set_texture(gs_effect_get_param_by_name(effect, "image"), image->texture);
     gs_matrix_translate3f(pos->x, pos->y, 1.f);
     gs_draw_sprite_subregion(image->texture, 0, rect->x, rect->y, rect->cx, rect->cy);
     gs_matrix_pop();
+    source_costs::count_draw();
 }
 
 void element_texture::draw(gs_effect *effect, gs_image_file_t *image, const gs_rect *rect, const vec2 *pos,
                            const float angle)
 {
+    if (auto *batch = sprite_batch::current()) {
+        batch->add(rect, pos, angle);
+        return;
+    }
+
     gs_effect_set_texture(gs_effect_get_param_by_name(effect, "image"), image->texture);
 
     gs_matrix_push();
@@ -78,4 +92,5 @@ void element_texture::draw(gs_effect *effect, gs_image_file_t *image, const gs_r
         gs_draw_sprite_subregion(image->texture, 0, rect->x, rect->y, rect->cx, rect->cy);
     }
     gs_matrix_pop();
+    source_costs::count_draw();
 }
\ No newline at end of file
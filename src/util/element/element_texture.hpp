@@ -26,7 +26,7 @@ public:
 
     explicit element_texture(element_type type);
 
-    void load(const QJsonObject &obj) override;
+    void load(const element_desc &desc) override;
     void draw(gs_effect_t *effect, gs_image_file_t *image, sources::overlay_settings *settings) override;
     void draw(gs_effect_t *effect, gs_image_file_t *image, const gs_rect *rect) const;
     static void draw(gs_effect_t *effect, gs_image_file_t *image, const gs_rect *rect, const vec2 *pos);
@@ -23,28 +23,29 @@
 
 element_trigger::element_trigger() : element_texture(ET_TRIGGER) {}
 
-void element_trigger::load(const QJsonObject &obj)
+void element_trigger::load(const element_desc &desc)
 {
-    element_texture::load(obj);
-    m_button_mode = obj[CFG_TRIGGER_MODE].toBool();
-    m_side = static_cast<element_side>(obj[CFG_SIDE].toInt());
+    element_texture::load(desc);
+    m_button_mode = desc.trigger_mode;
+    m_side = static_cast<element_side>(desc.side);
     m_keycode = VC_TRIGGER_DATA;
     m_pressed = m_mapping;
     m_pressed.y = m_mapping.y + m_mapping.cy + CFG_INNER_BORDER;
     if (!m_button_mode)
-        m_direction = static_cast<direction>(obj[CFG_DIRECTION].toInt());
+        m_direction = static_cast<direction>(desc.direction);
 }
 
 void element_trigger::draw(gs_effect_t *effect, gs_image_file_t *image, sources::overlay_settings *settings)
 {
     auto progress = 0.f;
 
+    /* Response curve is already applied, see axis_response */
     switch (m_side) {
     case element_side::LEFT:
-        progress = settings->data.gamepad_axis[gamepad::axis::LEFT_TRIGGER];
+        progress = settings->axes.trigger[0];
         break;
     case element_side::RIGHT:
-        progress = settings->data.gamepad_axis[gamepad::axis::RIGHT_TRIGGER];
+        progress = settings->axes.trigger[1];
         break;
     default:;
     }
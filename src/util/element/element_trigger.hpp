@@ -24,7 +24,7 @@ class element_trigger : public element_texture {
 public:
     element_trigger();
 
-    void load(const QJsonObject &obj) override;
+    void load(const element_desc &desc) override;
 
     void draw(gs_effect_t *effect, gs_image_file_t *image, sources::overlay_settings *settings) override;
 
@@ -0,0 +1,209 @@
+/*************************************************************************
+ * This file is part of input-overlay
+ * github.con/univrsal/input-overlay
+ * Copyright 2022 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#include "glyph_atlas.hpp"
+#include "log.h"
+#include "element/element_texture.hpp"
+#include <keycodes.h>
+#include <obs-module.h>
+#include <QFont>
+#include <QFontMetrics>
+#include <QImage>
+#include <QPainter>
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <layout_constants.h>
+
+extern "C" {
+#include <graphics/image-file.h>
+}
+
+#define GLYPH_PADDING 8 /* Left and right of the label */
+
+struct label {
+    uint16_t code;
+    const char *text;
+};
+
+/* clang-format off */
+static const label labels[] = {
+    {VC_ESCAPE, "Esc"}, {VC_F1, "F1"}, {VC_F2, "F2"}, {VC_F3, "F3"}, {VC_F4, "F4"}, {VC_F5, "F5"}, {VC_F6, "F6"},
+    {VC_F7, "F7"}, {VC_F8, "F8"}, {VC_F9, "F9"}, {VC_F10, "F10"}, {VC_F11, "F11"}, {VC_F12, "F12"},
+    {VC_BACKQUOTE, "`"}, {VC_1, "1"}, {VC_2, "2"}, {VC_3, "3"}, {VC_4, "4"}, {VC_5, "5"}, {VC_6, "6"}, {VC_7, "7"},
+    {VC_8, "8"}, {VC_9, "9"}, {VC_0, "0"}, {VC_MINUS, "-"}, {VC_EQUALS, "="}, {VC_BACKSPACE, "Backspace"},
+    {VC_TAB, "Tab"}, {VC_CAPS_LOCK, "Caps"},
+    {VC_A, "A"}, {VC_B, "B"}, {VC_C, "C"}, {VC_D, "D"}, {VC_E, "E"}, {VC_F, "F"}, {VC_G, "G"}, {VC_H, "H"},
+    {VC_I, "I"}, {VC_J, "J"}, {VC_K, "K"}, {VC_L, "L"}, {VC_M, "M"}, {VC_N, "N"}, {VC_O, "O"}, {VC_P, "P"},
+    {VC_Q, "Q"}, {VC_R, "R"}, {VC_S, "S"}, {VC_T, "T"}, {VC_U, "U"}, {VC_V, "V"}, {VC_W, "W"}, {VC_X, "X"},
+    {VC_Y, "Y"}, {VC_Z, "Z"},
+    {VC_OPEN_BRACKET, "["}, {VC_CLOSE_BRACKET, "]"}, {VC_BACK_SLASH, "\\"}, {VC_SEMICOLON, ";"}, {VC_QUOTE, "'"},
+    {VC_ENTER, "Enter"}, {VC_COMMA, ","}, {VC_PERIOD, "."}, {VC_SLASH, "/"}, {VC_SPACE, "Space"},
+    {VC_PRINTSCREEN, "Print"}, {VC_SCROLL_LOCK, "Scroll"}, {VC_PAUSE, "Pause"},
+    {VC_INSERT, "Ins"}, {VC_DELETE, "Del"}, {VC_HOME, "Home"}, {VC_END, "End"}, {VC_PAGE_UP, "PgUp"},
+    {VC_PAGE_DOWN, "PgDn"}, {VC_UP, "Up"}, {VC_LEFT, "Left"}, {VC_RIGHT, "Right"}, {VC_DOWN, "Down"},
+    {VC_NUM_LOCK, "Num"}, {VC_KP_DIVIDE, "Num /"}, {VC_KP_MULTIPLY, "Num *"}, {VC_KP_SUBTRACT, "Num -"},
+    {VC_KP_ADD, "Num +"}, {VC_KP_ENTER, "Num Enter"}, {VC_KP_SEPARATOR, "Num ."}, {VC_KP_0, "Num 0"},
+    {VC_KP_1, "Num 1"}, {VC_KP_2, "Num 2"}, {VC_KP_3, "Num 3"}, {VC_KP_4, "Num 4"}, {VC_KP_5, "Num 5"},
+    {VC_KP_6, "Num 6"}, {VC_KP_7, "Num 7"}, {VC_KP_8, "Num 8"}, {VC_KP_9, "Num 9"},
+    {VC_SHIFT_L, "Shift"}, {VC_SHIFT_R, "Shift"}, {VC_CONTROL_L, "Ctrl"}, {VC_CONTROL_R, "Ctrl"},
+    {VC_ALT_L, "Alt"}, {VC_ALT_R, "AltGr"}, {VC_META_L, "Win"}, {VC_META_R, "Win"}, {VC_CONTEXT_MENU, "Menu"},
+    {VC_MOUSE_BUTTON1, "LMB"}, {VC_MOUSE_BUTTON2, "RMB"}, {VC_MOUSE_BUTTON3, "MMB"}, {VC_MOUSE_BUTTON4, "M4"},
+    {VC_MOUSE_BUTTON5, "M5"},
+};
+/* clang-format on */
+
+static std::mutex atlas_mutex;
+static std::weak_ptr<glyph_atlas> shared_atlas;
+
+glyph_atlas::glyph_atlas() : m_image(std::make_unique<gs_image_file_t>()) {}
+
+glyph_atlas::~glyph_atlas()
+{
+    if (m_image->texture) {
+        obs_enter_graphics();
+        gs_texture_destroy(m_image->texture);
+        obs_leave_graphics();
+    }
+}
+
+std::shared_ptr<glyph_atlas> glyph_atlas::acquire()
+{
+    /* Held while rasterizing, so sources loading at the same time share the result */
+    std::lock_guard<std::mutex> lock(atlas_mutex);
+    if (auto atlas = shared_atlas.lock())
+        return atlas;
+
+    std::shared_ptr<glyph_atlas> atlas(new glyph_atlas());
+    if (!atlas->rasterize())
+        atlas->m_failed = true;
+    shared_atlas = atlas;
+    return atlas;
+}
+
+bool glyph_atlas::rasterize()
+{
+    QFont font;
+    font.setPixelSize(GLYPH_FONT_SIZE);
+    font.setBold(true);
+    const QFontMetrics metrics(font);
+
+    /* Glyphs are packed into rows, labels get a key background and are at least square */
+    struct glyph {
+        QString text;
+        gs_rect rect;
+        bool key;
+    };
+    std::vector<glyph> placed;
+    int x = 0, y = 0;
+    const auto place = [&](const QString &text, bool key) {
+        const auto advance = metrics.horizontalAdvance(text);
+        const auto width = key ? std::max(GLYPH_HEIGHT, advance + 2 * GLYPH_PADDING) : advance;
+        if (x > 0 && x + width > GLYPH_ATLAS_WIDTH) {
+            x = 0;
+            y += GLYPH_HEIGHT + CFG_INNER_BORDER;
+        }
+        placed.push_back({text, gs_rect{x, y, width, GLYPH_HEIGHT}, key});
+        x += width + CFG_INNER_BORDER;
+        return placed.back().rect;
+    };
+
+    for (const auto &l : labels)
+        m_glyphs[l.code] = place(QString::fromUtf8(l.text), true);
+    m_unknown = place("?", true);
+    for (int d = 0; d < 10; d++)
+        m_digits[d] = place(QString::number(d), false);
+
+    QImage image(GLYPH_ATLAS_WIDTH, y + GLYPH_HEIGHT, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::transparent);
+    {
+        QPainter painter(&image);
+        painter.setRenderHint(QPainter::Antialiasing);
+        painter.setFont(font);
+        for (const auto &g : placed) {
+            const QRect rect(g.rect.x, g.rect.y, g.rect.cx, g.rect.cy);
+            if (g.key) {
+                painter.setPen(Qt::NoPen);
+                painter.setBrush(QColor(0, 0, 0, 170));
+                painter.drawRoundedRect(QRectF(rect).adjusted(0.5, 0.5, -0.5, -0.5), 6, 6);
+            }
+            painter.setPen(Qt::white);
+            painter.drawText(rect, Qt::AlignCenter, g.text);
+        }
+    }
+
+    /* Straight alpha in R, G, B, A byte order, which is what GS_RGBA expects */
+    image = image.convertToFormat(QImage::Format_RGBA8888);
+    if (image.isNull()) {
+        berr("Couldn't rasterize the input history labels");
+        return false;
+    }
+    m_pixels.resize(size_t(image.width()) * image.height() * 4);
+    for (int row = 0; row < image.height(); row++)
+        memcpy(m_pixels.data() + size_t(row) * image.width() * 4, image.constScanLine(row), size_t(image.width()) * 4);
+    m_image->cx = uint32_t(image.width());
+    m_image->cy = uint32_t(image.height());
+    bdebug("Rasterized %zu glyphs into %ux%u", placed.size(), m_image->cx, m_image->cy);
+    return true;
+}
+
+gs_image_file_t *glyph_atlas::image()
+{
+    if (m_image->texture)
+        return m_image.get();
+    if (m_failed)
+        return nullptr;
+
+    const auto *data = m_pixels.data();
+    m_image->texture = gs_texture_create(m_image->cx, m_image->cy, GS_RGBA, 1, &data, 0);
+    if (!m_image->texture) {
+        berr("Couldn't create the input history label texture");
+        m_failed = true;
+        return nullptr;
+    }
+    m_image->format = GS_RGBA;
+    m_image->loaded = true;
+    m_pixels.clear();
+    m_pixels.shrink_to_fit();
+    return m_image.get();
+}
+
+const gs_rect *glyph_atlas::find(uint16_t code) const
+{
+    const auto it = m_glyphs.find(code);
+    return it == m_glyphs.end() ? &m_unknown : &it->second;
+}
+
+void glyph_atlas::draw(gs_effect_t *effect, gs_image_file_t *overlay_image, const gs_rect *const *rects, const vec2 *pos,
+                       size_t count)
+{
+    auto *glyphs = image();
+    if (!glyphs || !count)
+        return;
+    auto *overlay_batch = sprite_batch::current();
+    if (overlay_batch)
+        overlay_batch->end(effect);
+
+    m_batch.begin(glyphs);
+    for (size_t i = 0; i < count; i++)
+        element_texture::draw(effect, glyphs, rects[i], &pos[i]);
+    m_batch.end(effect);
+
+    if (overlay_batch)
+        overlay_batch->begin(overlay_image);
+}
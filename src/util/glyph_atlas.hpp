@@ -0,0 +1,79 @@
+/*************************************************************************
+ * This file is part of input-overlay
+ * github.con/univrsal/input-overlay
+ * Copyright 2022 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#pragma once
+
+#include "sprite_batch.hpp"
+#include <graphics/graphics.h>
+#include <graphics/vec2.h>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+typedef struct gs_image_file gs_image_file_t;
+
+/* Glyph height and the size labels are drawn with, in pixels */
+#define GLYPH_HEIGHT 32
+#define GLYPH_FONT_SIZE 16
+#define GLYPH_ATLAS_WIDTH 1024
+
+/* Labels of keys and mouse buttons and plain digits rasterized once with
+ * Qt into one texture, so elements draw text as sprites instead of
+ * through a text source. All sources share one atlas, the last reference
+ * frees the texture */
+class glyph_atlas {
+public:
+    ~glyph_atlas();
+
+    glyph_atlas(const glyph_atlas &) = delete;
+    glyph_atlas &operator=(const glyph_atlas &) = delete;
+
+    /* Rasterizes the labels if no atlas exists yet, the texture is only
+     * created by image. Can be called from any thread */
+    static std::shared_ptr<glyph_atlas> acquire();
+
+    /* Uploads the texture on first use, nullptr if that failed. Graphics
+     * context has to be entered */
+    gs_image_file_t *image();
+
+    /* Label of a key or mouse button (VC_MOUSE_BUTTON1 etc.), codes
+     * without a label get a placeholder */
+    const gs_rect *find(uint16_t code) const;
+
+    /* Digit 0 - 9 without a key background */
+    const gs_rect *digit(int d) const { return &m_digits[d]; }
+
+    /* Draws glyphs in the middle of an element table draw. Glyphs come from
+     * another texture than the overlay, so the overlay batch is drawn first,
+     * the glyphs get their own batch and the overlay batch is started again
+     * for the elements after. Only used on the graphics thread */
+    void draw(gs_effect_t *effect, gs_image_file_t *overlay_image, const gs_rect *const *rects, const vec2 *pos,
+              size_t count);
+
+private:
+    glyph_atlas();
+    bool rasterize();
+
+    std::unique_ptr<gs_image_file_t> m_image;
+    std::vector<uint8_t> m_pixels; /* RGBA, freed once uploaded */
+    std::unordered_map<uint16_t, gs_rect> m_glyphs;
+    gs_rect m_unknown = {};
+    gs_rect m_digits[10] = {};
+    sprite_batch m_batch;
+    bool m_failed = false;
+};
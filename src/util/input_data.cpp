@@ -18,43 +18,190 @@
 
 #include "input_data.hpp"
 #include "log.h"
+#include "timer_wheel.hpp"
+#include <algorithm>
+#include <thread>
+#include <util/platform.h>
+
+static_assert(gamepad::axis::LEFT_STICK_X < PAD_AXIS_COUNT && gamepad::axis::LEFT_STICK_Y < PAD_AXIS_COUNT &&
+                  gamepad::axis::RIGHT_STICK_X < PAD_AXIS_COUNT && gamepad::axis::RIGHT_STICK_Y < PAD_AXIS_COUNT &&
+                  gamepad::axis::LEFT_TRIGGER < PAD_AXIS_COUNT && gamepad::axis::RIGHT_TRIGGER < PAD_AXIS_COUNT,
+              "PAD_AXIS_COUNT has to cover all gamepad axis codes");
 
 namespace local_data {
-std::mutex data_mutex;
 input_data data;
 }
 
-void input_data::copy(const input_data *other)
+namespace input_cache {
+const input_state empty{};
+const frame_events no_events{};
+
+static std::unordered_map<std::string, snapshot> snapshots;
+
+static bool clear_events(frame_events &events)
+{
+    if (!events.count)
+        return false;
+    /* Nothing was set if no events came in */
+    events.keys_pressed.clear();
+    events.buttons_pressed.clear();
+    events.count = 0;
+    return true;
+}
+
+static void read_events(snapshot &entry, const input_data *source)
 {
-    keyboard = other->keyboard;
-    mouse = other->mouse;
-    gamepad_buttons = other->gamepad_buttons;
-    gamepad_axis = other->gamepad_axis;
-    last_key_pressed = other->last_key_pressed;
-    last_key_released = other->last_key_released;
-    last_key_typed = other->last_key_typed;
-    last_mouse_pressed = other->last_mouse_pressed;
-    last_mouse_dragged = other->last_mouse_dragged;
-    last_mouse_movement = other->last_mouse_movement;
-    last_wheel_event = other->last_wheel_event;
-    last_mouse_released = other->last_mouse_released;
-    last_axis_event = other->last_axis_event;
-    last_button_event = other->last_button_event;
+    auto &events = entry.events;
+    events.count = source->history.read(entry.history_cursor, events.events, EVENT_HISTORY_SIZE, events.dropped);
+
+    for (size_t i = 0; i < events.count; i++) {
+        const auto &event = events.events[i].event;
+        if (event.type == EVENT_KEY_PRESSED)
+            events.keys_pressed.set(event.data.keyboard.keycode, true);
+        else if (event.type == EVENT_MOUSE_PRESSED)
+            events.buttons_pressed.set(event.data.mouse.button, true);
+    }
 }
 
-void input_data::dispatch_uiohook_event(const uiohook_event *event)
+snapshot *get(const std::string &id, const input_data *source, uint64_t frame_time, bool &refreshed,
+              uint8_t channels)
 {
-    std::lock_guard<std::mutex> lock(m_mutex);
+    /* Entries are never erased, there's only one per client name */
+    auto &entry = snapshots[id];
+    refreshed = entry.frame_time != frame_time;
+    if (refreshed) {
+        entry.frame_time = frame_time;
+        const uint8_t wanted = entry.wanted ? entry.wanted : channels;
+        entry.wanted = 0;
+        if (clear_events(entry.events))
+            entry.version++; /* Short presses of the last frame have to disappear again */
+
+        const auto generation = source->generation();
+        if (entry.source != source || !(wanted & IC_EVENTS)) {
+            /* Only events from now on are relevant for the new source */
+            entry.history_cursor = source->history.head();
+        } else if (entry.generation != generation) {
+            read_events(entry, source);
+        }
+
+        if (entry.source != source || entry.generation != generation || (wanted & ~entry.copied)) {
+            source->read(entry.state, wanted);
+            entry.generation = generation;
+            entry.source = source;
+            entry.version++;
+        }
+        entry.copied = wanted;
+    }
+
+    entry.wanted |= channels;
+    if ((channels & IC_KEYBOARD) && !(entry.copied & IC_KEYBOARD)) {
+        source->read(entry.state, entry.copied | channels);
+        entry.copied |= channels;
+        entry.version++;
+    }
+    return &entry;
+}
+}
+
+void event_history::push(const uiohook_event &event, uint64_t time)
+{
+    const auto head = m_head.load(std::memory_order_relaxed);
+    auto &slot = m_events[head & (EVENT_HISTORY_SIZE - 1)];
+    slot.time = time;
+    slot.event = event;
+    m_head.store(head + 1, std::memory_order_release);
+}
+
+size_t event_history::read(uint64_t &cursor, timed_event *out, size_t max, uint64_t &dropped) const
+{
+    auto head = this->head();
+    auto begin = cursor;
+    if (head - begin > EVENT_HISTORY_SIZE) {
+        dropped += head - begin - EVENT_HISTORY_SIZE;
+        begin = head - EVENT_HISTORY_SIZE;
+    }
+    if (head - begin > max) {
+        /* Keep the newest events */
+        dropped += head - begin - max;
+        begin = head - max;
+    }
+
+    size_t count = 0;
+    for (auto i = begin; i < head; i++)
+        out[count++] = m_events[i & (EVENT_HISTORY_SIZE - 1)];
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    /* The writer might have lapped us while copying, the slot of the event at
+     * new_head - EVENT_HISTORY_SIZE could be half written at this point */
+    const auto new_head = m_head.load(std::memory_order_relaxed);
+    size_t skip = 0;
+    if (new_head - begin >= EVENT_HISTORY_SIZE)
+        skip = size_t(std::min<uint64_t>(new_head - begin - EVENT_HISTORY_SIZE + 1, count));
+    if (skip) {
+        memmove(out, out + skip, (count - skip) * sizeof(timed_event));
+        count -= skip;
+        dropped += skip;
+    }
+
+    cursor = head;
+    return count;
+}
+
+void input_data::begin_write()
+{
+    m_mutex.lock();
+    m_sequence.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+void input_data::end_write()
+{
+    m_sequence.fetch_add(1, std::memory_order_release);
+    bump_generation();
+    m_mutex.unlock();
+}
+
+void input_data::read(input_state &out, uint8_t channels) const
+{
+    /* The keyboard is most of the state, sources without keyboard elements skip it */
+    const auto size = (channels & IC_KEYBOARD) ? sizeof(input_state) : offsetof(input_state, keyboard);
+    for (;;) {
+        const auto begin = m_sequence.load(std::memory_order_acquire);
+        if (begin & 1u) {
+            /* Writer is in the middle of an update, which only takes a few stores */
+            std::this_thread::yield();
+            continue;
+        }
+
+        memcpy(static_cast<void *>(&out), static_cast<const input_state *>(this), size);
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        if (m_sequence.load(std::memory_order_relaxed) == begin)
+            break;
+    }
+}
+
+void input_data::reset_wheel()
+{
+    begin_write();
+    last_wheel_event = {};
+    end_write();
+}
+
+void input_data::dispatch_uiohook_event(const uiohook_event *event, uint64_t captured)
+{
+    begin_write();
+    history.push(*event, captured);
     last_event = *event;
 
     switch (event->type) {
     case EVENT_KEY_PRESSED:
         last_key_pressed = event->data.keyboard;
-        keyboard[event->data.keyboard.keycode] = true;
+        keyboard.set(event->data.keyboard.keycode, true);
         break;
     case EVENT_KEY_RELEASED:
         last_key_released = event->data.keyboard;
-        keyboard[event->data.keyboard.keycode] = false;
+        keyboard.set(event->data.keyboard.keycode, false);
         break;
     case EVENT_KEY_TYPED:
         last_key_typed = event->data.keyboard;
@@ -64,11 +211,11 @@ void input_data::dispatch_uiohook_event(const uiohook_event *event)
         break;
     case EVENT_MOUSE_PRESSED:
         last_mouse_pressed = event->data.mouse;
-        mouse[event->data.mouse.button] = true;
+        mouse.set(event->data.mouse.button, true);
         break;
     case EVENT_MOUSE_RELEASED:
         last_mouse_released = event->data.mouse;
-        mouse[event->data.mouse.button] = false;
+        mouse.set(event->data.mouse.button, false);
         break;
     case EVENT_MOUSE_CLICKED:
         last_mouse_clicked = event->data.mouse;
@@ -81,4 +228,9 @@ void input_data::dispatch_uiohook_event(const uiohook_event *event)
         break;
     default:;
     }
+    end_write();
+
+    /* Outside of the write lock, the timer takes it again to reset the wheel */
+    if (event->type == EVENT_MOUSE_WHEEL)
+        timers::arm(m_wheel_timer, SCROLL_TIMEOUT);
 }
@@ -18,20 +18,171 @@
 
 #pragma once
 
-#include <map>
+#include "trace.hpp"
+#include "timer_wheel.hpp"
 #include <mutex>
+#include <string>
+#include <unordered_map>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <cstddef>
+#include <type_traits>
 #include <uiohook.h>
+#include <keycodes.h>
 #include <libgamepad.hpp>
 
-/* Holds all input data for a computer, local or remote */
-struct input_data {
-    std::mutex m_mutex;
+/* Dense on/off state for N codes. Lookups are a shift and a mask, copies are
+ * a plain memcpy and there are no heap allocations. Out of range codes read
+ * as released and writes to them are ignored */
+template<size_t N> class input_bitset {
+    static constexpr size_t word_bits = 64;
+    uint64_t m_words[(N + word_bits - 1) / word_bits]{};
 
-    /* State of all keyboard keys*/
-    std::map<uint16_t, bool> keyboard{};
+public:
+    static constexpr size_t size() { return N; }
 
+    bool get(size_t code) const
+    {
+        if (code >= N)
+            return false;
+        return (m_words[code / word_bits] >> (code % word_bits)) & 1u;
+    }
+
+    void set(size_t code, bool state)
+    {
+        if (code >= N)
+            return;
+        const auto bit = uint64_t(1) << (code % word_bits);
+        if (state)
+            m_words[code / word_bits] |= bit;
+        else
+            m_words[code / word_bits] &= ~bit;
+    }
+
+    bool operator[](size_t code) const { return get(code); }
+
+    void clear() { memset(m_words, 0, sizeof(m_words)); }
+
+    /* Calls f(code) for every set code, skips empty words */
+    template<class F> void for_each(F f) const
+    {
+        for (size_t i = 0; i < sizeof(m_words) / sizeof(m_words[0]); i++) {
+            for (auto word = m_words[i]; word; word &= word - 1) {
+                size_t bit = 0;
+                while (!((word >> bit) & 1u))
+                    bit++;
+                f(i * word_bits + bit);
+            }
+        }
+    }
+};
+
+/* Key codes and gamepad codes (VC_PAD_MASK | n) span the full 16 bit range,
+ * uiohook only reports a handful of mouse buttons */
+typedef input_bitset<0x10000> key_state;
+typedef input_bitset<0x100> mouse_state;
+
+/* Gamepad axis codes (gamepad::axis::*) are small and dense */
+#define PAD_AXIS_COUNT 32
+
+/* Fixed size axis values indexed by axis code, out of range codes read as
+ * zero and writes to them are ignored */
+class axis_state {
+    float m_values[PAD_AXIS_COUNT]{};
+
+public:
+    float get(size_t code) const { return code < PAD_AXIS_COUNT ? m_values[code] : 0.f; }
+
+    void set(size_t code, float value)
+    {
+        if (code < PAD_AXIS_COUNT)
+            m_values[code] = value;
+    }
+
+    float operator[](size_t code) const { return get(code); }
+
+    void clear() { memset(m_values, 0, sizeof(m_values)); }
+};
+
+/* Gamepad button codes are VC_PAD_MASK | n with a small n, so they fit into
+ * 256 bits instead of the 8 KiB a key_state takes. Other codes read as
+ * released and writes to them are ignored */
+class pad_button_state {
+    input_bitset<0x100> m_bits;
+
+    static bool is_pad(size_t code) { return (code & ~size_t(0xff)) == VC_PAD_MASK; }
+
+public:
+    bool get(size_t code) const { return is_pad(code) && m_bits.get(code & 0xff); }
+
+    void set(size_t code, bool state)
+    {
+        if (is_pad(code))
+            m_bits.set(code & 0xff, state);
+    }
+
+    bool operator[](size_t code) const { return get(code); }
+
+    void clear() { m_bits.clear(); }
+};
+
+/* Parts of the input a layout reads, derived from its elements and flags
+ * when it's loaded. Sources only copy what their layout needs */
+enum input_channel : uint8_t {
+    IC_KEYBOARD = 1 << 0,
+    IC_MOUSE = 1 << 1,
+    IC_EVENTS = 1 << 2, /* Events of the frame, for presses shorter than a frame and the history */
+    IC_PAD_BUTTONS = 1 << 3,
+    IC_PAD_AXES = 1 << 4,
+    IC_ALL = 0x1f
+};
+
+/* The gamepad state a source draws, copied from its selected device. The
+ * times of the last events are in ms on the os_gettime_ns() clock like the
+ * uiohook events */
+struct pad_view {
+    axis_state axis{};
+    pad_button_state buttons{};
+    gamepad::input_event last_axis_event{};
+    gamepad::input_event last_button_event{};
+};
+
+/* Ns after the last scroll event until the wheel goes back to idle */
+#define SCROLL_TIMEOUT 120000000
+
+/* Number of uiohook events kept per computer, has to be a power of two */
+#define EVENT_HISTORY_SIZE 256
+
+struct timed_event {
+    uint64_t time; /* os_gettime_ns() when the event was captured */
+    uiohook_event event;
+};
+
+/* Fixed size ring of the most recent events. There is only one writer at a
+ * time (see input_data::m_mutex), readers keep their own cursor and never
+ * block the writer. Events a reader didn't pick up in time are overwritten
+ * and counted as dropped */
+class event_history {
+    timed_event m_events[EVENT_HISTORY_SIZE]{};
+    std::atomic<uint64_t> m_head{0}; /* Total number of events pushed */
+
+public:
+    void push(const uiohook_event &event, uint64_t time);
+
+    uint64_t head() const { return m_head.load(std::memory_order_acquire); }
+
+    /* Copies up to max events that came after cursor into out and moves the
+     * cursor past them. Returns the number of events copied, dropped is
+     * increased by the number of events that were overwritten */
+    size_t read(uint64_t &cursor, timed_event *out, size_t max, uint64_t &dropped) const;
+};
+
+/* Keyboard and mouse state, trivially copyable so readers can take a
+ * snapshot of it without holding any lock */
+struct input_state {
     /* State of all mouse buttons */
-    std::map<uint16_t, bool> mouse{};
+    mouse_state mouse{};
 
     /* Last uiohook events */
     keyboard_event_data last_key_pressed{}, last_key_released{}, last_key_typed{};
@@ -40,19 +191,96 @@ struct input_data {
     mouse_wheel_event_data last_wheel_event{};
     uiohook_event last_event{};
 
-    /* Gamepad data */
-    std::map<uint16_t, float> gamepad_axis{};
-    std::map<uint16_t, bool> gamepad_buttons{};
-    gamepad::input_event last_axis_event{};
-    gamepad::input_event last_button_event{};
+    /* State of all keyboard keys, last so copies without IC_KEYBOARD can stop before it */
+    key_state keyboard{};
+};
+
+static_assert(std::is_trivially_copyable<input_state>::value && std::is_standard_layout<input_state>::value,
+              "input_state is copied while it is being written to");
+
+/* Holds all input data for a computer, local or remote.
+ * The input_state part is guarded by a sequence lock: the input thread
+ * (uiohook or network) bumps m_sequence to an odd value while writing and
+ * back to an even value when done, readers retry their copy if the sequence
+ * changed in the meantime. Neither side waits on the other */
+struct input_data : input_state {
+    /* Only serializes writers, readers never take it */
+    IO_TRACED_MUTEX(m_mutex, "input_data::m_mutex");
+    std::atomic<uint32_t> m_sequence{0};
+
+    /* Increased on every change to the keyboard, mouse or gamepad state of
+     * this computer, so readers can skip work if nothing happened */
+    std::atomic<uint64_t> m_generation{0};
+
+    /* Every uiohook event, so presses shorter than a frame aren't lost */
+    event_history history;
 
-    /* Mutex needs to be locked */
-    void copy(const input_data *other);
+    /* Lock free copy of the input_state part, the keyboard is only copied
+     * with IC_KEYBOARD. Gamepad state stays in the devices */
+    void read(input_state &out, uint8_t channels = IC_ALL) const;
 
-    void dispatch_uiohook_event(const uiohook_event *event);
+    /* captured is when the event was captured, on the os_gettime_ns() clock */
+    void dispatch_uiohook_event(const uiohook_event *event, uint64_t captured);
+
+    /* Clears the last wheel event, called by a timer SCROLL_TIMEOUT after
+     * the last scroll and for clients that still send MSG_MOUSE_WHEEL_RESET */
+    void reset_wheel();
+
+    uint64_t generation() const { return m_generation.load(std::memory_order_acquire); }
+
+    /* Has to be called by the gamepad write paths, uiohook events do it on their own */
+    void bump_generation() { m_generation.fetch_add(1, std::memory_order_release); }
+
+private:
+    void begin_write();
+    void end_write();
+
+    /* Calls reset_wheel, last so it's cancelled before anything else goes */
+    timers::timer m_wheel_timer{[](void *data) { static_cast<input_data *>(data)->reset_wheel(); }, this};
 };
 
 namespace local_data {
-extern std::mutex data_mutex;
 extern input_data data;
 }
+
+/* Per frame snapshots of the input state, shared by all sources that read
+ * the same computer, so the copy only happens once per frame no matter how
+ * many sources there are. Only used on the graphics thread */
+namespace input_cache {
+extern const input_state empty;
+
+/* Events that arrived since the previous frame */
+struct frame_events {
+    timed_event events[EVENT_HISTORY_SIZE]{};
+    size_t count = 0;
+    uint64_t dropped = 0; /* Events that were overwritten before they were read, in total */
+
+    /* Keys and buttons that went down at some point during the frame, even
+     * if they were already released again */
+    key_state keys_pressed{};
+    mouse_state buttons_pressed{};
+};
+
+extern const frame_events no_events;
+
+struct snapshot {
+    input_state state{};
+    frame_events events{};
+    uint64_t history_cursor = 0;
+    uint64_t version = 0; /* Increased whenever state changes */
+    uint64_t frame_time = 0;
+    uint64_t generation = 0;
+    const input_data *source = nullptr;
+    uint8_t copied = 0; /* Channels state and events were copied with */
+    uint8_t wanted = 0; /* Channels the sources asked for in this frame, copied in the next one */
+};
+
+/* Returns the snapshot for id ("" for local input or the client name).
+ * refreshed is set to true for the first call in a frame, the state is only
+ * copied again if the generation of source changed. The events are reset for
+ * every frame. Only the channels the sources asked for in the last frame are
+ * copied, a source asking for more than that gets the keyboard copied right
+ * away and the events from the next frame on */
+snapshot *get(const std::string &id, const input_data *source, uint64_t frame_time, bool &refreshed,
+              uint8_t channels = IC_ALL);
+}
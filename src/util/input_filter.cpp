@@ -21,19 +21,21 @@
 #include "obs_util.hpp"
 #include "log.h"
 #include "settings.h"
+#include "window_helper.hpp"
 #include <QJsonArray>
 #include <QRegularExpression>
 #include <util/config-file.h>
 
 void input_filter::read_from_config()
 {
-    io_config::filter_mutex.lock();
+    std::lock_guard<std::mutex> lock(io_config::filter_mutex);
     m_filters.clear();
     m_regex = CGET_BOOL(S_REGEX);
     m_whitelist = CGET_INT(S_FILTER_MODE) == 0;
     QJsonDocument j;
     if (!util_open_json(util_get_data_file("filters.json"), j)) {
         berr("Couldn't load filters.json");
+        compile();
         return;
     }
 
@@ -44,7 +46,7 @@ void input_filter::read_from_config()
             }
         }
     }
-    io_config::filter_mutex.unlock();
+    compile();
 }
 
 void input_filter::write_to_config()
@@ -63,25 +65,85 @@ void input_filter::write_to_config()
 
 void input_filter::add_filter(const char *filter)
 {
-    io_config::filter_mutex.lock();
+    std::lock_guard<std::mutex> lock(io_config::filter_mutex);
     m_filters.append(filter);
-    io_config::filter_mutex.unlock();
+    compile();
 }
 
 void input_filter::remove_filter(const int index)
 {
+    std::lock_guard<std::mutex> lock(io_config::filter_mutex);
     if (index >= 0 && index < m_filters.size())
         m_filters.removeAt(index);
+    compile();
 }
 
 void input_filter::set_regex(bool enabled)
 {
+    std::lock_guard<std::mutex> lock(io_config::filter_mutex);
     m_regex = enabled;
+    compile();
 }
 
 void input_filter::set_whitelist(bool wl)
 {
+    std::lock_guard<std::mutex> lock(io_config::filter_mutex);
     m_whitelist = wl;
+    m_cache_valid = false;
+    m_cached_version = 0;
+}
+
+void input_filter::compile()
+{
+    m_exact.clear();
+    m_regexes.clear();
+    m_combined = QRegularExpression();
+    m_cache_valid = false;
+    m_cached_version = 0;
+
+    QStringList patterns;
+    for (const auto &filter : m_filters) {
+        m_exact.emplace(filter.toStdString());
+        if (!m_regex)
+            continue;
+        QRegularExpression regex(filter);
+        if (regex.isValid()) {
+            patterns.append(QString("(?:%1)").arg(filter));
+            m_regexes.emplace_back(std::move(regex));
+        } else {
+            bwarn("Ignoring invalid window filter regex '%s'", qt_to_utf8(filter));
+        }
+    }
+
+    if (patterns.isEmpty())
+        return;
+    m_combined.setPattern(patterns.join('|'));
+    if (m_combined.isValid()) {
+        m_combined.optimize();
+        m_regexes.clear();
+    } else {
+        /* e.g. numbered back references, which the alternation shifts */
+        m_combined = QRegularExpression();
+        for (auto &regex : m_regexes)
+            regex.optimize();
+    }
+}
+
+bool input_filter::matches(const std::string &title) const
+{
+    if (m_exact.count(title))
+        return true;
+    if (!m_regex)
+        return false;
+
+    const auto subject = QString::fromStdString(title);
+    if (!m_combined.pattern().isEmpty())
+        return m_combined.match(subject).hasMatch();
+    for (const auto &regex : m_regexes) {
+        if (regex.match(subject).hasMatch())
+            return true;
+    }
+    return false;
 }
 
 bool input_filter::input_blocked()
@@ -89,28 +151,35 @@ bool input_filter::input_blocked()
     if (!io_config::enable_input_control)
         return false;
 
-    io_config::filter_mutex.lock();
-    std::string current_window;
-    auto flag = m_whitelist;
-    GetCurrentWindowTitle(current_window);
-    const char *window_str = current_window.c_str();
-
-    for (const auto &filter : m_filters) {
-        if (filter == window_str) {
-            flag = !m_whitelist;
-            break;
-        }
+    StartWindowWatcher();
+    const auto version = GetWindowTitleVersion();
+    if (version && version == m_cached_version.load(std::memory_order_acquire))
+        return m_cached_blocked.load(std::memory_order_relaxed);
 
-        if (m_regex) {
-            QRegularExpression regex(filter);
-            if (regex.isValid() && regex.match(current_window.c_str()).hasMatch()) {
-                flag = !m_whitelist;
-                break;
-            }
-        }
+    std::string current_window;
+    if (version)
+        GetWatchedWindowTitle(current_window);
+    else
+        GetCurrentWindowTitle(current_window);
+
+    std::lock_guard<std::mutex> lock(io_config::filter_mutex);
+    if (!m_cache_valid || current_window != m_cached_title) {
+        m_cached_blocked = matches(current_window) ? !m_whitelist : m_whitelist;
+        m_cached_title = std::move(current_window);
+        m_cache_valid = true;
     }
-    io_config::filter_mutex.unlock();
-    return flag;
+    m_cached_version.store(version, std::memory_order_release);
+    return m_cached_blocked;
+}
+
+bool input_filter::input_blocked(uint64_t frame_time)
+{
+    if (frame_time && frame_time == m_frame_time.load(std::memory_order_acquire))
+        return m_frame_blocked.load(std::memory_order_relaxed);
+    const auto blocked = input_blocked();
+    m_frame_blocked.store(blocked, std::memory_order_relaxed);
+    m_frame_time.store(frame_time, std::memory_order_release);
+    return blocked;
 }
 
 QStringList &input_filter::filters()
@@ -19,12 +19,37 @@
 #pragma once
 
 #include <QStringList>
+#include <QRegularExpression>
+#include <atomic>
+#include <string>
+#include <unordered_set>
+#include <vector>
 
 class input_filter {
     QStringList m_filters;
     bool m_regex = false;
     bool m_whitelist = false;
 
+    /* Compiled from m_filters whenever they or the regex flag change */
+    std::unordered_set<std::string> m_exact;
+    QRegularExpression m_combined;             /* All valid regexes as one alternation */
+    std::vector<QRegularExpression> m_regexes; /* Only used if the alternation didn't compile */
+
+    /* The result only changes with the window title. With the window watcher
+     * running, checking the title version is enough and needs no lock */
+    std::string m_cached_title;
+    std::atomic<bool> m_cached_blocked{false};
+    std::atomic<uint64_t> m_cached_version{0};
+    bool m_cache_valid = false;
+
+    /* Decision for the current video frame, shared by all sources */
+    std::atomic<uint64_t> m_frame_time{0};
+    std::atomic<bool> m_frame_blocked{false};
+
+    /* filter_mutex has to be locked */
+    void compile();
+    bool matches(const std::string &title) const;
+
 public:
     ~input_filter();
 
@@ -42,5 +67,9 @@ public:
 
     bool input_blocked();
 
+    /* Same as input_blocked(), but only evaluated by the first caller of a
+     * video frame (obs_get_video_frame_time()), everyone else reuses it */
+    bool input_blocked(uint64_t frame_time);
+
     QStringList &filters();
 };
@@ -0,0 +1,181 @@
+/*************************************************************************
+ * This file is part of input-overlay
+ * github.con/univrsal/input-overlay
+ * Copyright 2022 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#include "input_hub.hpp"
+#include "trace.hpp"
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <util/platform.h>
+
+namespace input_hub {
+/* sequence is the position of the event + 1 once it's written, zero while
+ * it's being overwritten */
+struct slot {
+    std::atomic<uint64_t> sequence{0};
+    event e;
+};
+
+static slot ring[HUB_EVENT_COUNT];
+static std::atomic<uint64_t> head{0};
+/* Only serializes the producers, each holds it for one copy */
+static IO_TRACED_MUTEX(publish_mutex, "input_hub::publish_mutex");
+static std::atomic<void (*)()> listeners[HUB_MAX_LISTENERS]{};
+
+static std::mutex channel_mutex; /* Guards the names, never taken while publishing events */
+static std::vector<std::string> channel_names{"local"};
+static std::unordered_map<std::string, uint16_t> channel_ids{{"local", HUB_LOCAL}};
+static std::map<std::pair<uint16_t, uint8_t>, std::string> device_names;
+
+uint16_t channel(const std::string &name)
+{
+    std::lock_guard<std::mutex> lock(channel_mutex);
+    const auto it = channel_ids.find(name);
+    if (it != channel_ids.end())
+        return it->second;
+    const auto id = uint16_t(channel_names.size());
+    channel_names.emplace_back(name);
+    channel_ids.emplace(name, id);
+    return id;
+}
+
+std::string channel_name(uint16_t id)
+{
+    std::lock_guard<std::mutex> lock(channel_mutex);
+    return id < channel_names.size() ? channel_names[id] : std::string();
+}
+
+std::string device_name(uint16_t channel, uint8_t index)
+{
+    std::lock_guard<std::mutex> lock(channel_mutex);
+    const auto it = device_names.find({channel, index});
+    return it != device_names.end() ? it->second : std::string();
+}
+
+static void publish(const event &e)
+{
+    {
+        std::lock_guard<traced_mutex> lock(publish_mutex);
+        const auto position = head.load(std::memory_order_relaxed);
+        auto &s = ring[position & (HUB_EVENT_COUNT - 1)];
+        s.sequence.store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        s.e = e;
+        s.sequence.store(position + 1, std::memory_order_release);
+        head.store(position + 1, std::memory_order_release);
+    }
+
+    for (auto &l : listeners) {
+        if (auto *listener = l.load(std::memory_order_acquire))
+            listener();
+    }
+}
+
+void publish_uiohook(uint16_t channel, const uiohook_event &event, uint64_t captured)
+{
+    input_hub::event e;
+    e.time = captured;
+    e.channel = channel;
+    e.uiohook = event;
+    publish(e);
+}
+
+void publish_pad(uint16_t channel, uint8_t index, bool is_axis, const pad_input &input)
+{
+    event e;
+    e.time = os_gettime_ns();
+    e.channel = channel;
+    e.type = is_axis ? KIND_PAD_AXIS : KIND_PAD_BUTTON;
+    e.device_index = index;
+    e.pad = input;
+    publish(e);
+}
+
+void publish_pad_state(uint16_t channel, uint8_t index, kind type, const std::string &device)
+{
+    {
+        /* Set before publishing, so consumers never see the event without the name */
+        std::lock_guard<std::mutex> lock(channel_mutex);
+        device_names[{channel, index}] = device;
+    }
+    event e;
+    e.time = os_gettime_ns();
+    e.channel = channel;
+    e.type = type;
+    e.device_index = index;
+    e.pad.time = e.time / 1000000;
+    publish(e);
+}
+
+uint64_t published()
+{
+    return head.load(std::memory_order_relaxed);
+}
+
+bool add_listener(void (*listener)())
+{
+    for (auto &l : listeners) {
+        void (*empty)() = nullptr;
+        if (l.compare_exchange_strong(empty, listener))
+            return true;
+    }
+    return false;
+}
+
+void remove_listener(void (*listener)())
+{
+    for (auto &l : listeners) {
+        auto *expected = listener;
+        l.compare_exchange_strong(expected, nullptr);
+    }
+}
+
+cursor::cursor() : m_position(head.load(std::memory_order_acquire)) {}
+
+void cursor::skip()
+{
+    m_position = head.load(std::memory_order_acquire);
+}
+
+size_t cursor::read(event *out, size_t max)
+{
+    const auto newest = head.load(std::memory_order_acquire);
+    if (newest - m_position > HUB_EVENT_COUNT) {
+        m_dropped += newest - m_position - HUB_EVENT_COUNT;
+        m_position = newest - HUB_EVENT_COUNT;
+    }
+
+    size_t count = 0;
+    for (; m_position < newest && count < max; m_position++) {
+        auto &s = ring[m_position & (HUB_EVENT_COUNT - 1)];
+        const auto sequence = s.sequence.load(std::memory_order_acquire);
+        if (sequence == m_position + 1) {
+            out[count] = s.e;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            /* A producer might have lapped us while copying */
+            if (s.sequence.load(std::memory_order_relaxed) == sequence) {
+                count++;
+                continue;
+            }
+        }
+        m_dropped++;
+    }
+    return count;
+}
+}
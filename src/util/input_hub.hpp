@@ -0,0 +1,110 @@
+/*************************************************************************
+ * This file is part of input-overlay
+ * github.con/univrsal/input-overlay
+ * Copyright 2022 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <uiohook.h>
+
+#define HUB_EVENT_COUNT 8192 /* Events kept for all sources together, has to be a power of two */
+#define HUB_LOCAL 0          /* Channel of the local hooks, always called "local" */
+#define HUB_MAX_LISTENERS 4
+
+/* Every input event passes through here exactly once. Producers (the local
+ * hooks, remote clients and replays) publish each event into one shared ring,
+ * tagged with the channel of the source it came from. Consumers (websocket,
+ * recorder, stats) read the ring with their own cursor on their own thread,
+ * so they neither block the producers nor add work to them. Held state stays
+ * in each source's input_data, which is versioned through its generation,
+ * the overlay sources read it from there.
+ * Doesn't include libgamepad, mongoose has to see it */
+namespace input_hub {
+enum kind : uint8_t {
+    KIND_UIOHOOK,
+    KIND_PAD_AXIS,
+    KIND_PAD_BUTTON,
+    KIND_PAD_CONNECTED,
+    KIND_PAD_RECONNECTED,
+    KIND_PAD_DISCONNECTED
+};
+
+/* Copy of gamepad::input_event, see pad_input_of */
+struct pad_input {
+    uint64_t time; /* ms on the os_gettime_ns() clock */
+    uint16_t vc, native_id;
+    float virtual_value;
+    int32_t value;
+};
+
+template<class E> pad_input pad_input_of(const E &e)
+{
+    return {uint64_t(e.time), e.vc, e.native_id, e.virtual_value, e.value};
+}
+
+struct event {
+    uint64_t time = 0; /* os_gettime_ns() when it was captured or received */
+    uint16_t channel = HUB_LOCAL;
+    kind type = KIND_UIOHOOK;
+    uint8_t device_index = 0;
+    uiohook_event uiohook{}; /* Only for KIND_UIOHOOK */
+    pad_input pad{};         /* Only for KIND_PAD_AXIS and KIND_PAD_BUTTON */
+
+    bool is_pad_state() const { return type >= KIND_PAD_CONNECTED; }
+};
+
+/* Channel of a source name, it's registered the first time. Ids are never
+ * reused, so clients that reconnect keep theirs */
+uint16_t channel(const std::string &name);
+/* Empty for unknown ids */
+std::string channel_name(uint16_t id);
+/* Id of a gamepad as of its last connect event, empty if there was none */
+std::string device_name(uint16_t channel, uint8_t index);
+
+/* Producers, any thread. They only copy the event into the ring */
+void publish_uiohook(uint16_t channel, const uiohook_event &event, uint64_t captured);
+void publish_pad(uint16_t channel, uint8_t index, bool is_axis, const pad_input &input);
+/* type is one of the KIND_PAD_*CONNECTED */
+void publish_pad_state(uint16_t channel, uint8_t index, kind type, const std::string &device);
+
+/* Events published since the start */
+uint64_t published();
+
+/* Called after every publish, for consumers that sleep until there's
+ * something new. Has to be cheap, e.g. only wake the consumer up once */
+bool add_listener(void (*listener)());
+void remove_listener(void (*listener)());
+
+/* A consumer's position in the ring, only used by one thread. Starts at the
+ * newest event, events it doesn't read in time are overwritten and counted
+ * as dropped */
+class cursor {
+    uint64_t m_position;
+    uint64_t m_dropped = 0;
+
+public:
+    cursor();
+
+    /* Copies up to max events into out, oldest first, returns how many */
+    size_t read(event *out, size_t max);
+    /* Moves past everything that was published so far */
+    void skip();
+
+    uint64_t dropped() const { return m_dropped; }
+};
+}
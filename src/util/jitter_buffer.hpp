@@ -0,0 +1,90 @@
+/*************************************************************************
+ * This file is part of input-overlay
+ * github.con/univrsal/input-overlay
+ * Copyright 2022 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#pragma once
+
+#include "input_data.hpp"
+#include <cstddef>
+#include <cstdint>
+
+/* Number of samples kept, at 1000 axis updates per second that's enough for
+ * a delay of a bit over 60ms, anything older is dropped */
+#define JITTER_SAMPLES 64
+
+/* Gamepad axis values buffered by the time they were captured, so they can
+ * be drawn a fixed delay later at evenly spaced points in time, instead of
+ * whenever the network happens to deliver them */
+class axis_jitter_buffer {
+    struct sample {
+        uint64_t time; /* ms */
+        axis_state axes;
+    };
+
+    sample m_samples[JITTER_SAMPLES]{};
+    size_t m_first = 0, m_count = 0;
+
+    const sample &at(size_t i) const { return m_samples[(m_first + i) % JITTER_SAMPLES]; }
+
+public:
+    void clear() { m_first = m_count = 0; }
+
+    void push(uint64_t time, const axis_state &axes)
+    {
+        if (m_count) {
+            auto &last = m_samples[(m_first + m_count - 1) % JITTER_SAMPLES];
+            if (time < last.time)
+                return; /* Older than what we have, nothing sensible to do with it */
+            if (time == last.time) {
+                last.axes = axes;
+                return;
+            }
+        }
+        if (m_count == JITTER_SAMPLES) {
+            m_first = (m_first + 1) % JITTER_SAMPLES;
+            m_count--;
+        }
+        m_samples[(m_first + m_count++) % JITTER_SAMPLES] = {time, axes};
+    }
+
+    /* Axis values at time, interpolated between the two closest samples.
+     * Returns false if time is past the newest sample, out is the newest
+     * value then and won't change until the next push */
+    bool sample(uint64_t time, axis_state &out) const
+    {
+        if (!m_count)
+            return false;
+        if (time >= at(m_count - 1).time) {
+            out = at(m_count - 1).axes;
+            return false;
+        }
+        if (time <= at(0).time) {
+            out = at(0).axes;
+            return true;
+        }
+
+        size_t next = 1;
+        while (at(next).time <= time)
+            next++;
+        const auto &a = at(next - 1);
+        const auto &b = at(next);
+        const auto t = float(time - a.time) / float(b.time - a.time);
+        for (size_t i = 0; i < PAD_AXIS_COUNT; i++)
+            out.set(i, a.axes[i] + (b.axes[i] - a.axes[i]) * t);
+        return true;
+    }
+};
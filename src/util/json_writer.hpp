@@ -0,0 +1,163 @@
+/*************************************************************************
+ * This file is part of input-overlay
+ * github.con/univrsal/input-overlay
+ * Copyright 2022 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+
+/* Writes compact JSON straight into a string, so nothing goes through
+ * QJsonObject and UTF-16. Keys are written as they are and have to be plain
+ * ASCII without quotes or backslashes. Inside arrays a null name writes a
+ * value without key. Nothing checks that objects and arrays are balanced */
+class json_writer {
+    std::string &m_out;
+    bool m_first = true;
+
+    void key(const char *name)
+    {
+        if (!m_first)
+            m_out += ',';
+        m_first = false;
+        if (!name)
+            return;
+        m_out += '"';
+        m_out += name;
+        m_out += "\":";
+    }
+
+    json_writer &open(const char *name, char c)
+    {
+        key(name);
+        m_out += c;
+        m_first = true;
+        return *this;
+    }
+
+    json_writer &close(char c)
+    {
+        m_out += c;
+        m_first = false;
+        return *this;
+    }
+
+public:
+    /* out is cleared, keep it around between events so its memory is reused */
+    explicit json_writer(std::string &out) : m_out(out)
+    {
+        m_out.clear();
+        m_out += '{';
+    }
+
+    /* Has to be called once all fields are written */
+    const std::string &end()
+    {
+        m_out += '}';
+        return m_out;
+    }
+
+    json_writer &field(const char *name, int64_t value)
+    {
+        char tmp[24];
+        key(name);
+        m_out.append(tmp, size_t(snprintf(tmp, sizeof(tmp), "%lld", static_cast<long long>(value))));
+        return *this;
+    }
+
+    json_writer &begin_object(const char *name = nullptr) { return open(name, '{'); }
+    json_writer &end_object() { return close('}'); }
+    json_writer &begin_array(const char *name = nullptr) { return open(name, '['); }
+    json_writer &end_array() { return close(']'); }
+
+    json_writer &field(const char *name, bool value)
+    {
+        key(name);
+        m_out += value ? "true" : "false";
+        return *this;
+    }
+
+    json_writer &field(const char *name, int value) { return field(name, int64_t(value)); }
+    json_writer &field(const char *name, uint16_t value) { return field(name, int64_t(value)); }
+
+    /* Same precision as a float, which all values that are written are */
+    json_writer &field(const char *name, double value)
+    {
+        char tmp[32];
+        key(name);
+        m_out.append(tmp, size_t(snprintf(tmp, sizeof(tmp), "%.9g", value)));
+        return *this;
+    }
+
+    /* For values that need more than nine digits, like trace timestamps */
+    json_writer &field(const char *name, double value, int decimals)
+    {
+        char tmp[40];
+        key(name);
+        m_out.append(tmp, size_t(snprintf(tmp, sizeof(tmp), "%.*f", decimals, value)));
+        return *this;
+    }
+
+    /* value has to be UTF-8 */
+    json_writer &field(const char *name, std::string_view value)
+    {
+        static const char hex[] = "0123456789abcdef";
+        key(name);
+        m_out += '"';
+        for (const auto c : value) {
+            switch (c) {
+            case '"':
+                m_out += "\\\"";
+                break;
+            case '\\':
+                m_out += "\\\\";
+                break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    m_out += "\\u00";
+                    m_out += hex[(c >> 4) & 0xf];
+                    m_out += hex[c & 0xf];
+                } else {
+                    m_out += c;
+                }
+            }
+        }
+        m_out += '"';
+        return *this;
+    }
+
+    json_writer &field(const char *name, const char *value) { return field(name, std::string_view(value)); }
+    json_writer &field(const char *name, const std::string &value) { return field(name, std::string_view(value)); }
+
+    /* A single UTF-16 code unit, e.g. uiohook's keychar, as a one character string */
+    json_writer &char_field(const char *name, uint16_t value)
+    {
+        static const char hex[] = "0123456789abcdef";
+        if (value >= 0x20 && value < 0x80 && value != '"' && value != '\\') {
+            const char c = char(value);
+            return field(name, std::string_view(&c, 1));
+        }
+        key(name);
+        m_out += "\"\\u";
+        for (int shift = 12; shift >= 0; shift -= 4)
+            m_out += hex[(value >> shift) & 0xf];
+        m_out += '"';
+        return *this;
+    }
+};
@@ -0,0 +1,108 @@
+/*************************************************************************
+ * This file is part of input-overlay
+ * github.con/univrsal/input-overlay
+ * Copyright 2022 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#include "key_stats.hpp"
+#include <keycodes.h>
+#include <algorithm>
+
+/* Buckets start at second 1, so the zeroed stamps never count */
+static uint64_t to_second(uint64_t time)
+{
+    return time / 1000000000 + 1;
+}
+
+void key_stats::add(const uiohook_event &event, uint64_t time)
+{
+    switch (event.type) {
+    case EVENT_KEY_PRESSED:
+        press(event.data.keyboard.keycode, time);
+        break;
+    case EVENT_KEY_RELEASED:
+        release(event.data.keyboard.keycode, time);
+        break;
+    case EVENT_MOUSE_PRESSED:
+        press(uint16_t(event.data.mouse.button | VC_MOUSE_MASK), time);
+        break;
+    case EVENT_MOUSE_RELEASED:
+        release(uint16_t(event.data.mouse.button | VC_MOUSE_MASK), time);
+        break;
+    default:;
+    }
+}
+
+void key_stats::press(uint16_t code, uint64_t time)
+{
+    auto &k = m_keys[code];
+    if (k.held_since)
+        return; /* Repeat */
+    k.held_since = std::max<uint64_t>(time, 1);
+    k.presses++;
+    m_presses++;
+
+    const auto second = to_second(time);
+    if (!m_first_press)
+        m_first_press = second;
+    const auto i = second % STATS_WINDOW;
+    if (m_bucket_second[i] != second) {
+        m_bucket_second[i] = second;
+        m_buckets[i] = 0;
+    }
+    m_buckets[i]++;
+}
+
+void key_stats::release(uint16_t code, uint64_t time)
+{
+    const auto it = m_keys.find(code);
+    if (it == m_keys.end() || !it->second.held_since)
+        return; /* Pressed before the stats started */
+    auto &k = it->second;
+    const auto ms = time > k.held_since ? (time - k.held_since) / 1000000 : 0;
+    k.held_since = 0;
+    k.holds++;
+    k.hold_total += ms;
+
+    int bucket = 0;
+    while (bucket < STATS_HOLD_BUCKETS - 1 && ms >= hold_bucket_limit(bucket))
+        bucket++;
+    k.hold_histogram[bucket]++;
+}
+
+uint32_t key_stats::apm(uint64_t now) const
+{
+    if (!m_first_press)
+        return 0;
+    const auto second = to_second(now);
+    uint64_t count = 0;
+    for (int i = 0; i < STATS_WINDOW; i++) {
+        if (m_bucket_second[i] + STATS_WINDOW > second)
+            count += m_buckets[i];
+    }
+    const auto elapsed = std::clamp<uint64_t>(second - std::min(second, m_first_press) + 1, 1, STATS_WINDOW);
+    return uint32_t(count * 60 / elapsed);
+}
+
+const key_stats::key *key_stats::find(uint16_t code) const
+{
+    const auto it = m_keys.find(code);
+    return it == m_keys.end() ? nullptr : &it->second;
+}
+
+uint32_t key_stats::hold_bucket_limit(int i)
+{
+    return i < STATS_HOLD_BUCKETS - 1 ? uint32_t(STATS_HOLD_BASE) << i : 0;
+}
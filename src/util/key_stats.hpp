@@ -0,0 +1,73 @@
+/*************************************************************************
+ * This file is part of input-overlay
+ * github.con/univrsal/input-overlay
+ * Copyright 2022 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#pragma once
+#include <cstdint>
+#include <unordered_map>
+#include <uiohook.h>
+
+#define STATS_WINDOW 60       /* Seconds the action rate is taken over, one bucket per second */
+#define STATS_HOLD_BUCKETS 10 /* Bucket i counts holds shorter than STATS_HOLD_BASE << i ms, the last all longer ones */
+#define STATS_HOLD_BASE 16
+
+/* Key and mouse button counters of one source, updated incrementally from
+ * its events. Adding an event is O(1) and nothing grows with the number of
+ * events: there's one entry per key that was ever pressed, the rate comes
+ * from a fixed ring of one second buckets and hold times go into a fixed
+ * histogram. Not thread safe, every user keeps its own */
+class key_stats {
+public:
+    struct key {
+        uint64_t presses = 0;
+        uint64_t held_since = 0; /* os_gettime_ns(), 0 while released */
+        uint64_t holds = 0;      /* Finished presses */
+        uint64_t hold_total = 0; /* ms, of the finished presses */
+        uint32_t hold_histogram[STATS_HOLD_BUCKETS]{};
+
+        uint32_t average_hold() const { return holds ? uint32_t(hold_total / holds) : 0; }
+    };
+
+    /* time is when the event was captured. Only presses and releases of keys
+     * and mouse buttons count, key repeats are skipped. Mouse buttons are
+     * kept as VC_MOUSE_BUTTON1 etc. */
+    void add(const uiohook_event &event, uint64_t time);
+
+    /* Presses per minute over the last STATS_WINDOW seconds. Until a full
+     * window has passed since the first press it's extrapolated */
+    uint32_t apm(uint64_t now) const;
+
+    uint64_t presses() const { return m_presses; }
+
+    /* nullptr if the key was never pressed */
+    const key *find(uint16_t code) const;
+
+    const std::unordered_map<uint16_t, key> &keys() const { return m_keys; }
+
+    /* Upper bound of histogram bucket i in ms, 0 for the open ended last one */
+    static uint32_t hold_bucket_limit(int i);
+
+private:
+    void press(uint16_t code, uint64_t time);
+    void release(uint16_t code, uint64_t time);
+
+    std::unordered_map<uint16_t, key> m_keys;
+    uint64_t m_presses = 0;
+    uint64_t m_first_press = 0; /* s */
+    uint32_t m_buckets[STATS_WINDOW]{};
+    uint64_t m_bucket_second[STATS_WINDOW]{}; /* Which second each bucket counts, stale ones are ignored */
+};
@@ -26,6 +26,11 @@
 #define T_RELOAD_CONNECTIONS            T_("Source.InputSource.Reload")
 #define T_MENU_OPEN_SETTINGS            T_("Menu.InputOverlay.OpenSettings")
 #define T_REFRESH_RATE_TOOLTIP          T_("Dialog.InputOverlay.RemoteRefreshRate.Tooltip")
+#define T_REMOTE_LATENCY                T_("Dialog.Remote.Latency")
+#define T_REMOTE_LATENCY_UNKNOWN        T_("Dialog.Remote.Latency.Unknown")
+#define T_REMOTE_DROPPED                T_("Dialog.Remote.Dropped")
+#define T_COSTS_ENTRY                   T_("Dialog.Costs.Entry")
+#define T_COSTS_GPU_UNKNOWN             T_("Dialog.Costs.Gpu.Unknown")
 
 /* Lang Input Overlay */
 #define T_TEXTURE_FILE                  T_("Overlay.Path.Texture")
@@ -33,15 +38,23 @@
 #define T_FILTER_IMAGE_FILES            T_("Filter.ImageFiles")
 #define T_FILTER_TEXT_FILES             T_("Filter.TextFiles")
 #define T_FILTER_ALL_FILES              T_("Filter.AllFiles")
+#define T_FILTER_RECORDINGS             T_("Filter.Recordings")
 #define T_RELOAD_PAD_DEVICES            T_("Gamepad.Reload")
 #define T_CONTROLLER_ID                 T_("Gamepad.Id")
 #define T_CONROLLER_L_DEADZONE          T_("Gamepad.LeftDeadZone")
 #define T_CONROLLER_R_DEADZONE          T_("Gamepad.RightDeadZone")
+#define T_PAD_JITTER_DELAY              T_("Gamepad.JitterDelay")
+#define T_PAD_RESPONSE_CURVE            T_("Gamepad.ResponseCurve")
 #define T_MOUSE_SENS                    T_("Mouse.Sensitivity")
 #define T_MOUSE_DEAD_ZONE               T_("Mouse.Deadzone")
 #define T_MONITOR_USE_CENTER            T_("Mouse.UseCenter")
 #define T_MONITOR_H_CENTER              T_("Monitor.CenterX")
 #define T_MONITOR_V_CENTER              T_("Monitor.CenterY")
+#define T_RENDER_CACHE                  T_("Overlay.RenderCache")
+#define T_BAKE_STATIC                   T_("Overlay.BakeStatic")
+#define T_REPLAY_FILE                   T_("Overlay.Replay.File")
+#define T_REPLAY_MAX_SPEED              T_("Overlay.Replay.MaxSpeed")
+#define T_REPLAY_LOOP                   T_("Overlay.Replay.Loop")
 
 /* Lang Input History */
 #define T_HISTORY_USE_FALLBACK_NAMES    T_("History.UseFallbackNames")
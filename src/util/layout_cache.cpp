@@ -0,0 +1,134 @@
+/*************************************************************************
+ * This file is part of input-overlay
+ * github.con/univrsal/input-overlay
+ * Copyright 2022 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#include "layout_cache.hpp"
+#include "obs_util.hpp"
+#include "log.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <cstring>
+
+#define LAYOUT_CACHE_MAGIC 0x434C4F49 /* "IOLC" */
+#define LAYOUT_CACHE_VERSION 3 /* 3: element_desc::stat */
+
+namespace layout_cache {
+struct header {
+    uint32_t magic;
+    uint32_t version;
+    int64_t mtime; /* ms since epoch */
+    int64_t size;
+    uint32_t cx, cy;
+    uint32_t flags;
+    uint32_t path_length;
+    uint32_t element_count;
+    uint32_t padding;
+};
+/* Followed by the utf8 layout path, padded to eight bytes, and element_count element_descs */
+
+static_assert(sizeof(header) == 48, "Header layout changed, bump LAYOUT_CACHE_VERSION");
+
+static inline size_t align8(size_t n)
+{
+    return (n + 7) & ~size_t(7);
+}
+
+static QString cache_file(const QByteArray &path)
+{
+    /* FNV-1a of the layout path */
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (const auto c : path) {
+        hash ^= uint8_t(c);
+        hash *= 0x100000001b3ull;
+    }
+    return util_get_data_file(QString("layout-cache/%1.bin").arg(hash, 16, 16, QChar('0')));
+}
+
+bool read(const QString &layout_file, layout &out)
+{
+    const QFileInfo info(layout_file);
+    const auto path = info.absoluteFilePath().toUtf8();
+    QFile file(cache_file(path));
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    const auto file_size = size_t(file.size());
+    if (file_size < sizeof(header))
+        return false;
+
+    const auto *data = file.map(0, file.size());
+    if (!data)
+        return false;
+
+    header h;
+    memcpy(&h, data, sizeof(h));
+    const auto elements_offset = sizeof(header) + align8(h.path_length);
+    const auto valid = h.magic == LAYOUT_CACHE_MAGIC && h.version == LAYOUT_CACHE_VERSION &&
+                       h.mtime == info.lastModified().toMSecsSinceEpoch() && h.size == info.size() &&
+                       h.path_length == uint32_t(path.size()) &&
+                       file_size == elements_offset + h.element_count * sizeof(element_desc) &&
+                       memcmp(data + sizeof(header), path.constData(), h.path_length) == 0;
+
+    if (valid) {
+        out.cx = h.cx;
+        out.cy = h.cy;
+        out.flags = uint8_t(h.flags);
+        out.elements.resize(h.element_count);
+        if (h.element_count)
+            memcpy(out.elements.data(), data + elements_offset, h.element_count * sizeof(element_desc));
+    }
+    file.unmap(const_cast<uchar *>(data));
+    return valid;
+}
+
+void write(const QString &layout_file, const layout &in)
+{
+    const QFileInfo info(layout_file);
+    const auto path = info.absoluteFilePath().toUtf8();
+
+    QDir dir(util_get_data_file(""));
+    if (!dir.mkpath("layout-cache")) {
+        bwarn("Couldn't create layout cache directory in %s", qt_to_utf8(dir.absolutePath()));
+        return;
+    }
+
+    header h{};
+    h.magic = LAYOUT_CACHE_MAGIC;
+    h.version = LAYOUT_CACHE_VERSION;
+    h.mtime = info.lastModified().toMSecsSinceEpoch();
+    h.size = info.size();
+    h.cx = in.cx;
+    h.cy = in.cy;
+    h.flags = in.flags;
+    h.path_length = uint32_t(path.size());
+    h.element_count = uint32_t(in.elements.size());
+
+    QByteArray data;
+    data.reserve(int(sizeof(header) + align8(path.size()) + in.elements.size() * sizeof(element_desc)));
+    data.append(reinterpret_cast<const char *>(&h), sizeof(h));
+    data.append(path);
+    data.append(int(align8(path.size()) - path.size()), '\0');
+    data.append(reinterpret_cast<const char *>(in.elements.data()), int(in.elements.size() * sizeof(element_desc)));
+
+    /* Written to a temporary file first, so a crash never leaves a half written cache behind */
+    QSaveFile file(cache_file(path));
+    if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() || !file.commit())
+        bwarn("Couldn't write layout cache for %s", path.constData());
+}
+}
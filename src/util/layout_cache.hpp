@@ -0,0 +1,39 @@
+/*************************************************************************
+ * This file is part of input-overlay
+ * github.con/univrsal/input-overlay
+ * Copyright 2022 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#pragma once
+
+#include "element/element.hpp"
+#include <QString>
+#include <vector>
+
+/* Parsed layouts are stored in a flat binary file next to the other data
+ * files, so loading a layout that hasn't changed since the last time just
+ * maps that file instead of going through QJsonDocument */
+namespace layout_cache {
+struct layout {
+    uint32_t cx = 0, cy = 0;
+    uint8_t flags = 0;
+    std::vector<element_desc> elements;
+};
+
+/* Fails if there's no cache entry or the layout file was modified since it was written */
+bool read(const QString &layout_file, layout &out);
+
+void write(const QString &layout_file, const layout &in);
+}
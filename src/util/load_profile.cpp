@@ -0,0 +1,128 @@
+/*************************************************************************
+ * This file is part of input-overlay
+ * github.con/univrsal/input-overlay
+ * Copyright 2022 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#include "load_profile.hpp"
+#include "config.hpp"
+#include "log.h"
+#include <cstring>
+#include <mutex>
+#include <util/platform.h>
+
+namespace load_profile {
+struct load {
+    std::string name;
+    std::string stages;
+    uint64_t total;
+};
+
+static std::mutex mutex;
+static std::vector<load> loads;
+static int outstanding = 0;
+static bool held = true; /* Until the first scene collection is loaded */
+static uint64_t batch_start = 0;
+
+void stages::add(const char *stage, uint64_t ns)
+{
+    for (auto &time : m_times) {
+        if (strcmp(time.first, stage) == 0) {
+            time.second += ns;
+            return;
+        }
+    }
+    m_times.emplace_back(stage, ns);
+}
+
+uint64_t stages::total() const
+{
+    uint64_t total = 0;
+    for (const auto &time : m_times)
+        total += time.second;
+    return total;
+}
+
+std::string stages::format() const
+{
+    std::string out;
+    char buf[64];
+    for (const auto &time : m_times) {
+        snprintf(buf, sizeof(buf), "%s%s %.2f ms", out.empty() ? "" : ", ", time.first, time.second / 1000000.0);
+        out += buf;
+    }
+    return out;
+}
+
+scope::scope(stages &s, const char *stage) : m_stages(s), m_stage(stage), m_start(os_gettime_ns()) {}
+
+scope::~scope()
+{
+    m_stages.add(m_stage, os_gettime_ns() - m_start);
+}
+
+void report(const char *what, const stages &s)
+{
+    if (io_config::log_flag)
+        binfo("%s took %.2f ms (%s)", what, s.total() / 1000000.0, s.format().c_str());
+}
+
+/* Mutex has to be locked */
+static void flush()
+{
+    if (held || outstanding > 0 || loads.empty())
+        return;
+
+    uint64_t total = 0;
+    binfo("Loaded %i layouts in %.2f ms:", int(loads.size()), (os_gettime_ns() - batch_start) / 1000000.0);
+    for (const auto &l : loads) {
+        binfo("    %s: %.2f ms (%s)", l.name.c_str(), l.total / 1000000.0, l.stages.c_str());
+        total += l.total;
+    }
+    binfo("    total: %.2f ms", total / 1000000.0);
+    loads.clear();
+}
+
+void begin_load()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (outstanding++ == 0 && loads.empty())
+        batch_start = os_gettime_ns();
+}
+
+void end_load(const std::string &name, const stages &s)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (outstanding > 0)
+        outstanding--;
+    /* Checked here so nothing piles up if logging is off */
+    if (io_config::log_flag && s.total() > 0)
+        loads.push_back({name.empty() ? "(no layout)" : name, s.format(), s.total()});
+    flush();
+}
+
+void hold()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    held = true;
+}
+
+void release()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    held = false;
+    flush();
+}
+}
@@ -0,0 +1,59 @@
+/*************************************************************************
+ * This file is part of input-overlay
+ * github.con/univrsal/input-overlay
+ * Copyright 2022 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#pragma once
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+/* Timings of the module load and of layout loads, which are written to the
+ * log if logging is enabled. Layout loads are reported together once all
+ * of them are done, but only after OBS finished loading the scene collection */
+namespace load_profile {
+class stages {
+    std::vector<std::pair<const char *, uint64_t>> m_times; /* ns */
+
+public:
+    void add(const char *stage, uint64_t ns);
+    uint64_t total() const;
+    std::string format() const;
+};
+
+/* Adds the time until it goes out of scope to a stage */
+class scope {
+    stages &m_stages;
+    const char *m_stage;
+    uint64_t m_start;
+
+public:
+    scope(stages &s, const char *stage);
+    ~scope();
+};
+
+/* Writes a single line for something that isn't a layout load */
+void report(const char *what, const stages &s);
+
+/* Every begin_load has to be followed by exactly one end_load */
+void begin_load();
+void end_load(const std::string &name, const stages &s);
+
+/* Called by the frontend events, reports are held back while a scene collection loads */
+void hold();
+void release();
+}
@@ -0,0 +1,87 @@
+/*************************************************************************
+ * This file is part of input-overlay
+ * github.con/univrsal/input-overlay
+ * Copyright 2022 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#include "loader.hpp"
+#include "trace.hpp"
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <util/threading.h>
+
+namespace loader {
+static std::mutex mutex;
+static std::condition_variable wakeup;
+static std::deque<job> jobs;
+static std::thread thread;
+static bool running = false;
+
+static void thread_method()
+{
+    os_set_thread_name("inputovrly-loader");
+    IO_TRACE_THREAD("inputovrly-loader");
+    std::unique_lock<std::mutex> lock(mutex);
+    while (running) {
+        if (jobs.empty()) {
+            wakeup.wait(lock);
+            continue;
+        }
+        auto j = std::move(jobs.front());
+        jobs.pop_front();
+        lock.unlock();
+        j();
+        j = nullptr; /* Drop captures outside of the lock */
+        lock.lock();
+    }
+}
+
+void start()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (running)
+        return;
+    running = true;
+    thread = std::thread(thread_method);
+}
+
+void stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!running)
+            return;
+        running = false;
+        jobs.clear();
+    }
+    wakeup.notify_one();
+    thread.join();
+}
+
+void queue(job j)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (running) {
+            jobs.emplace_back(std::move(j));
+            wakeup.notify_one();
+            return;
+        }
+    }
+    j();
+}
+}
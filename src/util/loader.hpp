@@ -0,0 +1,36 @@
+/*************************************************************************
+ * This file is part of input-overlay
+ * github.con/univrsal/input-overlay
+ * Copyright 2022 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#pragma once
+#include <functional>
+
+/* Worker thread for loading layouts and decoding images, so the UI thread
+ * doesn't stall when sources are created or their files are changed. Also
+ * used for anything else that is too slow for the thread asking for it */
+namespace loader {
+typedef std::function<void()> job;
+
+void start();
+
+/* Waits for the running job, queued ones are dropped */
+void stop();
+
+/* Jobs run one after the other in the order they were queued. If the
+ * thread isn't running the job is run right away */
+void queue(job j);
+}
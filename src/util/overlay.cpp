@@ -19,14 +19,13 @@
 #include "overlay.hpp"
 #include "../sources/input_source.hpp"
 #include "config.hpp"
+#include "layout_cache.hpp"
+#include "texture_cache.hpp"
+#include "atlas.hpp"
+#include "loader.hpp"
+#include "pipeline_stats.hpp"
+#include "source_costs.hpp"
 #include "element/element.hpp"
-#include "element/element_analog_stick.hpp"
-#include "element/element_button.hpp"
-#include "element/element_dpad.hpp"
-#include "element/element_gamepad_id.hpp"
-#include "element/element_mouse_movement.hpp"
-#include "element/element_mouse_wheel.hpp"
-#include "element/element_trigger.hpp"
 #include "../gui/io_settings_dialog.hpp"
 #include "../hook/gamepad_hook_helper.hpp"
 #include "log.h"
@@ -35,11 +34,14 @@
 #include "obs_util.hpp"
 #include "lang.h"
 #include <QFile>
+#include <QFileInfo>
 #include <QJsonArray>
 #include <QJsonDocument>
+#include <cstring>
 #include <layout_constants.h>
 extern "C" {
 #include <graphics/image-file.h>
+#include <graphics/vec4.h>
 }
 
 namespace sources {
@@ -49,45 +51,181 @@ class overlay_settings;
 overlay::~overlay()
 {
     unload();
+    if (m_cache || m_background) {
+        obs_enter_graphics();
+        gs_texrender_destroy(m_cache);
+        gs_texrender_destroy(m_background);
+        obs_leave_graphics();
+    }
 }
 
 overlay::overlay(sources::overlay_settings *settings)
 {
     m_settings = settings;
-    m_is_loaded = load();
 }
 
-bool overlay::load()
+overlay::file_stamp overlay::file_stamp::of(const std::string &path)
 {
-    unload();
-    const auto image_loaded = load_texture();
-    m_is_loaded = image_loaded && load_cfg();
+    file_stamp stamp;
+    const QFileInfo info(QString::fromStdString(path));
+    if (!path.empty() && info.exists()) {
+        stamp.mtime = info.lastModified().toMSecsSinceEpoch();
+        stamp.size = info.size();
+    }
+    return stamp;
+}
+
+void overlay::load()
+{
+    queue_load(false);
+}
+
+void overlay::reload_if_changed()
+{
+    if (!m_job)
+        queue_load(true);
+}
+
+void overlay::queue_load(bool only_if_changed)
+{
+    /* A load that is still running is discarded once it's done */
+    auto job = std::make_shared<load_job>(m_settings->layout_file);
+    m_job = job;
+
+    const auto image_file = m_settings->image_file;
+    const auto layout_file = m_settings->layout_file;
+    const auto image_stamp = m_image_stamp;
+    const auto layout_stamp = m_layout_stamp;
+    auto descs = m_descs;
+    loader::queue([job, image_file, layout_file, image_stamp, layout_stamp, descs, only_if_changed] {
+        auto &result = job->result;
+        result.image_stamp = file_stamp::of(image_file);
+        result.layout_stamp = file_stamp::of(layout_file);
+        if (only_if_changed && result.image_stamp == image_stamp && result.layout_stamp == layout_stamp) {
+            result.unchanged = true;
+            job->done.store(true, std::memory_order_release);
+            return;
+        }
+
+        /* The layout goes first, trimming the image needs to know which parts
+         * of it are used. An image that didn't change is still in the texture
+         * cache, so it isn't decoded or uploaded again */
+        bool layout_loaded, image_loaded;
+        {
+            load_profile::scope s(job->profile, "layout");
+            layout_loaded = !image_file.empty() && load_cfg(layout_file, result);
+        }
+        {
+            load_profile::scope s(job->profile, "image");
+            image_loaded = load_texture(image_file, result);
+        }
+        result.loaded = image_loaded && layout_loaded;
+        if (image_loaded && !layout_loaded) {
+            result.cx = result.texture->cx;
+            result.cy = result.texture->cy;
+        }
+
+        /* If the same elements are still in the same order only the ones
+         * that changed are updated, which keeps the state of all others */
+        if (result.loaded && descs.size() == result.descs.size()) {
+            result.incremental = true;
+            for (size_t i = 0; i < descs.size() && result.incremental; i++) {
+                if (descs[i].id != result.descs[i].id || descs[i].type != result.descs[i].type)
+                    result.incremental = false;
+                else if (memcmp(&descs[i], &result.descs[i], sizeof(element_desc)) != 0)
+                    result.changed.emplace_back(i);
+            }
+        }
+        job->done.store(true, std::memory_order_release);
+    });
+}
+
+bool overlay::poll_load()
+{
+    if (!m_job || !m_job->done.load(std::memory_order_acquire))
+        return false;
+
+    auto job = std::move(m_job);
+    auto &result = job->result;
+    if (result.unchanged)
+        return false;
+
+    /* Only the texture upload needs the graphics context, the rest was done by the loader thread */
+    if (result.texture) {
+        load_profile::scope s(job->profile, "upload");
+        obs_enter_graphics();
+        texture_cache::upload(result.texture.get());
+        obs_leave_graphics();
+    }
 
+    m_texture = std::move(result.texture);
+    m_image = m_texture.get();
+    if (result.incremental && m_is_loaded) {
+        for (const auto i : result.changed)
+            m_elements.at(i)->load(result.descs[i]);
+        bdebug("Reloaded %s, %i elements changed", m_settings->layout_file.c_str(), int(result.changed.size()));
+    } else {
+        m_elements = std::move(result.elements);
+    }
+    m_descs = std::move(result.descs);
+    m_image_stamp = result.image_stamp;
+    m_layout_stamp = result.layout_stamp;
+    m_is_loaded = result.loaded;
+    m_background_valid = false;
+    m_source = nullptr;
+    m_settled = false;
+    m_needs_tick = true;
+    m_dirty = true;
+
+    m_settings->cx = result.cx;
+    m_settings->cy = result.cy;
+    m_settings->layout_flags = result.flags;
+    m_channels = m_elements.channels();
+    if (result.flags & OF_MOUSE)
+        m_channels |= IC_MOUSE;
+    if (result.flags & (OF_GAMEPAD | OF_LEFT_STICK | OF_RIGHT_STICK))
+        m_channels |= IC_PAD_BUTTONS | IC_PAD_AXES;
     if (!m_is_loaded) {
-        m_settings->gamepad = 0;
-        if (!image_loaded) {
+        m_settings->gamepad = nullptr;
+        m_settings->layout_flags = 0;
+        if (!m_image) {
             m_settings->cx = 100; /* Default size */
             m_settings->cy = 100;
         }
     }
-
-    return m_is_loaded;
+    return true;
 }
 
 void overlay::unload()
 {
+    m_job = nullptr;
     unload_texture();
     unload_elements();
+    m_descs.clear();
+    m_image_stamp = {};
+    m_layout_stamp = {};
+    m_is_loaded = false;
     m_settings->cx = 100;
     m_settings->cy = 100;
 }
 
-bool overlay::load_cfg()
+bool overlay::load_cfg(const std::string &layout_file, staged_layout &out)
 {
-    if (!m_settings || m_settings->layout_file.empty())
+    if (layout_file.empty())
         return false;
 
-    QFile file(m_settings->layout_file.c_str());
+    const QString path = layout_file.c_str();
+    layout_cache::layout cached;
+    if (layout_cache::read(path, cached)) {
+        out.cx = cached.cx;
+        out.cy = cached.cy;
+        out.flags = cached.flags;
+        for (const auto &desc : cached.elements)
+            load_element(out, desc, QString(), false);
+        return true;
+    }
+
+    QFile file(path);
 
     if (!file.open(QIODevice::ReadOnly)) {
         blog(LOG_ERROR, "[input-overlay] couldn't open config file");
@@ -100,9 +238,9 @@ bool overlay::load_cfg()
     const auto flag = true;
 
     if (err.error == QJsonParseError::NoError) {
-        m_settings->cx = static_cast<uint32_t>(cfg_obj[CFG_TOTAL_WIDTH].toInt());
-        m_settings->cy = static_cast<uint32_t>(cfg_obj[CFG_TOTAL_HEIGHT].toInt());
-        m_settings->layout_flags = static_cast<uint8_t>(cfg_obj[CFG_FLAGS].toInt());
+        out.cx = static_cast<uint32_t>(cfg_obj[CFG_TOTAL_WIDTH].toInt());
+        out.cy = static_cast<uint32_t>(cfg_obj[CFG_TOTAL_HEIGHT].toInt());
+        out.flags = static_cast<uint8_t>(cfg_obj[CFG_FLAGS].toInt());
 
         const auto debug_mode = cfg_obj[CFG_DEBUG_FLAG].toBool();
 
@@ -111,53 +249,80 @@ bool overlay::load_cfg()
 #else
         {
 #endif
-            binfo("Started loading of %s", m_settings->layout_file.c_str());
+            binfo("Started loading of %s", layout_file.c_str());
         }
 
         auto arr = cfg_obj[CFG_ELEMENTS].toArray();
+        cached.cx = out.cx;
+        cached.cy = out.cy;
+        cached.flags = out.flags;
+        cached.elements.reserve(arr.size());
+
+        for (const auto element : arr) {
+            const auto obj = element.toObject();
+            cached.elements.emplace_back(element::read_desc(obj));
+            load_element(out, cached.elements.back(), obj[CFG_ID].toString(), debug_mode);
+        }
 
-        for (const auto element : arr)
-            load_element(element.toObject(), debug_mode);
+        /* Debug layouts log every element on load, which the cache would skip */
+        if (!debug_mode)
+            layout_cache::write(path, cached);
     } else {
-        berr("Couldn't load layout from %s. Error: %s", m_settings->layout_file.c_str(), qt_to_utf8(err.errorString()));
+        berr("Couldn't load layout from %s. Error: %s", layout_file.c_str(), qt_to_utf8(err.errorString()));
     }
 
     return flag;
 }
 
-bool overlay::load_texture()
+bool overlay::load_texture(const std::string &image_file, staged_layout &out)
 {
-    if (!m_settings || m_settings->image_file.empty())
+    if (image_file.empty())
         return false;
 
-    auto flag = true;
+    if (!io_config::trim_atlas || out.descs.empty()) {
+        out.texture = texture_cache::acquire(image_file);
+    } else {
+        std::vector<gs_rect> regions;
+        regions.reserve(out.descs.size());
+        for (const auto &desc : out.descs)
+            regions.emplace_back(element::atlas_region(desc));
+        const auto plan = atlas::pack(regions);
+
+        /* Layouts using the same regions share the trimmed image */
+        uint64_t hash = 0xcbf29ce484222325ull;
+        for (const auto &r : plan.from) {
+            for (const auto v : {r.x, r.y, r.cx, r.cy})
+                hash = (hash ^ uint32_t(v)) * 0x100000001b3ull;
+        }
 
-    if (m_image == nullptr) {
-        m_image = new gs_image_file_t();
+        bool trimmed = false;
+        const auto trim = [&plan](gs_image_file_t *image) { return atlas::apply(image, plan); };
+        out.texture = texture_cache::acquire(image_file, "trim:" + std::to_string(hash), trim, trimmed);
+
+        if (out.texture && trimmed) {
+            for (size_t i = 0; i < out.descs.size(); i++) {
+                auto &desc = out.descs[i];
+                const auto &to = plan.to[plan.index[i]];
+                desc.mapping[0] = to.x;
+                desc.mapping[1] = to.y;
+                out.elements.at(i)->load(desc);
+            }
+            bdebug("Trimmed %s to %ux%u", image_file.c_str(), plan.cx, plan.cy);
+        }
     }
 
-    gs_image_file_init(m_image, m_settings->image_file.c_str());
-
-    obs_enter_graphics();
-    gs_image_file_init_texture(m_image);
-    obs_leave_graphics();
-
-    if (!m_image->loaded) {
-        bwarn("Error: failed to load texture %s", m_settings->image_file.c_str());
-        flag = false;
-    } else {
-        m_settings->cx = m_image->cx;
-        m_settings->cy = m_image->cy;
+    if (!out.texture) {
+        bwarn("Error: failed to load texture %s", image_file.c_str());
+        return false;
     }
-
-    return flag;
+    return true;
 }
 
-void overlay::unload_texture() const
+void overlay::unload_texture()
 {
-    obs_enter_graphics();
-    gs_image_file_free(m_image);
-    obs_leave_graphics();
+    /* Other sources might still be using it, the cache frees it with the last reference */
+    m_image = nullptr;
+    m_texture = nullptr;
 }
 
 void overlay::unload_elements()
@@ -167,19 +332,112 @@ void overlay::unload_elements()
 
 void overlay::draw(gs_effect_t *effect)
 {
-    if (m_is_loaded) {
-        for (auto const &element : m_elements) {
-            element->draw(effect, m_image, m_settings);
+    if (!m_is_loaded)
+        return;
+
+    m_use_background = m_settings->bake_static && m_elements.has_static() && update_background(effect);
+
+    if (m_settings->use_render_cache)
+        draw_cached(effect);
+    else
+        draw_elements(effect);
+}
+
+void overlay::draw_elements(gs_effect_t *effect)
+{
+    if (!m_use_background) {
+        m_batch.begin(m_image);
+        m_elements.draw(effect, m_image, m_settings);
+        m_batch.end(effect);
+        return;
+    }
+
+    /* The background is premultiplied, see update_background */
+    auto *background = gs_texrender_get_texture(m_background);
+    gs_blend_state_push();
+    gs_blend_function(GS_BLEND_ONE, GS_BLEND_INVSRCALPHA);
+    gs_effect_set_texture(gs_effect_get_param_by_name(effect, "image"), background);
+    gs_draw_sprite(background, 0, m_settings->cx, m_settings->cy);
+    source_costs::count_draw();
+    gs_blend_state_pop();
+
+    m_batch.begin(m_image);
+    m_elements.draw_dynamic(effect, m_image, m_settings);
+    m_batch.end(effect);
+}
+
+bool overlay::update_background(gs_effect_t *effect)
+{
+    if (!m_background)
+        m_background = gs_texrender_create(GS_RGBA, GS_ZS_NONE);
+
+    if (!m_background_valid || !gs_texrender_get_texture(m_background)) {
+        gs_texrender_reset(m_background);
+        if (!gs_texrender_begin(m_background, m_settings->cx, m_settings->cy))
+            return false;
+
+        vec4 clear_color;
+        vec4_zero(&clear_color);
+        gs_clear(GS_CLEAR_COLOR, &clear_color, 0.f, 0);
+        gs_ortho(0.f, float(m_settings->cx), 0.f, float(m_settings->cy), -100.f, 100.f);
+
+        /* Same as the render cache, keeps the alpha channel usable */
+        gs_blend_state_push();
+        gs_blend_function_separate(GS_BLEND_SRCALPHA, GS_BLEND_INVSRCALPHA, GS_BLEND_ONE, GS_BLEND_INVSRCALPHA);
+        m_batch.begin(m_image);
+        m_elements.draw_static(effect, m_image);
+        m_batch.end(effect);
+        gs_blend_state_pop();
+
+        gs_texrender_end(m_background);
+        m_background_valid = true;
+    }
+    return gs_texrender_get_texture(m_background) != nullptr;
+}
+
+void overlay::draw_cached(gs_effect_t *effect)
+{
+    if (!m_cache)
+        m_cache = gs_texrender_create(GS_RGBA, GS_ZS_NONE);
+
+    if (m_dirty || !gs_texrender_get_texture(m_cache)) {
+        gs_texrender_reset(m_cache);
+        if (gs_texrender_begin(m_cache, m_settings->cx, m_settings->cy)) {
+            vec4 clear_color;
+            vec4_zero(&clear_color);
+            gs_clear(GS_CLEAR_COLOR, &clear_color, 0.f, 0);
+            gs_ortho(0.f, float(m_settings->cx), 0.f, float(m_settings->cy), -100.f, 100.f);
+
+            /* Keep the alpha channel usable by rendering premultiplied */
+            gs_blend_state_push();
+            gs_blend_function_separate(GS_BLEND_SRCALPHA, GS_BLEND_INVSRCALPHA, GS_BLEND_ONE, GS_BLEND_INVSRCALPHA);
+            draw_elements(effect);
+            gs_blend_state_pop();
+
+            gs_texrender_end(m_cache);
+            m_dirty = false;
         }
     }
+
+    auto *texture = gs_texrender_get_texture(m_cache);
+    if (!texture) {
+        draw_elements(effect);
+        return;
+    }
+
+    gs_blend_state_push();
+    gs_blend_function(GS_BLEND_ONE, GS_BLEND_INVSRCALPHA);
+    gs_effect_set_texture(gs_effect_get_param_by_name(effect, "image"), texture);
+    gs_draw_sprite(texture, 0, m_settings->cx, m_settings->cy);
+    source_costs::count_draw();
+    gs_blend_state_pop();
 }
 
 void overlay::tick(float seconds)
 {
-    if (m_is_loaded) {
-        for (auto const &element : m_elements) {
-            element->tick(seconds, m_settings);
-        }
+    if (m_is_loaded && (m_needs_tick || m_elements.ticks_always())) {
+        m_elements.tick(seconds, m_settings);
+        m_dirty = true;
     }
 }
 
@@ -192,98 +450,179 @@ void overlay::refresh_data()
      * while the data is currently inaccessible, because it is being written
      * to by the input thread, resulting in all buttons being unpressed
      */
-    if (io_config::io_window_filters.input_blocked())
+    pipeline_stats::scope stats(pipeline_stats::STAGE_SNAPSHOT);
+    IO_TRACE_ZONE("input snapshot");
+    const auto frame_time = obs_get_video_frame_time();
+    /* Filters hide live input while certain windows are focused, recordings were already made */
+    if (!m_settings->replay && io_config::io_window_filters.input_blocked(frame_time)) {
+        /* The events of the last frame would otherwise be handled again by the settle tick */
+        m_settings->events = &input_cache::no_events;
+        mark_unchanged();
         return;
+    }
     input_data *source = nullptr;
-    std::mutex *m = nullptr;
     std::shared_ptr<network::io_client> client = nullptr; // Holds the reference until we've copied the data
-    if (uiohook::state || network::network_flag || libgamepad::state) {
+    if (m_settings->replay) {
+        source = m_settings->replay->data();
+    } else if (uiohook::state || network::network_flag || libgamepad::state) {
         if (network::server_instance && !m_settings->use_local_input()) {
-            client = network::server_instance->get_client(m_settings->selected_source);
-            if (client && client->valid()) {
-                source = client->get_data();
-                m = &network::mutex;
+            /* The handle stays usable until the client disconnects, so the
+             * list only has to be searched after that */
+            client = m_client.lock();
+            if (!client || !client->valid() || client->name() != m_settings->selected_source) {
+                /* Only guards the client list, which is just changed on connects and disconnects */
+                std::lock_guard<traced_mutex> lock(network::mutex);
+                client = network::server_instance->get_client(m_settings->selected_source);
+                m_client = client;
             }
+            if (client && client->valid())
+                source = client->get_data();
         } else {
             source = &local_data::data;
-            m = &local_data::data_mutex;
         }
     }
 
-    if (m && source) {
-        // copy over data from gamepad into the input data structure
-        auto copy = [](input_data *source, std::shared_ptr<gamepad::device> d) {
-            source->last_axis_event = *d->last_axis_event();
-            source->last_button_event = *d->last_button_event();
-            source->gamepad_axis = d->get_axis();
-            source->gamepad_buttons = d->get_buttons();
-        };
-
-        if (m_settings->use_local_input()) {
-            if (libgamepad::hook_instance && m_settings->gamepad) {
-                libgamepad::hook_instance->get_mutex()->lock();
-                copy(source, m_settings->gamepad);
-                libgamepad::hook_instance->get_mutex()->unlock();
-            }
-            m->lock();
-            m_settings->data.copy(source);
-            if (uiohook::state)
-                uiohook::check_wheel();
-            m->unlock();
+    if (!source) {
+        mark_unchanged();
+        return;
+    }
+
+    /* Read the generation before copying anything, a change that happens
+     * while copying will just cause another copy next frame */
+    const auto generation = source->generation();
+    if (source != m_source || m_settings->gamepad.get() != m_gamepad)
+        m_jitter.clear();
+    const auto unchanged =
+        source == m_source && generation == m_generation && m_settings->gamepad.get() == m_gamepad;
+    m_source = source;
+    m_generation = generation;
+    m_gamepad = m_settings->gamepad.get();
+
+    /* Keyboard and mouse state is published by the input thread through a
+     * sequence lock, so this never blocks the hook or the network thread.
+     * The first source to tick in a frame copies it, all others reuse it.
+     * Gamepad only layouts don't need it at all */
+    if (m_channels & (IC_KEYBOARD | IC_MOUSE | IC_EVENTS)) {
+        bool refreshed = false;
+        const auto &key = m_settings->replay           ? m_settings->replay->name()
+                          : m_settings->use_local_input() ? std::string()
+                                                          : m_settings->selected_source;
+        auto *snapshot = input_cache::get(key, source, frame_time, refreshed, m_channels);
+        if (refreshed) {
+            pipeline_stats::count(pipeline_stats::COUNTER_COPIES);
+            source_costs::count_bytes((snapshot->copied & IC_KEYBOARD) ? sizeof(input_state)
+                                                                       : offsetof(input_state, keyboard));
+        }
+        m_settings->input = &snapshot->state;
+        m_settings->events = &snapshot->events;
+
+        /* Short presses disappearing don't change the generation, so also check the snapshot itself */
+        if (snapshot != m_snapshot || snapshot->version != m_snapshot_version) {
+            m_snapshot = snapshot;
+            m_snapshot_version = snapshot->version;
+            m_dirty = true;
+        }
+    } else {
+        m_settings->input = &input_cache::empty;
+        m_settings->events = &input_cache::no_events;
+    }
+
+    if (unchanged) {
+        /* Interpolated axes keep moving until they caught up with the last sample */
+        const bool smoothing = smooth_axes();
+        if (smoothing || !(m_settings->pad_response == m_response)) {
+            process_axes();
+            m_settled = false;
+            m_needs_tick = true;
+            m_dirty = true;
         } else {
-            m->lock();
-            if (m_settings->gamepad)
-                copy(source, m_settings->gamepad);
-            m_settings->data.copy(source);
-            m->unlock();
+            mark_unchanged();
+        }
+        return;
+    }
+    m_settled = false;
+    m_needs_tick = true;
+
+    /* Copy over the parts of the gamepad state the layout draws */
+    const auto channels = m_channels;
+    auto copy = [channels](pad_view *target, const std::shared_ptr<gamepad::device> &d) {
+        pipeline_stats::count(pipeline_stats::COUNTER_COPIES);
+        if (channels & IC_PAD_AXES) {
+            source_costs::count_bytes(sizeof(target->last_axis_event) + sizeof(target->axis));
+            target->last_axis_event = *d->last_axis_event();
+            target->axis.clear();
+            for (const auto &axis : d->get_axis())
+                target->axis.set(axis.first, axis.second);
+        }
+        if (channels & IC_PAD_BUTTONS) {
+            source_costs::count_bytes(sizeof(target->last_button_event) + sizeof(target->buttons));
+            target->last_button_event = *d->last_button_event();
+            target->buttons.clear();
+            for (const auto &button : d->get_buttons())
+                target->buttons.set(button.first, button.second);
         }
+    };
+
+    if (!m_settings->gamepad || !(channels & (IC_PAD_AXES | IC_PAD_BUTTONS))) {
+        /* Nothing to copy */
+    } else if (m_settings->replay) {
+        std::lock_guard<std::mutex> lock(m_settings->replay->mutex());
+        copy(&m_settings->pad, m_settings->gamepad);
+    } else if (m_settings->use_local_input()) {
+        if (libgamepad::hook_instance) {
+            libgamepad::hook_instance->get_mutex()->lock();
+            copy(&m_settings->pad, m_settings->gamepad);
+            libgamepad::hook_instance->get_mutex()->unlock();
+        }
+    } else if (client) {
+        /* Remote gamepad state is written by the network thread */
+        std::lock_guard<traced_mutex> lock(client->mutex());
+        copy(&m_settings->pad, m_settings->gamepad);
     }
+
+    if (m_settings->pad_jitter_delay && m_settings->gamepad && (channels & IC_PAD_AXES)) {
+        m_jitter.push(m_settings->pad.last_axis_event.time, m_settings->pad.axis);
+        smooth_axes();
+    }
+    process_axes();
 }
 
-void overlay::load_element(const QJsonObject &obj, const bool debug)
+void overlay::process_axes()
 {
-    const auto type = obj[CFG_TYPE].toInt();
-    element *new_element = nullptr;
+    /* Once per change for all sticks and triggers, instead of in every element that draws one */
+    m_response = m_settings->pad_response;
+    if (m_channels & IC_PAD_AXES)
+        m_response.apply(m_settings->pad.axis, m_settings->axes);
+}
 
-    switch (type) {
-    case ET_TEXTURE:
-        new_element = new element_texture;
-        break;
-    case ET_GAMEPAD_ID:
-        new_element = new element_gamepad_id;
-        break;
-    case ET_KEYBOARD_KEY:
-        new_element = new element_keyboard_key;
-        break;
-    case ET_MOUSE_BUTTON:
-        new_element = new element_mouse_button;
-        break;
-    case ET_GAMEPAD_BUTTON:
-        new_element = new element_gamepad_button;
-        break;
-    case ET_WHEEL:
-        new_element = new element_wheel;
-        break;
-    case ET_TRIGGER:
-        new_element = new element_trigger;
-        break;
-    case ET_ANALOG_STICK:
-        new_element = new element_analog_stick;
-        break;
-    case ET_DPAD_STICK:
-        new_element = new element_dpad;
-        break;
-    case ET_MOUSE_MOVEMENT:
-        new_element = new element_mouse_movement;
-        break;
-    default:
-        if (debug)
-            binfo("Invalid element type %i for %s", type, qt_to_utf8(obj[CFG_ID].toString()));
-    }
+bool overlay::smooth_axes()
+{
+    if (!m_settings->pad_jitter_delay || !m_settings->gamepad || !(m_channels & IC_PAD_AXES))
+        return false;
+    /* Event times are os_gettime_ns() in ms, remote ones are already converted to it */
+    const auto now = os_gettime_ns() / 1000000;
+    return m_jitter.sample(now - m_settings->pad_jitter_delay, m_settings->pad.axis);
+}
+
+void overlay::mark_unchanged()
+{
+    /* Elements get one more tick after the last change, so they can settle
+     * (e.g. mouse movement going back to the center) */
+    m_needs_tick = !m_settled;
+    m_settled = true;
+}
+
+void overlay::load_element(staged_layout &out, const element_desc &desc, const QString &id, const bool debug)
+{
+    const auto type = desc.type;
+    auto *new_element = out.elements.add(static_cast<element_type>(type));
+
+    if (!new_element && debug)
+        binfo("Invalid element type %i for %s", type, qt_to_utf8(id));
 
     if (new_element) {
-        new_element->load(obj);
-        m_elements.emplace_back(new_element);
+        new_element->load(desc);
+        out.descs.emplace_back(desc);
 
 #ifndef _DEBUG
         if (debug) {
@@ -291,7 +630,7 @@ void overlay::load_element(const QJsonObject &obj, const bool debug)
         {
 #endif
             binfo("Type: %14s, KEYCODE: 0x%04X ID: %s", element_type_to_string(static_cast<element_type>(type)),
-                  new_element->get_keycode(), qt_to_utf8(obj[CFG_ID].toString()));
+                  new_element->get_keycode(), qt_to_utf8(id));
         }
     }
 }
@@ -319,6 +658,10 @@ const char *overlay::element_type_to_string(const element_type t)
         return "Gamepad ID";
     case ET_DPAD_STICK:
         return "DPad";
+    case ET_INPUT_HISTORY:
+        return "Input history";
+    case ET_INPUT_STATS:
+        return "Input stats";
     default:
     case ET_INVALID:
         return "Invalid";
@@ -23,12 +23,22 @@
 #endif
 
 #include "../hook/uiohook_helper.hpp"
-#include "element/element.hpp"
+#include "element/element_table.hpp"
+#include "axis_response.hpp"
+#include "jitter_buffer.hpp"
+#include "load_profile.hpp"
+#include "sprite_batch.hpp"
+#include <atomic>
 #include <memory>
+#include <string>
 #include <vector>
 
 class ccl_config;
 
+namespace network {
+class io_client;
+}
+
 typedef struct gs_image_file gs_image_file_t;
 
 class overlay {
@@ -36,28 +46,104 @@ public:
     overlay() = default;
     ~overlay();
     explicit overlay(sources::overlay_settings *settings);
-    bool load();
+    /* Loads the layout and image in the background, the current ones are
+     * drawn until poll_load swaps them out */
+    void load();
+    /* Swaps in a finished load, has to be called from the graphics thread.
+     * Returns true if the layout changed */
+    bool poll_load();
+    /* Loads again if the layout or image file were modified since the last load */
+    void reload_if_changed();
     void unload();
     void draw(gs_effect_t *effect);
     void tick(float seconds);
     void refresh_data();
     bool is_loaded() const { return m_is_loaded; }
     gs_image_file_t *get_texture() const { return m_image; }
+    size_t element_count() const { return m_elements.size(); }
 
 private:
-    bool load_cfg();
-    bool load_texture();
-    void unload_texture() const;
+    struct file_stamp {
+        int64_t mtime = -1, size = -1;
+        bool operator==(const file_stamp &o) const { return mtime == o.mtime && size == o.size; }
+        static file_stamp of(const std::string &path);
+    };
+
+    /* Everything a load produces, filled on the loader thread */
+    struct staged_layout {
+        std::shared_ptr<gs_image_file_t> texture;
+        element_table elements;
+        std::vector<element_desc> descs; /* Of every element in elements, in the same order */
+        std::vector<size_t> changed;     /* Indices into descs, if incremental */
+        file_stamp image_stamp, layout_stamp;
+        uint32_t cx = 0, cy = 0;
+        uint8_t flags = 0;
+        bool loaded = false;
+        bool unchanged = false;   /* Neither file was modified, nothing was loaded */
+        bool incremental = false; /* Same elements as before, only the changed ones have to be updated */
+    };
+
+    struct load_job {
+        staged_layout result;
+        std::atomic<bool> done{false};
+        std::string name;
+        load_profile::stages profile;
+
+        explicit load_job(std::string n) : name(std::move(n)) { load_profile::begin_load(); }
+        ~load_job() { load_profile::end_load(name, profile); }
+    };
+
+    static bool load_cfg(const std::string &layout_file, staged_layout &out);
+    static bool load_texture(const std::string &image_file, staged_layout &out);
+    void unload_texture();
     void unload_elements();
-    void load_element(const QJsonObject &obj, bool debug);
+    void queue_load(bool only_if_changed);
+    static void load_element(staged_layout &out, const element_desc &desc, const QString &id, bool debug);
+    void mark_unchanged();
+    bool smooth_axes();
+    void process_axes();
+    void draw_elements(gs_effect_t *effect);
+    void draw_cached(gs_effect_t *effect);
+    bool update_background(gs_effect_t *effect);
 
     static const char *element_type_to_string(element_type t);
 
+    std::shared_ptr<gs_image_file_t> m_texture; /* Shared with other sources using the same image */
     gs_image_file_t *m_image = nullptr;
     sources::overlay_settings *m_settings = nullptr;
     bool m_is_loaded = false;
-    std::vector<std::unique_ptr<element>> m_elements;
+    element_table m_elements;
+    sprite_batch m_batch;
     uint16_t m_track_radius{};
     uint16_t m_max_mouse_movement{};
     float m_arrow_rot = 0.f;
+
+    /* Generation of the input data seen in the last refresh_data call, if
+     * nothing changed copying and ticking can be skipped */
+    const input_data *m_source = nullptr;
+    const gamepad::device *m_gamepad = nullptr;
+    uint64_t m_generation = 0;
+    bool m_settled = false;
+    bool m_needs_tick = true;
+    uint8_t m_channels = IC_ALL; /* Parts of the input the loaded layout reads */
+
+    std::shared_ptr<load_job> m_job; /* Load in progress, shared with the loader thread */
+    std::vector<element_desc> m_descs; /* Of the loaded elements, to find the changed ones on reload */
+    file_stamp m_image_stamp, m_layout_stamp;
+
+    axis_jitter_buffer m_jitter; /* Raw axis values of the selected gamepad, if smoothing is enabled */
+    axis_response m_response;    /* Settings m_settings->axes was last computed with */
+
+    std::weak_ptr<network::io_client> m_client; /* Cached remote client handle */
+
+    /* Optional render cache, only redrawn if something changed */
+    gs_texrender_t *m_cache = nullptr;
+    const input_cache::snapshot *m_snapshot = nullptr;
+    uint64_t m_snapshot_version = 0;
+    bool m_dirty = true;
+
+    /* Textures and released buttons drawn once, only pressed ones are drawn on top of it */
+    gs_texrender_t *m_background = nullptr;
+    bool m_background_valid = false;
+    bool m_use_background = false;
 };
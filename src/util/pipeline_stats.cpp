@@ -0,0 +1,190 @@
+/*************************************************************************
+ * This file is part of input-overlay
+ * github.con/univrsal/input-overlay
+ * Copyright 2022 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#include "pipeline_stats.hpp"
+#include "config.hpp"
+#include "input_hub.hpp"
+#include "json_writer.hpp"
+#include "log.h"
+#include <algorithm>
+#include <mutex>
+#include <obs-module.h>
+
+namespace pipeline_stats {
+std::atomic<bool> enabled{false};
+std::atomic<uint64_t> counters[COUNTER_COUNT]{};
+
+static const char *stage_names[STAGE_COUNT] = {"hook", "network", "snapshot", "tick", "render"};
+
+struct stage_samples {
+    std::mutex mutex;
+    float samples[PIPELINE_SAMPLE_COUNT]{}; /* µs */
+    size_t count = 0, pos = 0;
+    uint64_t total = 0;
+};
+
+struct stage_info {
+    uint64_t count = 0;
+    float p50 = 0, p99 = 0, max = 0;
+};
+
+struct rates {
+    float events = 0, drops = 0, copies_per_frame = 0, frames = 0;
+};
+
+static stage_samples stages[STAGE_COUNT];
+
+/* Only touched by the tick callback, except for the rates */
+static std::mutex rate_mutex;
+static rates current_rates;
+static uint64_t last_counters[COUNTER_COUNT]{};
+static uint64_t last_events = 0;
+static uint64_t frames = 0;
+static float window = 0, since_log = 0;
+
+void add_sample(stage s, uint64_t ns)
+{
+    auto &stage = stages[s];
+    std::lock_guard<std::mutex> lock(stage.mutex);
+    stage.samples[stage.pos] = ns / 1000.f;
+    stage.pos = (stage.pos + 1) % PIPELINE_SAMPLE_COUNT;
+    stage.count = std::min<size_t>(stage.count + 1, PIPELINE_SAMPLE_COUNT);
+    stage.total++;
+}
+
+static stage_info info(stage s)
+{
+    auto &stage = stages[s];
+    stage_info result;
+    float samples[PIPELINE_SAMPLE_COUNT];
+    size_t count;
+    {
+        std::lock_guard<std::mutex> lock(stage.mutex);
+        result.count = stage.total;
+        count = stage.count;
+        std::copy(stage.samples, stage.samples + count, samples);
+    }
+
+    if (count) {
+        auto *p50 = samples + count / 2;
+        auto *p99 = samples + std::min(count - 1, count * 99 / 100);
+        std::nth_element(samples, p50, samples + count);
+        result.p50 = *p50;
+        std::nth_element(samples, p99, samples + count);
+        result.p99 = *p99;
+        result.max = *std::max_element(samples, samples + count);
+    }
+    return result;
+}
+
+static rates get_rates()
+{
+    std::lock_guard<std::mutex> lock(rate_mutex);
+    return current_rates;
+}
+
+static void log_stats()
+{
+    std::string line;
+    char buf[96];
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        const auto s = info(stage(i));
+        snprintf(buf, sizeof(buf), "%s%s %.1f/%.1f", line.empty() ? "" : ", ", stage_names[i], s.p50, s.p99);
+        line += buf;
+    }
+    const auto r = get_rates();
+    binfo("Pipeline p50/p99 µs: %s | %.0f events/s, %.0f drops/s, %.2f copies/frame", line.c_str(), r.events,
+          r.drops, r.copies_per_frame);
+}
+
+static void tick(void *, float seconds)
+{
+    frames++;
+    window += seconds;
+    since_log += seconds;
+    if (window < 1.f)
+        return;
+
+    uint64_t now[COUNTER_COUNT];
+    for (int i = 0; i < COUNTER_COUNT; i++)
+        now[i] = counters[i].load(std::memory_order_relaxed);
+    const auto events = input_hub::published();
+    {
+        std::lock_guard<std::mutex> lock(rate_mutex);
+        current_rates.events = (events - last_events) / window;
+        current_rates.drops = (now[COUNTER_DROPS] - last_counters[COUNTER_DROPS]) / window;
+        current_rates.copies_per_frame = float(now[COUNTER_COPIES] - last_counters[COUNTER_COPIES]) / frames;
+        current_rates.frames = frames / window;
+    }
+    std::copy(now, now + COUNTER_COUNT, last_counters);
+    last_events = events;
+    frames = 0;
+    window = 0;
+
+    if (io_config::pipeline_stats_log && since_log >= io_config::pipeline_stats_log) {
+        log_stats();
+        since_log = 0;
+    }
+}
+
+void start()
+{
+    if (!io_config::pipeline_stats || enabled)
+        return;
+    last_events = input_hub::published();
+    enabled = true;
+    obs_add_tick_callback(tick, nullptr);
+    binfo("Collecting pipeline stats");
+}
+
+void stop()
+{
+    if (!enabled)
+        return;
+    enabled = false;
+    obs_remove_tick_callback(tick, nullptr);
+}
+
+void serialize(std::string &out)
+{
+    json_writer json(out);
+    json.field("event_type", "stats").field("enabled", active());
+    if (!active()) {
+        json.end();
+        return;
+    }
+
+    json.begin_object("stages");
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        const auto s = info(stage(i));
+        json.begin_object(stage_names[i])
+            .field("count", int64_t(s.count))
+            .field("p50", double(s.p50))
+            .field("p99", double(s.p99))
+            .field("max", double(s.max))
+            .end_object();
+    }
+    const auto r = get_rates();
+    json.end_object()
+        .field("events_per_second", double(r.events))
+        .field("drops_per_second", double(r.drops))
+        .field("copies_per_frame", double(r.copies_per_frame))
+        .field("frames_per_second", double(r.frames))
+        .end();
+}
+}
@@ -0,0 +1,84 @@
+/*************************************************************************
+ * This file is part of input-overlay
+ * github.con/univrsal/input-overlay
+ * Copyright 2022 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <util/platform.h>
+
+#define PIPELINE_SAMPLE_COUNT 512 /* Per stage, used for the percentiles */
+
+/* Where time goes between the input hook and the rendered frame. Stages
+ * measure how long one pass took, counters are turned into rates once per
+ * second. Everything is a single relaxed load if it's disabled */
+namespace pipeline_stats {
+enum stage {
+    STAGE_HOOK,     /* uiohook::process_event */
+    STAGE_NETWORK,  /* io_server::update_clients */
+    STAGE_SNAPSHOT, /* overlay::refresh_data */
+    STAGE_TICK,     /* input_source::tick */
+    STAGE_RENDER,   /* input_source::render */
+    STAGE_COUNT
+};
+
+/* Input events are counted by input_hub */
+enum counter {
+    COUNTER_DROPS,  /* Events that were thrown away, full queues or rate limits */
+    COUNTER_COPIES, /* Input state copied by sources */
+    COUNTER_COUNT
+};
+
+extern std::atomic<bool> enabled;
+extern std::atomic<uint64_t> counters[COUNTER_COUNT];
+
+inline bool active()
+{
+    return enabled.load(std::memory_order_relaxed);
+}
+
+inline void count(counter c, uint64_t n = 1)
+{
+    if (active())
+        counters[c].fetch_add(n, std::memory_order_relaxed);
+}
+
+void add_sample(stage s, uint64_t ns);
+
+class scope {
+    stage m_stage;
+    uint64_t m_start;
+
+public:
+    explicit scope(stage s) : m_stage(s), m_start(active() ? os_gettime_ns() : 0) {}
+    ~scope()
+    {
+        if (m_start)
+            add_sample(m_stage, os_gettime_ns() - m_start);
+    }
+};
+
+/* Only does something if pipeline_stats is enabled in the config */
+void start();
+void stop();
+
+/* {"event_type": "stats", "enabled": true, "stages": {"hook": {"count", "p50",
+ * "p99", "max"}, ...}, "events_per_second", "drops_per_second",
+ * "copies_per_frame", "frames_per_second"}, times are in µs */
+void serialize(std::string &out);
+}
@@ -0,0 +1,198 @@
+/*************************************************************************
+ * This file is part of input-overlay
+ * github.con/univrsal/input-overlay
+ * Copyright 2022 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#include "recorder.hpp"
+#include "config.hpp"
+#include "input_hub.hpp"
+#include "log.h"
+#include "obs_util.hpp"
+#include "trace.hpp"
+#include <buffer.hpp>
+#include <messages.hpp>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <util/platform.h>
+#include <util/threading.h>
+
+#define RECORDING_READ_INTERVAL 50   /* ms, well within what input_hub keeps */
+#define RECORDING_FLUSH_INTERVAL 250 /* ms */
+#define RECORDING_READ_BATCH 256
+
+namespace recorder {
+std::atomic<bool> recording{false};
+
+static std::mutex control_mutex; /* Serializes start and stop */
+static std::thread writer_thread;
+static std::unique_ptr<QFile> file;
+static uint64_t start_time = 0;
+static input_hub::cursor hub; /* Only used by the writer thread while recording */
+
+static record_type to_record_type(input_hub::kind type)
+{
+    switch (type) {
+    case input_hub::KIND_PAD_AXIS:
+        return REC_PAD_AXIS;
+    case input_hub::KIND_PAD_BUTTON:
+        return REC_PAD_BUTTON;
+    case input_hub::KIND_PAD_CONNECTED:
+        return REC_PAD_CONNECTED;
+    case input_hub::KIND_PAD_RECONNECTED:
+        return REC_PAD_RECONNECTED;
+    case input_hub::KIND_PAD_DISCONNECTED:
+        return REC_PAD_DISCONNECTED;
+    default:
+        return REC_UIOHOOK;
+    }
+}
+
+static void encode(buffer &record, const input_hub::event &e, uint64_t &last_time,
+                   network::compact_event_state &compact)
+{
+    const auto type = to_record_type(e.type);
+    record.reset();
+    record.write<uint8_t>(0); /* Length, filled in at the end */
+    record.write<uint8_t>(type);
+    network::write_varint(record, e.time > last_time ? (e.time - last_time) / 1000 : 0);
+    if (e.time > last_time)
+        last_time = e.time;
+
+    switch (type) {
+    case REC_UIOHOOK:
+        network::write_compact_event(record, compact, e.uiohook);
+        break;
+    case REC_PAD_CONNECTED:
+    case REC_PAD_RECONNECTED:
+    case REC_PAD_DISCONNECTED: {
+        const auto id = input_hub::device_name(e.channel, e.device_index).substr(0, RECORDING_MAX_ID);
+        record.write<uint8_t>(e.device_index);
+        record.write<uint8_t>(uint8_t(id.size()));
+        record.write(id.data(), id.size());
+        break;
+    }
+    case REC_PAD_AXIS:
+    case REC_PAD_BUTTON:
+        record.write<uint8_t>(e.device_index);
+        record.write<uint16_t>(e.pad.vc);
+        record.write<float>(e.pad.virtual_value);
+        break;
+    }
+    record[0] = uint8_t(record.write_pos() - 1);
+}
+
+static void writer_method()
+{
+    os_set_thread_name("inputovrly-recorder");
+    IO_TRACE_THREAD("inputovrly-recorder");
+    buffer record(RECORDING_MAX_ID + 32);
+    std::string batch;
+    std::vector<input_hub::event> events(RECORDING_READ_BATCH);
+    network::compact_event_state compact;
+    auto last_time = start_time, last_flush = start_time;
+    uint64_t bytes = 0, reported_drops = hub.dropped();
+
+    for (;;) {
+        /* Checked before reading so everything published before stop() is written */
+        const bool running = active();
+        for (size_t count; (count = hub.read(events.data(), events.size())) > 0;) {
+            for (size_t i = 0; i < count; i++) {
+                if (events[i].channel != HUB_LOCAL)
+                    continue;
+                encode(record, events[i], last_time, compact);
+                batch.append(reinterpret_cast<const char *>(record.get()), record.write_pos());
+            }
+        }
+
+        const auto now = os_gettime_ns();
+        if (!batch.empty() && (!running || now - last_flush >= RECORDING_FLUSH_INTERVAL * 1000000ull)) {
+            IO_TRACE_ZONE("recording flush");
+            if (file->write(batch.data(), qint64(batch.size())) != qint64(batch.size()))
+                berr("Couldn't write to input recording %s", qt_to_utf8(file->fileName()));
+            file->flush();
+            bytes += batch.size();
+            batch.clear();
+            last_flush = now;
+        }
+
+        const auto drops = hub.dropped();
+        if (drops != reported_drops) {
+            bwarn("Input recording couldn't keep up, dropped %llu events in total", (unsigned long long)drops);
+            reported_drops = drops;
+        }
+
+        if (!running)
+            break;
+        os_sleep_ms(RECORDING_READ_INTERVAL);
+    }
+
+    binfo("Stopped input recording %s after %.1f s, %.1f KiB", qt_to_utf8(file->fileName()),
+          (os_gettime_ns() - start_time) / 1e9, bytes / 1024.0);
+}
+
+void start()
+{
+    std::lock_guard<std::mutex> lock(control_mutex);
+    if (!io_config::record_input || active())
+        return;
+
+    const auto dir_path =
+        io_config::record_path.empty() ? util_get_data_file("recordings") : utf8_to_qt(io_config::record_path.c_str());
+    QDir dir(dir_path);
+    if (!dir.mkpath(".")) {
+        berr("Couldn't create input recording directory %s", qt_to_utf8(dir_path));
+        return;
+    }
+
+    const auto name = QString("input-%1." RECORDING_EXTENSION)
+                          .arg(QDateTime::currentDateTime().toString("yyyy-MM-dd_hh-mm-ss"));
+    file = std::make_unique<QFile>(dir.absoluteFilePath(name));
+    if (!file->open(QIODevice::WriteOnly)) {
+        berr("Couldn't open input recording %s", qt_to_utf8(file->fileName()));
+        file = nullptr;
+        return;
+    }
+
+    buffer header(RECORDING_HEADER_SIZE + 1);
+    header.write<uint32_t>(RECORDING_MAGIC);
+    header.write<uint8_t>(RECORDING_VERSION);
+    header.write<uint64_t>(uint64_t(QDateTime::currentMSecsSinceEpoch()));
+    file->write(reinterpret_cast<const char *>(header.get()), qint64(header.write_pos()));
+
+    hub.skip();
+    start_time = os_gettime_ns();
+    recording = true;
+    writer_thread = std::thread(writer_method);
+    binfo("Recording input to %s", qt_to_utf8(file->fileName()));
+}
+
+void stop()
+{
+    std::lock_guard<std::mutex> lock(control_mutex);
+    if (!active())
+        return;
+    recording = false;
+    if (writer_thread.joinable())
+        writer_thread.join();
+    file->close();
+    file = nullptr;
+}
+}
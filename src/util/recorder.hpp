@@ -0,0 +1,63 @@
+/*************************************************************************
+ * This file is part of input-overlay
+ * github.con/univrsal/input-overlay
+ * Copyright 2022 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+/* Recordings (*.iorec) of the local input, only ever appended to so a crash
+ * at most loses the last flush. Everything is little-endian:
+ *  - header: RECORDING_MAGIC, uint8_t RECORDING_VERSION, uint64_t unix time
+ *    in ms when the recording was started
+ *  - records: uint8_t length of the rest, uint8_t record_type, varint µs
+ *    since the previous record (or the start) and the payload:
+ *    - REC_UIOHOOK: a MSG_UIOHOOK_COMPACT message, see messages.hpp. There
+ *      is one compact_event_state for the whole recording
+ *    - REC_PAD_*CONNECTED: uint8_t device index, uint8_t id length and the id
+ *    - REC_PAD_AXIS/BUTTON: uint8_t device index, uint16_t code, float value
+ * Readers skip records with unknown types and ignore a cut off last record */
+#define RECORDING_MAGIC 0x43524f49 /* "IORC" */
+#define RECORDING_VERSION 1
+#define RECORDING_HEADER_SIZE 13
+#define RECORDING_MAX_ID 200
+#define RECORDING_EXTENSION "iorec"
+
+enum record_type : uint8_t {
+    REC_UIOHOOK,
+    REC_PAD_CONNECTED,
+    REC_PAD_RECONNECTED,
+    REC_PAD_DISCONNECTED,
+    REC_PAD_AXIS,
+    REC_PAD_BUTTON,
+};
+
+/* Writes the events of the local hooks to a recording while the hooks run,
+ * if io_config::record_input is enabled. A separate thread reads them from
+ * input_hub, encodes and writes them */
+namespace recorder {
+extern std::atomic<bool> recording;
+
+inline bool active()
+{
+    return recording.load(std::memory_order_relaxed);
+}
+
+/* Creates a new file in io_config::record_path, does nothing if recording is disabled */
+void start();
+void stop();
+}
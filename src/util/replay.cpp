@@ -0,0 +1,297 @@
+/*************************************************************************
+ * This file is part of input-overlay
+ * github.con/univrsal/input-overlay
+ * Copyright 2022 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#include "replay.hpp"
+#include "recorder.hpp"
+#include "log.h"
+#include "obs_util.hpp"
+#include "input_hub.hpp"
+#include "trace.hpp"
+#include <QFile>
+#include <algorithm>
+#include <libgamepad.hpp>
+#include <util/platform.h>
+#include <util/threading.h>
+
+/* Long pauses in a recording are slept in steps, so playback can be stopped */
+#define REPLAY_MAX_SLEEP 100000000 /* ns */
+
+namespace replay {
+static std::mutex registry_mutex;
+static std::map<std::string, std::weak_ptr<player>> players;
+
+player::player(const std::string &name, bool max_speed, bool loop)
+    : m_name(name), m_channel(input_hub::channel(name)), m_max_speed(max_speed), m_loop(loop)
+{
+}
+
+player::~player()
+{
+    m_running = false;
+    if (m_thread.joinable())
+        m_thread.join();
+}
+
+bool player::start(const std::string &path)
+{
+    QFile file(utf8_to_qt(path.c_str()));
+    if (!file.open(QIODevice::ReadOnly)) {
+        bwarn("Couldn't open input recording %s", path.c_str());
+        return false;
+    }
+
+    const auto content = file.readAll();
+    uint32_t magic = 0;
+    if (content.size() >= RECORDING_HEADER_SIZE)
+        memcpy(&magic, content.constData(), sizeof(magic));
+    if (magic != RECORDING_MAGIC || uint8_t(content.constData()[4]) != RECORDING_VERSION) {
+        bwarn("%s isn't an input recording or was made by a different version", path.c_str());
+        return false;
+    }
+
+    m_recording.assign(content.constData(), content.constData() + content.size());
+    m_running = true;
+    m_thread = std::thread(&player::run, this);
+    binfo("Playing input recording %s (%.1f KiB)%s%s", path.c_str(), content.size() / 1024.0,
+          m_max_speed ? " at max speed" : "", m_loop ? " in a loop" : "");
+    return true;
+}
+
+void player::run()
+{
+    os_set_thread_name("inputovrly-replay");
+    IO_TRACE_THREAD("inputovrly-replay");
+    while (m_running) {
+        const bool played = play();
+        reset();
+        if (!m_loop || !played)
+            break;
+    }
+}
+
+bool player::play()
+{
+    buffer record(0xff);
+    network::compact_event_state compact;
+    const auto *data = m_recording.data() + RECORDING_HEADER_SIZE;
+    const auto *end = m_recording.data() + m_recording.size();
+    const auto begin = os_gettime_ns();
+    uint64_t offset = 0; /* ns since the start of the recording */
+    bool played = false;
+
+    while (data < end && m_running) {
+        const size_t size = *data++;
+        if (size > size_t(end - data))
+            break; /* Cut off by a crash */
+        if (!size)
+            continue;
+        record.assign(data, size);
+        data += size;
+
+        uint8_t type;
+        uint64_t delta = 0;
+        if (!record.read(type) || !network::read_varint(record, delta))
+            continue;
+        offset += delta * 1000;
+
+        if (!m_max_speed) {
+            const auto due = begin + offset;
+            for (auto now = os_gettime_ns(); now < due && m_running; now = os_gettime_ns())
+                os_sleepto_ns(std::min(due, now + REPLAY_MAX_SLEEP));
+        }
+        play_record(type, record, compact);
+        played = true;
+    }
+    return played && m_running;
+}
+
+void player::dispatch(uiohook_event &event, uint64_t now)
+{
+    /* Played events happen now, the recorded time only decides when */
+    event.time = now / 1000000;
+    m_data.dispatch_uiohook_event(&event, now);
+    input_hub::publish_uiohook(m_channel, event, now);
+}
+
+void player::play_record(uint8_t type, buffer &record, network::compact_event_state &compact)
+{
+    IO_TRACE_ZONE("replay event");
+    const auto now = os_gettime_ns();
+    switch (type) {
+    case REC_UIOHOOK: {
+        uint8_t id;
+        uiohook_event event;
+        if (record.read(id) && id == network::MSG_UIOHOOK_COMPACT &&
+            network::read_compact_event(record, compact, event))
+            dispatch(event, now);
+        break;
+    }
+    case REC_PAD_CONNECTED:
+    case REC_PAD_RECONNECTED:
+    case REC_PAD_DISCONNECTED: {
+        uint8_t index, length;
+        void *chars = nullptr;
+        if (!record.read(index) || !record.read(length))
+            break;
+        if (length)
+            record.read(&chars, length);
+        if (length && !chars)
+            break;
+
+        const std::string id(static_cast<const char *>(chars), chars ? length : 0);
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto &slot = m_gamepads[index];
+        if (!slot || slot->get_id() != id) {
+            if (slot)
+                slot->invalidate(); /* Sources still holding it look it up again */
+            slot = std::make_shared<gamepad::device>();
+            slot->set_index(index);
+            slot->set_id(id);
+        }
+        if (type == REC_PAD_DISCONNECTED)
+            slot->invalidate();
+        else
+            slot->set_valid();
+        m_data.bump_generation();
+        input_hub::publish_pad_state(m_channel, index,
+                                     type == REC_PAD_CONNECTED      ? input_hub::KIND_PAD_CONNECTED
+                                     : type == REC_PAD_RECONNECTED ? input_hub::KIND_PAD_RECONNECTED
+                                                                   : input_hub::KIND_PAD_DISCONNECTED,
+                                     id);
+        break;
+    }
+    case REC_PAD_AXIS:
+    case REC_PAD_BUTTON: {
+        uint8_t index;
+        uint16_t code;
+        float value;
+        if (!record.read(index) || !record.read(code) || !record.read(value))
+            break;
+
+        const bool is_axis = type == REC_PAD_AXIS;
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto device = pad(index);
+        auto *event = is_axis ? device->last_axis_event() : device->last_button_event();
+        if (is_axis)
+            device->get_axis()[code] = value;
+        else
+            device->get_buttons()[code] = value != 0.f;
+        event->vc = code;
+        event->virtual_value = value;
+        event->time = now / 1000000;
+        m_data.bump_generation();
+        input_hub::publish_pad(m_channel, index, is_axis, input_hub::pad_input_of(*event));
+        break;
+    }
+    default:; /* Newer record type */
+    }
+}
+
+std::shared_ptr<gamepad::device> player::pad(uint8_t index)
+{
+    /* Recordings started while a pad was plugged in might not have its connect */
+    auto &slot = m_gamepads[index];
+    if (!slot) {
+        slot = std::make_shared<gamepad::device>();
+        slot->set_index(index);
+        slot->set_id("replay " + std::to_string(index));
+        slot->set_valid();
+    }
+    return slot;
+}
+
+void player::reset()
+{
+    const auto now = os_gettime_ns();
+    input_state state;
+    m_data.read(state);
+
+    state.keyboard.for_each([&](size_t code) {
+        uiohook_event event{};
+        event.type = EVENT_KEY_RELEASED;
+        event.data.keyboard.keycode = uint16_t(code);
+        event.data.keyboard.keychar = CHAR_UNDEFINED;
+        dispatch(event, now);
+    });
+    state.mouse.for_each([&](size_t button) {
+        uiohook_event event{};
+        event.type = EVENT_MOUSE_RELEASED;
+        event.data.mouse.button = uint16_t(button);
+        event.data.mouse.x = state.last_mouse_movement.x;
+        event.data.mouse.y = state.last_mouse_movement.y;
+        dispatch(event, now);
+    });
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto &pad : m_gamepads) {
+        for (auto &axis : pad.second->get_axis())
+            axis.second = 0.f;
+        for (auto &button : pad.second->get_buttons())
+            button.second = false;
+    }
+    m_data.bump_generation();
+}
+
+std::shared_ptr<gamepad::device> player::get_pad(const std::string &id)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const auto &pad : m_gamepads) {
+        if (pad.second->get_id() == id)
+            return pad.second;
+    }
+    return nullptr;
+}
+
+std::vector<std::string> player::pad_ids()
+{
+    std::vector<std::string> ids;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const auto &pad : m_gamepads)
+        ids.emplace_back(pad.second->get_id());
+    return ids;
+}
+
+std::shared_ptr<player> get(const std::string &path, bool max_speed, bool loop)
+{
+    auto name = "replay:" + path;
+    if (max_speed)
+        name += "|max";
+    if (loop)
+        name += "|loop";
+
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    for (auto it = players.begin(); it != players.end();) {
+        if (it->second.expired())
+            it = players.erase(it);
+        else
+            ++it;
+    }
+
+    auto &entry = players[name];
+    if (auto existing = entry.lock())
+        return existing;
+
+    auto result = std::make_shared<player>(name, max_speed, loop);
+    if (!result->start(path)) {
+        players.erase(name);
+        return nullptr;
+    }
+    entry = result;
+    return result;
+}
+}
@@ -0,0 +1,77 @@
+/*************************************************************************
+ * This file is part of input-overlay
+ * github.con/univrsal/input-overlay
+ * Copyright 2022 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#pragma once
+#include "input_data.hpp"
+#include <buffer.hpp>
+#include <messages.hpp>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/* Plays recordings (see recorder.hpp) back on their own thread. Events go
+ * through the same input_data and websocket paths as live input, with the
+ * time they're played at, so sources don't need running hooks for them */
+namespace replay {
+class player {
+    std::string m_name; /* Cache key and websocket source name */
+    uint16_t m_channel; /* See input_hub */
+    std::vector<uint8_t> m_recording;
+    bool m_max_speed, m_loop;
+
+    input_data m_data;
+    std::mutex m_mutex; /* Guards the gamepads */
+    std::map<uint8_t, std::shared_ptr<gamepad::device>> m_gamepads;
+
+    std::thread m_thread;
+    std::atomic<bool> m_running{false};
+
+    void run();
+    /* Plays the recording once, false if it had no events or playback was stopped */
+    bool play();
+    void play_record(uint8_t type, buffer &record, network::compact_event_state &compact);
+    void dispatch(uiohook_event &event, uint64_t now);
+    std::shared_ptr<gamepad::device> pad(uint8_t index);
+    /* Releases everything between two passes */
+    void reset();
+
+public:
+    /* max_speed plays without waiting between events */
+    player(const std::string &name, bool max_speed, bool loop);
+    ~player();
+
+    /* Reads the whole file and starts playing it */
+    bool start(const std::string &path);
+
+    const std::string &name() const { return m_name; }
+    input_data *data() { return &m_data; }
+
+    /* Guards the gamepads, which are written by the playback thread */
+    std::mutex &mutex() { return m_mutex; }
+    std::shared_ptr<gamepad::device> get_pad(const std::string &id);
+    std::vector<std::string> pad_ids();
+};
+
+/* Sources that play the same file with the same options share one player,
+ * returns nullptr if the file couldn't be read */
+std::shared_ptr<player> get(const std::string &path, bool max_speed, bool loop);
+}
@@ -0,0 +1,135 @@
+/*************************************************************************
+ * This file is part of input-overlay
+ * github.con/univrsal/input-overlay
+ * Copyright 2022 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#include "services.hpp"
+#include "config.hpp"
+#include "loader.hpp"
+#include "load_profile.hpp"
+#include "log.h"
+#include "recorder.hpp"
+#include "timer_wheel.hpp"
+#include "../hook/gamepad_hook_helper.hpp"
+#include "../hook/uiohook_helper.hpp"
+#include "../network/remote_connection.hpp"
+#include <mutex>
+
+namespace services {
+static std::mutex mutex;
+static int refs = 0;
+static bool running = false; /* Hooks and server were started */
+static bool enabled = false; /* Between start and stop */
+static void on_idle_timer(void *);
+static timers::timer idle_timer(on_idle_timer, nullptr);
+
+/* Mutex has to be locked for both */
+static void start_all()
+{
+    /* Before the hooks, so the pads that are already plugged in are recorded as connects */
+    recorder::start();
+
+    load_profile::stages profile;
+    if (io_config::enable_uiohook) {
+        load_profile::scope s(profile, "uiohook");
+        uiohook::start();
+    }
+
+    if (io_config::enable_gamepad_hook) {
+        load_profile::scope s(profile, "gamepad");
+        libgamepad::start_pad_hook();
+    }
+
+    if (io_config::enable_remote_connections) {
+        load_profile::scope s(profile, "network");
+        network::local_input = io_config::enable_gamepad_hook || io_config::enable_uiohook;
+        network::start_network(io_config::server_port);
+    }
+    running = true;
+    load_profile::report("Starting input services", profile);
+}
+
+static void stop_all()
+{
+    recorder::stop();
+    libgamepad::end_pad_hook();
+    uiohook::stop();
+    network::close_network();
+    running = false;
+}
+
+static void stop_if_idle()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (enabled && running && refs == 0) {
+        binfo("Nothing uses input for %i seconds, stopping hooks", int(io_config::idle_stop_delay));
+        stop_all();
+    }
+}
+
+static void on_idle_timer(void *)
+{
+    loader::queue(stop_if_idle);
+}
+
+void start()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    enabled = true;
+    if (!io_config::lazy_start)
+        start_all();
+}
+
+void stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        enabled = false;
+        if (running)
+            stop_all();
+    }
+    timers::cancel(idle_timer);
+}
+
+void acquire()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    refs++;
+    if (enabled && !running) {
+        binfo("Input is needed, starting hooks");
+        start_all();
+    }
+}
+
+void release()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (refs > 0)
+        refs--;
+    if (refs > 0 || !running || !io_config::lazy_start)
+        return;
+
+    /* Stopping can destroy remote clients, which cancel their own timers and
+     * that can't happen on the timer thread, so it's left to the loader */
+    timers::arm(idle_timer, uint64_t(io_config::idle_stop_delay) * 1000000000ull);
+}
+
+bool active()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return running;
+}
+}
@@ -0,0 +1,37 @@
+/*************************************************************************
+ * This file is part of input-overlay
+ * github.con/univrsal/input-overlay
+ * Copyright 2022 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#pragma once
+
+/* Input hooks and the remote connection server are only needed while
+ * something shows their input. Every input source and websocket client
+ * holds a reference, the first one starts them and they're stopped again
+ * once nobody used them for io_config::idle_stop_delay seconds */
+namespace services {
+/* Starts everything right away if lazy starting is disabled */
+void start();
+
+/* Stops everything, acquire does nothing after this */
+void stop();
+
+void acquire();
+
+void release();
+
+bool active();
+}
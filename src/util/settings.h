@@ -24,6 +24,8 @@
 #define S_UIOHOOK                       "iohook"
 #define S_USE_DINPUT                    "use_dinput"
 #define S_USE_JS                        "use_js"
+#define S_USE_EVDEV                     "use_evdev"
+#define S_USE_RAW_INPUT                 "use_raw_input"
 #define S_GAMEPAD                       "gamepad"
 #define S_OVERLAY                       "overlay"
 #define S_HISTORY                       "history"
@@ -36,6 +38,25 @@
 #define S_CONTROL                       "control"
 #define S_REGEX                         "regex"
 #define S_FILTER_MODE                   "filter_mode"
+#define S_CLIENT_MESSAGE_RATE           "client_message_rate"
+#define S_CLIENT_BYTE_RATE              "client_byte_rate"
+#define S_PAD_IDLE_POLL                 "pad_idle_poll"
+#define S_PAD_AXIS_DEADBAND             "pad_axis_deadband"
+#define S_PAD_AXIS_STEP                 "pad_axis_step"
+#define S_WSS_MOUSE_RATE                "wss_mouse_rate"
+#define S_WSS_AXIS_RATE                 "wss_axis_rate"
+#define S_WSS_SLOW_BYTES                "wss_slow_bytes"
+#define S_WSS_MAX_BYTES                 "wss_max_bytes"
+#define S_INPUT_THREAD_PRIORITY         "input_thread_priority"
+#define S_NETWORK_THREAD_PRIORITY       "network_thread_priority"
+#define S_THREAD_AFFINITY               "thread_affinity"
+#define S_LAZY_START                    "lazy_start"
+#define S_IDLE_STOP_DELAY               "idle_stop_delay"
+#define S_TRIM_ATLAS                    "trim_atlas"
+#define S_PIPELINE_STATS                "pipeline_stats"
+#define S_PIPELINE_STATS_LOG            "pipeline_stats_log"
+#define S_RECORD_INPUT                  "record_input"
+#define S_RECORD_PATH                   "record_path"
 
 /* Misc values */
 #define S_INPUT_SOURCE                  "io.input_source"
@@ -53,6 +74,13 @@
 #define S_MONITOR_H_CENTER              "io.monitor_h_center"
 #define S_MONITOR_V_CENTER              "io.monitor_v_center"
 #define S_RELOAD_PAD_DEVICES            "io.reload_pads"
+#define S_PAD_JITTER_DELAY              "io.pad_jitter_delay"
+#define S_PAD_RESPONSE_CURVE            "io.pad_response_curve"
+#define S_RENDER_CACHE                  "io.render_cache"
+#define S_BAKE_STATIC                   "io.bake_static"
+#define S_REPLAY_FILE                   "io.replay_file"
+#define S_REPLAY_MAX_SPEED              "io.replay_max_speed"
+#define S_REPLAY_LOOP                   "io.replay_loop"
 
 /* History source */
 #define S_HISTORY_SIZE                  "io.history_size"
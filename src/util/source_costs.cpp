@@ -0,0 +1,174 @@
+/*************************************************************************
+ * This file is part of input-overlay
+ * github.con/univrsal/input-overlay
+ * Copyright 2022 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#include "source_costs.hpp"
+#include <algorithm>
+#include <mutex>
+#include <obs-module.h>
+#include <util/platform.h>
+
+namespace source_costs {
+std::atomic<bool> enabled{false};
+meter *meter::m_current = nullptr;
+
+static std::mutex registry_mutex;
+static std::vector<meter *> meters;
+
+static void smooth(float &average, float sample)
+{
+    average += (sample - average) * COST_SMOOTHING;
+}
+
+meter::meter(obs_source_t *source) : m_source(source)
+{
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    meters.emplace_back(this);
+}
+
+meter::~meter()
+{
+    {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        meters.erase(std::remove(meters.begin(), meters.end(), this), meters.end());
+    }
+
+    if (m_timers_created) {
+        obs_enter_graphics();
+        for (auto &t : m_timers) {
+            gs_timer_destroy(t.timer);
+            gs_timer_range_destroy(t.range);
+        }
+        obs_leave_graphics();
+    }
+}
+
+void meter::begin_tick()
+{
+    if (!active())
+        return;
+    m_start = os_gettime_ns();
+    m_bytes = 0;
+    m_current = this;
+}
+
+void meter::end_tick(uint32_t elements)
+{
+    if (!m_start)
+        return;
+    m_current = nullptr;
+    const auto us = (os_gettime_ns() - m_start) / 1000.f;
+    m_start = 0;
+
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    smooth(m_info.tick, us);
+    smooth(m_info.bytes, float(m_bytes));
+    m_info.elements = elements;
+}
+
+void meter::begin_render()
+{
+    if (!active())
+        return;
+    m_start = os_gettime_ns();
+    m_draws = 0;
+    m_current = this;
+
+    /* Timer queries aren't supported by every renderer, then these are null */
+    if (!m_timers_created) {
+        m_timers_created = true;
+        for (auto &t : m_timers) {
+            t.range = gs_timer_range_create();
+            t.timer = t.range ? gs_timer_create() : nullptr;
+        }
+    }
+    read_timers();
+
+    /* Renders are only timed while a query is free, the cpu never waits for one */
+    auto &t = m_timers[m_timer_pos];
+    if (t.timer && !t.pending) {
+        gs_timer_range_begin(t.range);
+        gs_timer_begin(t.timer);
+        m_active_timer = &t;
+        m_timer_pos = (m_timer_pos + 1) % COST_GPU_TIMERS;
+    }
+}
+
+void meter::end_render()
+{
+    if (!m_start)
+        return;
+    m_current = nullptr;
+    if (m_active_timer) {
+        gs_timer_end(m_active_timer->timer);
+        gs_timer_range_end(m_active_timer->range);
+        m_active_timer->pending = true;
+        m_active_timer = nullptr;
+    }
+    const auto us = (os_gettime_ns() - m_start) / 1000.f;
+    m_start = 0;
+
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    smooth(m_info.render, us);
+    smooth(m_info.draw_calls, float(m_draws));
+}
+
+void meter::read_timers()
+{
+    for (auto &t : m_timers) {
+        if (!t.pending)
+            continue;
+
+        bool disjoint = false;
+        uint64_t frequency = 0, ticks = 0;
+        if (!gs_timer_range_get_data(t.range, &disjoint, &frequency) || !gs_timer_get_data(t.timer, &ticks))
+            continue; /* Not done yet */
+        t.pending = false;
+
+        /* A disjoint range means the clock changed while measuring */
+        if (disjoint || !frequency)
+            continue;
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        const auto us = float(ticks * 1000000.0 / frequency);
+        if (m_info.gpu < 0)
+            m_info.gpu = us;
+        else
+            smooth(m_info.gpu, us);
+    }
+}
+
+info meter::get() const
+{
+    auto result = m_info;
+    if (const auto *name = obs_source_get_name(m_source))
+        result.name = name;
+    return result;
+}
+
+std::vector<info> collect()
+{
+    std::vector<info> result;
+    {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        for (const auto *m : meters)
+            result.emplace_back(m->get());
+    }
+    std::sort(result.begin(), result.end(),
+              [](const info &a, const info &b) { return a.tick + a.render > b.tick + b.render; });
+    return result;
+}
+}
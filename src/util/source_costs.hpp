@@ -0,0 +1,110 @@
+/*************************************************************************
+ * This file is part of input-overlay
+ * github.con/univrsal/input-overlay
+ * Copyright 2022 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+typedef struct obs_source obs_source_t;
+typedef struct gs_timer gs_timer_t;
+typedef struct gs_timer_range gs_timer_range_t;
+
+#define COST_GPU_TIMERS 4   /* Queries in flight, results are read a few frames later so nothing stalls */
+#define COST_SMOOTHING 0.05f /* Weight of a new sample in the averages */
+
+/* What each source costs per frame, shown in the settings dialog to find
+ * heavy layouts. Only measured while the dialog is open, otherwise every
+ * call is a single relaxed load. Tick and render both run on the graphics
+ * thread, the averages are handed to the dialog under the registry lock */
+namespace source_costs {
+struct info {
+    std::string name;
+    float tick = 0, render = 0;      /* µs */
+    float gpu = -1;                  /* µs, negative if timer queries aren't supported */
+    float draw_calls = 0, bytes = 0; /* Draw calls per render, bytes copied per tick */
+    uint32_t elements = 0;
+};
+
+extern std::atomic<bool> enabled;
+
+inline bool active()
+{
+    return enabled.load(std::memory_order_relaxed);
+}
+
+class meter {
+public:
+    explicit meter(obs_source_t *source);
+    ~meter();
+
+    meter(const meter &) = delete;
+    meter &operator=(const meter &) = delete;
+
+    /* The meter of the source that is currently ticking or rendering or nullptr */
+    static meter *current() { return m_current; }
+
+    void begin_tick();
+    void end_tick(uint32_t elements);
+    void begin_render();
+    void end_render();
+
+    void add_draw() { m_draws++; }
+    void add_bytes(size_t bytes) { m_bytes += bytes; }
+
+    info get() const;
+
+private:
+    struct gpu_timer {
+        gs_timer_range_t *range = nullptr;
+        gs_timer_t *timer = nullptr;
+        bool pending = false;
+    };
+
+    void read_timers();
+
+    static meter *m_current;
+
+    obs_source_t *m_source;
+    uint64_t m_start = 0;
+    uint32_t m_draws = 0;
+    uint64_t m_bytes = 0;
+    gpu_timer m_timers[COST_GPU_TIMERS];
+    gpu_timer *m_active_timer = nullptr;
+    size_t m_timer_pos = 0;
+    bool m_timers_created = false;
+    info m_info; /* Written under the registry lock */
+};
+
+/* Attributed to the source that is currently ticking or rendering */
+inline void count_draw()
+{
+    if (auto *m = meter::current())
+        m->add_draw();
+}
+
+inline void count_bytes(size_t bytes)
+{
+    if (auto *m = meter::current())
+        m->add_bytes(bytes);
+}
+
+/* Averages of every source, sorted by their total cpu time */
+std::vector<info> collect();
+}
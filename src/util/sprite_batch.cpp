@@ -0,0 +1,157 @@
+/*************************************************************************
+ * This file is part of input-overlay
+ * github.con/univrsal/input-overlay
+ * Copyright 2022 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#include "sprite_batch.hpp"
+#include "log.h"
+#include "source_costs.hpp"
+#include <obs-module.h>
+#include <graphics/matrix4.h>
+#include <util/bmem.h>
+#include <cstring>
+
+extern "C" {
+#include <graphics/image-file.h>
+}
+
+sprite_batch *sprite_batch::m_current = nullptr;
+
+sprite_batch::~sprite_batch()
+{
+    if (m_buffer) {
+        obs_enter_graphics();
+        gs_vertexbuffer_destroy(m_buffer);
+        obs_leave_graphics();
+    }
+}
+
+bool sprite_batch::reserve(size_t vertex_count)
+{
+    if (m_buffer && vertex_count <= m_capacity)
+        return true;
+
+    if (m_buffer)
+        gs_vertexbuffer_destroy(m_buffer);
+
+    /* Grow in steps so layouts with a few more sprites don't recreate it every frame */
+    auto capacity = m_capacity ? m_capacity : 6 * 64;
+    while (capacity < vertex_count)
+        capacity *= 2;
+
+    auto *data = gs_vbdata_create();
+    data->num = capacity;
+    data->points = static_cast<vec3 *>(bzalloc(sizeof(vec3) * capacity));
+    data->num_tex = 1;
+    data->tvarray = static_cast<gs_tvertarray *>(bzalloc(sizeof(gs_tvertarray)));
+    data->tvarray[0].width = 2;
+    data->tvarray[0].array = bzalloc(sizeof(vec2) * capacity);
+
+    m_buffer = gs_vertexbuffer_create(data, GS_DYNAMIC);
+    if (!m_buffer) {
+        berr("Failed to create sprite batch vertex buffer for %zu vertices", capacity);
+        m_capacity = 0;
+        m_failed = true;
+        return false;
+    }
+    m_capacity = capacity;
+    return true;
+}
+
+void sprite_batch::begin(gs_image_file_t *image)
+{
+    m_image = image;
+    m_points.clear();
+    m_uvs.clear();
+
+    if (m_failed || !image || !image->texture || !image->cx || !image->cy)
+        return; /* Elements will draw on their own */
+
+    m_inv_cx = 1.f / image->cx;
+    m_inv_cy = 1.f / image->cy;
+    m_current = this;
+}
+
+void sprite_batch::add_vertex(float x, float y, float u, float v)
+{
+    vec3 p;
+    vec3_set(&p, x, y, 0.f);
+    m_points.emplace_back(p);
+    vec2 uv;
+    vec2_set(&uv, u, v);
+    m_uvs.emplace_back(uv);
+}
+
+void sprite_batch::add(const gs_rect *rect, const vec2 *pos, float angle)
+{
+    const auto w = float(rect->cx), h = float(rect->cy);
+    const auto u0 = rect->x * m_inv_cx, v0 = rect->y * m_inv_cy;
+    const auto u1 = (rect->x + rect->cx) * m_inv_cx, v1 = (rect->y + rect->cy) * m_inv_cy;
+
+    vec3 corners[4];
+    vec3_set(&corners[0], 0.f, 0.f, 0.f);
+    vec3_set(&corners[1], w, 0.f, 0.f);
+    vec3_set(&corners[2], 0.f, h, 0.f);
+    vec3_set(&corners[3], w, h, 0.f);
+
+    if (angle != 0.f) {
+        /* Same transformations as the rotated element_texture::draw, in the
+         * order they end up being applied to the vertices */
+        matrix4 m;
+        matrix4_identity(&m);
+        matrix4_translate3f(&m, &m, -(w / 2.f), -(h / 2.f), 0.f);
+        matrix4_rotate_aa4f(&m, &m, 0.f, 0.f, 1.f, angle);
+        matrix4_translate3f(&m, &m, -(w / 2.f), -(h / 2.f), 0.f);
+        matrix4_translate3f(&m, &m, pos->x, pos->y + h, 0.f);
+        for (auto &c : corners)
+            vec3_transform(&c, &c, &m);
+    } else {
+        for (auto &c : corners) {
+            c.x += pos->x;
+            c.y += pos->y;
+        }
+    }
+
+    /* Two triangles per sprite */
+    add_vertex(corners[0].x, corners[0].y, u0, v0);
+    add_vertex(corners[1].x, corners[1].y, u1, v0);
+    add_vertex(corners[2].x, corners[2].y, u0, v1);
+    add_vertex(corners[1].x, corners[1].y, u1, v0);
+    add_vertex(corners[3].x, corners[3].y, u1, v1);
+    add_vertex(corners[2].x, corners[2].y, u0, v1);
+}
+
+void sprite_batch::end(gs_effect_t *effect)
+{
+    if (m_current != this)
+        return;
+    m_current = nullptr;
+
+    const auto count = m_points.size();
+    if (!count || !reserve(count))
+        return;
+
+    auto *data = gs_vertexbuffer_get_data(m_buffer);
+    memcpy(data->points, m_points.data(), sizeof(vec3) * count);
+    memcpy(data->tvarray[0].array, m_uvs.data(), sizeof(vec2) * count);
+    gs_vertexbuffer_flush(m_buffer);
+
+    gs_effect_set_texture(gs_effect_get_param_by_name(effect, "image"), m_image->texture);
+    gs_load_vertexbuffer(m_buffer);
+    gs_load_indexbuffer(nullptr);
+    gs_draw(GS_TRIS, 0, uint32_t(count));
+    source_costs::count_draw();
+}
@@ -0,0 +1,61 @@
+/*************************************************************************
+ * This file is part of input-overlay
+ * github.con/univrsal/input-overlay
+ * Copyright 2022 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#pragma once
+
+#include <graphics/graphics.h>
+#include <graphics/vec2.h>
+#include <vector>
+
+typedef struct gs_image_file gs_image_file_t;
+
+/* Collects all sprites of one overlay, which all come from the same atlas
+ * texture, into one dynamic vertex buffer and draws them with a single
+ * draw call. While a batch is active element_texture::draw only adds
+ * quads to it. Only used on the graphics thread */
+class sprite_batch {
+public:
+    sprite_batch() = default;
+    ~sprite_batch();
+
+    sprite_batch(const sprite_batch &) = delete;
+    sprite_batch &operator=(const sprite_batch &) = delete;
+
+    /* The batch currently collecting sprites or nullptr */
+    static sprite_batch *current() { return m_current; }
+
+    void begin(gs_image_file_t *image);
+    void add(const gs_rect *rect, const vec2 *pos, float angle = 0.f);
+    void end(gs_effect_t *effect);
+
+private:
+    bool reserve(size_t vertex_count);
+    void add_vertex(float x, float y, float u, float v);
+
+    static sprite_batch *m_current;
+
+    gs_image_file_t *m_image = nullptr;
+    gs_vertbuffer_t *m_buffer = nullptr;
+    size_t m_capacity = 0; /* Vertex count of m_buffer */
+    bool m_failed = false; /* Couldn't create the vertex buffer, elements draw on their own */
+    float m_inv_cx = 0.f, m_inv_cy = 0.f;
+
+    /* Staging arrays, their capacity is kept between frames */
+    std::vector<vec3> m_points;
+    std::vector<vec2> m_uvs;
+};
@@ -0,0 +1,62 @@
+/*************************************************************************
+ * This file is part of input-overlay
+ * github.con/univrsal/input-overlay
+ * Copyright 2022 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <type_traits>
+
+/* Bounded lock free queue for exactly one producer and one consumer thread.
+ * Neither push nor pop ever block, push fails if the queue is full */
+template<class T, size_t N> class spsc_queue {
+    static_assert(N && (N & (N - 1)) == 0, "Capacity has to be a power of two");
+    static_assert(std::is_trivially_copyable<T>::value, "Items are copied without constructors");
+
+    /* Kept on separate cache lines so producer and consumer don't fight over them */
+    alignas(64) std::atomic<size_t> m_head{0}; /* Next item to pop, only written by the consumer */
+    alignas(64) std::atomic<size_t> m_tail{0}; /* Next free slot, only written by the producer */
+    alignas(64) T m_items[N];
+
+public:
+    static constexpr size_t capacity() { return N; }
+
+    /* Producer only */
+    bool push(const T &item)
+    {
+        const auto tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head.load(std::memory_order_acquire) == N)
+            return false;
+        m_items[tail & (N - 1)] = item;
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /* Consumer only */
+    bool pop(T &out)
+    {
+        const auto head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire))
+            return false;
+        out = m_items[head & (N - 1)];
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool empty() const { return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire); }
+};
@@ -0,0 +1,109 @@
+/*************************************************************************
+ * This file is part of input-overlay
+ * github.con/univrsal/input-overlay
+ * Copyright 2022 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#include "texture_cache.hpp"
+#include "obs_util.hpp"
+#include "log.h"
+#include <QFileInfo>
+#include <map>
+#include <mutex>
+#include <obs-module.h>
+extern "C" {
+#include <graphics/image-file.h>
+}
+
+namespace texture_cache {
+struct entry {
+    std::weak_ptr<gs_image_file_t> image;
+    bool prepared; /* False if prepare refused and this is the plain image */
+};
+
+static std::mutex cache_mutex;
+static std::map<std::string, entry> cache;
+
+static void free_image(gs_image_file_t *image)
+{
+    obs_enter_graphics();
+    gs_image_file_free(image);
+    obs_leave_graphics();
+    delete image;
+}
+
+std::shared_ptr<gs_image_file_t> acquire(const std::string &path)
+{
+    bool prepared;
+    return acquire(path, std::string(), nullptr, prepared);
+}
+
+std::shared_ptr<gs_image_file_t> acquire(const std::string &path, const std::string &variant,
+                                         const std::function<bool(gs_image_file_t *)> &prepare, bool &prepared)
+{
+    const QFileInfo info(QString::fromStdString(path));
+    auto canonical = info.canonicalFilePath();
+    if (canonical.isEmpty())
+        canonical = info.absoluteFilePath();
+    const auto key = std::string(qt_to_utf8(canonical)) + '|' + std::to_string(info.lastModified().toMSecsSinceEpoch());
+    const auto variant_key = variant.empty() ? key : key + '|' + variant;
+    prepared = false;
+
+    /* Held while decoding, so two sources loading the same image at once
+     * don't both decode it */
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    for (auto it = cache.begin(); it != cache.end();) {
+        if (it->second.image.expired())
+            it = cache.erase(it);
+        else
+            ++it;
+    }
+
+    auto it = cache.find(variant_key);
+    if (it != cache.end()) {
+        if (auto image = it->second.image.lock()) {
+            prepared = it->second.prepared;
+            return image;
+        }
+    }
+
+    std::shared_ptr<gs_image_file_t> image(new gs_image_file_t(), free_image);
+    gs_image_file_init(image.get(), path.c_str());
+
+    if (!image->loaded)
+        return nullptr;
+
+    bdebug("Decoded texture %s", path.c_str());
+    if (prepare) {
+        prepared = prepare(image.get());
+        /* Remembered either way, so the next source doesn't try again */
+        cache[variant_key] = {image, prepared};
+        if (!prepared && !cache[key].image.lock())
+            cache[key] = {image, false};
+    } else {
+        cache[key] = {image, false};
+    }
+    return image;
+}
+
+void upload(gs_image_file_t *image)
+{
+    /* Sources sharing the image all upload from the graphics thread, so
+     * there's no need to lock. init_texture frees the decoded pixels, it
+     * can't be called twice */
+    if (image && image->loaded && !image->texture)
+        gs_image_file_init_texture(image);
+}
+}
@@ -0,0 +1,45 @@
+/*************************************************************************
+ * This file is part of input-overlay
+ * github.con/univrsal/input-overlay
+ * Copyright 2022 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+
+typedef struct gs_image_file gs_image_file_t;
+
+/* Sources using the same image share one decoded copy and one GPU texture.
+ * Entries are keyed by the canonical path and modification time, so editing
+ * the image still gets picked up on the next load */
+namespace texture_cache {
+/* Decodes the image if it isn't cached yet, the GPU texture is only created
+ * by upload. Returns nullptr if the image couldn't be loaded, the last
+ * reference frees the texture */
+std::shared_ptr<gs_image_file_t> acquire(const std::string &path);
+
+/* Creates the texture of an acquired image if that hasn't happened yet.
+ * Graphics context has to be entered */
+void upload(gs_image_file_t *image);
+
+/* A changed version of the image, prepare gets the decoded image before
+ * it's uploaded. Sources asking for the same variant share it. If prepare
+ * returns false the plain image is returned and prepared is false */
+std::shared_ptr<gs_image_file_t> acquire(const std::string &path, const std::string &variant,
+                                         const std::function<bool(gs_image_file_t *)> &prepare, bool &prepared);
+}
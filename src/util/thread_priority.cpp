@@ -0,0 +1,140 @@
+/*************************************************************************
+ * This file is part of input-overlay
+ * github.con/univrsal/input-overlay
+ * Copyright 2022 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#include "thread_priority.hpp"
+#include "config.hpp"
+#include "log.h"
+
+#if _WIN32
+#include <windows.h>
+#include <avrt.h>
+#elif __linux__
+#include <algorithm>
+#include <cerrno>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+#define RT_PRIORITY 10 /* Kept low so audio servers and IRQ threads still win */
+#define HIGH_NICE -10
+#endif
+
+#if _WIN32
+static bool set_realtime(const char *name)
+{
+    /* MMCSS boosts the thread into the real-time range for as long as it
+     * runs, without needing administrator rights */
+    DWORD task_index = 0;
+    if (!AvSetMmThreadCharacteristics(TEXT("Pro Audio"), &task_index)) {
+        bwarn("Couldn't register %s thread with MMCSS (%#lX)", name, (unsigned long)GetLastError());
+        return false;
+    }
+    return true;
+}
+
+static bool set_high(const char *name)
+{
+    if (!SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL)) {
+        bwarn("Couldn't raise priority of %s thread (%#lX)", name, (unsigned long)GetLastError());
+        return false;
+    }
+    return true;
+}
+
+static void set_affinity(uint32_t mask, const char *name)
+{
+    if (!SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(mask)))
+        bwarn("Couldn't set CPU affinity of %s thread to %#x", name, mask);
+}
+#elif __linux__
+static bool set_realtime(const char *name)
+{
+    /* Unprivileged users can only go as high as RLIMIT_RTPRIO allows,
+     * which is usually set for the audio or realtime group */
+    int priority = RT_PRIORITY;
+    rlimit limit{};
+    if (getrlimit(RLIMIT_RTPRIO, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY && geteuid() != 0)
+        priority = std::min<int>(priority, int(limit.rlim_cur));
+    if (priority < sched_get_priority_min(SCHED_RR)) {
+        bwarn("RLIMIT_RTPRIO doesn't allow real-time scheduling for %s thread", name);
+        return false;
+    }
+
+    /* Reset on fork so anything we spawn doesn't inherit it */
+    sched_param param{};
+    param.sched_priority = priority;
+    if (sched_setscheduler(0, SCHED_RR | SCHED_RESET_ON_FORK, &param) != 0) {
+        bwarn("Couldn't give %s thread real-time priority %i", name, priority);
+        return false;
+    }
+    return true;
+}
+
+static bool set_high(const char *name)
+{
+    /* The nice value is per thread on Linux */
+    if (setpriority(PRIO_PROCESS, id_t(syscall(SYS_gettid)), HIGH_NICE) != 0) {
+        /* Expected for normal users unless RLIMIT_NICE was raised, so it isn't worth a warning for every thread */
+        if (errno == EPERM || errno == EACCES)
+            bdebug("Not allowed to lower nice value of %s thread to %i, RLIMIT_NICE is too low", name, HIGH_NICE);
+        else
+            bwarn("Couldn't lower nice value of %s thread to %i", name, HIGH_NICE);
+        return false;
+    }
+    return true;
+}
+
+static void set_affinity(uint32_t mask, const char *name)
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int i = 0; i < 32; i++) {
+        if (mask & (1u << i))
+            CPU_SET(i, &set);
+    }
+    if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0)
+        bwarn("Couldn't set CPU affinity of %s thread to %#x", name, mask);
+}
+#else
+static bool set_realtime(const char *)
+{
+    return false;
+}
+
+static bool set_high(const char *)
+{
+    return false;
+}
+
+static void set_affinity(uint32_t, const char *) {}
+#endif
+
+void util_set_thread_priority(thread_role role, const char *name)
+{
+    const auto priority = role == THREAD_INPUT ? io_config::input_thread_priority : io_config::network_thread_priority;
+
+    if (priority >= PRIORITY_REALTIME && set_realtime(name))
+        bdebug("Running %s thread with real-time priority", name);
+    else if (priority >= PRIORITY_HIGH && set_high(name))
+        bdebug("Running %s thread with high priority", name);
+
+    if (io_config::thread_affinity)
+        set_affinity(io_config::thread_affinity, name);
+}
@@ -0,0 +1,31 @@
+/*************************************************************************
+ * This file is part of input-overlay
+ * github.con/univrsal/input-overlay
+ * Copyright 2022 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#pragma once
+
+/* Threads that capture input get the configured input priority, the ones
+ * that only send it on get the network priority */
+enum thread_role { THREAD_INPUT, THREAD_NETWORK };
+
+/* Values of io_config::input_thread_priority and network_thread_priority */
+enum thread_priority { PRIORITY_NORMAL, PRIORITY_HIGH, PRIORITY_REALTIME };
+
+/* Applies the configured priority and CPU affinity to the calling thread,
+ * the name is only used for logging. Falls back to the next lower priority
+ * if the system doesn't allow the requested one */
+void util_set_thread_priority(thread_role role, const char *name);
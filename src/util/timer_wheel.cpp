@@ -0,0 +1,261 @@
+/*************************************************************************
+ * This file is part of input-overlay
+ * github.con/univrsal/input-overlay
+ * Copyright 2022 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#include "timer_wheel.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <util/platform.h>
+#include <util/threading.h>
+
+namespace timers {
+static std::mutex mutex;
+static std::mutex fire_mutex; /* Held while callbacks run, so cancel can wait for them */
+static std::condition_variable wakeup;
+static size_t pending = 0;
+static uint64_t current_tick = 0; /* Every bucket up to this tick was handled */
+static uint64_t wake_time = UINT64_MAX;
+static std::thread thread;
+static bool running = false;
+
+static size_t bucket_of(uint64_t tick)
+{
+    return size_t(tick & (WHEEL_SLOTS - 1));
+}
+
+/* Everything but move_later needs the mutex */
+struct wheel {
+    static timer *buckets[WHEEL_SLOTS];
+
+    static void link(timer &t, uint64_t deadline)
+    {
+        /* Anything due before the current tick goes into the next bucket */
+        const auto tick = std::max(deadline / WHEEL_TICK + 1, current_tick + 1);
+        t.m_slot = bucket_of(tick);
+        auto &head = buckets[t.m_slot];
+        t.m_prev = nullptr;
+        t.m_next = head;
+        if (head)
+            head->m_prev = &t;
+        head = &t;
+        if (tick * WHEEL_TICK < wake_time) {
+            wake_time = tick * WHEEL_TICK;
+            wakeup.notify_one();
+        }
+    }
+
+    static void unlink(timer &t)
+    {
+        if (t.m_prev)
+            t.m_prev->m_next = t.m_next;
+        else
+            buckets[t.m_slot] = t.m_next;
+        if (t.m_next)
+            t.m_next->m_prev = t.m_prev;
+        t.m_prev = t.m_next = nullptr;
+    }
+
+    /* Moves the deadline of a pending timer, which works without the mutex
+     * since collect puts it into its new bucket when the old one is due.
+     * False if t isn't pending or deadline is earlier, so it has to be
+     * linked again. Zero deadlines are only changed with the mutex locked */
+    static bool move_later(timer &t, uint64_t deadline)
+    {
+        auto current = t.m_deadline.load(std::memory_order_acquire);
+        while (current && current <= deadline && !t.m_deadline.compare_exchange_weak(current, deadline))
+            ;
+        return current && current <= deadline;
+    }
+
+    static void add(timer &t, uint64_t deadline)
+    {
+        t.m_deadline.store(deadline, std::memory_order_release);
+        link(t, deadline);
+        pending++;
+    }
+
+    static void remove(timer &t)
+    {
+        if (t.m_deadline.exchange(0)) {
+            unlink(t);
+            pending--;
+        }
+    }
+
+    /* Takes everything that is due out of the buckets between the last and
+     * the current tick. Timers whose deadline was moved go into their new
+     * bucket */
+    static void collect(uint64_t now, std::vector<timer *> &due)
+    {
+        const auto now_tick = now / WHEEL_TICK;
+        /* After a long sleep every bucket only has to be visited once */
+        const auto first = std::max(current_tick + 1, now_tick >= WHEEL_SLOTS ? now_tick - WHEEL_SLOTS + 1 : 0);
+        current_tick = std::max(current_tick, now_tick);
+
+        for (auto tick = first; tick <= now_tick; tick++) {
+            for (auto *t = buckets[bucket_of(tick)]; t;) {
+                auto *next = t->m_next;
+                auto deadline = t->m_deadline.load(std::memory_order_acquire);
+                /* Flagged first, so a destructor that sees no deadline sees the flag */
+                t->m_firing.store(true);
+                /* Zero marks it as fired, unless arm moved it in the meantime */
+                while (deadline <= now && !t->m_deadline.compare_exchange_weak(deadline, 0))
+                    ;
+                if (deadline > now)
+                    t->m_firing.store(false);
+                if (deadline <= now) {
+                    unlink(*t);
+                    pending--;
+                    due.push_back(t);
+                } else if (deadline / WHEEL_TICK + 1 != tick) {
+                    unlink(*t);
+                    link(*t, deadline); /* Moved or in a later round of the wheel */
+                }
+                t = next;
+            }
+        }
+    }
+
+    /* Deadline of the nearest occupied bucket */
+    static uint64_t next_deadline()
+    {
+        if (!pending)
+            return UINT64_MAX;
+        for (uint64_t tick = current_tick + 1; tick <= current_tick + WHEEL_SLOTS; tick++) {
+            if (buckets[bucket_of(tick)])
+                return tick * WHEEL_TICK;
+        }
+        return UINT64_MAX;
+    }
+
+    static void clear()
+    {
+        for (auto &head : buckets) {
+            while (head) {
+                auto *t = head;
+                head = t->m_next;
+                t->m_prev = t->m_next = nullptr;
+                t->m_deadline = 0;
+            }
+        }
+        pending = 0;
+    }
+
+    /* Runs with the fire mutex held, so the timer can't be destroyed before the flag is cleared */
+    static void fire(timer *t)
+    {
+        t->m_fire(t->m_owner);
+        t->m_firing.store(false);
+    }
+};
+
+timer *wheel::buckets[WHEEL_SLOTS]{};
+
+timer::~timer()
+{
+    /* Timers that are neither pending nor firing don't need the wheel, which
+     * might already be gone at exit. Same order as collect, in reverse */
+    if (m_deadline.load() || m_firing.load())
+        cancel(*this);
+}
+
+static void thread_method()
+{
+    os_set_thread_name("inputovrly-timers");
+    std::vector<timer *> due;
+    due.reserve(16);
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (running) {
+        wake_time = wheel::next_deadline();
+        if (wake_time == UINT64_MAX) {
+            wakeup.wait(lock);
+        } else {
+            const auto now = os_gettime_ns();
+            if (wake_time > now)
+                wakeup.wait_for(lock, std::chrono::nanoseconds(wake_time - now));
+        }
+        if (!running)
+            break;
+
+        wheel::collect(os_gettime_ns(), due);
+        if (due.empty())
+            continue;
+
+        /* The fire mutex is taken before the timer mutex is released, so a
+         * cancel that comes in now waits for the callbacks */
+        {
+            std::lock_guard<std::mutex> fire_lock(fire_mutex);
+            lock.unlock();
+            for (auto *t : due)
+                wheel::fire(t);
+        }
+        due.clear();
+        lock.lock();
+    }
+}
+
+void start()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (running)
+        return;
+    running = true;
+    current_tick = os_gettime_ns() / WHEEL_TICK;
+    thread = std::thread(thread_method);
+}
+
+void stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!running)
+            return;
+        running = false;
+        wheel::clear();
+    }
+    wakeup.notify_one();
+    if (thread.joinable())
+        thread.join();
+}
+
+void arm(timer &t, uint64_t delay)
+{
+    const auto deadline = os_gettime_ns() + delay;
+    /* Scrolling re-arms the same timer for every event, that doesn't need the lock */
+    if (wheel::move_later(t, deadline))
+        return;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!running)
+        return;
+    wheel::remove(t);
+    wheel::add(t, deadline);
+}
+
+void cancel(timer &t)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        wheel::remove(t);
+    }
+    std::lock_guard<std::mutex> fire_lock(fire_mutex);
+}
+}
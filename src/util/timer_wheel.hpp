@@ -0,0 +1,70 @@
+/*************************************************************************
+ * This file is part of input-overlay
+ * github.con/univrsal/input-overlay
+ * Copyright 2022 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/* Deadlines for state that times out on its own, like the scroll wheel
+ * going back to idle. Every owner keeps a fixed timer per thing that times
+ * out and the wheel links them into WHEEL_SLOTS buckets of WHEEL_TICK ns by
+ * their deadline, so arming and cancelling are constant time and never
+ * allocate. Re-arming a pending timer only moves its deadline, which is one
+ * atomic store, the wheel moves it to its new bucket once the old one is
+ * due. The timer thread only wakes up for the next occupied bucket and
+ * sleeps while nothing is armed */
+#define WHEEL_TICK 10000000 /* 10ms */
+#define WHEEL_SLOTS 256
+
+namespace timers {
+typedef void (*callback)(void *owner);
+
+class timer {
+    friend struct wheel;
+
+    const callback m_fire;
+    void *const m_owner;
+    std::atomic<uint64_t> m_deadline{0}; /* os_gettime_ns(), zero if not pending */
+    std::atomic<bool> m_firing{false};   /* Set before the deadline drops to zero, until the callback returned */
+    /* Guarded by the wheel */
+    timer *m_prev = nullptr, *m_next = nullptr;
+    size_t m_slot = 0; /* Bucket it's linked into */
+
+public:
+    timer(callback fire, void *owner) : m_fire(fire), m_owner(owner) {}
+    /* Cancels the timer if it's still pending and waits for the callback if it's running */
+    ~timer();
+
+    timer(const timer &) = delete;
+    timer &operator=(const timer &) = delete;
+};
+
+void start();
+
+/* Pending timers are dropped without firing */
+void stop();
+
+/* Fires the callback on the timer thread once delay ns passed. Arming a
+ * timer that is already pending moves its deadline */
+void arm(timer &t, uint64_t delay);
+
+/* Once this returns the callback is neither pending nor running, so the
+ * owner can be destroyed. Must not be called from a callback */
+void cancel(timer &t);
+}
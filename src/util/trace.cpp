@@ -0,0 +1,151 @@
+/*************************************************************************
+ * This file is part of input-overlay
+ * github.con/univrsal/input-overlay
+ * Copyright 2022 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#include "trace.hpp"
+#ifdef IO_TRACING
+#include "json_writer.hpp"
+#include "log.h"
+#include "obs_util.hpp"
+#include <QDateTime>
+#include <QFile>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <util/platform.h>
+
+namespace trace {
+struct event {
+    const char *name;
+    uint64_t start, end;
+    kind k;
+};
+
+/* The lock is only contended while the trace is written */
+struct thread_buffer {
+    std::mutex mutex;
+    uint32_t id = 0;
+    std::string name;
+    std::vector<event> events;
+    uint64_t dropped = 0;
+};
+
+static std::atomic<bool> recording{false};
+static uint64_t start_time = 0;
+static std::mutex buffers_mutex;
+static std::vector<std::unique_ptr<thread_buffer>> buffers; /* Kept after their threads exit */
+
+static thread_buffer *local_buffer()
+{
+    static thread_local thread_buffer *local = nullptr;
+    if (!local) {
+        std::lock_guard<std::mutex> lock(buffers_mutex);
+        buffers.emplace_back(std::make_unique<thread_buffer>());
+        local = buffers.back().get();
+        local->id = uint32_t(buffers.size());
+        local->name = "thread " + std::to_string(local->id);
+    }
+    return local;
+}
+
+uint64_t now()
+{
+    return os_gettime_ns();
+}
+
+void add(const char *name, kind k, uint64_t start, uint64_t end)
+{
+    if (!recording.load(std::memory_order_relaxed))
+        return;
+    auto *buffer = local_buffer();
+    std::lock_guard<std::mutex> lock(buffer->mutex);
+    if (buffer->events.size() < TRACE_MAX_EVENTS)
+        buffer->events.push_back({name, start, end, k});
+    else
+        buffer->dropped++;
+}
+
+void name_thread(const char *name)
+{
+    auto *buffer = local_buffer();
+    std::lock_guard<std::mutex> lock(buffer->mutex);
+    buffer->name = name;
+}
+
+void start()
+{
+    start_time = now();
+    recording = true;
+    binfo("Tracing is compiled in, a trace will be written when the plugin is unloaded");
+}
+
+void stop()
+{
+    if (!recording.exchange(false))
+        return;
+
+    std::string out;
+    json_writer json(out);
+    json.field("displayTimeUnit", "ns");
+    json.begin_array("traceEvents");
+    size_t count = 0;
+    uint64_t dropped = 0;
+
+    std::lock_guard<std::mutex> lock(buffers_mutex);
+    for (const auto &buffer : buffers) {
+        std::lock_guard<std::mutex> buffer_lock(buffer->mutex);
+        json.begin_object()
+            .field("name", "thread_name")
+            .field("ph", "M")
+            .field("pid", 1)
+            .field("tid", int64_t(buffer->id));
+        json.begin_object("args").field("name", buffer->name).end_object().end_object();
+
+        for (const auto &e : buffer->events) {
+            /* Only the waits that actually blocked are interesting, skip the rest to keep the trace small */
+            if (e.start < start_time || (e.k == KIND_WAIT && e.end - e.start < 1000))
+                continue;
+            json.begin_object()
+                .field("name", e.name)
+                .field("cat", e.k == KIND_ZONE ? "zone" : e.k == KIND_WAIT ? "lock wait" : "lock hold")
+                .field("ph", "X")
+                .field("pid", 1)
+                .field("tid", int64_t(buffer->id))
+                .field("ts", (e.start - start_time) / 1000.0, 3)
+                .field("dur", (e.end - e.start) / 1000.0, 3)
+                .end_object();
+            count++;
+        }
+        dropped += buffer->dropped;
+        buffer->events.clear();
+        buffer->events.shrink_to_fit();
+    }
+    json.end_array();
+    json.end();
+
+    const auto path = util_get_data_file(
+        QString("trace-%1.json").arg(QDateTime::currentDateTime().toString("yyyy-MM-dd_hh-mm-ss")));
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly) || file.write(out.data(), qint64(out.size())) != qint64(out.size())) {
+        berr("Couldn't write trace to %s", qt_to_utf8(path));
+        return;
+    }
+    binfo("Wrote %zu trace events to %s, %llu were dropped", count, qt_to_utf8(path), (unsigned long long)dropped);
+}
+}
+#endif
@@ -0,0 +1,104 @@
+/*************************************************************************
+ * This file is part of input-overlay
+ * github.con/univrsal/input-overlay
+ * Copyright 2022 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#pragma once
+#include <mutex>
+
+/* Timeline of what the threads do and how long they wait for each other,
+ * only built with -DENABLE_TRACING=ON. Zones and every wait for and hold of
+ * a traced_mutex are kept in per thread buffers and written to a trace file
+ * in the Chrome trace event format when the plugin is unloaded. Perfetto
+ * opens it directly, Tracy through its import-chrome tool.
+ * Without IO_TRACING, traced_mutex is a plain std::mutex and the macros are
+ * empty */
+#ifdef IO_TRACING
+#include <cstdint>
+
+#define TRACE_MAX_EVENTS (1 << 20) /* Per thread, later events are counted as dropped */
+
+namespace trace {
+enum kind : uint8_t { KIND_ZONE, KIND_WAIT, KIND_HOLD };
+
+/* name has to be a string literal, only the pointer is kept */
+void add(const char *name, kind k, uint64_t start, uint64_t end);
+void name_thread(const char *name);
+uint64_t now();
+
+void start();
+/* Writes the trace and stops recording */
+void stop();
+
+class zone {
+    const char *m_name;
+    uint64_t m_start;
+
+public:
+    explicit zone(const char *name) : m_name(name), m_start(now()) {}
+    ~zone() { add(m_name, KIND_ZONE, m_start, now()); }
+};
+}
+
+class traced_mutex {
+    std::mutex m_mutex;
+    const char *m_name;
+    uint64_t m_acquired = 0; /* Only used by the thread holding it */
+
+public:
+    explicit traced_mutex(const char *name) : m_name(name) {}
+
+    void lock()
+    {
+        const auto start = trace::now();
+        m_mutex.lock();
+        m_acquired = trace::now();
+        trace::add(m_name, trace::KIND_WAIT, start, m_acquired);
+    }
+
+    bool try_lock()
+    {
+        if (!m_mutex.try_lock())
+            return false;
+        m_acquired = trace::now();
+        return true;
+    }
+
+    void unlock()
+    {
+        const auto acquired = m_acquired;
+        m_mutex.unlock();
+        trace::add(m_name, trace::KIND_HOLD, acquired, trace::now());
+    }
+};
+
+#define IO_TRACE_CAT_(a, b) a##b
+#define IO_TRACE_CAT(a, b) IO_TRACE_CAT_(a, b)
+#define IO_TRACE_ZONE(name) trace::zone IO_TRACE_CAT(trace_zone_, __LINE__)(name)
+#define IO_TRACE_THREAD(name) trace::name_thread(name)
+#define IO_TRACED_MUTEX(var, name) traced_mutex var{name}
+#else
+namespace trace {
+inline void start() {}
+inline void stop() {}
+}
+
+typedef std::mutex traced_mutex;
+
+#define IO_TRACE_ZONE(name)
+#define IO_TRACE_THREAD(name)
+#define IO_TRACED_MUTEX(var, name) std::mutex var
+#endif
@@ -7,9 +7,26 @@
 
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <vector>
 
+/* Foreground window refresh when the watcher can't get change notifications */
+#define WINDOW_TITLE_POLL 250
+
 void GetWindowList(std::vector<std::string> &windows);
 
 void GetCurrentWindowTitle(std::string &title);
+
+/* Tracks the foreground window and its title on a separate thread, driven
+ * by focus change events, so filter checks don't have to query the window
+ * system every frame. Starting it again does nothing */
+void StartWindowWatcher();
+
+void StopWindowWatcher();
+
+/* Increased whenever the foreground window or its title changes, zero while
+ * the watcher isn't running */
+uint64_t GetWindowTitleVersion();
+
+void GetWatchedWindowTitle(std::string &title);
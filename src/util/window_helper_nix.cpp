@@ -10,6 +10,11 @@
 #include <X11/Xlib.h>
 #include <X11/Xutil.h>
 #include <util/platform.h>
+#include <util/threading.h>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <poll.h>
 
 #undef Bool
 #undef CursorShape
@@ -44,9 +49,8 @@ void cleanupDisplay()
     xdisplay = nullptr;
 }
 
-static bool ewmhIsSupported()
+static bool ewmhIsSupported(Display *display = disp())
 {
-    Display *display = disp();
     Atom netSupportingWmCheck = XInternAtom(display, "_NET_SUPPORTING_WM_CHECK", true);
     Atom actualType;
     int format = 0;
@@ -116,11 +120,10 @@ static std::vector<Window> getTopLevelWindows()
     return res;
 }
 
-static std::string GetWindowTitle(size_t i)
+static std::string GetWindowTitle(Window w)
 {
-    Window w = getTopLevelWindows().at(i);
     std::string windowTitle;
-    char *name;
+    char *name = nullptr;
 
     int status = XFetchName(disp(), w, &name);
     if (status >= Success && name != nullptr) {
@@ -128,7 +131,8 @@ static std::string GetWindowTitle(size_t i)
         windowTitle = str;
     }
 
-    XFree(name);
+    if (name)
+        XFree(name);
 
     return windowTitle;
 }
@@ -137,31 +141,42 @@ void GetWindowList(vector<string> &windows)
 {
     windows.resize(0);
 
-    for (size_t i = 0; i < getTopLevelWindows().size(); ++i) {
-        if (!GetWindowTitle(i).empty())
-            windows.emplace_back(GetWindowTitle(i));
+    /* The client list is only fetched once, after that it's a single
+     * request per window */
+    const auto topLevelWindows = getTopLevelWindows();
+    windows.reserve(topLevelWindows.size());
+    for (const auto window : topLevelWindows) {
+        auto title = GetWindowTitle(window);
+        if (!title.empty())
+            windows.emplace_back(std::move(title));
     }
 }
 
-void GetCurrentWindowTitle(string &title)
+static void GetCurrentWindowTitle(Display *display, string &title)
 {
-    if (!ewmhIsSupported()) {
+    if (!ewmhIsSupported(display)) {
         return;
     }
 
-    Atom active = XInternAtom(disp(), "_NET_ACTIVE_WINDOW", true);
+    Atom active = XInternAtom(display, "_NET_ACTIVE_WINDOW", true);
     Atom actualType;
     int format;
-    unsigned long num, bytes;
+    unsigned long num = 0, bytes;
     Window *data = 0;
-    char *name;
+    char *name = nullptr;
 
-    Window rootWin = RootWindow(disp(), 0);
+    Window rootWin = RootWindow(display, 0);
 
-    XGetWindowProperty(disp(), rootWin, active, 0L, ~0L, false, AnyPropertyType, &actualType, &format, &num, &bytes,
-                       (uint8_t **)&data);
+    int status = XGetWindowProperty(display, rootWin, active, 0L, ~0L, false, AnyPropertyType, &actualType, &format,
+                                    &num, &bytes, (uint8_t **)&data);
+    if (status != Success || num == 0 || !data[0]) {
+        if (data)
+            XFree(data);
+        title.clear();
+        return;
+    }
 
-    int status = XFetchName(disp(), data[0], &name);
+    status = XFetchName(display, data[0], &name);
 
     if (status >= Success && name != nullptr) {
         std::string str(name);
@@ -169,4 +184,83 @@ void GetCurrentWindowTitle(string &title)
     }
 
     XFree(name);
+    XFree(data);
+}
+
+void GetCurrentWindowTitle(string &title)
+{
+    GetCurrentWindowTitle(disp(), title);
+}
+
+static std::thread watcher_thread;
+static std::atomic<bool> watcher_flag{false};
+static std::mutex watched_mutex;
+static std::string watched_title;
+static std::atomic<uint64_t> watched_version{0};
+
+static void UpdateWatchedTitle(Display *display)
+{
+    std::string title;
+    GetCurrentWindowTitle(display, title);
+    std::lock_guard<std::mutex> lock(watched_mutex);
+    if (watched_version && title == watched_title)
+        return;
+    watched_title = std::move(title);
+    watched_version.fetch_add(1, std::memory_order_release);
+}
+
+/* Has its own display connection, Xlib connections can't be shared between
+ * threads without XInitThreads. _NET_ACTIVE_WINDOW changes on the root
+ * window wake it up, title changes of the focused window are picked up by
+ * re-reading it every WINDOW_TITLE_POLL ms */
+static void WatcherMethod()
+{
+    os_set_thread_name("inputovrly-window-watcher");
+    Display *display = XOpenDisplay(nullptr);
+    if (!display)
+        return; /* The version stays at zero, so titles are queried directly */
+
+    XSelectInput(display, DefaultRootWindow(display), PropertyChangeMask);
+    XFlush(display);
+    UpdateWatchedTitle(display);
+
+    pollfd fd{ConnectionNumber(display), POLLIN, 0};
+    while (watcher_flag) {
+        poll(&fd, 1, WINDOW_TITLE_POLL);
+        /* Any root property change triggers a check, comparing the title
+         * filters out everything that isn't _NET_ACTIVE_WINDOW */
+        while (XPending(display)) {
+            XEvent event;
+            XNextEvent(display, &event);
+        }
+        UpdateWatchedTitle(display);
+    }
+
+    XCloseDisplay(display);
+    watched_version = 0;
+}
+
+void StartWindowWatcher()
+{
+    if (watcher_flag.exchange(true))
+        return;
+    watcher_thread = std::thread(WatcherMethod);
+}
+
+void StopWindowWatcher()
+{
+    watcher_flag = false;
+    if (watcher_thread.joinable())
+        watcher_thread.join();
+}
+
+uint64_t GetWindowTitleVersion()
+{
+    return watched_version.load(std::memory_order_acquire);
+}
+
+void GetWatchedWindowTitle(string &title)
+{
+    std::lock_guard<std::mutex> lock(watched_mutex);
+    title = watched_title;
 }
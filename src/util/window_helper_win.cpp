@@ -7,7 +7,12 @@
 
 #include "window_helper.hpp"
 #include <util/platform.h>
+#include <util/threading.h>
 #include <windows.h>
+#include <atomic>
+#include <future>
+#include <mutex>
+#include <thread>
 
 using namespace std;
 
@@ -74,3 +79,87 @@ void GetCurrentWindowTitle(string &title)
     }
     GetWindowTitle(window, title);
 }
+
+static std::thread watcher_thread;
+static DWORD watcher_thread_id = 0;
+static std::atomic<bool> watcher_flag{false};
+static std::mutex watched_mutex;
+static std::string watched_title;
+static std::atomic<uint64_t> watched_version{0};
+
+static void UpdateWatchedTitle()
+{
+    string title;
+    GetCurrentWindowTitle(title);
+    std::lock_guard<std::mutex> lock(watched_mutex);
+    if (watched_version && title == watched_title)
+        return;
+    watched_title = std::move(title);
+    watched_version.fetch_add(1, std::memory_order_release);
+}
+
+static void CALLBACK WinEventProc(HWINEVENTHOOK, DWORD event, HWND window, LONG object, LONG, DWORD, DWORD)
+{
+    /* Name changes are sent for every object of every window */
+    if (event == EVENT_OBJECT_NAMECHANGE && (object != OBJID_WINDOW || window != GetForegroundWindow()))
+        return;
+    UpdateWatchedTitle();
+}
+
+/* Out of context hooks are delivered through this thread's message loop */
+static void WatcherMethod(std::promise<void> *ready)
+{
+    os_set_thread_name("inputovrly-window-watcher");
+    MSG msg;
+    PeekMessage(&msg, nullptr, WM_USER, WM_USER, PM_NOREMOVE); /* Creates the message queue */
+    watcher_thread_id = GetCurrentThreadId();
+
+    HWINEVENTHOOK foreground = SetWinEventHook(EVENT_SYSTEM_FOREGROUND, EVENT_SYSTEM_FOREGROUND, nullptr,
+                                               WinEventProc, 0, 0, WINEVENT_OUTOFCONTEXT);
+    HWINEVENTHOOK name = SetWinEventHook(EVENT_OBJECT_NAMECHANGE, EVENT_OBJECT_NAMECHANGE, nullptr, WinEventProc, 0,
+                                         0, WINEVENT_OUTOFCONTEXT);
+    if (foreground)
+        UpdateWatchedTitle();
+    ready->set_value();
+
+    while (GetMessage(&msg, nullptr, 0, 0) > 0) {
+        TranslateMessage(&msg);
+        DispatchMessage(&msg);
+    }
+
+    if (name)
+        UnhookWinEvent(name);
+    if (foreground)
+        UnhookWinEvent(foreground);
+    watched_version = 0;
+}
+
+void StartWindowWatcher()
+{
+    if (watcher_flag.exchange(true))
+        return;
+    std::promise<void> ready;
+    auto started = ready.get_future();
+    watcher_thread = std::thread(WatcherMethod, &ready);
+    started.wait();
+}
+
+void StopWindowWatcher()
+{
+    if (!watcher_flag.exchange(false))
+        return;
+    PostThreadMessage(watcher_thread_id, WM_QUIT, 0, 0);
+    if (watcher_thread.joinable())
+        watcher_thread.join();
+}
+
+uint64_t GetWindowTitleVersion()
+{
+    return watched_version.load(std::memory_order_acquire);
+}
+
+void GetWatchedWindowTitle(string &title)
+{
+    std::lock_guard<std::mutex> lock(watched_mutex);
+    title = watched_title;
+}
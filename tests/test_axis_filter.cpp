@@ -0,0 +1,98 @@
+/*************************************************************************
+ * This file is part of input-overlay
+ * github.con/univrsal/input-overlay
+ * Copyright 2022 univrsal <uni@vrsal.xyz>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#include <axis_filter.hpp>
+#include <cstdio>
+
+static int failures = 0;
+
+#define CHECK(expr)                                                           \
+    do {                                                                      \
+        if (!(expr)) {                                                        \
+            fprintf(stderr, "%s:%i: %s failed\n", __FILE__, __LINE__, #expr); \
+            failures++;                                                       \
+        }                                                                     \
+    } while (0)
+
+/* Sticks are 0 to 1 with the centre at 0.5 */
+static void stick_ends()
+{
+    axis_filter filter(0.1f, 0.05f);
+    CHECK(filter.pass(0, 0, 0.5f, true));
+    /* Full left/up is 0, it must not be snapped to the centre */
+    CHECK(filter.pass(0, 0, 0.f, true));
+    CHECK(filter.pass(0, 0, 1.f, true));
+    CHECK(!filter.pass(0, 0, 0.99f, true));
+    /* Full deflection always passes, even right next to the last value */
+    CHECK(filter.pass(0, 0, 0.5f, true));
+    CHECK(filter.pass(0, 0, 0.98f, true));
+    CHECK(filter.pass(0, 0, 1.f, true));
+    CHECK(filter.pass(0, 0, 0.02f, true));
+    CHECK(filter.pass(0, 0, 0.f, true));
+}
+
+static void stick_return_to_centre()
+{
+    axis_filter filter(0.1f, 0.05f);
+    CHECK(filter.pass(0, 1, 0.5f, true));
+    CHECK(filter.pass(0, 1, 0.55f, true));  /* 0.1 from the centre, outside of the deadband */
+    CHECK(!filter.pass(0, 1, 0.56f, true)); /* Less than a step */
+    /* Back into the deadband is the centre, which always passes */
+    CHECK(filter.pass(0, 1, 0.52f, true));
+    CHECK(!filter.pass(0, 1, 0.5f, true)); /* Already there */
+    CHECK(!filter.pass(0, 1, 0.48f, true));
+}
+
+static void stick_noise()
+{
+    axis_filter filter(0.1f, 0.05f);
+    CHECK(filter.pass(0, 2, 0.8f, true));
+    CHECK(!filter.pass(0, 2, 0.81f, true));
+    CHECK(!filter.pass(0, 2, 0.79f, true));
+    CHECK(filter.pass(0, 2, 0.83f, true));
+}
+
+/* Triggers are 0 to 1 with the centre at 0 */
+static void trigger_ends()
+{
+    axis_filter filter(0.1f, 0.05f);
+    CHECK(filter.pass(0, 3, 0.f, false));
+    CHECK(!filter.pass(0, 3, 0.05f, false)); /* Deadband */
+    CHECK(filter.pass(0, 3, 0.5f, false));
+    CHECK(filter.pass(0, 3, 1.f, false));
+    CHECK(filter.pass(0, 3, 0.02f, false)); /* Released */
+}
+
+static void disabled()
+{
+    axis_filter filter(0.f, 0.f);
+    CHECK(filter.pass(0, 0, 0.5f, true));
+    CHECK(filter.pass(0, 0, 0.5f, true));
+}
+
+int main()
+{
+    stick_ends();
+    stick_return_to_centre();
+    stick_noise();
+    trigger_ends();
+    disabled();
+    if (failures)
+        fprintf(stderr, "%i checks failed\n", failures);
+    return failures ? 1 : 0;
+}